@@ -21,16 +21,19 @@
 #define EIGEN_USE_THREADS
 
 #include "tfrt/dtype/dtype.h"
+#include "tfrt/support/bf16.h"
 #include "tfrt/support/fp16.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
 
 namespace tfrt {
 
 template <DType K>
-using EigenTypeForDTypeKind =
-    std::conditional_t<std::is_same<fp16, TypeForDTypeKind<K>>::value,
-                       Eigen::half, TypeForDTypeKind<K>>;
+using EigenTypeForDTypeKind = std::conditional_t<
+    std::is_same<fp16, TypeForDTypeKind<K>>::value, Eigen::half,
+    std::conditional_t<std::is_same<bf16, TypeForDTypeKind<K>>::value,
+                       Eigen::bfloat16, TypeForDTypeKind<K>>>;
 TFRT_REGISTER_DTYPE(Eigen::half, F16)
+TFRT_REGISTER_DTYPE(Eigen::bfloat16, BF16)
 }  // namespace tfrt
 
 namespace llvm {
@@ -26,12 +26,19 @@
 #include <type_traits>
 
 #include "./thread_pool_device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 namespace compat {
 
 // AsyncEigenEvaluator use the thread pool to do the eigen operation.
+//
+// If constructed from the ExecutionContext, expressions without dependencies
+// are evaluated with ParallelFor using the expression cost to choose block
+// sizes (see ParallelAssign), otherwise with the Eigen ThreadPoolDevice.
 class AsyncEigenEvaluator {
  public:
   using DependencyToken = AsyncValueRef<Chain>;
@@ -39,6 +46,11 @@ class AsyncEigenEvaluator {
   explicit AsyncEigenEvaluator(HostContext* host)
       : ctx_(host->GetOrCreateSharedContext<compat::EigenHostContext>()) {}
 
+  explicit AsyncEigenEvaluator(const ExecutionContext& exec_ctx)
+      : ctx_(exec_ctx.host()
+                 ->GetOrCreateSharedContext<compat::EigenHostContext>()),
+        exec_ctx_(exec_ctx) {}
+
   template <typename... DenseHostTensors>
   auto KeepAlive(DenseHostTensors&&... tensors)
       -> std::array<RCReference<HostBuffer>, sizeof...(DenseHostTensors)> {
@@ -49,6 +61,9 @@ class AsyncEigenEvaluator {
       typename Output, typename Expr, typename DoneCallback,
       typename = std::enable_if_t<internal::is_invocable<DoneCallback>::value>>
   void Evaluate(Output out, Expr expr, DoneCallback done) {
+    if (exec_ctx_)
+      return ParallelAssign(*exec_ctx_, std::move(out), std::move(expr),
+                            std::move(done));
     return AsyncAssign(ctx_, std::move(out), std::move(expr), std::move(done));
   }
 
@@ -57,6 +72,9 @@ class AsyncEigenEvaluator {
                 !internal::is_invocable<ArgLifetimeExtension>::value>>
   AsyncValueRef<Chain> Evaluate(Output out, Expr expr,
                                 ArgLifetimeExtension args) {
+    if (exec_ctx_)
+      return ParallelAssign(*exec_ctx_, std::move(out), std::move(expr),
+                            std::move(args));
     return AsyncAssign(ctx_, std::move(out), std::move(expr), std::move(args));
   }
 
@@ -69,6 +87,19 @@ class AsyncEigenEvaluator {
                        std::move(args));
   }
 
+  // Calls `compute` for the blocks of the [0, total_size) range in parallel.
+  // Requires the evaluator to be constructed from the ExecutionContext.
+  template <typename Compute, typename ArgLifetimeExtension>
+  AsyncValueRef<Chain> ParallelExecute(
+      size_t total_size, const ParallelFor::BlockSizes& block_sizes,
+      Compute compute, ArgLifetimeExtension args) {
+    assert(exec_ctx_ && "ParallelExecute requires an execution context");
+    return ParallelFor(*exec_ctx_).Execute(
+        total_size, block_sizes,
+        [compute = std::move(compute), args = std::move(args)](
+            size_t begin, size_t end) { compute(begin, end); });
+  }
+
   template <typename... Args>
   DependencyToken MakeError(Args&&... args) {
     return MakeErrorAsyncValueRef(StrCat(std::forward<Args>(args)...));
@@ -76,6 +107,7 @@ class AsyncEigenEvaluator {
 
  private:
   const EigenHostContext& ctx_;
+  Optional<ExecutionContext> exec_ctx_;
 };
 
 // AsyncEigenEvaluator does the eigen operation inline in the same thread.
@@ -91,6 +123,7 @@ class SyncEigenEvaluator {
   using DependencyToken = Error;
 
   explicit SyncEigenEvaluator(HostContext* host) {}
+  explicit SyncEigenEvaluator(const ExecutionContext& exec_ctx) {}
 
   // KeepAlive is a no-op for the sync evaluation.
   template <typename... DenseHostTensors>
@@ -121,6 +154,14 @@ class SyncEigenEvaluator {
     return Error::success();
   }
 
+  template <typename Compute>
+  Error ParallelExecute(size_t total_size,
+                        const ParallelFor::BlockSizes& block_sizes,
+                        Compute compute, NoKeepAlive) {
+    if (total_size > 0) compute(0, total_size);
+    return Error::success();
+  }
+
   template <typename... Args>
   Error MakeError(Args&&... args) {
     return MakeStringError(std::forward<Args>(args)...);
@@ -27,6 +27,7 @@
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/kernel_frame.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/host_context/shared_context.h"
 #include "tfrt/support/thread_local.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -275,6 +276,74 @@ AsyncValueRef<Chain> AsyncAssign(const EigenHostContext& ctx,
                      std::move(args));
 }
 
+// Evaluates Eigen expression `expr` and assigns result to the output `out`
+// using ParallelFor on the work queue of the execution context. The flattened
+// output range is split into blocks based on the expression cost per
+// coefficient (see ParallelFor::BlockSizes::Cost), and every block is evaluated
+// with the default Eigen device. Cheap expressions are evaluated in the caller
+// thread without enqueuing any work.
+//
+// `done` callback is called when all blocks are completed. The same lifetime
+// requirements as for `AsyncAssign` apply to the values captured by `done`.
+template <
+    typename Output, typename Expr, typename DoneCallback,
+    typename = std::enable_if_t<internal::is_invocable<DoneCallback>::value>>
+void ParallelAssign(const ExecutionContext& exec_ctx, Output out, Expr expr,
+                    DoneCallback done) {
+  using Assign = const Eigen::TensorAssignOp<Output, const Expr>;
+  using Evaluator = Eigen::TensorEvaluator<Assign, Eigen::DefaultDevice>;
+  using Index = typename Evaluator::Index;
+
+  static constexpr bool kVectorizable = Evaluator::PacketAccess;
+  using EvalRange = Eigen::internal::EvalRange<Evaluator, Index, kVectorizable>;
+
+  // Blocks must start at the packet boundary to keep aligned stores valid.
+  static constexpr Index kPacketSize = Eigen::internal::unpacket_traits<
+      typename Evaluator::PacketReturnType>::size;
+  static constexpr Index kAlignment = kVectorizable ? 4 * kPacketSize : 1;
+
+  // Evaluators hold only pointers to the tensor data, and can be safely used
+  // after `out` and `expr` are destroyed.
+  static const Eigen::DefaultDevice device{};
+  auto evaluator = std::make_unique<Evaluator>(Assign(out, expr), device);
+
+  const bool needs_assign = evaluator->evalSubExprsIfNeeded(nullptr);
+  const Index size =
+      needs_assign ? Eigen::internal::array_prod(evaluator->dimensions()) : 0;
+  const Eigen::TensorOpCost cost = evaluator->costPerCoeff(kVectorizable);
+
+  Evaluator* eval = evaluator.get();
+  ParallelFor(exec_ctx).Execute(
+      (size + kAlignment - 1) / kAlignment,
+      ParallelFor::BlockSizes::Cost(cost.bytes_loaded() * kAlignment,
+                                    cost.bytes_stored() * kAlignment,
+                                    cost.compute_cycles() * kAlignment),
+      [eval, size](size_t begin, size_t end) {
+        EvalRange::run(eval, begin * kAlignment,
+                       std::min<Index>(size, end * kAlignment));
+      },
+      [evaluator = std::move(evaluator), done = std::move(done)]() mutable {
+        evaluator->cleanup();
+        done();
+      });
+}
+
+// Syntactic sugar for the `ParallelAssign` defined above, that does output
+// chain allocation (see `AsyncAssign` with `ArgLifetimeExtension`).
+template <typename Output, typename Expr, typename ArgLifetimeExtension,
+          typename = std::enable_if_t<
+              !internal::is_invocable<ArgLifetimeExtension>::value>>
+AsyncValueRef<Chain> ParallelAssign(const ExecutionContext& exec_ctx,
+                                    Output out, Expr expr,
+                                    ArgLifetimeExtension args) {
+  auto chain = MakeUnconstructedAsyncValueRef<Chain>();
+  ParallelAssign(exec_ctx, std::move(out), std::move(expr),
+                 [args = std::move(args), chain = chain.CopyRef()]() {
+                   chain.emplace();
+                 });
+  return chain;
+}
+
 }  // namespace compat
 }  // namespace tfrt
 
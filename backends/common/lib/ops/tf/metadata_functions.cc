@@ -37,6 +37,14 @@ static DType OpAttrTypeToDType(OpAttrType type) {
   switch (type) {
     default:
       return DType(DType::Invalid);
+    case OpAttrType::BF16:
+      return DType(DType::BF16);
+    case OpAttrType::UNSUPPORTED_QUI8:
+      return DType(DType::QUI8);
+    case OpAttrType::UNSUPPORTED_QI8:
+      return DType(DType::QI8);
+    case OpAttrType::UNSUPPORTED_QI32:
+      return DType(DType::QI32);
 #define DTYPE_NUMERIC(ENUM) \
   case OpAttrType::ENUM:    \
     return DType(DType::ENUM);
@@ -93,14 +101,11 @@ static TensorMetadata UnaryIdentityMd(const TensorMetadata& input) {
   return input;
 }
 
-static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
-                                         const TensorMetadata& b,
-                                         VariadicOpArg<TensorMetadata> _,
-                                         const OpAttrsRef& attrs) {
-  if (a.dtype != b.dtype)
-    return MakeStringError("incompatible dtypes for MatMul: In[0]: ", a.dtype,
-                           ", In[1]: ", b.dtype);
-
+// Returns the metadata of the `dtype` product of the `a` and `b` matrices.
+static Expected<TensorMetadata> MatMulOutputMd(const TensorMetadata& a,
+                                               const TensorMetadata& b,
+                                               const OpAttrsRef& attrs,
+                                               DType dtype) {
   if (a.shape.GetRank() != 2)
     return MakeStringError(
         "argument 0 of matmul op is not a rank-2 tensor. Actual rank is ",
@@ -135,8 +140,73 @@ static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
   int a_remaining_dim = 1 - a_matching_dim;
   int b_remaining_dim = 1 - b_matching_dim;
 
-  return TensorMetadata(a.dtype, {a.shape.GetDimensionSize(a_remaining_dim),
-                                  b.shape.GetDimensionSize(b_remaining_dim)});
+  return TensorMetadata(dtype, {a.shape.GetDimensionSize(a_remaining_dim),
+                                b.shape.GetDimensionSize(b_remaining_dim)});
+}
+
+static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
+                                         const TensorMetadata& b,
+                                         VariadicOpArg<TensorMetadata> _,
+                                         const OpAttrsRef& attrs) {
+  if (a.dtype != b.dtype)
+    return MakeStringError("incompatible dtypes for MatMul: In[0]: ", a.dtype,
+                           ", In[1]: ", b.dtype);
+
+  return MatMulOutputMd(a, b, attrs, a.dtype);
+}
+
+// Quantized ops return the quantized tensor and the float scalars of its
+// range.
+using QuantizedOpMd =
+    std::tuple<TensorMetadata, TensorMetadata, TensorMetadata>;
+
+static QuantizedOpMd MakeQuantizedOpMd(const TensorMetadata& output) {
+  TensorMetadata range_bound(DType(DType::F32), ArrayRef<Index>{});
+  return std::make_tuple(output, range_bound, range_bound);
+}
+
+static Expected<QuantizedOpMd> TfQuantizeV2OpMd(const TensorMetadata& input,
+                                                const TensorMetadata& min_range,
+                                                const TensorMetadata& max_range,
+                                                const OpAttrsRef& attrs) {
+  if (input.dtype != DType::F32)
+    return MakeStringError("tf.QuantizeV2 input must be a float tensor");
+
+  auto dtype = OpAttrTypeToDType(attrs.GetAsserting<OpAttrType>("T"));
+  if (dtype != DType::QUI8 && dtype != DType::QI8 && dtype != DType::QI32)
+    return MakeStringError("Unsupported `T` value: ", dtype);
+
+  return MakeQuantizedOpMd(TensorMetadata(dtype, input.shape));
+}
+
+static TensorMetadata TfDequantizeOpMd(const TensorMetadata& input,
+                                       const TensorMetadata& min_range,
+                                       const TensorMetadata& max_range) {
+  return TensorMetadata(DType(DType::F32), input.shape);
+}
+
+static Expected<QuantizedOpMd> TfQuantizedMatMulOpMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    const TensorMetadata& min_a, const TensorMetadata& max_a,
+    const TensorMetadata& min_b, const TensorMetadata& max_b,
+    const OpAttrsRef& attrs) {
+  TFRT_ASSIGN_OR_RETURN(auto output,
+                        MatMulOutputMd(a, b, attrs, DType(DType::QI32)));
+  return MakeQuantizedOpMd(output);
+}
+
+static Expected<QuantizedOpMd> TfQuantizedMatMulWithBiasAndRequantizeOpMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    const TensorMetadata& bias, const TensorMetadata& min_a,
+    const TensorMetadata& max_a, const TensorMetadata& min_b,
+    const TensorMetadata& max_b, const TensorMetadata& min_freezed_output,
+    const TensorMetadata& max_freezed_output, const OpAttrsRef& attrs) {
+  auto dtype = OpAttrTypeToDType(attrs.GetAsserting<OpAttrType>("Toutput"));
+  if (dtype != DType::QUI8 && dtype != DType::QI8)
+    return MakeStringError("Unsupported `Toutput` value: ", dtype);
+
+  TFRT_ASSIGN_OR_RETURN(auto output, MatMulOutputMd(a, b, attrs, dtype));
+  return MakeQuantizedOpMd(output);
 }
 
 static Expected<TensorMetadata> TfConvOpMd(const TensorMetadata& input,
@@ -374,26 +444,29 @@ static Expected<TensorMetadata> TfPadOpFoldedMd(const TensorMetadata& input,
 static Expected<TensorMetadata> TfTransposeOpMdImpl(const TensorMetadata& input,
                                                     ArrayRef<Index> perm,
                                                     const OpAttrsRef& attrs) {
-  if (perm.size() != input.shape.GetRank()) {
+  const int rank = input.shape.GetRank();
+  if (perm.size() != rank) {
     return MakeStringError(
         "tf.Transpose `perm` must size must match input rank");
   }
 
+  llvm::SmallVector<bool, 4> permuted_dim(rank, false);
   llvm::SmallVector<Index, 4> output_dims;
-  for (int i = 0; i < input.shape.GetRank(); ++i) {
+  for (int i = 0; i < rank; ++i) {
+    if (perm[i] < 0 || perm[i] >= rank) {
+      return MakeStringError(
+          "tf.Transpose `perm` values must be in [0, input_rank) range");
+    }
+    if (permuted_dim[perm[i]]) {
+      return MakeStringError("tf.Transpose `perm` values must be unique");
+    }
+    permuted_dim[perm[i]] = true;
     output_dims.push_back(input.shape.GetDimensionSize(perm[i]));
   }
 
   return TensorMetadata(input.dtype, output_dims);
 }
 
-static Expected<TensorMetadata> TfTransposeOpMd(const TensorMetadata& input,
-                                                const TensorMetadata& /*perm*/,
-                                                const OpAttrsRef& attrs) {
-  static constexpr Index default_perm[] = {0, 3, 1, 2};
-  return TfTransposeOpMdImpl(input, default_perm, attrs);
-}
-
 static Expected<TensorMetadata> TfTransposeOpFoldedMd(
     const TensorMetadata& input, const OpAttrsRef& attrs) {
   DenseAttr perm_attr;
@@ -513,10 +586,16 @@ GetAllTFMetadataFunctions() {
                          TFRT_METADATA(TfFusedBatchNormExOpMd));
     result->emplace_back("tf.Pad", TFRT_METADATA(TfPadOpMd));
     result->emplace_back("_tf.Pad", TFRT_METADATA(TfPadOpFoldedMd));
-    result->emplace_back("tf.Transpose", TFRT_METADATA(TfTransposeOpMd));
     result->emplace_back("_tf.Transpose", TFRT_METADATA(TfTransposeOpFoldedMd));
     result->emplace_back("tf.Cast", TFRT_METADATA(TfCastOpMd));
     result->emplace_back("tf.ZerosLike", TFRT_METADATA(TfZerosLikeOpMd));
+    result->emplace_back("tf.QuantizeV2", TFRT_METADATA(TfQuantizeV2OpMd));
+    result->emplace_back("tf.Dequantize", TFRT_METADATA(TfDequantizeOpMd));
+    result->emplace_back("tf.QuantizedMatMul",
+                         TFRT_METADATA(TfQuantizedMatMulOpMd));
+    result->emplace_back(
+        "tf.QuantizedMatMulWithBiasAndRequantize",
+        TFRT_METADATA(TfQuantizedMatMulWithBiasAndRequantizeOpMd));
     return result;
   }();
 
@@ -16,27 +16,140 @@
 
 #include "../../lib/kernels/cwise_binary_kernels.h"
 
+#include <vector>
+
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "tfrt/common/ops/tf/bcast.h"
+#include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/dtype/dtype.h"
-#include "tfrt/host_context/concurrent_work_queue.h"
-#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
-#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/latch.h"
 #include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
 namespace {
-std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
-  return std::make_unique<HostContext>(
-      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
-      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+using Plan = cpu::internal::BinaryBroadcastPlan;
+using PlanArg = Plan::Arg;
+
+void ExpectPlan(const TensorShape& lhs, const TensorShape& rhs,
+                Eigen::Index rows, Eigen::Index cols, PlanArg lhs_arg,
+                PlanArg rhs_arg) {
+  TensorShape out = GetBroadcastedShape(lhs, rhs).get();
+  auto plan = cpu::internal::PlanBinaryBroadcast(lhs, rhs, out);
+  ASSERT_TRUE(plan.has_value());
+  EXPECT_EQ(plan->rows, rows);
+  EXPECT_EQ(plan->cols, cols);
+  EXPECT_EQ(plan->lhs, lhs_arg);
+  EXPECT_EQ(plan->rhs, rhs_arg);
+}
+
+TEST(BinaryBroadcastPlanTest, Patterns) {
+  // Row broadcast.
+  ExpectPlan(TensorShape({8, 4}), TensorShape({4}), 8, 4, PlanArg::kFull,
+             PlanArg::kRow);
+  ExpectPlan(TensorShape({1, 1, 1, 4}), TensorShape({2, 3, 5, 4}), 30, 4,
+             PlanArg::kRow, PlanArg::kFull);
+  // Column broadcast.
+  ExpectPlan(TensorShape({8, 4}), TensorShape({8, 1}), 8, 4, PlanArg::kFull,
+             PlanArg::kColumn);
+  ExpectPlan(TensorShape({2, 3, 1}), TensorShape({2, 3, 4}), 6, 4,
+             PlanArg::kColumn, PlanArg::kFull);
+  // Outer product.
+  ExpectPlan(TensorShape({8, 1}), TensorShape({4}), 8, 4, PlanArg::kColumn,
+             PlanArg::kRow);
+  // Same number of elements.
+  ExpectPlan(TensorShape({1, 4}), TensorShape({4}), 1, 4, PlanArg::kFull,
+             PlanArg::kFull);
+}
+
+TEST(BinaryBroadcastPlanTest, Unsupported) {
+  // [2, 1, 4] + [3, 1] broadcasts three collapsed dimensions.
+  TensorShape lhs({2, 1, 4});
+  TensorShape rhs({3, 1});
+  TensorShape out({2, 3, 4});
+  EXPECT_FALSE(cpu::internal::PlanBinaryBroadcast(lhs, rhs, out).has_value());
+
+  // Incompatible shapes are reported by the Eigen broadcast.
+  EXPECT_FALSE(cpu::internal::PlanBinaryBroadcast(
+                   TensorShape({2, 3}), TensorShape({4}), TensorShape({2, 3}))
+                   .has_value());
+}
+
+// Computes `lhs + rhs` with the broadcasting binary kernel and compares the
+// result with the element by element broadcast.
+template <typename T>
+void TestBroadcastAdd(const TensorShape& lhs_shape,
+                      const TensorShape& rhs_shape) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  TensorShape out_shape = GetBroadcastedShape(lhs_shape, rhs_shape).get();
+  auto lhs = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), lhs_shape), host.get());
+  auto rhs = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), rhs_shape), host.get());
+  auto out = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), out_shape), host.get());
+
+  MutableDHTArrayView<T> lhs_view(&*lhs);
+  MutableDHTArrayView<T> rhs_view(&*rhs);
+  for (Index i = 0; i < lhs_view.NumElements(); ++i) lhs_view[i] = i;
+  for (Index i = 0; i < rhs_view.NumElements(); ++i) rhs_view[i] = 1000 * i;
+
+  using Functor = typename ::tfrt::cpu::functor::Add::Functor<T>;
+  tfrt::latch done(1);
+  ::tfrt::cpu::BinaryKernel<Functor, compat::AsyncEigenEvaluator>(
+      *lhs, *rhs, &*out, exec_ctx, [&](Error err) {
+        EXPECT_FALSE(err);
+        done.count_down();
+      });
+  done.wait();
+
+  // Returns the offset of the argument element broadcasted to the output
+  // element at `index`.
+  const int rank = out_shape.GetRank();
+  auto offset = [&](const TensorShape& shape, Index index) {
+    Index result = 0;
+    Index stride = 1;
+    for (int i = rank - 1; i >= rank - shape.GetRank(); --i) {
+      Index out_dim = out_shape.GetDimensionSize(i);
+      Index dim = shape.GetDimensionSize(i - (rank - shape.GetRank()));
+      if (dim != 1) result += (index % out_dim) * stride;
+      stride *= dim;
+      index /= out_dim;
+    }
+    return result;
+  };
+
+  DHTArrayView<T> out_view(&*out);
+  for (Index i = 0; i < out_view.NumElements(); ++i) {
+    ASSERT_EQ(out_view[i],
+              lhs_view[offset(lhs_shape, i)] + rhs_view[offset(rhs_shape, i)])
+        << "at " << i;
+  }
 }
+
+TEST(BinaryKernelTest, BroadcastFastPaths) {
+  TestBroadcastAdd<float>(TensorShape({33, 17}), TensorShape({17}));
+  TestBroadcastAdd<float>(TensorShape({2, 3, 5, 17}),
+                          TensorShape({1, 1, 1, 17}));
+  TestBroadcastAdd<float>(TensorShape({33, 17}), TensorShape({33, 1}));
+  TestBroadcastAdd<float>(TensorShape({33, 1}), TensorShape({33, 17}));
+  TestBroadcastAdd<float>(TensorShape({33, 1}), TensorShape({17}));
+  TestBroadcastAdd<float>(TensorShape({17}), TensorShape({33, 1}));
+  TestBroadcastAdd<int32_t>(TensorShape({64, 1000}), TensorShape({1000}));
+  TestBroadcastAdd<int32_t>(TensorShape({1000, 1}), TensorShape({1, 64}));
+}
+
+TEST(BinaryKernelTest, BroadcastEigenPath) {
+  TestBroadcastAdd<float>(TensorShape({2, 1, 4}), TensorShape({3, 1}));
+}
+
 }  // namespace
 
 void BinaryKernel(benchmark::State& state, int num_threads,
@@ -63,8 +176,7 @@ void BinaryKernel(benchmark::State& state, int num_threads,
     tfrt::latch done(1);
 
     ::tfrt::cpu::BinaryKernel<Functor, compat::AsyncEigenEvaluator>(
-        *lhs, *rhs, &*res, *exec_ctx.host(),
-        [&](Error err) { done.count_down(); });
+        *lhs, *rhs, &*res, exec_ctx, [&](Error err) { done.count_down(); });
 
     done.wait();
   }
@@ -106,4 +218,132 @@ BM_Add_TensorD2_Scalar(4, 1500, 300);
 BM_Add_TensorD2_Scalar(8, 1500, 300);
 BM_Add_TensorD2_Scalar(16, 1500, 300);
 
+void AddTensorTensor(benchmark::State& state, int num_threads,
+                     ArrayRef<Index> tensor_dims) {
+  TensorShape shape(tensor_dims);
+  BinaryKernel(state, num_threads, shape, shape);
+}
+
+#define BM_Add_TensorD2_TensorD2(threads, D0, D1)                \
+  static void BM_AddTensor_##D0##x##D1##_Tensor_tpool_##threads( \
+      benchmark::State& state) {                                 \
+    AddTensorTensor(state, threads, {D0, D1});                   \
+  }                                                              \
+  BENCHMARK(BM_AddTensor_##D0##x##D1##_Tensor_tpool_##threads)
+
+// [1, 1] + [1, 1]
+BM_Add_TensorD2_TensorD2(4, 1, 1);
+BM_Add_TensorD2_TensorD2(8, 1, 1);
+BM_Add_TensorD2_TensorD2(16, 1, 1);
+
+// [32, 32] + [32, 32]
+BM_Add_TensorD2_TensorD2(4, 32, 32);
+BM_Add_TensorD2_TensorD2(8, 32, 32);
+BM_Add_TensorD2_TensorD2(16, 32, 32);
+
+// [300, 300] + [300, 300]
+BM_Add_TensorD2_TensorD2(4, 300, 300);
+BM_Add_TensorD2_TensorD2(8, 300, 300);
+BM_Add_TensorD2_TensorD2(16, 300, 300);
+
+// [1500, 300] + [1500, 300]
+BM_Add_TensorD2_TensorD2(4, 1500, 300);
+BM_Add_TensorD2_TensorD2(8, 1500, 300);
+BM_Add_TensorD2_TensorD2(16, 1500, 300);
+
+// Benchmarks for the broadcasting patterns planned by PlanBinaryBroadcast,
+// comparing the planned loops with the Eigen broadcast expression.
+template <typename T>
+void BroadcastAdd(benchmark::State& state, bool planned,
+                  const TensorShape& lhs_shape, const TensorShape& rhs_shape) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  TensorShape res_shape = GetBroadcastedShape(lhs_shape, rhs_shape).get();
+
+  auto lhs = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), lhs_shape), host.get());
+  auto rhs = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), rhs_shape), host.get());
+  auto res = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), res_shape), host.get());
+
+  using Functor = typename ::tfrt::cpu::functor::Add::Functor<T>;
+  cpu::internal::BinaryKernelImpl<Functor, compat::AsyncEigenEvaluator> impl(
+      compat::AsyncEigenEvaluator{exec_ctx});
+
+  for (auto _ : state) {
+    tfrt::latch done(1);
+    auto on_done = [&](Error err) { done.count_down(); };
+
+    if (planned) {
+      impl.TensorTensorBcast(*lhs, *rhs, &*res, on_done);
+    } else {
+      impl.TensorTensorEigenBcast(*lhs, *rhs, &*res, on_done);
+    }
+
+    done.wait();
+  }
+
+  state.SetItemsProcessed(res_shape.GetNumElements() * state.iterations());
+}
+
+// [D0, D1] + [D1]
+template <typename T>
+void RowBroadcastAdd(benchmark::State& state, bool planned, Index d0,
+                     Index d1) {
+  BroadcastAdd<T>(state, planned, TensorShape({d0, d1}), TensorShape({d1}));
+}
+
+// [32, D0, D0, D1] + [1, 1, 1, D1]
+template <typename T>
+void NhwcBroadcastAdd(benchmark::State& state, bool planned, Index d0,
+                      Index d1) {
+  BroadcastAdd<T>(state, planned, TensorShape({32, d0, d0, d1}),
+                  TensorShape({1, 1, 1, d1}));
+}
+
+// [D0, D1] + [D0, 1]
+template <typename T>
+void ColumnBroadcastAdd(benchmark::State& state, bool planned, Index d0,
+                        Index d1) {
+  BroadcastAdd<T>(state, planned, TensorShape({d0, d1}),
+                  TensorShape({d0, 1}));
+}
+
+// [D0, 1] + [D1]
+template <typename T>
+void OuterBroadcastAdd(benchmark::State& state, bool planned, Index d0,
+                       Index d1) {
+  BroadcastAdd<T>(state, planned, TensorShape({d0, 1}), TensorShape({d1}));
+}
+
+#define BM_BroadcastAdd(Pattern, T, D0, D1)                               \
+  static void BM_##Pattern##_##T##_##D0##x##D1##_Planned(                 \
+      benchmark::State& state) {                                          \
+    Pattern<T>(state, /*planned=*/true, D0, D1);                          \
+  }                                                                       \
+  BENCHMARK(BM_##Pattern##_##T##_##D0##x##D1##_Planned);                  \
+  static void BM_##Pattern##_##T##_##D0##x##D1##_Eigen(                   \
+      benchmark::State& state) {                                          \
+    Pattern<T>(state, /*planned=*/false, D0, D1);                         \
+  }                                                                       \
+  BENCHMARK(BM_##Pattern##_##T##_##D0##x##D1##_Eigen)
+
+BM_BroadcastAdd(RowBroadcastAdd, float, 1024, 64);
+BM_BroadcastAdd(RowBroadcastAdd, float, 4096, 1000);
+BM_BroadcastAdd(RowBroadcastAdd, int32_t, 4096, 1000);
+
+BM_BroadcastAdd(NhwcBroadcastAdd, float, 28, 64);
+BM_BroadcastAdd(NhwcBroadcastAdd, float, 7, 512);
+BM_BroadcastAdd(NhwcBroadcastAdd, int32_t, 28, 64);
+
+BM_BroadcastAdd(ColumnBroadcastAdd, float, 1024, 64);
+BM_BroadcastAdd(ColumnBroadcastAdd, float, 4096, 1000);
+BM_BroadcastAdd(ColumnBroadcastAdd, int32_t, 4096, 1000);
+
+BM_BroadcastAdd(OuterBroadcastAdd, float, 256, 256);
+BM_BroadcastAdd(OuterBroadcastAdd, float, 2048, 2048);
+BM_BroadcastAdd(OuterBroadcastAdd, int32_t, 2048, 2048);
+
 }  // namespace tfrt
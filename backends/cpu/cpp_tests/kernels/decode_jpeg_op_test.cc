@@ -0,0 +1,263 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Batched jpeg decode tests and benchmarks.
+
+#include "../../lib/kernels/image/decode_jpeg_op.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../../lib/kernels/image/jpeg/jpeg_mem.h"
+#include "../../lib/kernels/image/resize_bilinear_op.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Encodes the RGB gradient image of the given size as jpeg.
+std::string EncodeJpeg(int width, int height) {
+  std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+      pixel[0] = 255 * x / width;
+      pixel[1] = 255 * y / height;
+      pixel[2] = 255 * (x + y) / (width + height);
+    }
+  }
+
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  unsigned char* buffer = nullptr;
+  unsigned long size = 0;  // NOLINT
+  jpeg_mem_dest(&cinfo, &buffer, &size);
+
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row =
+        &pixels[static_cast<size_t>(cinfo.next_scanline) * width * 3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  std::string jpeg(reinterpret_cast<char*>(buffer), size);
+  free(buffer);
+  return jpeg;
+}
+
+StringHostTensor CreateImages(ArrayRef<std::string> jpegs, HostContext* host) {
+  auto images = StringHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::String),
+                     TensorShape({static_cast<Index>(jpegs.size())})),
+      host);
+  for (int i = 0; i < jpegs.size(); ++i) images->strings()[i] = jpegs[i];
+  return std::move(*images);
+}
+
+// Decodes the `jpeg` in the full size, and resizes the decoded image.
+std::vector<float> DecodeFullAndResize(const std::string& jpeg, Index height,
+                                       Index width) {
+  image::jpeg::UncompressFlags flags;
+  flags.components = 3;
+  flags.dct_method = JDCT_IFAST;
+
+  std::vector<uint8_t> decoded;
+  Index decoded_height = 0, decoded_width = 0;
+  image::jpeg::Uncompress(jpeg.data(), jpeg.size(), flags, nullptr,
+                          [&](int w, int h, int c) -> uint8_t* {
+                            decoded_height = h;
+                            decoded_width = w;
+                            decoded.resize(static_cast<size_t>(h) * w * c);
+                            return decoded.data();
+                          });
+
+  std::vector<float> resized(height * width * 3);
+  image::resize_image(decoded.data(), decoded_height, decoded_width, 3,
+                      resized.data(), height, width, image::ResizeOptions());
+  return resized;
+}
+
+TEST(DecodeJpegTest, ScaleDenom) {
+  EXPECT_EQ(image::jpeg_scale_denom(100, 80, 224, 224), 1);
+  EXPECT_EQ(image::jpeg_scale_denom(300, 300, 224, 224), 1);
+  EXPECT_EQ(image::jpeg_scale_denom(640, 480, 224, 224), 2);
+  EXPECT_EQ(image::jpeg_scale_denom(1920, 1080, 224, 224), 4);
+  EXPECT_EQ(image::jpeg_scale_denom(2000, 2000, 250, 250), 8);
+  EXPECT_EQ(image::jpeg_scale_denom(2000, 2000, 251, 250), 4);
+  EXPECT_EQ(image::jpeg_scale_denom(1999, 1999, 250, 250), 8);
+}
+
+TEST(DecodeJpegTest, Batch) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  const Index height = 32, width = 48;
+  std::vector<std::string> jpegs = {EncodeJpeg(20, 10), EncodeJpeg(640, 480),
+                                    EncodeJpeg(48, 32), EncodeJpeg(500, 900)};
+  auto images = MakeAvailableAsyncValueRef<StringHostTensor>(
+      CreateImages(jpegs, host.get()));
+
+  auto output = image::decode_and_resize_jpeg_batch(images.CopyRef(), height,
+                                                    width, exec_ctx);
+  host->Await(output.CopyRCRef());
+  ASSERT_FALSE(output.IsError());
+  EXPECT_EQ(output->shape(), TensorShape({4, height, width, 3}));
+
+  DHTArrayView<float> view(&*output);
+  const Index image_size = height * width * 3;
+  for (int i = 0; i < jpegs.size(); ++i) {
+    // Images are downscaled while decoding, and they are close to the resize
+    // of the full size images (the downscale averages the pixel blocks, and
+    // shifts the sampled gradients by a few pixels).
+    std::vector<float> expected = DecodeFullAndResize(jpegs[i], height, width);
+    double error = 0;
+    for (Index j = 0; j < image_size; ++j) {
+      error += std::abs(view[i * image_size + j] - expected[j]);
+    }
+    EXPECT_LT(error / image_size, 4.0) << "image " << i;
+  }
+
+  // Images without downscale are the same as the resize of the full images.
+  std::vector<float> expected = DecodeFullAndResize(jpegs[0], height, width);
+  for (Index j = 0; j < image_size; ++j) ASSERT_EQ(view[j], expected[j]);
+}
+
+TEST(DecodeJpegTest, EmptyBatch) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  auto images = MakeAvailableAsyncValueRef<StringHostTensor>(
+      CreateImages({}, host.get()));
+  auto output =
+      image::decode_and_resize_jpeg_batch(images.CopyRef(), 8, 8, exec_ctx);
+  host->Await(output.CopyRCRef());
+  ASSERT_FALSE(output.IsError());
+  EXPECT_EQ(output->shape(), TensorShape({0, 8, 8, 3}));
+}
+
+TEST(DecodeJpegTest, InvalidImage) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  std::string jpeg = EncodeJpeg(64, 64);
+  std::vector<std::string> jpegs = {jpeg, "not a jpeg", jpeg.substr(0, 16)};
+  auto images = MakeAvailableAsyncValueRef<StringHostTensor>(
+      CreateImages(jpegs, host.get()));
+
+  auto output =
+      image::decode_and_resize_jpeg_batch(images.CopyRef(), 8, 8, exec_ctx);
+  host->Await(output.CopyRCRef());
+  EXPECT_TRUE(output.IsError());
+
+  auto decode_error = [](const std::string& jpeg) {
+    std::vector<float> decoded(8 * 8 * 3);
+    return toString(image::decode_and_resize_jpeg(jpeg, 8, 8, decoded.data()));
+  };
+  EXPECT_EQ(decode_error(jpegs[0]), "");
+  EXPECT_EQ(decode_error(jpegs[1]), "image does not have jpeg format");
+  EXPECT_EQ(decode_error(jpegs[2]), "cannot read jpeg header");
+}
+
+}  // namespace
+
+static std::vector<std::string> CreateBenchmarkJpegs(int width, int height) {
+  return std::vector<std::string>(16, EncodeJpeg(width, height));
+}
+
+static void DecodeAndResizeJpegBatch(benchmark::State& state, int num_threads,
+                                     int width, int height) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  std::vector<std::string> jpegs = CreateBenchmarkJpegs(width, height);
+  auto images = MakeAvailableAsyncValueRef<StringHostTensor>(
+      CreateImages(jpegs, host.get()));
+
+  for (auto _ : state) {
+    auto output = image::decode_and_resize_jpeg_batch(images.CopyRef(), 224,
+                                                      224, exec_ctx);
+    host->Await(output.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(jpegs.size() * state.iterations());
+}
+
+// Decodes every image in the full size, and then resizes it, in parallel.
+static void DecodeJpegAndResize(benchmark::State& state, int num_threads,
+                                int width, int height) {
+  auto host = CreateTestHostContext(num_threads);
+
+  std::vector<std::string> jpegs = CreateBenchmarkJpegs(width, height);
+
+  for (auto _ : state) {
+    llvm::SmallVector<RCReference<AsyncValue>, 16> resized;
+    for (const std::string& jpeg : jpegs) {
+      resized.push_back(
+          EnqueueBlockingWork(host.get(), [&jpeg] {
+            return DecodeFullAndResize(jpeg, 224, 224);
+          }).ReleaseRCRef());
+    }
+    host->Await(resized);
+  }
+
+  state.SetItemsProcessed(jpegs.size() * state.iterations());
+}
+
+#define BM_DecodeJpeg(width, height, threads)                          \
+  static void BM_DecodeJpegBatch_##width##x##height##_tpool_##threads( \
+      benchmark::State& state) {                                       \
+    DecodeAndResizeJpegBatch(state, threads, width, height);           \
+  }                                                                    \
+  static void BM_DecodeJpegFull_##width##x##height##_tpool_##threads(  \
+      benchmark::State& state) {                                       \
+    DecodeJpegAndResize(state, threads, width, height);                \
+  }                                                                    \
+  BENCHMARK(BM_DecodeJpegBatch_##width##x##height##_tpool_##threads);  \
+  BENCHMARK(BM_DecodeJpegFull_##width##x##height##_tpool_##threads)
+
+// Decode of the batch of 16 jpeg images resized to 224x224 (items are images).
+BM_DecodeJpeg(640, 480, 1);
+BM_DecodeJpeg(640, 480, 8);
+BM_DecodeJpeg(1920, 1080, 1);
+BM_DecodeJpeg(1920, 1080, 8);
+
+}  // namespace tfrt
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Fused MatMul kernel tests and benchmarks.
+
+#include "../../lib/kernels/fused_matmul_kernel.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/bef_attr_encoder.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Encodes the `fused_ops` attribute of the tf._FusedMatMul operation.
+class FusedOpsAttr {
+ public:
+  explicit FusedOpsAttr(std::vector<std::string> ops) {
+    std::vector<const void*> values;
+    std::vector<size_t> sizes;
+    for (const std::string& op : ops) {
+      values.push_back(op.data());
+      sizes.push_back(op.size());
+    }
+    BefAttrEncoder encoder;
+    offset_ = encoder.EncodeStringListAttr(values.data(), sizes.data(),
+                                           values.size());
+    buffer_ = encoder.TakeResult();
+  }
+
+  AggregateAttr attr() const { return AggregateAttr(buffer_.data() + offset_); }
+
+ private:
+  BefBuffer buffer_;
+  size_t offset_;
+};
+
+DenseHostTensor CreateTensor(llvm::ArrayRef<Index> dims, HostContext* host) {
+  auto tensor = DenseHostTensor::CreateUninitialized<float>(TensorShape(dims),
+                                                            host);
+  std::mt19937 engine(dims.size() * 1000 + dims.back());
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (float& value : MutableDHTArrayView<float>(&*tensor).Elements())
+    value = dist(engine);
+  return std::move(*tensor);
+}
+
+double Apply(string_view op, double x, double alpha) {
+  if (op == "Relu") return std::max(0.0, x);
+  if (op == "Relu6") return std::min(6.0, std::max(0.0, x));
+  if (op == "Elu") return x < 0.0 ? std::exp(x) - 1.0 : x;
+  if (op == "LeakyRelu") return x < 0.0 ? alpha * x : x;
+  if (op == "Sigmoid") return 1.0 / (1.0 + std::exp(-x));
+  if (op == "Tanh") return std::tanh(x);
+  if (op == "GeluApproximate") {
+    const double inner = std::sqrt(2.0 / M_PI) * (x + 0.044715 * x * x * x);
+    return 0.5 * x * (1.0 + std::tanh(inner));
+  }
+  if (op == "GeluExact") return 0.5 * x * (1.0 + std::erf(x / std::sqrt(2.0)));
+  ADD_FAILURE() << "unexpected fused op " << op;
+  return x;
+}
+
+// Computes the fused MatMul of [m, k] and [k, n] matrices with the fused ops
+// chain, and compares it with the unfused reference.
+void TestFusedMatMul(Index m, Index k, Index n,
+                     std::vector<std::string> fused_ops) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+  const float alpha = 0.3f;
+
+  DenseHostTensor a = CreateTensor({m, k}, host.get());
+  DenseHostTensor b = CreateTensor({k, n}, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+
+  std::vector<DenseHostTensor> fusion_inputs;
+  for (const std::string& op : fused_ops) {
+    if (op == "BiasAdd") fusion_inputs.push_back(CreateTensor({n}, host.get()));
+    if (op == "Add") fusion_inputs.push_back(CreateTensor({m, n}, host.get()));
+  }
+
+  FusedOpsAttr attr(fused_ops);
+  ASSERT_FALSE((cpu::FusedMatMul<float, compat::SyncEigenEvaluator>(
+      a, b, &*c, llvm::ArrayRef<DenseHostTensor>(fusion_inputs), false, false,
+      attr.attr(), alpha, exec_ctx)));
+
+  DHTIndexableView<float, 2> a_view(&a);
+  DHTIndexableView<float, 2> b_view(&b);
+  DHTIndexableView<float, 2> c_view(&*c);
+
+  for (Index i = 0; i < m; ++i) {
+    for (Index j = 0; j < n; ++j) {
+      double expected = 0.0;
+      for (Index p = 0; p < k; ++p)
+        expected += a_view.ElementAt(i, p) * b_view.ElementAt(p, j);
+
+      size_t input = 0;
+      for (const std::string& op : fused_ops) {
+        if (op == "BiasAdd") {
+          expected += DHTArrayView<float>(&fusion_inputs[input++])[j];
+        } else if (op == "Add") {
+          DHTIndexableView<float, 2> residual(&fusion_inputs[input++]);
+          expected += residual.ElementAt(i, j);
+        } else {
+          expected = Apply(op, expected, alpha);
+        }
+      }
+
+      EXPECT_NEAR(c_view.ElementAt(i, j), expected,
+                  1e-4 * std::max(1.0, std::abs(expected)))
+          << "at [" << i << ", " << j << "]";
+    }
+  }
+}
+
+TEST(FusedMatMulKernelTest, BiasAddActivation) {
+  for (std::string activation : {"Relu", "Relu6", "Elu", "LeakyRelu",
+                                 "Sigmoid", "Tanh", "GeluApproximate",
+                                 "GeluExact"}) {
+    TestFusedMatMul(17, 64, 300, {"BiasAdd", activation});
+  }
+}
+
+TEST(FusedMatMulKernelTest, ResidualAdd) {
+  TestFusedMatMul(17, 64, 300, {"BiasAdd", "Add"});
+  TestFusedMatMul(33, 129, 65, {"BiasAdd", "Add", "Relu"});
+}
+
+TEST(FusedMatMulKernelTest, ActivationChain) {
+  TestFusedMatMul(17, 64, 300, {"BiasAdd", "GeluApproximate", "Add"});
+  TestFusedMatMul(8, 32, 16, {"Tanh", "BiasAdd", "Sigmoid", "Relu6"});
+}
+
+TEST(FusedMatMulKernelTest, InvalidFusion) {
+  auto host = CreateTestHostContext(1);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor a = CreateTensor({4, 8}, host.get());
+  DenseHostTensor b = CreateTensor({8, 16}, host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({4, 16}),
+                                                       host.get());
+
+  std::vector<DenseHostTensor> fusion_inputs;
+  fusion_inputs.push_back(CreateTensor({16}, host.get()));
+
+  auto fused_matmul = [&](std::vector<std::string> fused_ops) {
+    FusedOpsAttr attr(fused_ops);
+    return cpu::FusedMatMul<float, compat::SyncEigenEvaluator>(
+        a, b, &*c, llvm::ArrayRef<DenseHostTensor>(fusion_inputs), false,
+        false, attr.attr(), 0.2f, exec_ctx);
+  };
+
+  EXPECT_EQ(toString(fused_matmul({"BiasAdd", "Relu"})), "");
+  EXPECT_NE(toString(fused_matmul({"BiasAdd", "Softplus"})), "");
+  // The residual input is missing.
+  EXPECT_NE(toString(fused_matmul({"BiasAdd", "Add"})), "");
+  // The bias input is not used.
+  EXPECT_NE(toString(fused_matmul({"Relu"})), "");
+}
+
+}  // namespace
+
+// Applies Gelu to the tensor in a separate pass over the memory.
+static AsyncValueRef<Chain> Gelu(DenseHostTensor* tensor,
+                                 const ExecutionContext& exec_ctx) {
+  auto x = compat::AsEigenTensor(MutableDHTArrayView<float>(tensor));
+  auto expr =
+      x * 0.5f * (((x + x.cube() * 0.044715f) * 0.7978845608f).tanh() + 1.0f);
+
+  AsyncValueRef<Chain> chain = MakeConstructedAsyncValueRef<Chain>();
+  compat::ParallelAssign(exec_ctx, x, std::move(expr),
+                         [chain = chain.CopyRef()]() {
+                           chain.SetStateConcrete();
+                         });
+  return chain;
+}
+
+// Transformer style MLP with 4 [hidden, hidden] layers: BiasAdd and Gelu
+// after every MatMul, and a residual connection after the last layer.
+void Mlp(benchmark::State& state, int num_threads, Index batch, Index hidden,
+         bool fused) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+  constexpr int kNumLayers = 4;
+
+  std::vector<DenseHostTensor> weights;
+  std::vector<DenseHostTensor> biases;
+  for (int i = 0; i < kNumLayers; ++i) {
+    weights.push_back(CreateTensor({hidden, hidden}, host.get()));
+    biases.push_back(CreateTensor({hidden}, host.get()));
+  }
+
+  // Activations are double buffered between the layers.
+  DenseHostTensor input = CreateTensor({batch, hidden}, host.get());
+  DenseHostTensor activations[2] = {
+      CreateTensor({batch, hidden}, host.get()),
+      CreateTensor({batch, hidden}, host.get())};
+
+  FusedOpsAttr bias_add({"BiasAdd"});
+  FusedOpsAttr bias_add_gelu({"BiasAdd", "GeluApproximate"});
+  FusedOpsAttr bias_add_gelu_add({"BiasAdd", "GeluApproximate", "Add"});
+
+  for (auto _ : state) {
+    const DenseHostTensor* x = &input;
+    for (int i = 0; i < kNumLayers; ++i) {
+      DenseHostTensor* y = &activations[i % 2];
+      const bool last = i == kNumLayers - 1;
+
+      std::vector<DenseHostTensor> fusion_inputs;
+      fusion_inputs.push_back(biases[i].CopyRef());
+      if (fused && last) fusion_inputs.push_back(input.CopyRef());
+
+      AggregateAttr fused_ops = !fused  ? bias_add.attr()
+                                : last ? bias_add_gelu_add.attr()
+                                       : bias_add_gelu.attr();
+
+      auto done = cpu::FusedMatMul<float, compat::AsyncEigenEvaluator>(
+          *x, weights[i], y, llvm::ArrayRef<DenseHostTensor>(fusion_inputs),
+          false, false, fused_ops, 0.2f, exec_ctx);
+      host->Await(done.CopyRCRef());
+
+      if (!fused) {
+        host->Await(Gelu(y, exec_ctx).CopyRCRef());
+        if (last) {
+          auto out = compat::AsEigenTensor(MutableDHTArrayView<float>(y));
+          out += compat::AsEigenConstTensor(DHTArrayView<float>(&input));
+        }
+      }
+
+      x = y;
+    }
+  }
+
+  state.SetItemsProcessed(kNumLayers * batch * hidden * hidden *
+                          state.iterations());
+}
+
+#define BM_Mlp(threads, batch, hidden)                              \
+  static void BM_FusedMlp_##batch##x##hidden##_tpool_##threads(     \
+      benchmark::State& state) {                                    \
+    Mlp(state, threads, batch, hidden, /*fused=*/true);             \
+  }                                                                 \
+  BENCHMARK(BM_FusedMlp_##batch##x##hidden##_tpool_##threads);      \
+  static void BM_UnfusedMlp_##batch##x##hidden##_tpool_##threads(   \
+      benchmark::State& state) {                                    \
+    Mlp(state, threads, batch, hidden, /*fused=*/false);            \
+  }                                                                 \
+  BENCHMARK(BM_UnfusedMlp_##batch##x##hidden##_tpool_##threads)
+
+BM_Mlp(4, 16, 1024);
+BM_Mlp(4, 128, 1024);
+BM_Mlp(8, 512, 1024);
+
+}  // namespace tfrt
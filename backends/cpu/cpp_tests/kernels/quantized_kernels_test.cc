@@ -0,0 +1,325 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Quantized kernels tests and benchmarks.
+
+#include "../../lib/kernels/quantized_kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "../../lib/kernels/matmul_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/dtype/quantized_types.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Creates the [rows, cols] matrix of the quantized type Q with random values.
+template <typename Q>
+DenseHostTensor CreateQuantizedMatrix(Index rows, Index cols,
+                                      HostContext* host) {
+  using T = decltype(Q::value);
+  auto matrix = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<Q>(), TensorShape({rows, cols})), host);
+  std::mt19937 engine(42);
+  std::uniform_int_distribution<int> dist(std::numeric_limits<T>::lowest(),
+                                          std::numeric_limits<T>::max());
+  T* data = static_cast<T*>(matrix->data());
+  for (Index i = 0; i < rows * cols; ++i)
+    data[i] = static_cast<T>(dist(engine));
+  return std::move(*matrix);
+}
+
+TEST(QuantizedKernelsTest, QuantizedRange) {
+  cpu::QuantizedRange<uint8_t> range(-1.0f, 3.0f);
+  EXPECT_EQ(range.Quantize(-1.0f), 0);
+  EXPECT_EQ(range.Quantize(3.0f), 255);
+  EXPECT_EQ(range.Quantize(100.0f), 255);
+  EXPECT_EQ(range.Quantize(0.0f), range.ZeroPoint());
+  EXPECT_EQ(range.Dequantize(range.ZeroPoint()), 0.0f);
+
+  for (float value : {-1.0f, -0.3f, 0.5f, 1.7f, 2.9f}) {
+    EXPECT_NEAR(range.Dequantize(range.Quantize(value)), value,
+                range.FloatForOneLevel());
+  }
+
+  // Symmetric signed range has the zero point at zero.
+  cpu::QuantizedRange<int8_t> symmetric(-2.0f, 2.0f);
+  EXPECT_EQ(symmetric.ZeroPoint(), 0);
+  EXPECT_EQ(symmetric.Quantize(-2.0f), -128);
+  EXPECT_EQ(symmetric.Quantize(2.0f), 127);
+
+  // Zero points are not clamped to the T range, and saturate in int32.
+  EXPECT_EQ(cpu::QuantizedRange<uint8_t>(1.0f, 2.0f).ZeroPoint(), -255);
+  EXPECT_EQ(cpu::QuantizedRange<int32_t>(1.0f, 2.0f).ZeroPoint(),
+            std::numeric_limits<int32_t>::lowest());
+}
+
+// Computes the quantized matmul with the kernel, and compares the result with
+// the reference computed from the quantized values.
+void ExpectQuantizedMatMul(const DenseHostTensor& a, const DenseHostTensor& b,
+                           int32_t a_zero_point, int32_t b_zero_point,
+                           bool transpose_a, bool transpose_b,
+                           const DenseHostTensor& c) {
+  const Index m = c.shape().GetDimensionSize(0);
+  const Index n = c.shape().GetDimensionSize(1);
+  const Index k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+
+  const uint8_t* a_data = static_cast<const uint8_t*>(a.data());
+  const int8_t* b_data = static_cast<const int8_t*>(b.data());
+  const int32_t* c_data = static_cast<const int32_t*>(c.data());
+  for (Index i = 0; i < m; ++i) {
+    for (Index j = 0; j < n; ++j) {
+      int32_t expected = 0;
+      for (Index p = 0; p < k; ++p) {
+        int32_t a_value = transpose_a ? a_data[p * m + i] : a_data[i * k + p];
+        int32_t b_value = transpose_b ? b_data[j * k + p] : b_data[p * n + j];
+        expected += (a_value - a_zero_point) * (b_value - b_zero_point);
+      }
+      ASSERT_EQ(c_data[i * n + j], expected)
+          << "at [" << i << ", " << j << "]";
+    }
+  }
+}
+
+void TestQuantizedMatMul(Index m, Index k, Index n, bool transpose_a,
+                         bool transpose_b) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor a = transpose_a
+                          ? CreateQuantizedMatrix<quint8>(k, m, host.get())
+                          : CreateQuantizedMatrix<quint8>(m, k, host.get());
+  DenseHostTensor b = transpose_b
+                          ? CreateQuantizedMatrix<qint8>(n, k, host.get())
+                          : CreateQuantizedMatrix<qint8>(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<qint32>(), TensorShape({m, n})), host.get());
+
+  const int32_t a_zero_point = 17;
+  const int32_t b_zero_point = -3;
+
+  cpu::QuantizedMatMulInt32Output output_kernel{
+      static_cast<int32_t*>(c->data()), n};
+
+  // The packed `b` operand is reused by the second MatMul.
+  auto packed_b = cpu::PackQuantizedMatMulRhs(b, transpose_b);
+  for (int i = 0; i < 2; ++i) {
+    std::fill_n(static_cast<int32_t*>(c->data()), m * n, 0);
+    ASSERT_FALSE((cpu::QuantizedMatMul<cpu::QuantizedMatMulInt32Output,
+                                       compat::SyncEigenEvaluator>(
+        a, packed_b, a_zero_point, b_zero_point, transpose_a, output_kernel,
+        &*c, exec_ctx)));
+    ExpectQuantizedMatMul(a, b, a_zero_point, b_zero_point, transpose_a,
+                          transpose_b, *c);
+  }
+}
+
+TEST(QuantizedKernelsTest, QuantizedMatMul) {
+  // Inner dimensions shorter than a SIMD register, with a tail, and with many
+  // registers.
+  for (Index k : {1, 7, 16, 64, 100, 515}) {
+    TestQuantizedMatMul(/*m=*/5, k, /*n=*/9, false, false);
+  }
+}
+
+TEST(QuantizedKernelsTest, QuantizedMatMulTransposed) {
+  TestQuantizedMatMul(/*m=*/13, /*k=*/70, /*n=*/6, true, false);
+  TestQuantizedMatMul(/*m=*/13, /*k=*/70, /*n=*/6, false, true);
+  TestQuantizedMatMul(/*m=*/13, /*k=*/70, /*n=*/6, true, true);
+}
+
+TEST(QuantizedKernelsTest, QuantizedMatMulLargeZeroPoints) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  // k * a_zero_point * b_zero_point overflows int32, but the accumulators do
+  // not, as every `a` value is one level below the `a` zero point.
+  const Index m = 3, k = 70000, n = 5;
+  const int32_t a_zero_point = 255;
+  const int32_t b_zero_point = -128;
+
+  auto a = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<quint8>(), TensorShape({m, k})), host.get());
+  std::fill_n(static_cast<uint8_t*>(a->data()), m * k, 254);
+  DenseHostTensor b = CreateQuantizedMatrix<qint8>(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<qint32>(), TensorShape({m, n})), host.get());
+
+  cpu::QuantizedMatMulInt32Output output_kernel{
+      static_cast<int32_t*>(c->data()), n};
+  ASSERT_FALSE((cpu::QuantizedMatMul<cpu::QuantizedMatMulInt32Output,
+                                     compat::SyncEigenEvaluator>(
+      *a, b, a_zero_point, b_zero_point, false, false, output_kernel, &*c,
+      exec_ctx)));
+  ExpectQuantizedMatMul(*a, b, a_zero_point, b_zero_point, false, false, *c);
+}
+
+TEST(QuantizedKernelsTest, QuantizedMatMulRequantize) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  const Index m = 4, k = 33, n = 5;
+  DenseHostTensor a = CreateQuantizedMatrix<quint8>(m, k, host.get());
+  DenseHostTensor b = CreateQuantizedMatrix<qint8>(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<qint8>(), TensorShape({m, n})), host.get());
+
+  cpu::QuantizedRange<uint8_t> a_range(-1.0f, 2.0f);
+  cpu::QuantizedRange<int8_t> b_range(-0.5f, 0.5f);
+  cpu::QuantizedRange<int8_t> c_range(-16.0f, 16.0f);
+  const std::vector<float> bias = {-1.0f, 0.0f, 0.5f, 1.0f, 2.0f};
+
+  using OutputKernel = cpu::QuantizedMatMulRequantizeOutput<int8_t>;
+  OutputKernel output_kernel{
+      static_cast<int8_t*>(c->data()), n,
+      a_range.FloatForOneLevel() * b_range.FloatForOneLevel(), bias, c_range};
+  ASSERT_FALSE(
+      (cpu::QuantizedMatMul<OutputKernel, compat::SyncEigenEvaluator>(
+          a, b, a_range.ZeroPoint(), b_range.ZeroPoint(), false, false,
+          output_kernel, &*c, exec_ctx)));
+
+  // Compare with the float matmul of the dequantized values.
+  DHTIndexableView<quint8, 2> a_view(&a);
+  DHTIndexableView<qint8, 2> b_view(&b);
+  DHTIndexableView<qint8, 2> c_view(&*c);
+  for (Index i = 0; i < m; ++i) {
+    for (Index j = 0; j < n; ++j) {
+      double expected = bias[j];
+      for (Index p = 0; p < k; ++p) {
+        expected += a_range.Dequantize(a_view.ElementAt(i, p).value) *
+                    b_range.Dequantize(b_view.ElementAt(p, j).value);
+      }
+      EXPECT_NEAR(c_range.Dequantize(c_view.ElementAt(i, j).value), expected,
+                  c_range.FloatForOneLevel())
+          << "at [" << i << ", " << j << "]";
+    }
+  }
+}
+
+TEST(QuantizedKernelsTest, QuantizeDequantize) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  auto input = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({1000}), host.get());
+  MutableDHTArrayView<float> input_view(&*input);
+  for (int i = 0; i < 1000; ++i) input_view[i] = -5.0f + i * 0.01f;
+
+  auto quantized = DenseHostTensor::CreateUninitialized<quint8>(
+      TensorShape({1000}), host.get());
+  auto dequantized = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({1000}), host.get());
+
+  cpu::QuantizedRange<uint8_t> range(-5.0f, 5.0f);
+  ASSERT_FALSE((cpu::Quantize<uint8_t, compat::SyncEigenEvaluator>(
+      *input, range, &*quantized, exec_ctx)));
+  ASSERT_FALSE((cpu::Dequantize<uint8_t, compat::SyncEigenEvaluator>(
+      *quantized, range, &*dequantized, exec_ctx)));
+
+  DHTArrayView<float> dequantized_view(&*dequantized);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_NEAR(dequantized_view[i], input_view[i], range.FloatForOneLevel());
+  }
+}
+
+}  // namespace
+
+// Benchmarks the quantized matmul against the float matmul of the same shape.
+void QuantizedMatMul(benchmark::State& state, int num_threads, Index m,
+                     Index k, Index n) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor a = CreateQuantizedMatrix<quint8>(m, k, host.get());
+  DenseHostTensor b = CreateQuantizedMatrix<qint8>(k, n, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<qint32>(), TensorShape({m, n})), host.get());
+
+  cpu::QuantizedMatMulInt32Output output_kernel{
+      static_cast<int32_t*>(c->data()), n};
+
+  // `b` is a constant weight, which is packed once.
+  auto packed_b = cpu::PackQuantizedMatMulRhs(b, /*transpose_b=*/false);
+
+  for (auto _ : state) {
+    auto done = cpu::QuantizedMatMul<cpu::QuantizedMatMulInt32Output,
+                                     compat::AsyncEigenEvaluator>(
+        a, packed_b, /*a_zero_point=*/3, /*b_zero_point=*/0, false,
+        output_kernel, &*c, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * k * n * state.iterations());
+}
+
+void FloatMatMul(benchmark::State& state, int num_threads, Index m, Index k,
+                 Index n) {
+  auto host = CreateTestHostContext(num_threads);
+
+  auto a = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, k}),
+                                                       host.get());
+  auto b = DenseHostTensor::CreateUninitialized<float>(TensorShape({k, n}),
+                                                       host.get());
+  auto c = DenseHostTensor::CreateUninitialized<float>(TensorShape({m, n}),
+                                                       host.get());
+  MutableDHTArrayView<float>(&*a).Fill(0.5f);
+  MutableDHTArrayView<float>(&*b).Fill(0.25f);
+
+  for (auto _ : state) {
+    auto done = cpu::MatMul<float>(1.0, *a, *b, 0.0, &*c, false, false,
+                                   Eigen::NoOpOutputKernel(),
+                                   compat::AsyncEigenEvaluator(host.get()));
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * k * n * state.iterations());
+}
+
+#define BM_MatMul(threads, m, k, n)                                  \
+  static void BM_QuantizedMatMul_##m##x##k##x##n##_tpool_##threads(  \
+      benchmark::State& state) {                                     \
+    QuantizedMatMul(state, threads, m, k, n);                        \
+  }                                                                  \
+  BENCHMARK(BM_QuantizedMatMul_##m##x##k##x##n##_tpool_##threads);   \
+  static void BM_FloatMatMul_##m##x##k##x##n##_tpool_##threads(      \
+      benchmark::State& state) {                                     \
+    FloatMatMul(state, threads, m, k, n);                            \
+  }                                                                  \
+  BENCHMARK(BM_FloatMatMul_##m##x##k##x##n##_tpool_##threads)
+
+// Small batch inference.
+BM_MatMul(1, 1, 1024, 1024);
+BM_MatMul(4, 16, 1024, 1024);
+
+// Large batch inference.
+BM_MatMul(4, 256, 1024, 1024);
+BM_MatMul(8, 512, 2048, 512);
+
+}  // namespace tfrt
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// F16 and BF16 kernels tests and benchmarks.
+
+#include "../../lib/kernels/reduced_precision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../../lib/kernels/matmul_kernel.h"
+#include "../../lib/kernels/softmax_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Creates the [rows, cols] matrix of type T with random values.
+template <typename T>
+DenseHostTensor CreateMatrix(Index rows, Index cols, float range,
+                             HostContext* host) {
+  auto matrix = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape({rows, cols})), host);
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<float> dist(-range, range);
+  std::vector<float> values(rows * cols);
+  for (float& value : values) value = dist(engine);
+  cpu::ConvertValues(values.data(), static_cast<T*>(matrix->data()),
+                     values.size());
+  return std::move(*matrix);
+}
+
+// Returns the tensor values converted to a float tensor.
+template <typename T>
+DenseHostTensor ToFloat(const DenseHostTensor& tensor, HostContext* host) {
+  auto result = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(), tensor.shape()), host);
+  cpu::ConvertValues(static_cast<const T*>(tensor.data()),
+                     static_cast<float*>(result->data()),
+                     tensor.NumElements());
+  return std::move(*result);
+}
+
+// Checks that the reduced precision results match the float results rounded
+// to the reduced precision type.
+template <typename T>
+void ExpectNear(const DenseHostTensor& result, const DenseHostTensor& expected,
+                HostContext* host) {
+  DenseHostTensor result_float = ToFloat<T>(result, host);
+  DHTArrayView<float> result_view(&result_float);
+  DHTArrayView<float> expected_view(&expected);
+  ASSERT_EQ(result_view.NumElements(), expected_view.NumElements());
+
+  const float tolerance = static_cast<float>(Eigen::NumTraits<T>::epsilon());
+  for (size_t i = 0; i < result_view.NumElements(); ++i) {
+    EXPECT_NEAR(result_view[i], expected_view[i],
+                tolerance * std::max(1.0f, std::abs(expected_view[i])))
+        << "at " << i;
+  }
+}
+
+template <typename T>
+void TestMatMul(Index m, Index k, Index n, bool transpose_a,
+                bool transpose_b) {
+  auto host = CreateTestHostContext(4);
+  compat::SyncEigenEvaluator eigen(host.get());
+
+  DenseHostTensor a = transpose_a ? CreateMatrix<T>(k, m, 1.0, host.get())
+                                  : CreateMatrix<T>(m, k, 1.0, host.get());
+  DenseHostTensor b = transpose_b ? CreateMatrix<T>(n, k, 1.0, host.get())
+                                  : CreateMatrix<T>(k, n, 1.0, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape({m, n})), host.get());
+  ASSERT_FALSE(cpu::MatMul<T>(1.0, a, b, 0.0, &*c, transpose_a, transpose_b,
+                              Eigen::NoOpOutputKernel(), eigen));
+
+  // The inputs are exactly representable in float.
+  DenseHostTensor a_float = ToFloat<T>(a, host.get());
+  DenseHostTensor b_float = ToFloat<T>(b, host.get());
+  auto expected = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(), TensorShape({m, n})), host.get());
+  ASSERT_FALSE(cpu::MatMul<float>(1.0, a_float, b_float, 0.0, &*expected,
+                                  transpose_a, transpose_b,
+                                  Eigen::NoOpOutputKernel(), eigen));
+
+  ExpectNear<T>(*c, *expected, host.get());
+}
+
+template <typename T>
+void TestSoftmax(Index batch_size, Index num_classes) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits =
+      CreateMatrix<T>(batch_size, num_classes, 20.0, host.get());
+  auto softmax =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+  ASSERT_FALSE((cpu::Softmax<T, false, compat::SyncEigenEvaluator>(
+      logits, &*softmax, exec_ctx)));
+
+  DenseHostTensor logits_float = ToFloat<T>(logits, host.get());
+  auto expected =
+      DenseHostTensor::CreateUninitialized(logits_float.metadata(), host.get());
+  ASSERT_FALSE((cpu::Softmax<float, false, compat::SyncEigenEvaluator>(
+      logits_float, &*expected, exec_ctx)));
+
+  ExpectNear<T>(*softmax, *expected, host.get());
+}
+
+TEST(ReducedPrecisionKernelsTest, HalfMatMul) {
+  for (Index k : {1, 7, 64, 300}) {
+    TestMatMul<Eigen::half>(13, k, 37, false, false);
+    TestMatMul<Eigen::half>(13, k, 37, true, false);
+    TestMatMul<Eigen::half>(13, k, 37, false, true);
+  }
+}
+
+TEST(ReducedPrecisionKernelsTest, BFloat16MatMul) {
+  for (Index k : {1, 7, 64, 300}) {
+    TestMatMul<Eigen::bfloat16>(13, k, 37, false, false);
+    TestMatMul<Eigen::bfloat16>(13, k, 37, true, false);
+    TestMatMul<Eigen::bfloat16>(13, k, 37, false, true);
+  }
+}
+
+TEST(ReducedPrecisionKernelsTest, Softmax) {
+  for (Index num_classes : {1, 13, 1027}) {
+    TestSoftmax<Eigen::half>(/*batch_size=*/5, num_classes);
+    TestSoftmax<Eigen::bfloat16>(/*batch_size=*/5, num_classes);
+  }
+}
+
+TEST(ReducedPrecisionKernelsTest, ConvertValues) {
+  std::vector<float> values = {0.0f, -1.0f, 0.5f, 3.0f, -256.0f, 1024.0f};
+  std::vector<Eigen::bfloat16> bf16(values.size());
+  std::vector<Eigen::half> f16(values.size());
+  std::vector<float> result(values.size());
+
+  cpu::ConvertValues(values.data(), bf16.data(), values.size());
+  cpu::ConvertValues(bf16.data(), f16.data(), bf16.size());
+  cpu::ConvertValues(f16.data(), result.data(), f16.size());
+  EXPECT_EQ(result, values);
+}
+
+}  // namespace
+
+template <typename T>
+void MatMul(benchmark::State& state, int num_threads, Index m, Index k,
+            Index n) {
+  auto host = CreateTestHostContext(num_threads);
+
+  DenseHostTensor a = CreateMatrix<T>(m, k, 1.0, host.get());
+  DenseHostTensor b = CreateMatrix<T>(k, n, 1.0, host.get());
+  auto c = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape({m, n})), host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::MatMul<T>(1.0, a, b, 0.0, &*c, false, false,
+                               Eigen::NoOpOutputKernel(),
+                               compat::AsyncEigenEvaluator(host.get()));
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(m * k * n * state.iterations());
+}
+
+template <typename T>
+void Softmax(benchmark::State& state, int num_threads, Index batch_size,
+             Index num_classes) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits =
+      CreateMatrix<T>(batch_size, num_classes, 20.0, host.get());
+  auto softmax =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::Softmax<T, false, compat::AsyncEigenEvaluator>(
+        logits, &*softmax, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(batch_size * num_classes * state.iterations());
+}
+
+#define BM_MatMul(threads, m, k, n)                                  \
+  static void BM_FloatMatMul_##m##x##k##x##n##_tpool_##threads(      \
+      benchmark::State& state) {                                     \
+    MatMul<float>(state, threads, m, k, n);                          \
+  }                                                                  \
+  BENCHMARK(BM_FloatMatMul_##m##x##k##x##n##_tpool_##threads);       \
+  static void BM_HalfMatMul_##m##x##k##x##n##_tpool_##threads(       \
+      benchmark::State& state) {                                     \
+    MatMul<Eigen::half>(state, threads, m, k, n);                    \
+  }                                                                  \
+  BENCHMARK(BM_HalfMatMul_##m##x##k##x##n##_tpool_##threads);        \
+  static void BM_BFloat16MatMul_##m##x##k##x##n##_tpool_##threads(   \
+      benchmark::State& state) {                                     \
+    MatMul<Eigen::bfloat16>(state, threads, m, k, n);                \
+  }                                                                  \
+  BENCHMARK(BM_BFloat16MatMul_##m##x##k##x##n##_tpool_##threads)
+
+#define BM_Softmax(threads, batch, classes)                             \
+  static void BM_FloatSoftmax_##batch##x##classes##_tpool_##threads(    \
+      benchmark::State& state) {                                        \
+    Softmax<float>(state, threads, batch, classes);                     \
+  }                                                                     \
+  BENCHMARK(BM_FloatSoftmax_##batch##x##classes##_tpool_##threads);     \
+  static void BM_BFloat16Softmax_##batch##x##classes##_tpool_##threads( \
+      benchmark::State& state) {                                        \
+    Softmax<Eigen::bfloat16>(state, threads, batch, classes);           \
+  }                                                                     \
+  BENCHMARK(BM_BFloat16Softmax_##batch##x##classes##_tpool_##threads)
+
+BM_MatMul(1, 1, 1024, 1024);
+BM_MatMul(4, 256, 1024, 1024);
+BM_MatMul(8, 512, 2048, 512);
+
+BM_Softmax(4, 256, 1000);
+BM_Softmax(4, 8, 100000);
+
+}  // namespace tfrt
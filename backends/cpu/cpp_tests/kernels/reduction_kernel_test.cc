@@ -0,0 +1,300 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reduction kernel tests and benchmarks.
+
+#include "../../lib/kernels/reduction_kernel.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Creates an input with small values of both signs, so that the reductions
+// are exact.
+template <typename T>
+DenseHostTensor CreateInput(ArrayRef<Index> dims, HostContext* host) {
+  return CreateTestTensor<T>(
+      dims,
+      [](size_t i) { return static_cast<T>(static_cast<int>(i * 7 % 13) - 6); },
+      host);
+}
+
+llvm::SmallVector<Index, 5> ReducedDims(ArrayRef<Index> dims,
+                                        ArrayRef<int32_t> reduction_indices) {
+  llvm::SmallVector<Index, 5> output_dims;
+  for (int d = 0; d < static_cast<int>(dims.size()); ++d) {
+    if (!llvm::is_contained(reduction_indices, d))
+      output_dims.push_back(dims[d]);
+  }
+  return output_dims;
+}
+
+// Reduces the input with the double precision reference reducer, visiting
+// input elements in row major order.
+template <typename T, typename ReduceFn>
+std::vector<double> ReferenceReduce(const DenseHostTensor& input,
+                                    ArrayRef<int32_t> reduction_indices,
+                                    double init, ReduceFn reduce) {
+  llvm::SmallVector<Index, 5> dims;
+  input.shape().GetDimensions(&dims);
+  llvm::SmallVector<Index, 5> output_dims =
+      ReducedDims(dims, reduction_indices);
+
+  Index num_outputs = 1;
+  for (Index dim : output_dims) num_outputs *= dim;
+  std::vector<double> output(num_outputs, init);
+
+  const int rank = dims.size();
+  DHTArrayView<T> input_view(&input);
+  llvm::SmallVector<Index, 5> index(rank, 0);
+  for (size_t i = 0; i < input_view.NumElements(); ++i) {
+    Index offset = 0;
+    for (int d = 0; d < rank; ++d) {
+      if (!llvm::is_contained(reduction_indices, d))
+        offset = offset * dims[d] + index[d];
+    }
+    output[offset] =
+        reduce(output[offset], static_cast<double>(input_view[i]));
+
+    // Increment the input index.
+    for (int d = rank - 1; d >= 0 && ++index[d] == dims[d]; --d) index[d] = 0;
+  }
+  return output;
+}
+
+template <template <typename> class Reducer, typename T>
+DenseHostTensor RunReduce(const DenseHostTensor& input,
+                          ArrayRef<int32_t> reduction_indices,
+                          HostContext* host) {
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host);
+
+  llvm::SmallVector<Index, 5> dims;
+  input.shape().GetDimensions(&dims);
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(),
+                     TensorShape(ReducedDims(dims, reduction_indices))),
+      host);
+
+  auto done = cpu::Reduce<Reducer, T>(input, reduction_indices, &*output,
+                                      exec_ctx);
+  host->Await(done.CopyRCRef());
+  EXPECT_FALSE(done.IsError());
+  return std::move(*output);
+}
+
+template <typename T>
+void TestReductions(ArrayRef<Index> dims,
+                    ArrayRef<int32_t> reduction_indices) {
+  auto host = CreateTestHostContext(4);
+  DenseHostTensor input = CreateInput<T>(dims, host.get());
+
+  Index num_reduced = 1;
+  for (int32_t d : reduction_indices) num_reduced *= dims[d];
+
+  auto check = [&](const DenseHostTensor& output,
+                   const std::vector<double>& expected) {
+    DHTArrayView<T> output_view(&output);
+    ASSERT_EQ(output_view.NumElements(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_NEAR(static_cast<double>(output_view[i]), expected[i], 1e-3)
+          << "at " << i;
+    }
+  };
+
+  std::vector<double> sum = ReferenceReduce<T>(
+      input, reduction_indices, 0.0, [](double a, double b) { return a + b; });
+  check(RunReduce<cpu::SumReducer, T>(input, reduction_indices, host.get()),
+        sum);
+
+  // Max and min of the empty reductions are the lowest and the highest values.
+  if (num_reduced == 0) return;
+
+  // Integer means are truncated towards zero.
+  std::vector<double> mean = sum;
+  for (double& value : mean) value = static_cast<T>(value / num_reduced);
+  check(RunReduce<cpu::MeanReducer, T>(input, reduction_indices, host.get()),
+        mean);
+
+  check(RunReduce<cpu::MaxReducer, T>(input, reduction_indices, host.get()),
+        ReferenceReduce<T>(input, reduction_indices, -1e9,
+                           [](double a, double b) { return std::max(a, b); }));
+
+  check(RunReduce<cpu::MinReducer, T>(input, reduction_indices, host.get()),
+        ReferenceReduce<T>(input, reduction_indices, 1e9,
+                           [](double a, double b) { return std::min(a, b); }));
+}
+
+template <typename T>
+void TestReductions() {
+  // Full reductions.
+  TestReductions<T>({}, {});
+  TestReductions<T>({1}, {0});
+  TestReductions<T>({1000}, {0});
+  TestReductions<T>({3, 70, 2}, {0, 1, 2});
+
+  // Inner (row) reductions.
+  TestReductions<T>({37, 300}, {1});
+  TestReductions<T>({4, 5, 6}, {1, 2});
+
+  // Outer (column) reductions.
+  TestReductions<T>({300, 37}, {0});
+  TestReductions<T>({5, 1000, 3}, {1});
+  TestReductions<T>({2, 3, 4, 5}, {0, 1});
+
+  // Reductions of the non-adjacent dimensions.
+  TestReductions<T>({4, 5, 6}, {0, 2});
+  TestReductions<T>({2, 3, 4, 5}, {1, 3});
+  TestReductions<T>({2, 3, 1, 4, 5}, {0, 2, 4});
+
+  // Small outer dimensions with a long reduced dimension.
+  TestReductions<T>({2, 20000}, {1});
+  TestReductions<T>({20000, 3}, {0});
+
+  // Empty reductions.
+  TestReductions<T>({0, 3}, {0});
+  TestReductions<T>({3, 0}, {0});
+}
+
+TEST(ReductionKernelTest, Float) { TestReductions<float>(); }
+TEST(ReductionKernelTest, Double) { TestReductions<double>(); }
+TEST(ReductionKernelTest, Int32) { TestReductions<int32_t>(); }
+TEST(ReductionKernelTest, Int64) { TestReductions<int64_t>(); }
+
+TEST(ReductionKernelTest, Prod) {
+  auto host = CreateTestHostContext(4);
+  auto input = CreateTestTensor<int64_t>(
+      {3, 4}, [](size_t i) { return i + 1; }, host.get());
+
+  auto output = RunReduce<cpu::ProdReducer, int64_t>(input, {0}, host.get());
+  DHTArrayView<int64_t> output_view(&output);
+  EXPECT_EQ(output_view[0], 1 * 5 * 9);
+  EXPECT_EQ(output_view[1], 2 * 6 * 10);
+  EXPECT_EQ(output_view[2], 3 * 7 * 11);
+  EXPECT_EQ(output_view[3], 4 * 8 * 12);
+}
+
+TEST(ReductionKernelTest, AllAny) {
+  auto host = CreateTestHostContext(4);
+  const bool values[] = {true, false, true, true, true, false};
+  auto input = CreateTestTensor<bool>(
+      {3, 2}, [&](size_t i) { return values[i]; }, host.get());
+
+  auto all = RunReduce<cpu::AllReducer, bool>(input, {1}, host.get());
+  DHTArrayView<bool> all_view(&all);
+  EXPECT_FALSE(all_view[0]);
+  EXPECT_TRUE(all_view[1]);
+  EXPECT_FALSE(all_view[2]);
+
+  auto any = RunReduce<cpu::AnyReducer, bool>(input, {0}, host.get());
+  DHTArrayView<bool> any_view(&any);
+  EXPECT_TRUE(any_view[0]);
+  EXPECT_TRUE(any_view[1]);
+}
+
+TEST(ReductionKernelTest, HalfMean) {
+  auto host = CreateTestHostContext(4);
+  auto input = CreateTestTensor<Eigen::half>(
+      {4096}, [](size_t) { return Eigen::half(1.5f); }, host.get());
+
+  // Half precision accumulation loses the fraction once the sum exceeds 2048.
+  auto output = RunReduce<cpu::MeanReducer, Eigen::half>(input, {0},
+                                                         host.get());
+  EXPECT_EQ(static_cast<float>(DHTArrayView<Eigen::half>(&output)[0]), 1.5f);
+}
+
+TEST(ReductionKernelTest, SumPrecision) {
+  auto host = CreateTestHostContext(4);
+  const Index size = 10000000;
+  auto input = CreateTestTensor<float>(
+      {size}, [](size_t) { return 0.1f; }, host.get());
+
+  // Sequential float summation is off by more than 8%.
+  auto output = RunReduce<cpu::SumReducer, float>(input, {0}, host.get());
+  EXPECT_NEAR(DHTArrayView<float>(&output)[0], 1e6, 1.0);
+}
+
+}  // namespace
+
+static void Reduce(benchmark::State& state, int num_threads,
+                   ArrayRef<Index> dims, ArrayRef<int32_t> reduction_indices) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input = CreateInput<float>(dims, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape(ReducedDims(dims, reduction_indices))),
+      host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::Reduce<cpu::SumReducer, float>(input, reduction_indices,
+                                                    &*output, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetBytesProcessed(input.DataSizeInBytes() * state.iterations());
+}
+
+#define BM_Reduce(name, threads, dims, reduction_indices) \
+  static void BM_Reduce_##name##_tpool_##threads(         \
+      benchmark::State& state) {                          \
+    Reduce(state, threads, dims, reduction_indices);      \
+  }                                                       \
+  BENCHMARK(BM_Reduce_##name##_tpool_##threads)
+
+#define DIMS(...) \
+  { __VA_ARGS__ }
+
+// Reduction of the innermost dimension (e.g. softmax or layer norm rows).
+BM_Reduce(Inner, 1, DIMS(4096, 1024), DIMS(1));
+BM_Reduce(Inner, 8, DIMS(4096, 1024), DIMS(1));
+
+// Reduction of the outermost dimension (e.g. bias gradient).
+BM_Reduce(Outer, 1, DIMS(4096, 1024), DIMS(0));
+BM_Reduce(Outer, 8, DIMS(4096, 1024), DIMS(0));
+
+// Full reduction.
+BM_Reduce(Full, 1, DIMS(4194304), DIMS(0));
+BM_Reduce(Full, 8, DIMS(4194304), DIMS(0));
+
+// NHWC spatial reduction (global average pooling).
+BM_Reduce(Spatial, 1, DIMS(32, 56, 56, 64), DIMS(1, 2));
+BM_Reduce(Spatial, 8, DIMS(32, 56, 56, 64), DIMS(1, 2));
+
+// NHWC batch norm statistics.
+BM_Reduce(BatchNorm, 1, DIMS(32, 56, 56, 64), DIMS(0, 1, 2));
+BM_Reduce(BatchNorm, 8, DIMS(32, 56, 56, 64), DIMS(0, 1, 2));
+
+// Non-adjacent reduced dimensions.
+BM_Reduce(Transposed, 1, DIMS(32, 64, 56, 56), DIMS(0, 2));
+BM_Reduce(Transposed, 8, DIMS(32, 64, 56, 56), DIMS(0, 2));
+
+}  // namespace tfrt
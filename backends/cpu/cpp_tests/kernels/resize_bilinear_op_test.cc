@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bilinear image resize tests and benchmarks.
+
+#include "../../lib/kernels/image/resize_bilinear_op.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+template <typename T>
+DenseHostTensor CreateImages(Index batch, Index height, Index width,
+                             Index channels, HostContext* host) {
+  auto tensor = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(),
+                     TensorShape({batch, height, width, channels})),
+      host);
+  MutableDHTArrayView<T> view(&*tensor);
+  for (size_t i = 0; i < view.NumElements(); ++i) view[i] = T(i * 37 % 256);
+  return std::move(*tensor);
+}
+
+// Interpolates a single output value as in tf.image.resize.
+template <typename T>
+float ReferenceResize(DHTArrayView<T> input, Index height, Index width,
+                      Index channels, Index out_height, Index out_width,
+                      Index b, Index y, Index x, Index c,
+                      const image::ResizeOptions& options) {
+  auto source = [&](Index i, Index in_size, Index out_size) {
+    const float scale = (options.align_corners && out_size > 1)
+                            ? (in_size - 1) / static_cast<float>(out_size - 1)
+                            : in_size / static_cast<float>(out_size);
+    return options.half_pixel_centers ? (i + 0.5f) * scale - 0.5f : i * scale;
+  };
+
+  const float in_y = source(y, height, out_height);
+  const float in_x = source(x, width, out_width);
+  const Index y0 = std::max<Index>(std::floor(in_y), 0);
+  const Index y1 = std::min<Index>(std::ceil(in_y), height - 1);
+  const Index x0 = std::max<Index>(std::floor(in_x), 0);
+  const Index x1 = std::min<Index>(std::ceil(in_x), width - 1);
+  const float y_lerp = in_y - std::floor(in_y);
+  const float x_lerp = in_x - std::floor(in_x);
+
+  auto at = [&](Index yy, Index xx) -> float {
+    return input[((b * height + yy) * width + xx) * channels + c];
+  };
+  const float top = at(y0, x0) + (at(y0, x1) - at(y0, x0)) * x_lerp;
+  const float bottom = at(y1, x0) + (at(y1, x1) - at(y1, x0)) * x_lerp;
+  return top + (bottom - top) * y_lerp;
+}
+
+template <typename T>
+void TestResize(Index batch, Index height, Index width, Index channels,
+                Index out_height, Index out_width,
+                const image::ResizeOptions& options) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input =
+      CreateImages<T>(batch, height, width, channels, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape({batch, out_height, out_width, channels})),
+      host.get());
+
+  auto done = image::resize_image(input, options, &*output, exec_ctx);
+  host->Await(done.CopyRCRef());
+  ASSERT_FALSE(done.IsError());
+
+  DHTArrayView<T> input_view(&input);
+  DHTArrayView<float> output_view(&*output);
+  for (Index b = 0; b < batch; ++b)
+    for (Index y = 0; y < out_height; ++y)
+      for (Index x = 0; x < out_width; ++x)
+        for (Index c = 0; c < channels; ++c) {
+          const Index i = ((b * out_height + y) * out_width + x) * channels + c;
+          ASSERT_NEAR(output_view[i],
+                      ReferenceResize(input_view, height, width, channels,
+                                      out_height, out_width, b, y, x, c,
+                                      options),
+                      1e-3)
+              << "at " << b << ", " << y << ", " << x << ", " << c;
+        }
+}
+
+template <typename T>
+void TestResizes(const image::ResizeOptions& options) {
+  for (Index channels : {1, 3, 4, 5}) {
+    TestResize<T>(1, 1, 1, channels, 3, 2, options);
+    TestResize<T>(1, 7, 5, channels, 7, 5, options);
+    TestResize<T>(2, 13, 17, channels, 5, 6, options);
+    TestResize<T>(3, 17, 13, channels, 40, 31, options);
+    TestResize<T>(1, 480, 640, channels, 224, 224, options);
+  }
+}
+
+TEST(ResizeBilinearTest, Legacy) {
+  TestResizes<uint8_t>({});
+  TestResizes<float>({});
+}
+
+TEST(ResizeBilinearTest, AlignCorners) {
+  image::ResizeOptions options;
+  options.align_corners = true;
+  TestResizes<uint8_t>(options);
+  TestResizes<float>(options);
+}
+
+TEST(ResizeBilinearTest, HalfPixelCenters) {
+  image::ResizeOptions options;
+  options.half_pixel_centers = true;
+  TestResizes<uint8_t>(options);
+  TestResizes<float>(options);
+}
+
+TEST(ResizeBilinearTest, CachedTables) {
+  image::ResizeOptions options;
+  auto table = image::GetInterpolationTable(480, 224, options);
+  EXPECT_EQ(table, image::GetInterpolationTable(480, 224, options));
+  EXPECT_EQ(table->size(), 224u);
+
+  options.half_pixel_centers = true;
+  EXPECT_NE(table, image::GetInterpolationTable(480, 224, options));
+}
+
+}  // namespace
+
+static void ResizeBilinear(benchmark::State& state, int num_threads,
+                           Index channels, Index size) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  const Index batch = 8;
+  DenseHostTensor input =
+      CreateImages<uint8_t>(batch, 480, 640, channels, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape({batch, size, size, channels})),
+      host.get());
+
+  image::ResizeOptions options;
+  options.half_pixel_centers = true;
+
+  for (auto _ : state) {
+    auto done = image::resize_image(input, options, &*output, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(batch * state.iterations());
+}
+
+#define BM_ResizeBilinear(channels, size, threads)                        \
+  static void BM_ResizeBilinear_##channels##c_##size##_tpool_##threads(   \
+      benchmark::State& state) {                                          \
+    ResizeBilinear(state, threads, channels, size);                       \
+  }                                                                       \
+  BENCHMARK(BM_ResizeBilinear_##channels##c_##size##_tpool_##threads)
+
+// Resize of the [8, 480, 640, C] uint8 images to the common model input
+// sizes (items are images).
+BM_ResizeBilinear(3, 224, 1);
+BM_ResizeBilinear(3, 224, 8);
+BM_ResizeBilinear(3, 299, 1);
+BM_ResizeBilinear(3, 299, 8);
+BM_ResizeBilinear(3, 512, 1);
+BM_ResizeBilinear(3, 512, 8);
+BM_ResizeBilinear(4, 224, 8);
+BM_ResizeBilinear(1, 224, 8);
+
+}  // namespace tfrt
@@ -0,0 +1,218 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Softmax kernel tests and benchmarks.
+
+#include "../../lib/kernels/softmax_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+DenseHostTensor CreateLogits(Index batch_size, Index num_classes,
+                             HostContext* host) {
+  auto logits = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(), TensorShape({batch_size, num_classes})),
+      host);
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<float> dist(-20.0f, 20.0f);
+  MutableDHTArrayView<float> view(&*logits);
+  for (float& value : view.Elements()) value = dist(engine);
+  return std::move(*logits);
+}
+
+// Compares the softmax computed by the kernel with the softmax computed in
+// double precision. Masked (-inf) logits have zero probability, and rows with
+// only masked logits have zero probabilities for all classes.
+template <bool log>
+void ExpectSoftmax(const DenseHostTensor& logits,
+                   const DenseHostTensor& softmax) {
+  constexpr double kMasked = -std::numeric_limits<double>::infinity();
+  const Index batch_size = logits.shape().GetDimensionSize(0);
+  const Index num_classes = logits.shape().GetDimensionSize(1);
+
+  DHTIndexableView<float, 2> logits_view(&logits);
+  DHTIndexableView<float, 2> softmax_view(&softmax);
+  for (Index row = 0; row < batch_size; ++row) {
+    double max = kMasked;
+    for (Index i = 0; i < num_classes; ++i)
+      max = std::max<double>(max, logits_view.ElementAt(row, i));
+    double sum = 0.0;
+    for (Index i = 0; i < num_classes; ++i) {
+      if (logits_view.ElementAt(row, i) != kMasked)
+        sum += std::exp(logits_view.ElementAt(row, i) - max);
+    }
+
+    for (Index i = 0; i < num_classes; ++i) {
+      if (logits_view.ElementAt(row, i) == kMasked) {
+        EXPECT_EQ(softmax_view.ElementAt(row, i), log ? kMasked : 0.0)
+            << "at [" << row << ", " << i << "]";
+        continue;
+      }
+      double shifted = logits_view.ElementAt(row, i) - max;
+      double expected = log ? shifted - std::log(sum) : std::exp(shifted) / sum;
+      EXPECT_NEAR(softmax_view.ElementAt(row, i), expected,
+                  1e-5 * std::max(1.0, std::abs(expected)))
+          << "at [" << row << ", " << i << "]";
+    }
+  }
+}
+
+// Computes softmax of the logits with the kernel and compares the result with
+// the softmax computed in double precision.
+template <bool log>
+void TestSoftmax(Index batch_size, Index num_classes) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits = CreateLogits(batch_size, num_classes, host.get());
+  auto softmax =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+
+  Error error = cpu::Softmax<float, log, compat::SyncEigenEvaluator>(
+      logits, &*softmax, exec_ctx);
+  ASSERT_FALSE(error);
+  ExpectSoftmax<log>(logits, *softmax);
+}
+
+// Computes softmax of the logits with a fully masked row, and partly masked
+// rows (masked first and last classes, and masked packet lanes).
+template <bool log>
+void TestMaskedSoftmax(Index num_classes) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits = CreateLogits(4, num_classes, host.get());
+  const float masked = -std::numeric_limits<float>::infinity();
+  MutableDHTIndexableView<float, 2> view(&logits);
+  for (Index i = 0; i < num_classes; ++i) {
+    view.ElementAt(0, i) = masked;
+    if (i % 4 == 0 || i == num_classes - 1) view.ElementAt(1, i) = masked;
+    if (i != num_classes - 1) view.ElementAt(2, i) = masked;
+  }
+
+  auto softmax =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+  Error error = cpu::Softmax<float, log, compat::SyncEigenEvaluator>(
+      logits, &*softmax, exec_ctx);
+  ASSERT_FALSE(error);
+  ExpectSoftmax<log>(logits, *softmax);
+}
+
+TEST(SoftmaxKernelTest, Softmax) {
+  // Rows shorter than a packet, with a tail, and with many packets.
+  for (Index num_classes : {1, 3, 8, 13, 100, 1027}) {
+    TestSoftmax</*log=*/false>(/*batch_size=*/5, num_classes);
+  }
+}
+
+TEST(SoftmaxKernelTest, LogSoftmax) {
+  for (Index num_classes : {1, 3, 8, 13, 100, 1027}) {
+    TestSoftmax</*log=*/true>(/*batch_size=*/5, num_classes);
+  }
+}
+
+TEST(SoftmaxKernelTest, MaskedSoftmax) {
+  // Rows shorter than a packet, and with packets and a tail.
+  for (Index num_classes : {3, 37}) {
+    TestMaskedSoftmax</*log=*/false>(num_classes);
+  }
+}
+
+TEST(SoftmaxKernelTest, MaskedLogSoftmax) {
+  for (Index num_classes : {3, 37}) {
+    TestMaskedSoftmax</*log=*/true>(num_classes);
+  }
+}
+
+TEST(SoftmaxKernelTest, InPlace) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits = CreateLogits(3, 37, host.get());
+  auto expected =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+  ASSERT_FALSE((cpu::Softmax<float, false, compat::SyncEigenEvaluator>(
+      logits, &*expected, exec_ctx)));
+
+  // The result buffer is forwarded from the logits by tf.Softmax.
+  DenseHostTensor softmax = logits.CopyRef();
+  ASSERT_FALSE((cpu::Softmax<float, false, compat::SyncEigenEvaluator>(
+      logits, &softmax, exec_ctx)));
+  EXPECT_EQ(softmax, *expected);
+}
+
+}  // namespace
+
+template <bool log>
+void Softmax(benchmark::State& state, int num_threads, Index batch_size,
+             Index num_classes) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor logits = CreateLogits(batch_size, num_classes, host.get());
+  auto softmax =
+      DenseHostTensor::CreateUninitialized(logits.metadata(), host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::Softmax<float, log, compat::AsyncEigenEvaluator>(
+        logits, &*softmax, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetItemsProcessed(batch_size * num_classes * state.iterations());
+}
+
+#define BM_Softmax(threads, batch, classes)                             \
+  static void BM_Softmax_##batch##x##classes##_tpool_##threads(         \
+      benchmark::State& state) {                                        \
+    Softmax</*log=*/false>(state, threads, batch, classes);             \
+  }                                                                     \
+  BENCHMARK(BM_Softmax_##batch##x##classes##_tpool_##threads);          \
+  static void BM_LogSoftmax_##batch##x##classes##_tpool_##threads(      \
+      benchmark::State& state) {                                        \
+    Softmax</*log=*/true>(state, threads, batch, classes);              \
+  }                                                                     \
+  BENCHMARK(BM_LogSoftmax_##batch##x##classes##_tpool_##threads)
+
+// Short rows.
+BM_Softmax(4, 1024, 10);
+BM_Softmax(4, 1024, 128);
+
+// Medium rows.
+BM_Softmax(4, 32, 1000);
+BM_Softmax(4, 256, 1000);
+
+// Large vocabulary.
+BM_Softmax(1, 1, 100000);
+BM_Softmax(4, 8, 100000);
+BM_Softmax(8, 64, 100000);
+
+}  // namespace tfrt
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tile kernel tests and benchmarks.
+
+#include "../../lib/kernels/tile_kernel.h"
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+llvm::SmallVector<Index, 5> TiledDims(ArrayRef<Index> dims,
+                                      ArrayRef<Index> multiples) {
+  llvm::SmallVector<Index, 5> output_dims;
+  for (int i = 0; i < dims.size(); ++i) {
+    output_dims.push_back(dims[i] * multiples[i]);
+  }
+  return output_dims;
+}
+
+// Returns the input offset of the output element `index`.
+Index TiledOffset(Index index, ArrayRef<Index> dims,
+                  ArrayRef<Index> multiples) {
+  Index offset = 0;
+  Index stride = 1;
+  for (int d = dims.size() - 1; d >= 0; --d) {
+    const Index output_dim = dims[d] * multiples[d];
+    offset += index % output_dim % dims[d] * stride;
+    index /= output_dim;
+    stride *= dims[d];
+  }
+  return offset;
+}
+
+template <typename T>
+void TestTile(ArrayRef<Index> dims, ArrayRef<Index> multiples) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input = CreateTestTensor<T>(dims, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape(TiledDims(dims, multiples))),
+      host.get());
+
+  ASSERT_FALSE(cpu::Tile<compat::SyncEigenEvaluator>(input, multiples,
+                                                     &*output, exec_ctx));
+
+  DHTArrayView<T> input_view(&input);
+  DHTArrayView<T> output_view(&*output);
+  for (size_t i = 0; i < output_view.NumElements(); ++i) {
+    ASSERT_EQ(output_view[i], input_view[TiledOffset(i, dims, multiples)])
+        << "at " << i;
+  }
+}
+
+template <typename T>
+void TestTiles() {
+  TestTile<T>({}, {});
+  TestTile<T>({7}, {1});
+  TestTile<T>({7}, {3});
+  TestTile<T>({7}, {0});
+  TestTile<T>({0, 3}, {4, 2});
+  TestTile<T>({1, 1}, {5, 3});
+  TestTile<T>({5, 1}, {1, 300});
+  TestTile<T>({3, 4}, {2, 1});
+  TestTile<T>({3, 4}, {1, 2});
+  TestTile<T>({3, 4, 5}, {2, 3, 4});
+  TestTile<T>({3, 1, 5}, {1, 7, 1});
+  TestTile<T>({2, 3, 4, 5}, {3, 1, 2, 1});
+  TestTile<T>({2, 1, 3, 1, 2}, {1, 4, 1, 5, 3});
+  TestTile<T>({300, 2}, {2, 300});
+  TestTile<T>({1000}, {1000});
+}
+
+TEST(TileKernelTest, Bool) { TestTiles<bool>(); }
+TEST(TileKernelTest, Half) { TestTiles<Eigen::half>(); }
+TEST(TileKernelTest, Float) { TestTiles<float>(); }
+TEST(TileKernelTest, Int64) { TestTiles<int64_t>(); }
+
+TEST(TileKernelTest, String) {
+  auto host = CreateTestHostContext(4);
+  const llvm::SmallVector<Index, 3> dims = {2, 1, 3};
+  const llvm::SmallVector<Index, 3> multiples = {3, 4, 2};
+
+  auto input = StringHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::String), TensorShape(dims)), host.get());
+  for (int i = 0; i < input->NumElements(); ++i) {
+    input->strings()[i] = std::string(i + 1, 'a' + i);
+  }
+
+  auto output = StringHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::String),
+                     TensorShape(TiledDims(dims, multiples))),
+      host.get());
+  cpu::TileStringTensor(*input, &*output);
+
+  for (int i = 0; i < output->NumElements(); ++i) {
+    ASSERT_EQ(output->strings()[i],
+              input->strings()[TiledOffset(i, dims, multiples)])
+        << "at " << i;
+  }
+}
+
+}  // namespace
+
+static void Tile(benchmark::State& state, int num_threads,
+                 ArrayRef<Index> dims, ArrayRef<Index> multiples) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input = CreateTestTensor<float>(dims, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape(TiledDims(dims, multiples))),
+      host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::Tile<compat::AsyncEigenEvaluator>(input, multiples,
+                                                       &*output, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetBytesProcessed(output->DataSizeInBytes() * state.iterations());
+}
+
+// Eigen broadcast based tiling for comparison.
+template <int rank>
+static void EigenTile(benchmark::State& state, int num_threads,
+                      ArrayRef<Index> dims, ArrayRef<Index> multiples) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+  compat::AsyncEigenEvaluator eigen{exec_ctx};
+
+  DenseHostTensor input = CreateTestTensor<float>(dims, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape(TiledDims(dims, multiples))),
+      host.get());
+
+  auto input_t =
+      compat::AsEigenConstTensor(DHTIndexableView<float, rank>(&input));
+  auto output_t =
+      compat::AsEigenTensor(MutableDHTIndexableView<float, rank>(&*output));
+
+  Eigen::DSizes<Eigen::Index, rank> broadcast;
+  for (int i = 0; i < rank; ++i) broadcast[i] = multiples[i];
+
+  for (auto _ : state) {
+    auto done = eigen.Evaluate(output_t, input_t.broadcast(broadcast),
+                               eigen.KeepAlive(&input, &*output));
+    host->Await(done.CopyRCRef());
+  }
+
+  state.SetBytesProcessed(output->DataSizeInBytes() * state.iterations());
+}
+
+#define BM_Tile(name, threads, rank, dims, multiples)                 \
+  static void BM_Tile_##name##_tpool_##threads(                       \
+      benchmark::State& state) {                                      \
+    Tile(state, threads, dims, multiples);                            \
+  }                                                                   \
+  static void BM_EigenTile_##name##_tpool_##threads(                  \
+      benchmark::State& state) {                                      \
+    EigenTile<rank>(state, threads, dims, multiples);                 \
+  }                                                                   \
+  BENCHMARK(BM_Tile_##name##_tpool_##threads);                        \
+  BENCHMARK(BM_EigenTile_##name##_tpool_##threads)
+
+#define DIMS(...) \
+  { __VA_ARGS__ }
+
+// Tiling of the inner dimension.
+BM_Tile(Inner, 1, 2, DIMS(1024, 64), DIMS(1, 64));
+BM_Tile(Inner, 8, 2, DIMS(1024, 64), DIMS(1, 64));
+
+// Tiling of the outer dimension (e.g. batch replication).
+BM_Tile(Outer, 1, 2, DIMS(64, 1024), DIMS(64, 1));
+BM_Tile(Outer, 8, 2, DIMS(64, 1024), DIMS(64, 1));
+
+// Column vector broadcast.
+BM_Tile(Column, 1, 2, DIMS(4096, 1), DIMS(1, 256));
+BM_Tile(Column, 8, 2, DIMS(4096, 1), DIMS(1, 256));
+
+// NHWC spatial tiling.
+BM_Tile(Spatial, 1, 4, DIMS(8, 28, 28, 256), DIMS(1, 2, 2, 1));
+BM_Tile(Spatial, 8, 4, DIMS(8, 28, 28, 256), DIMS(1, 2, 2, 1));
+
+// Small input tiled along all dimensions.
+BM_Tile(Small, 1, 3, DIMS(32, 3, 4), DIMS(8, 16, 32));
+BM_Tile(Small, 8, 3, DIMS(32, 3, 4), DIMS(8, 16, 32));
+
+}  // namespace tfrt
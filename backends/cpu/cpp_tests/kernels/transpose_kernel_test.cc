@@ -0,0 +1,159 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Transpose kernel tests and benchmarks.
+
+#include "../../lib/kernels/transpose_kernel.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+llvm::SmallVector<Index, 5> TransposedDims(ArrayRef<Index> dims,
+                                           ArrayRef<Index> perm) {
+  llvm::SmallVector<Index, 5> output_dims;
+  for (Index dim : perm) output_dims.push_back(dims[dim]);
+  return output_dims;
+}
+
+template <typename T>
+void TestTranspose(ArrayRef<Index> dims, ArrayRef<Index> perm) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input = CreateTestTensor<T>(dims, host.get());
+  llvm::SmallVector<Index, 5> output_dims = TransposedDims(dims, perm);
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape(output_dims)), host.get());
+
+  ASSERT_FALSE(cpu::Transpose<compat::SyncEigenEvaluator>(input, perm,
+                                                          &*output, exec_ctx));
+
+  // Row major strides of the input dimensions.
+  const int rank = dims.size();
+  llvm::SmallVector<Index, 5> strides(rank);
+  for (Index d = rank - 1, stride = 1; d >= 0; --d) {
+    strides[d] = stride;
+    stride *= dims[d];
+  }
+
+  DHTArrayView<T> input_view(&input);
+  DHTArrayView<T> output_view(&*output);
+  llvm::SmallVector<Index, 5> index(rank, 0);
+  for (size_t i = 0; i < output_view.NumElements(); ++i) {
+    Index offset = 0;
+    for (int d = 0; d < rank; ++d) offset += index[d] * strides[perm[d]];
+    ASSERT_EQ(output_view[i], input_view[offset]) << "at " << i;
+
+    // Increment the output index.
+    for (int d = rank - 1; d >= 0 && ++index[d] == output_dims[d]; --d) {
+      index[d] = 0;
+    }
+  }
+}
+
+template <typename T>
+void TestTransposes() {
+  TestTranspose<T>({}, {});
+  TestTranspose<T>({7}, {0});
+  TestTranspose<T>({0, 3}, {1, 0});
+  TestTranspose<T>({1, 1}, {1, 0});
+  TestTranspose<T>({5, 1}, {1, 0});
+  TestTranspose<T>({8, 8}, {1, 0});
+  TestTranspose<T>({33, 70}, {1, 0});
+  TestTranspose<T>({3, 4, 5}, {0, 2, 1});
+  TestTranspose<T>({3, 4, 5}, {2, 0, 1});
+  TestTranspose<T>({3, 4, 5}, {1, 0, 2});
+  TestTranspose<T>({2, 17, 9, 40}, {0, 3, 1, 2});
+  TestTranspose<T>({2, 40, 17, 9}, {0, 2, 3, 1});
+  TestTranspose<T>({2, 9, 4, 16}, {0, 2, 1, 3});
+  TestTranspose<T>({3, 1, 4, 1, 5}, {4, 3, 2, 1, 0});
+  TestTranspose<T>({2, 3, 4, 5, 6}, {1, 0, 4, 2, 3});
+}
+
+TEST(TransposeKernelTest, Int8) { TestTransposes<int8_t>(); }
+TEST(TransposeKernelTest, Half) { TestTransposes<Eigen::half>(); }
+TEST(TransposeKernelTest, Float) { TestTransposes<float>(); }
+TEST(TransposeKernelTest, Int64) { TestTransposes<int64_t>(); }
+
+TEST(TransposeKernelTest, IsIdentityTranspose) {
+  EXPECT_TRUE(cpu::IsIdentityTranspose({}, {}));
+  EXPECT_TRUE(cpu::IsIdentityTranspose({2, 3, 4}, {0, 1, 2}));
+  EXPECT_TRUE(cpu::IsIdentityTranspose({2, 1, 4}, {1, 0, 2}));
+  EXPECT_TRUE(cpu::IsIdentityTranspose({2, 1, 4}, {0, 2, 1}));
+  EXPECT_FALSE(cpu::IsIdentityTranspose({2, 3, 4}, {0, 2, 1}));
+  EXPECT_FALSE(cpu::IsIdentityTranspose({2, 3, 4}, {1, 0, 2}));
+}
+
+}  // namespace
+
+static void Transpose(benchmark::State& state, int num_threads,
+                      ArrayRef<Index> dims, ArrayRef<Index> perm) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateTestExecutionContext(host.get());
+
+  DenseHostTensor input = CreateTestTensor<float>(dims, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<float>(),
+                     TensorShape(TransposedDims(dims, perm))),
+      host.get());
+
+  for (auto _ : state) {
+    auto done = cpu::Transpose<compat::AsyncEigenEvaluator>(input, perm,
+                                                            &*output, exec_ctx);
+    host->Await(done.CopyRCRef());
+  }
+
+  // Every element is read once and written once.
+  state.SetBytesProcessed(2 * input.DataSizeInBytes() * state.iterations());
+}
+
+#define BM_Transpose(name, threads, dims, perm)                        \
+  static void BM_Transpose_##name##_tpool_##threads(                   \
+      benchmark::State& state) {                                       \
+    Transpose(state, threads, dims, perm);                             \
+  }                                                                    \
+  BENCHMARK(BM_Transpose_##name##_tpool_##threads)
+
+#define DIMS(...) \
+  { __VA_ARGS__ }
+
+// NHWC -> NCHW and NCHW -> NHWC.
+BM_Transpose(NhwcToNchw, 1, DIMS(32, 56, 56, 64), DIMS(0, 3, 1, 2));
+BM_Transpose(NhwcToNchw, 8, DIMS(32, 56, 56, 64), DIMS(0, 3, 1, 2));
+BM_Transpose(NchwToNhwc, 1, DIMS(32, 64, 56, 56), DIMS(0, 2, 3, 1));
+BM_Transpose(NchwToNhwc, 8, DIMS(32, 64, 56, 56), DIMS(0, 2, 3, 1));
+
+// [batch, seq, heads, depth] -> [batch, heads, seq, depth].
+BM_Transpose(Bshd, 1, DIMS(32, 128, 16, 64), DIMS(0, 2, 1, 3));
+BM_Transpose(Bshd, 8, DIMS(32, 128, 16, 64), DIMS(0, 2, 1, 3));
+
+}  // namespace tfrt
@@ -20,6 +20,8 @@
 #ifndef TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_HANDLER_H_
 #define TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_HANDLER_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include "llvm/ADT/SetVector.h"
@@ -44,9 +46,43 @@ class CpuOpHandler : public OpHandler {
 
   bool AllowImplicitConversion(TensorType src, TensorType dst);
 
+  // Enables the lazy execution of elementwise ops (see
+  // CpuOpRegistry::SetElementwiseFn). In the lazy mode, elementwise ops on
+  // available tensors return LazyHost tensors, which record the ops instead of
+  // computing them. A chain of lazy ops is computed in a single fused loop when
+  // its result is converted to a DenseHostTensor, e.g. to be used by an op that
+  // is not elementwise.
+  void SetLazyFusion(bool enabled) {
+    lazy_fusion_.store(enabled, std::memory_order_relaxed);
+  }
+
+  bool IsLazyFusionEnabled() const {
+    return lazy_fusion_.load(std::memory_order_relaxed);
+  }
+
+  // Counters of the results of the ops that declare forwardable arguments (see
+  // CpuOpFlags::ForwardsArg0): `forwarded` results reused an argument buffer,
+  // `allocated` results required a new buffer.
+  struct BufferForwardingStats {
+    int64_t forwarded = 0;
+    int64_t allocated = 0;
+  };
+
+  BufferForwardingStats GetBufferForwardingStats() const;
+
+  // Forwards the buffer of a forwardable argument of the op to its first
+  // result, as declared by `flags`. Called by the op dispatch before running
+  // the dispatch function.
+  void MaybeForwardArgument(CpuOpFlags flags, ArrayRef<AsyncValue*> arguments,
+                            ArrayRef<TensorMetadata> result_mds,
+                            MutableArrayRef<RCReference<AsyncValue>> results);
+
  private:
   const CpuOpRegistry op_registry_;
   RCReference<Device> device_;
+  std::atomic<bool> lazy_fusion_{false};
+  std::atomic<int64_t> forwarded_results_{0};
+  std::atomic<int64_t> allocated_results_{0};
 
   llvm::SmallSetVector<TensorConversionFnRegistry::ConversionKey, 4>
       allowed_conversions;
@@ -21,6 +21,7 @@
 #ifndef TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_REGISTRY_H_
 #define TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_REGISTRY_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "tfrt/core_runtime/op_metadata_function.h"
@@ -86,6 +87,17 @@ struct CpuOpFlags {
     // If this is set, the op dispatch function is prepared to deal with tensor
     // inputs in the TFRuntimeFallbackTensor format.
     AllowsTfRuntimeFallback = 1 << 5,
+
+    // If this is set, the first result of the op may reuse the buffer of its
+    // first (ForwardsArg0) or second (ForwardsArg1) argument. The op handler
+    // forwards the argument buffer to the result when the argument is a
+    // DenseHostTensor that is not used by anybody else and has the metadata of
+    // the result, so the op requires a metadata function. The dispatch function
+    // must then allocate the result with GetForwardedOrAllocateOutput (see
+    // lib/ops/tf/buffer_forwarding.h), and must not read an element of the
+    // forwarded argument after writing the result element at the same index.
+    ForwardsArg0 = 1 << 6,
+    ForwardsArg1 = 1 << 7,
   } flags;
 
   explicit CpuOpFlags() : flags(None) {}
@@ -111,6 +123,17 @@ inline CpuOpFlags operator|(CpuOpFlags::Flags lhs, CpuOpFlags::Flags rhs) {
   return CpuOpFlags(lhs) | CpuOpFlags(rhs);
 }
 
+// Elementwise computations that CpuOpHandler can fuse into a single loop in the
+// lazy execution mode (see CpuOpHandler::SetLazyFusion).
+enum class CpuElementwiseFn : uint8_t {
+  kNone,
+  kAdd,   // lhs + rhs
+  kSub,   // lhs - rhs
+  kMul,   // lhs * rhs
+  kRelu,  // max(x, 0)
+  kCast,  // cast to the result dtype
+};
+
 // This represents a mapping from op names to the associated metadata functions
 // (optional) and kernel dispatch functions.
 class CpuOpRegistry {
@@ -132,6 +155,13 @@ class CpuOpRegistry {
   // same op are allowed (making static initialization easier).
   void AddMetadataFn(string_view op_name, OpMetadataFn metadata_fn);
 
+  // Declare that the specified op computes the elementwise function `fn` of
+  // its arguments, which allows the op to be fused with adjacent elementwise
+  // ops in the lazy execution mode. Fused ops must produce bit-identical
+  // results, so `fn` must be implemented with the same Eigen expression as the
+  // fused loop, which is only used for arguments of the result shape.
+  void SetElementwiseFn(string_view op_name, CpuElementwiseFn fn);
+
  private:
   friend class CpuOpHandler;
   CpuOpRegistry(const CpuOpRegistry&) = delete;
@@ -16,7 +16,10 @@
 
 #include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 
+#include <vector>
+
 #include "cpu_op_registry_impl.h"
+#include "lazy_host_tensor.h"
 #include "llvm/Support/Compiler.h"
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/dispatch_utils.h"
@@ -27,6 +30,7 @@
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/tensor/coo_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -179,6 +183,11 @@ struct CpuOpHandlerTraits {
                        MutableArrayRef<RCReference<AsyncValue>> results,
                        AsyncValueRef<Chain>* chain,
                        const ExecutionContext& exec_ctx) {
+    if (op_entry.flags &
+        (CpuOpFlags::ForwardsArg0 | CpuOpFlags::ForwardsArg1)) {
+      cpu_op_handler->MaybeForwardArgument(op_entry.flags, inputs, result_mds,
+                                           results);
+    }
     op_entry.dispatch_fn(exec_ctx, inputs, attrs, result_mds, results, chain);
   }
 
@@ -198,6 +207,173 @@ struct CpuOpHandlerTraits {
   }
 };
 
+// Executes `invocation` of an elementwise op lazily, by returning a
+// LazyHostTensor that fuses the op with its lazy arguments. Returns false if
+// the invocation can not be executed lazily.
+bool ExecuteOpLazily(const CpuOpEntry& op_entry, CpuElementwiseFn fn,
+                     CpuOpHandler* op_handler, const OpInvocation& invocation) {
+  if (!op_entry.metadata_fn || !(op_entry.flags & CpuOpFlags::NoSideEffects) ||
+      invocation.results.size() != 1)
+    return false;
+
+  // All the arguments must be available dense or lazy tensors on this device.
+  RCReference<Device> device = op_handler->GetDeviceRef();
+  llvm::SmallVector<const HostTensor*, 2> arguments;
+  for (const TensorHandle& argument : invocation.arguments) {
+    if (!argument.IsDeviceAvailable() ||
+        argument.GetAvailableDevice().get() != device.get())
+      return false;
+    AsyncValue* tensor_av = argument.GetAsyncTensor();
+    if (!tensor_av->IsConcrete()) return false;
+    const auto& tensor = tensor_av->get<Tensor>();
+    if (!isa<DenseHostTensor>(tensor) && !isa<LazyHostTensor>(tensor))
+      return false;
+    arguments.push_back(static_cast<const HostTensor*>(&tensor));
+  }
+
+  llvm::SmallVector<TensorMetadata, 4> result_mds;
+  switch (internal::ExecuteMetadataFunction(op_entry.metadata_fn, invocation,
+                                            result_mds)) {
+    case internal::MDFunctionExecResult::kMetadataUnavailable:
+      return false;
+    case internal::MDFunctionExecResult::kError:
+      // The error is already propagated to the results.
+      return true;
+    case internal::MDFunctionExecResult::kSuccess:
+      break;
+  }
+
+  std::optional<LazyHostTensor> result =
+      MakeLazyHostTensor(fn, result_mds[0], arguments);
+  if (!result) return false;
+
+  invocation.results[0] = TensorHandle(
+      std::move(device), result_mds[0],
+      MakeAvailableAsyncValueRef<LazyHostTensor>(std::move(*result)));
+  return true;
+}
+
+// Executes `invocation` of the op described by `op_entry`.
+void ExecuteOp(const CpuOpEntry& op_entry, CpuElementwiseFn elementwise_fn,
+               CpuOpHandler* op_handler, const OpInvocation& invocation) {
+  if (elementwise_fn != CpuElementwiseFn::kNone &&
+      op_handler->IsLazyFusionEnabled() &&
+      ExecuteOpLazily(op_entry, elementwise_fn, op_handler, invocation))
+    return;
+
+  bool update_chain = !(op_entry.flags & CpuOpFlags::NoSideEffects);
+
+  // Convert the argument tensors if needed.
+  for (auto& argument : invocation.arguments) {
+    argument = MaybeConvertArgument(invocation.exec_ctx, op_entry.flags,
+                                    op_handler, std::move(argument));
+  }
+
+  // TODO(fishx): ExecuteOnOpHandler should return void.
+  ExecuteOnOpHandler<CpuOpHandlerTraits>(update_chain, invocation, op_entry,
+                                         op_handler);
+}
+
+// An op invocation deferred to a worker thread. The invocation arguments and
+// attributes are moved into the deferred invocation, and the caller results
+// and out chain are replaced with unavailable async values, which are resolved
+// when the invocation is executed.
+class DeferredInvocation {
+ public:
+  DeferredInvocation(const OpInvocation& invocation, RCReference<Device> device)
+      : exec_ctx_(invocation.exec_ctx),
+        attrs_(invocation.attrs.freeze()),
+        has_chain_(invocation.chain != nullptr) {
+    arguments_.reserve(invocation.arguments.size());
+    for (auto& argument : invocation.arguments)
+      arguments_.push_back(std::move(argument));
+
+    result_mds_.reserve(invocation.results.size());
+    result_tensors_.reserve(invocation.results.size());
+    for (auto& result : invocation.results) {
+      auto md = MakeUnconstructedAsyncValueRef<TensorMetadata>();
+      auto tensor = MakeIndirectAsyncValue();
+      result = TensorHandle(device.CopyRef(), md.CopyRef(),
+                            AsyncValueRef<Tensor>(tensor.CopyRef()));
+      result_mds_.push_back(std::move(md));
+      result_tensors_.push_back(std::move(tensor));
+    }
+
+    if (has_chain_ && *invocation.chain) {
+      chain_ = std::move(*invocation.chain);
+      out_chain_ = MakeIndirectAsyncValue();
+      *invocation.chain = AsyncValueRef<Chain>(out_chain_.CopyRef());
+    }
+  }
+
+  void Execute(const CpuOpEntry& op_entry, CpuElementwiseFn elementwise_fn,
+               CpuOpHandler* op_handler) {
+    llvm::SmallVector<TensorHandle, 2> results(result_tensors_.size());
+    OpInvocation invocation{op_entry.op_name, exec_ctx_, arguments_, attrs_,
+                            results, has_chain_ ? &chain_ : nullptr};
+    ExecuteOp(op_entry, elementwise_fn, op_handler, invocation);
+
+    for (size_t i = 0, e = results.size(); i != e; ++i) {
+      TensorHandle& result = results[i];
+      result_tensors_[i]->ForwardTo(FormRef(result.GetAsyncTensor()));
+      if (result.IsMetadataAvailable()) {
+        result_mds_[i].emplace(result.GetAvailableMetadata());
+        continue;
+      }
+      const AsyncValueRef<TensorMetadata>& md = result.GetAsyncMetadata();
+      md.AndThen([md = md.CopyRef(),
+                  result_md = std::move(result_mds_[i])]() mutable {
+        if (md.IsError()) {
+          result_md.SetError(md.GetError());
+        } else {
+          result_md.emplace(md.get());
+        }
+      });
+    }
+
+    if (out_chain_) out_chain_->ForwardTo(chain_.CopyRCRef());
+  }
+
+ private:
+  ExecutionContext exec_ctx_;
+  llvm::SmallVector<TensorHandle, 4> arguments_;
+  OpAttrsRef attrs_;
+  bool has_chain_;
+  AsyncValueRef<Chain> chain_;
+  RCReference<IndirectAsyncValue> out_chain_;
+  llvm::SmallVector<AsyncValueRef<TensorMetadata>, 2> result_mds_;
+  llvm::SmallVector<RCReference<IndirectAsyncValue>, 2> result_tensors_;
+};
+
+// Executes a batch of `invocations` of the op described by `op_entry`. If
+// `parallel` is true, the invocations are executed concurrently on the host
+// worker threads.
+void ExecuteOpBatch(const CpuOpEntry& op_entry,
+                    CpuElementwiseFn elementwise_fn, CpuOpHandler* op_handler,
+                    ArrayRef<OpInvocation> invocations, bool parallel) {
+  if (!parallel || invocations.size() <= 1) {
+    for (const OpInvocation& invocation : invocations)
+      ExecuteOp(op_entry, elementwise_fn, op_handler, invocation);
+    return;
+  }
+
+  std::vector<DeferredInvocation> deferred;
+  deferred.reserve(invocations.size());
+  for (const OpInvocation& invocation : invocations)
+    deferred.emplace_back(invocation, op_handler->GetDeviceRef());
+
+  size_t num_invocations = deferred.size();
+  ParallelFor(invocations.front().exec_ctx)
+      .Execute(
+          num_invocations, ParallelFor::BlockSizes::Min(1),
+          [&op_entry, elementwise_fn, op_handler,
+           deferred = std::move(deferred)](size_t begin, size_t end) mutable {
+            for (size_t i = begin; i < end; ++i)
+              deferred[i].Execute(op_entry, elementwise_fn, op_handler);
+          },
+          [] {});
+}
+
 }  // namespace
 
 llvm::Expected<CpuOpHandler*> CreateCpuOpHandler(CoreRuntime* runtime,
@@ -217,6 +393,8 @@ llvm::Expected<CpuOpHandler*> CreateCpuOpHandler(CoreRuntime* runtime,
                                             DenseHostTensor::kTensorType);
   cpu_op_handler_ptr->AddImplicitConversion(CooHostTensor::kTensorType,
                                             DenseHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(LazyHostTensor::kTensorType,
+                                            DenseHostTensor::kTensorType);
 
   return cpu_op_handler_ptr;
 }
@@ -241,28 +419,68 @@ Expected<CoreRuntimeOp> CpuOpHandler::MakeOp(string_view op_name) {
   // fallback OpHandler.
   if (op_entry->dispatch_fn == nullptr) return GetFallback()->MakeOp(op_name);
 
+  CpuElementwiseFn elementwise_fn =
+      op_registry_.impl_->GetElementwiseFn(op_name);
+
   // NOTE(fishx): To avoid introducing an extra heap allocation, we need to
   // ensure that the size of captured variable is smaller than 3 pointers.
   return CoreRuntimeOp(
-      [op_entry, this](const OpInvocation& invocation) {
+      [op_entry, elementwise_fn, this](const OpInvocation& invocation) {
         // CPU OpHandler should associate a CPU device.
         assert(this->device_);
-        bool update_chain = !(op_entry->flags & CpuOpFlags::NoSideEffects);
-
-        // Convert the argument tensors if needed.
-        for (auto& argument : invocation.arguments) {
-          argument = MaybeConvertArgument(invocation.exec_ctx, op_entry->flags,
-                                          this, std::move(argument));
-        }
-
-        // TODO(fishx): ExecuteOnOpHandler should return void.
-        ExecuteOnOpHandler<CpuOpHandlerTraits>(update_chain, invocation,
-                                               *op_entry, this);
+        ExecuteOp(*op_entry, elementwise_fn, this, invocation);
+      },
+      // The op entry is resolved once for all the invocations of a batch.
+      [op_entry, elementwise_fn, this](ArrayRef<OpInvocation> invocations,
+                                       bool parallel) {
+        assert(this->device_);
+        ExecuteOpBatch(*op_entry, elementwise_fn, this, invocations, parallel);
       },
       /*is_fallback=*/false, /*device=*/device_,
       /*arg_tensor_type=*/DenseHostTensor::kTensorType);
 }
 
+void CpuOpHandler::MaybeForwardArgument(
+    CpuOpFlags flags, ArrayRef<AsyncValue*> arguments,
+    ArrayRef<TensorMetadata> result_mds,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  static constexpr CpuOpFlags::Flags kForwardsArg[] = {
+      CpuOpFlags::ForwardsArg0, CpuOpFlags::ForwardsArg1};
+
+  // The result metadata is required to check that an argument is compatible.
+  if (!result_mds.empty()) {
+    for (size_t i = 0; i < arguments.size() && i < 2; ++i) {
+      if (!(flags & kForwardsArg[i])) continue;
+
+      // Check that the op holds the last reference to the argument.
+      AsyncValue* argument = arguments[i];
+      if (!argument->IsConcrete() || !argument->IsUnique()) continue;
+
+      auto* tensor = dyn_cast<DenseHostTensor>(&argument->get<Tensor>());
+      if (!tensor || tensor->metadata() != result_mds[0]) continue;
+
+      // Check that no other tensors share the buffer with the argument.
+      if (!tensor->buffer()->IsExclusiveDataOwner()) continue;
+
+      results[0] =
+          MakeAvailableAsyncValueRef<DenseHostTensor>(tensor->CopyRef())
+              .ReleaseRCRef();
+      forwarded_results_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  allocated_results_.fetch_add(1, std::memory_order_relaxed);
+}
+
+CpuOpHandler::BufferForwardingStats CpuOpHandler::GetBufferForwardingStats()
+    const {
+  BufferForwardingStats stats;
+  stats.forwarded = forwarded_results_.load(std::memory_order_relaxed);
+  stats.allocated = allocated_results_.load(std::memory_order_relaxed);
+  return stats;
+}
+
 void CpuOpHandler::AddImplicitConversion(TensorType src, TensorType dst) {
   allowed_conversions.insert({src, dst});
 }
@@ -48,6 +48,11 @@ void CpuOpRegistry::AddMetadataFn(string_view op_name,
   impl_->AddMetadataFn(op_name, metadata_fn);
 }
 
+void CpuOpRegistry::SetElementwiseFn(string_view op_name,
+                                     CpuElementwiseFn fn) {
+  impl_->elementwise_fns[op_name] = fn;
+}
+
 static std::vector<CpuOpRegistration>* GetStaticCpuOpRegistrations() {
   static std::vector<CpuOpRegistration>* ret =
       new std::vector<CpuOpRegistration>;
@@ -20,6 +20,7 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_CPU_OP_REGISTRY_IMPL_H_
 #define TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_CPU_OP_REGISTRY_IMPL_H_
 
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/support/op_registry_impl.h"
 
@@ -27,7 +28,15 @@ namespace tfrt {
 
 // This is the pImpl implementation details for CpuOpRegistry.
 struct CpuOpRegistry::Impl final
-    : OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags> {};
+    : OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags> {
+  CpuElementwiseFn GetElementwiseFn(string_view op_name) const {
+    auto it = elementwise_fns.find(op_name);
+    return it == elementwise_fns.end() ? CpuElementwiseFn::kNone : it->second;
+  }
+
+  // Elementwise functions of the ops that can be fused in the lazy mode.
+  llvm::StringMap<CpuElementwiseFn> elementwise_fns;
+};
 
 using CpuOpEntry =
     OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags>::OpEntry;
@@ -0,0 +1,354 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements LazyHostTensor and its fused elementwise loop.
+
+#include "lazy_host_tensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/conversion_utils.h"
+
+namespace tfrt {
+
+// A node of the elementwise ops DAG: either a leaf DenseHostTensor, or an op
+// that computes `fn` of its inputs. All the nodes have the same shape.
+class LazyElementwiseExpr : public ReferenceCounted<LazyElementwiseExpr> {
+ public:
+  explicit LazyElementwiseExpr(DenseHostTensor value)
+      : dtype_(value.dtype()), value_(std::move(value)) {}
+
+  LazyElementwiseExpr(
+      DType dtype, CpuElementwiseFn fn,
+      llvm::SmallVector<RCReference<LazyElementwiseExpr>, 2> inputs)
+      : dtype_(dtype), fn_(fn), num_ops_(1), inputs_(std::move(inputs)) {
+    for (auto& input : inputs_) num_ops_ += input->num_ops_;
+  }
+
+  bool IsLeaf() const { return fn_ == CpuElementwiseFn::kNone; }
+
+  DType dtype() const { return dtype_; }
+  CpuElementwiseFn fn() const { return fn_; }
+
+  // The number of ops in the expression. Ops used by several other ops are
+  // counted once for each use.
+  int num_ops() const { return num_ops_; }
+
+  ArrayRef<RCReference<LazyElementwiseExpr>> inputs() const { return inputs_; }
+
+  const DenseHostTensor& value() const {
+    assert(IsLeaf());
+    return value_;
+  }
+
+  // Computes the expression on the first call, and returns the same result on
+  // all the subsequent calls.
+  AsyncValueRef<DenseHostTensor> Materialize(const TensorMetadata& metadata,
+                                             const ExecutionContext& exec_ctx);
+
+  // Returns the result of the expression if it is already computed, otherwise
+  // returns nullptr.
+  const DenseHostTensor* GetMaterialized();
+
+ private:
+  DType dtype_;
+  CpuElementwiseFn fn_ = CpuElementwiseFn::kNone;
+  int num_ops_ = 0;
+  llvm::SmallVector<RCReference<LazyElementwiseExpr>, 2> inputs_;
+  DenseHostTensor value_;
+
+  mutex mu_;
+  AsyncValueRef<DenseHostTensor> materialized_ TFRT_GUARDED_BY(mu_);
+};
+
+namespace {
+
+// Elements are computed in blocks of this size, so that the intermediate
+// results stay in the cache. The size is a multiple of all the packet sizes,
+// so the fused loop splits the elements into vectorized and scalar parts the
+// same way the unfused Eigen kernels do.
+constexpr Index kBlockSize = 1024;
+
+// The minimum number of blocks computed by a parallel task.
+constexpr size_t kMinBlocksPerTask = 16;
+
+// The maximum number of ops fused into a single loop.
+constexpr int kMaxFusedOps = 16;
+
+bool IsSupportedDType(DType dtype) {
+  switch (dtype) {
+    case DType::F32:
+    case DType::F64:
+    case DType::I32:
+    case DType::I64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls `f` with a value of the C++ type of the (supported) `dtype`.
+template <typename F>
+void DispatchDType(DType dtype, F&& f) {
+  switch (dtype) {
+    case DType::F32:
+      return f(float{});
+    case DType::F64:
+      return f(double{});
+    case DType::I32:
+      return f(int32_t{});
+    case DType::I64:
+      return f(int64_t{});
+    default:
+      llvm_unreachable("unsupported dtype");
+  }
+}
+
+template <typename T>
+compat::EigenConstTensor<T> ConstBlock(const void* data, Index size) {
+  return compat::EigenConstTensor<T>(static_cast<const T*>(data), size);
+}
+
+template <typename T>
+compat::EigenTensor<T> Block(void* data, Index size) {
+  return compat::EigenTensor<T>(static_cast<T*>(data), size);
+}
+
+// Computes a block of `size` elements of the op `expr`.
+void EvalOp(const LazyElementwiseExpr& expr, ArrayRef<const void*> operands,
+            void* result, Index size) {
+  switch (expr.fn()) {
+    case CpuElementwiseFn::kAdd:
+    case CpuElementwiseFn::kSub:
+    case CpuElementwiseFn::kMul:
+      return DispatchDType(expr.dtype(), [&](auto type_tag) {
+        using T = decltype(type_tag);
+        auto lhs = ConstBlock<T>(operands[0], size);
+        auto rhs = ConstBlock<T>(operands[1], size);
+        auto out = Block<T>(result, size);
+        if (expr.fn() == CpuElementwiseFn::kAdd) {
+          out = lhs + rhs;
+        } else if (expr.fn() == CpuElementwiseFn::kSub) {
+          out = lhs - rhs;
+        } else {
+          out = lhs * rhs;
+        }
+      });
+    case CpuElementwiseFn::kRelu:
+      return DispatchDType(expr.dtype(), [&](auto type_tag) {
+        using T = decltype(type_tag);
+        auto out = Block<T>(result, size);
+        out = ConstBlock<T>(operands[0], size).cwiseMax(static_cast<T>(0));
+      });
+    case CpuElementwiseFn::kCast:
+      return DispatchDType(expr.inputs()[0]->dtype(), [&](auto in_tag) {
+        using Tin = decltype(in_tag);
+        DispatchDType(expr.dtype(), [&](auto out_tag) {
+          using Tout = decltype(out_tag);
+          auto out = Block<Tout>(result, size);
+          out = ConstBlock<Tin>(operands[0], size).template cast<Tout>();
+        });
+      });
+    case CpuElementwiseFn::kNone:
+      llvm_unreachable("leaves are not computed");
+  }
+}
+
+// An instruction of the fused loop that computes the node `expr` from the
+// results of the `operands` instructions.
+struct FusedInstr {
+  const LazyElementwiseExpr* expr;
+  llvm::SmallVector<int, 2> operands;
+};
+
+// Appends the instructions computing `expr` to `program` in topological order,
+// and returns the index of the `expr` instruction.
+int AddInstrs(const LazyElementwiseExpr* expr,
+              llvm::DenseMap<const LazyElementwiseExpr*, int>* ids,
+              llvm::SmallVectorImpl<FusedInstr>* program) {
+  auto it = ids->find(expr);
+  if (it != ids->end()) return it->second;
+
+  FusedInstr instr{expr, {}};
+  for (auto& input : expr->inputs())
+    instr.operands.push_back(AddInstrs(input.get(), ids, program));
+
+  int id = program->size();
+  program->push_back(std::move(instr));
+  ids->try_emplace(expr, id);
+  return id;
+}
+
+// Computes the elements [begin, end) of the last instruction of `program` into
+// `result`, one block at a time.
+void EvalBlocks(ArrayRef<FusedInstr> program, Index begin, Index end,
+                void* result) {
+  struct alignas(64) ScratchBlock {
+    char data[kBlockSize * sizeof(int64_t)];
+  };
+  std::unique_ptr<ScratchBlock[]> scratch(new ScratchBlock[program.size()]);
+
+  // The data of the current block for each instruction.
+  llvm::SmallVector<const void*, 16> values(program.size());
+  llvm::SmallVector<const void*, 2> operands;
+
+  for (Index offset = begin; offset < end; offset += kBlockSize) {
+    Index size = std::min(kBlockSize, end - offset);
+    for (size_t i = 0, e = program.size(); i != e; ++i) {
+      const LazyElementwiseExpr& expr = *program[i].expr;
+      size_t offset_bytes = offset * GetHostSize(expr.dtype());
+      if (expr.IsLeaf()) {
+        values[i] =
+            static_cast<const char*>(expr.value().data()) + offset_bytes;
+        continue;
+      }
+
+      // The last instruction writes directly to the result.
+      void* out = i + 1 == e ? static_cast<char*>(result) + offset_bytes
+                             : scratch[i].data;
+      operands.clear();
+      for (int id : program[i].operands) operands.push_back(values[id]);
+      EvalOp(expr, operands, out, size);
+      values[i] = out;
+    }
+  }
+}
+
+}  // namespace
+
+AsyncValueRef<DenseHostTensor> LazyElementwiseExpr::Materialize(
+    const TensorMetadata& metadata, const ExecutionContext& exec_ctx) {
+  mutex_lock lock(mu_);
+  if (materialized_) return materialized_.CopyRef();
+
+  auto dest = DenseHostTensor::CreateUninitialized(metadata, exec_ctx.host());
+  if (!dest) {
+    materialized_ = MakeErrorAsyncValueRef("out of memory allocating result");
+    return materialized_.CopyRef();
+  }
+  materialized_ = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+
+  llvm::SmallVector<FusedInstr, 16> program;
+  llvm::DenseMap<const LazyElementwiseExpr*, int> ids;
+  AddInstrs(this, &ids, &program);
+
+  Index num_elements = metadata.shape.GetNumElements();
+  size_t num_blocks = (num_elements + kBlockSize - 1) / kBlockSize;
+  void* result = dest->data();
+
+  ParallelFor(exec_ctx).Execute(
+      num_blocks, ParallelFor::BlockSizes::Min(kMinBlocksPerTask),
+      [expr = FormRef(this), program = std::move(program), num_elements,
+       result](size_t begin, size_t end) {
+        EvalBlocks(program, begin * kBlockSize,
+                   std::min<Index>(end * kBlockSize, num_elements), result);
+      },
+      [materialized = materialized_.CopyRef(),
+       dest = std::move(*dest)]() mutable {
+        materialized.emplace(std::move(dest));
+      });
+
+  return materialized_.CopyRef();
+}
+
+const DenseHostTensor* LazyElementwiseExpr::GetMaterialized() {
+  mutex_lock lock(mu_);
+  if (materialized_ && materialized_.IsConcrete()) return &materialized_.get();
+  return nullptr;
+}
+
+LazyHostTensor::LazyHostTensor(const TensorMetadata& metadata,
+                               RCReference<LazyElementwiseExpr> expr)
+    : HostTensor(metadata), expr_(std::move(expr)) {}
+
+LazyHostTensor::~LazyHostTensor() {}
+
+LazyHostTensor::LazyHostTensor(LazyHostTensor&& other) = default;
+
+LazyHostTensor& LazyHostTensor::operator=(LazyHostTensor&& other) = default;
+
+AsyncValueRef<DenseHostTensor> LazyHostTensor::Materialize(
+    const ExecutionContext& exec_ctx) const {
+  return expr_->Materialize(metadata(), exec_ctx);
+}
+
+int LazyHostTensor::NumFusedOps() const { return expr_->num_ops(); }
+
+void LazyHostTensor::Print(raw_ostream& os) const {
+  os << "LazyHostTensor dtype = " << dtype() << ", shape = " << shape()
+     << ", fused ops = " << NumFusedOps();
+}
+
+std::optional<LazyHostTensor> MakeLazyHostTensor(
+    CpuElementwiseFn fn, const TensorMetadata& result_md,
+    ArrayRef<const HostTensor*> arguments) {
+  if (!IsSupportedDType(result_md.dtype)) return std::nullopt;
+
+  int num_ops = 1;
+  llvm::SmallVector<RCReference<LazyElementwiseExpr>, 2> inputs;
+  for (const HostTensor* argument : arguments) {
+    // The fused loop does not support broadcasting.
+    if (argument->shape() != result_md.shape) return std::nullopt;
+    if (!IsSupportedDType(argument->dtype())) return std::nullopt;
+    if (fn != CpuElementwiseFn::kCast && argument->dtype() != result_md.dtype)
+      return std::nullopt;
+
+    if (auto* dht = dyn_cast<DenseHostTensor>(argument)) {
+      inputs.push_back(TakeRef(new LazyElementwiseExpr(dht->CopyRef())));
+      continue;
+    }
+
+    // Lazy tensors that are already computed become leaves of the new DAG.
+    auto* lazy = cast<LazyHostTensor>(argument);
+    if (auto* dht = lazy->expr_->GetMaterialized()) {
+      inputs.push_back(TakeRef(new LazyElementwiseExpr(dht->CopyRef())));
+      continue;
+    }
+    num_ops += lazy->expr_->num_ops();
+    inputs.push_back(lazy->expr_.CopyRef());
+  }
+
+  if (num_ops > kMaxFusedOps) return std::nullopt;
+
+  auto expr = TakeRef(
+      new LazyElementwiseExpr(result_md.dtype, fn, std::move(inputs)));
+  return LazyHostTensor(result_md, std::move(expr));
+}
+
+static AsyncValueRef<DenseHostTensor> ConvertLazyHostTensorToDenseHostTensor(
+    const LazyHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  return tensor.Materialize(exec_ctx);
+}
+
+void RegisterLazyHostTensorConversionFn(TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertLazyHostTensorToDenseHostTensor));
+}
+
+}  // namespace tfrt
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares LazyHostTensor, the result of the elementwise ops executed
+// lazily by CpuOpHandler.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_LAZY_HOST_TENSOR_H_
+#define TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_LAZY_HOST_TENSOR_H_
+
+#include <optional>
+
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/host_tensor.h"
+
+namespace tfrt {
+
+class ExecutionContext;
+class LazyElementwiseExpr;
+
+void RegisterLazyHostTensorConversionFn(TensorConversionFnRegistry* registry);
+
+// LazyHostTensor is a tensor defined by a DAG of elementwise ops, whose leaves
+// are DenseHostTensors. The ops are not executed until the tensor is converted
+// to a DenseHostTensor, which computes the whole DAG in a single fused loop.
+class LazyHostTensor final : public HostTensor,
+                             public TensorTraits<LazyHostTensor> {
+ public:
+  LazyHostTensor(const TensorMetadata& metadata,
+                 RCReference<LazyElementwiseExpr> expr);
+  ~LazyHostTensor() override;
+
+  LazyHostTensor(LazyHostTensor&& other);
+  LazyHostTensor& operator=(LazyHostTensor&& other);
+
+  // Computes the tensor elements. All the calls share the same result.
+  AsyncValueRef<DenseHostTensor> Materialize(
+      const ExecutionContext& exec_ctx) const;
+
+  // Returns the number of ops fused into the tensor computation.
+  int NumFusedOps() const;
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for LazyHostTensor.
+  static const char* name() { return "LazyHost"; }
+
+ private:
+  friend std::optional<LazyHostTensor> MakeLazyHostTensor(
+      CpuElementwiseFn fn, const TensorMetadata& result_md,
+      ArrayRef<const HostTensor*> arguments);
+
+  RCReference<LazyElementwiseExpr> expr_;
+};
+
+// Returns a LazyHostTensor that computes `fn` of `arguments`, which must be
+// DenseHostTensors or LazyHostTensors. Returns an empty optional if the op can
+// not be fused: its dtypes or shapes are not supported, or the fused loop would
+// be too long.
+std::optional<LazyHostTensor> MakeLazyHostTensor(
+    CpuElementwiseFn fn, const TensorMetadata& result_md,
+    ArrayRef<const HostTensor*> arguments);
+
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_LAZY_HOST_TENSOR_H_
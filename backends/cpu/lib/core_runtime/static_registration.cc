@@ -16,12 +16,19 @@
 // kernels in this directory.  This can be used to simplify clients that don't
 // care about selective registration of kernels.
 
+#include "lazy_host_tensor.h"
 #include "op_handler_kernels.h"
 #include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 #include "tfrt/cpu/core_runtime/null_op_handler.h"
+#include "tfrt/tensor/conversion_registry.h"
 
 namespace tfrt {
 
 TFRT_STATIC_KERNEL_REGISTRATION(RegisterCpuOpHandlerKernels);
 
+static bool lazy_host_tensor_conversion_fn_registration = []() {
+  AddStaticTensorConversionFn(RegisterLazyHostTensorConversionFn);
+  return true;
+}();
+
 }  // namespace tfrt
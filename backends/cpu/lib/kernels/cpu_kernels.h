@@ -24,12 +24,15 @@
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
 #include <type_traits>
+#include <vector>
 
+#include "reduction_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/msan.h"
 #include "tfrt/support/string_util.h"
@@ -72,60 +75,34 @@ llvm::Error SyncRelu(const DenseHostTensor& A, DenseHostTensor* B,
 // CPU Mean kernels
 //===----------------------------------------------------------------------===//
 
+// Computes the mean of the `input` along the `reduction_indices` dimensions.
 template <typename T>
 AsyncValueRef<Chain> Mean(const DenseHostTensor& input,
                           ArrayRef<int32_t> reduction_indices,
                           DenseHostTensor* output,
                           const ExecutionContext& exec_ctx) {
-  auto mean = [&](auto input_rank_tag,
-                  auto reduction_rank_tag) -> AsyncValueRef<Chain> {
-    constexpr int input_rank = decltype(input_rank_tag)::value;
-    constexpr int reduction_rank = decltype(reduction_rank_tag)::value;
-    constexpr int output_rank = input_rank - reduction_rank;
-    static_assert(output_rank >= 0, "Output rank must be greater than 0");
-
-    DHTIndexableView<T, input_rank> input_view(&input);
-    MutableDHTIndexableView<T, output_rank> output_view(output);
-
-    Eigen::DSizes<Eigen::Index, reduction_rank> reduction_indices_t;
-    for (int i = 0; i < reduction_rank; ++i) {
-      reduction_indices_t[i] = reduction_indices[i];
-    }
-
-    auto input_t = AsEigenConstTensor(input_view);
-    auto output_t = AsEigenTensor(output_view);
-    auto expr = input_t.mean(reduction_indices_t);
-
-    return AsyncAssign(
-        exec_ctx.host()->GetOrCreateSharedContext<EigenHostContext>(),
-        std::move(output_t), std::move(expr),
-        KeepBuffers::alive(&input, output));
-  };
+  return Reduce<MeanReducer, T>(input, reduction_indices, output, exec_ctx);
+}
+
+// Computes the mean of the `input` along the outermost dimension.
+template <typename T>
+AsyncValueRef<Chain> MeanAxisZero(const DenseHostTensor& input,
+                                  DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx) {
+  const Index num_rows =
+      input.shape().GetRank() > 0 ? input.shape().GetDimensionSize(0) : 1;
+  const Index row_size = num_rows > 0 ? input.NumElements() / num_rows : 0;
+
+  if (output->NumElements() != row_size) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("MeanAxisZero output shape ", output->shape(),
+                         " does not match the input shape ", input.shape()));
+  }
 
-  const int input_rank = input.shape().GetRank();
-  const int reduction_rank = reduction_indices.size();
-
-#define REDUCE(INPUT, REDUCTION)                          \
-  if (input_rank == INPUT && reduction_rank == REDUCTION) \
-    return mean(std::integral_constant<int32_t, INPUT>{}, \
-                std::integral_constant<int32_t, REDUCTION>{});
-
-  REDUCE(1, 1);
-  REDUCE(2, 1);
-  REDUCE(2, 2);
-  REDUCE(3, 1);
-  REDUCE(3, 2);
-  REDUCE(3, 3);
-  REDUCE(4, 1);
-  REDUCE(4, 2);
-  REDUCE(4, 3);
-  REDUCE(4, 4);
-
-#undef REDUCE
-
-  return EmitErrorAsync(
-      exec_ctx, StrCat("Unsupported reduction ranks: input_rank=", input_rank,
-                       " reduction_rank=", reduction_rank));
+  static constexpr int32_t kAxisZero[] = {0};
+  ArrayRef<int32_t> reduction_indices;
+  if (input.shape().GetRank() > 0) reduction_indices = kAxisZero;
+  return Reduce<MeanReducer, T>(input, reduction_indices, output, exec_ctx);
 }
 
 //===----------------------------------------------------------------------===//
@@ -19,6 +19,11 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 
+#include <algorithm>
+#include <optional>
+#include <type_traits>
+
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -26,9 +31,11 @@
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tensor/host_tensor.h"
 #include "tfrt/tensor/scalar_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
 namespace cpu {
@@ -162,6 +169,162 @@ struct BindLeftScalar : private Functor {
 
 namespace internal {
 
+// The output of a broadcasting binary op viewed as a [rows, cols] matrix, and
+// how each argument maps onto it. Adjacent dimensions where the arguments are
+// broadcasted the same way are collapsed into one, so that common shapes fall
+// into a few patterns:
+//
+//   row broadcast:    [N, C] op [C], [N, H, W, C] op [1, 1, 1, C]
+//   column broadcast: [N, C] op [N, 1]
+//   outer product:    [N, 1] op [1, C]
+struct BinaryBroadcastPlan {
+  enum class Arg {
+    kFull,    // [rows, cols] elements.
+    kRow,     // [cols] elements, the same for all rows.
+    kColumn,  // [rows] elements, each one broadcasted along its row.
+  };
+
+  Eigen::Index rows = 1;
+  Eigen::Index cols = 1;
+  Arg lhs = Arg::kFull;
+  Arg rhs = Arg::kFull;
+
+  // Returns the offset of the argument element for the output element at
+  // [row, col].
+  Eigen::Index Offset(Arg arg, Eigen::Index row, Eigen::Index col) const {
+    switch (arg) {
+      case Arg::kFull:
+        return row * cols + col;
+      case Arg::kRow:
+        return col;
+      case Arg::kColumn:
+        return row;
+    }
+    return 0;
+  }
+};
+
+// Returns the plan of the `lhs` and `rhs` broadcast to `out` if it matches one
+// of the patterns above, and an empty optional otherwise, in which case the
+// broadcast is evaluated with Eigen.
+inline std::optional<BinaryBroadcastPlan> PlanBinaryBroadcast(
+    const TensorShape& lhs, const TensorShape& rhs, const TensorShape& out) {
+  using Arg = BinaryBroadcastPlan::Arg;
+
+  const int rank = out.GetRank();
+  if (lhs.GetRank() > rank || rhs.GetRank() > rank) return std::nullopt;
+  if (out.GetNumElements() == 0) return std::nullopt;
+
+  // Returns the argument dimension aligned with the output dimension `i`.
+  auto dim = [&](const TensorShape& shape, int i) -> Index {
+    int shape_i = i - (rank - shape.GetRank());
+    return shape_i < 0 ? 1 : shape.GetDimensionSize(shape_i);
+  };
+
+  // Collapsed dimensions: size and whether lhs and rhs are broadcasted.
+  struct Dim {
+    Index size;
+    bool lhs_bcast;
+    bool rhs_bcast;
+  };
+  llvm::SmallVector<Dim, 4> dims;
+
+  for (int i = 0; i < rank; ++i) {
+    const Index size = out.GetDimensionSize(i);
+    if (size == 1) continue;
+
+    const Index lhs_size = dim(lhs, i);
+    const Index rhs_size = dim(rhs, i);
+    if (lhs_size != 1 && lhs_size != size) return std::nullopt;
+    if (rhs_size != 1 && rhs_size != size) return std::nullopt;
+
+    const bool lhs_bcast = lhs_size == 1;
+    const bool rhs_bcast = rhs_size == 1;
+    if (!dims.empty() && dims.back().lhs_bcast == lhs_bcast &&
+        dims.back().rhs_bcast == rhs_bcast) {
+      dims.back().size *= size;
+    } else {
+      dims.push_back({size, lhs_bcast, rhs_bcast});
+    }
+  }
+
+  if (dims.size() > 2) return std::nullopt;
+
+  // Pad the collapsed dimensions to the [rows, cols] matrix.
+  while (dims.size() < 2) dims.insert(dims.begin(), Dim{1, false, false});
+
+  auto arg = [&](bool row_bcast, bool col_bcast) -> std::optional<Arg> {
+    if (!row_bcast && !col_bcast) return Arg::kFull;
+    if (row_bcast && !col_bcast) return Arg::kRow;
+    if (!row_bcast && col_bcast) return Arg::kColumn;
+    // Scalar arguments are handled before broadcasting.
+    return std::nullopt;
+  };
+
+  auto lhs_arg = arg(dims[0].lhs_bcast, dims[1].lhs_bcast);
+  auto rhs_arg = arg(dims[0].rhs_bcast, dims[1].rhs_bcast);
+  if (!lhs_arg || !rhs_arg) return std::nullopt;
+
+  BinaryBroadcastPlan plan;
+  plan.rows = dims[0].size;
+  plan.cols = dims[1].size;
+  plan.lhs = *lhs_arg;
+  plan.rhs = *rhs_arg;
+  return plan;
+}
+
+// Computes `size` elements of the binary op output. Each argument is either a
+// row of `size` elements, or a single value broadcasted along the row.
+template <bool kLhsScalar, bool kRhsScalar>
+struct BinaryRow {
+  template <typename Functor, typename T, typename R>
+  static void Compute(const Functor& functor, const T* lhs, const T* rhs,
+                      R* out, Eigen::Index size) {
+    using Vectorize = std::integral_constant<
+        bool, std::is_same<T, R>::value &&
+                  Eigen::internal::packet_traits<T>::Vectorizable &&
+                  Eigen::internal::functor_traits<Functor>::PacketAccess>;
+
+    Eigen::Index i = ComputePackets(functor, lhs, rhs, out, size, Vectorize());
+    for (; i < size; ++i)
+      out[i] = functor(lhs[kLhsScalar ? 0 : i], rhs[kRhsScalar ? 0 : i]);
+  }
+
+ private:
+  // Computes the row prefix that fits into packets. Returns the number of
+  // computed elements.
+  template <typename Functor, typename T, typename R>
+  static Eigen::Index ComputePackets(const Functor& functor, const T* lhs,
+                                     const T* rhs, R* out, Eigen::Index size,
+                                     std::false_type) {
+    return 0;
+  }
+
+  template <typename Functor, typename T, typename R>
+  static Eigen::Index ComputePackets(const Functor& functor, const T* lhs,
+                                     const T* rhs, R* out, Eigen::Index size,
+                                     std::true_type) {
+    using Packet = typename Eigen::internal::packet_traits<T>::type;
+    constexpr Eigen::Index kPacketSize =
+        Eigen::internal::unpacket_traits<Packet>::size;
+    if (size < kPacketSize) return 0;
+
+    const Packet lhs_scalar = Eigen::internal::pset1<Packet>(lhs[0]);
+    const Packet rhs_scalar = Eigen::internal::pset1<Packet>(rhs[0]);
+
+    Eigen::Index i = 0;
+    for (; i + kPacketSize <= size; i += kPacketSize) {
+      const Packet lhs_packet =
+          kLhsScalar ? lhs_scalar : Eigen::internal::ploadu<Packet>(lhs + i);
+      const Packet rhs_packet =
+          kRhsScalar ? rhs_scalar : Eigen::internal::ploadu<Packet>(rhs + i);
+      Eigen::internal::pstoreu(out + i,
+                               functor.packetOp(lhs_packet, rhs_packet));
+    }
+    return i;
+  }
+};
+
 template <typename BinaryFunctor, typename EigenEvaluator>
 struct BinaryKernelImpl {
   using Functor = typename BinaryFunctor::Functor;
@@ -270,6 +433,71 @@ struct BinaryKernelImpl {
   void TensorTensorBcast(const DenseHostTensor& lhs_tensor,
                          const DenseHostTensor& rhs_tensor,
                          DenseHostTensor* out_tensor, OnDone on_done) {
+    auto plan = PlanBinaryBroadcast(lhs_tensor.shape(), rhs_tensor.shape(),
+                                    out_tensor->shape());
+    if (plan) {
+      TensorTensorPlannedBcast(*plan, lhs_tensor, rhs_tensor, out_tensor,
+                               std::move(on_done));
+    } else {
+      TensorTensorEigenBcast(lhs_tensor, rhs_tensor, out_tensor,
+                             std::move(on_done));
+    }
+  }
+
+  // Evaluates the broadcast planned by PlanBinaryBroadcast. The output is
+  // computed in parallel blocks of elements, split into the parts of the
+  // matrix rows, each computed with a vectorized loop.
+  template <typename OnDone>
+  void TensorTensorPlannedBcast(const BinaryBroadcastPlan& plan,
+                                const DenseHostTensor& lhs_tensor,
+                                const DenseHostTensor& rhs_tensor,
+                                DenseHostTensor* out_tensor, OnDone on_done) {
+    using Arg = BinaryBroadcastPlan::Arg;
+
+    const Input* lhs = static_cast<const Input*>(lhs_tensor.data());
+    const Input* rhs = static_cast<const Input*>(rhs_tensor.data());
+    Output* out = static_cast<Output*>(out_tensor->data());
+
+    auto compute = [plan, lhs, rhs, out](size_t begin, size_t end) {
+      Functor functor;
+      const Eigen::Index block_end = end;
+      for (Eigen::Index i = begin; i < block_end;) {
+        const Eigen::Index row = i / plan.cols;
+        const Eigen::Index col = i % plan.cols;
+        const Eigen::Index size =
+            std::min<Eigen::Index>(block_end - i, plan.cols - col);
+
+        const Input* lhs_row = lhs + plan.Offset(plan.lhs, row, col);
+        const Input* rhs_row = rhs + plan.Offset(plan.rhs, row, col);
+        if (plan.lhs == Arg::kColumn) {
+          BinaryRow<true, false>::Compute(functor, lhs_row, rhs_row, out + i,
+                                          size);
+        } else if (plan.rhs == Arg::kColumn) {
+          BinaryRow<false, true>::Compute(functor, lhs_row, rhs_row, out + i,
+                                          size);
+        } else {
+          BinaryRow<false, false>::Compute(functor, lhs_row, rhs_row, out + i,
+                                           size);
+        }
+        i += size;
+      }
+    };
+
+    const double cycles = Eigen::internal::functor_traits<Functor>::Cost;
+    OnDependencyReady(
+        eigen.ParallelExecute(
+            plan.rows * plan.cols,
+            ParallelFor::BlockSizes::Cost(2 * sizeof(Input), sizeof(Output),
+                                          cycles),
+            std::move(compute),
+            eigen.KeepAlive(&lhs_tensor, &rhs_tensor, out_tensor)),
+        std::move(on_done));
+  }
+
+  template <typename OnDone>
+  void TensorTensorEigenBcast(const DenseHostTensor& lhs_tensor,
+                              const DenseHostTensor& rhs_tensor,
+                              DenseHostTensor* out_tensor, OnDone on_done) {
     // Get broadcasting specifications for lhs and rhs arguments.
     auto lhs_bcast = GetArgumentBCast(lhs_tensor.shape(), out_tensor->shape());
     auto rhs_bcast = GetArgumentBCast(rhs_tensor.shape(), out_tensor->shape());
@@ -330,6 +558,19 @@ struct BinaryKernelImpl {
     }
   }
 
+  // Calls `on_done` when the parallel computation completes.
+  template <typename OnDone>
+  static void OnDependencyReady(AsyncValueRef<Chain> done, OnDone on_done) {
+    done.AndThen([on_done = std::move(on_done)]() mutable {
+      on_done(Error::success());
+    });
+  }
+
+  template <typename OnDone>
+  static void OnDependencyReady(Error error, OnDone on_done) {
+    on_done(std::move(error));
+  }
+
   // Helper struct to pass compile time constant to lambda as a value argument.
   template <int rank>
   struct Rank {
@@ -343,11 +584,12 @@ struct BinaryKernelImpl {
 
 template <typename BinaryFunctor, typename EigenEvaluator, typename OnDone>
 void BinaryKernel(const HostTensor& lhs, const HostTensor& rhs,
-                  HostTensor* output, HostContext& host_ctx, OnDone on_done) {
+                  HostTensor* output, const ExecutionContext& exec_ctx,
+                  OnDone on_done) {
   using T = typename BinaryFunctor::Input;
 
   internal::BinaryKernelImpl<BinaryFunctor, EigenEvaluator> impl(
-      EigenEvaluator{&host_ctx});
+      EigenEvaluator{exec_ctx});
 
   if (isa<ScalarHostTensor<T>>(lhs) && isa<ScalarHostTensor<T>>(rhs)) {
     impl.ScalarScalar(lhs, rhs, output, std::move(on_done));
@@ -378,7 +620,7 @@ AsyncValueRef<Chain> BinaryKernel(const HostTensor& lhs, const HostTensor& rhs,
   };
 
   BinaryKernel<BinaryFunctor, compat::AsyncEigenEvaluator>(
-      lhs, rhs, output, *exec_ctx.host(), std::move(on_done));
+      lhs, rhs, output, exec_ctx, std::move(on_done));
 
   return chain;
 }
@@ -388,8 +630,8 @@ Error SyncBinaryKernel(const HostTensor& lhs, const HostTensor& rhs,
                        HostTensor* output, const ExecutionContext& exec_ctx) {
   Error error = Error::success();
   auto on_done = [&](Error err) { error = std::move(err); };
-  BinaryKernel<BinaryFunctor, compat::SyncEigenEvaluator>(
-      lhs, rhs, output, *exec_ctx.host(), on_done);
+  BinaryKernel<BinaryFunctor, compat::SyncEigenEvaluator>(lhs, rhs, output,
+                                                         exec_ctx, on_done);
   return error;
 }
 
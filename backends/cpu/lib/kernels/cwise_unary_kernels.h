@@ -66,16 +66,13 @@ static void UnaryKernel(const DenseHostTensor& input, DenseHostTensor* output,
   using T = typename UnaryFunctor::Input;
   using R = typename UnaryFunctor::Output;
 
-  HostContext* host = exec_ctx.host();
-  auto& ctx = host->GetOrCreateSharedContext<compat::EigenHostContext>();
-
   auto input_t = compat::AsEigenConstTensor(DHTArrayView<T>(&input));
   auto output_t = compat::AsEigenTensor(MutableDHTArrayView<R>(output));
 
   auto expr = input_t.unaryExpr(F());
 
-  compat::AsyncAssign(
-      ctx, output_t, std::move(expr),
+  compat::ParallelAssign(
+      exec_ctx, output_t, std::move(expr),
       [buffers = compat::KeepBuffers::alive(&input, output),
        on_done = std::move(on_done)]() { on_done(Error::success()); });
 }
@@ -108,6 +105,25 @@ void SyncUnaryKernel(const DenseHostTensor& input, DenseHostTensor* output) {
   output_t = input_t.unaryExpr(F());
 }
 
+// Converts the input values to the output type R. Conversions between float
+// and the reduced precision types are vectorized by Eigen.
+template <typename T, typename R>
+static AsyncValueRef<Chain> CastKernel(const DenseHostTensor& input,
+                                       DenseHostTensor* output,
+                                       const ExecutionContext& exec_ctx) {
+  auto input_t = compat::AsEigenConstTensor(DHTArrayView<T>(&input));
+  auto output_t = compat::AsEigenTensor(MutableDHTArrayView<R>(output));
+
+  AsyncValueRef<Chain> chain = MakeConstructedAsyncValueRef<Chain>();
+
+  compat::ParallelAssign(
+      exec_ctx, output_t, input_t.template cast<R>(),
+      [buffers = compat::KeepBuffers::alive(&input, output),
+       chain = chain.CopyRef()]() { chain.SetStateConcrete(); });
+
+  return chain;
+}
+
 }  // namespace cpu
 }  // namespace tfrt
 
@@ -19,7 +19,13 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_MATMUL_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_MATMUL_KERNEL_H_
 
+#include <memory>
+#include <optional>
+#include <type_traits>
+
 #include "./matmul_kernel.h"
+#include "./reduced_precision.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/common/compat/eigen/contraction_output_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
@@ -31,89 +37,253 @@
 
 namespace tfrt {
 namespace cpu {
-namespace {
 
-template <typename OutputKernel, typename T, typename EigenEvaluator>
-typename EigenEvaluator::DependencyToken FusedMatMulInternal(
-    const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* output,
-    const DenseHostTensor& fusion_input, bool transpose_a, bool transpose_b,
-    EigenEvaluator eigen) {
-  DHTArrayView<T> bias_view(&fusion_input);
-  OutputKernel output_kernel(compat::AsEigenConstTensor(bias_view));
-  return cpu::MatMul<T>(1.0, a, b, 0.0, output, transpose_a, transpose_b,
-                        std::move(output_kernel), eigen);
+// Element-wise operations that can be fused into the MatMul output kernel.
+enum class FusedOp {
+  kBiasAdd,  // adds the [n] bias vector to every output row
+  kAdd,      // adds the [m, n] residual tensor to the output
+  kRelu,
+  kRelu6,
+  kElu,
+  kLeakyRelu,
+  kSigmoid,
+  kTanh,
+  kGeluApproximate,
+  kGeluExact,
+};
+
+// Applies a chain of fused element-wise operations to the output blocks of the
+// [m, n] matrix multiplication result with the element type T. Operations are
+// applied in order to each output block column while it is in L1 cache, which
+// replaces a separate pass over the output for every fused operation.
+//
+// Reduced precision outputs are computed in float by the MatMul kernel, so the
+// output kernel works with the ComputeType<T> output blocks, and converts the
+// fused operands from T.
+template <typename T>
+class FusedOutputKernel {
+  using Index = Eigen::Index;
+  using Compute = ComputeType<T>;
+  using Vec = Eigen::Tensor<Compute, 1, Eigen::RowMajor, Index>;
+  using OperandVec = Eigen::Tensor<const T, 1, Eigen::RowMajor, Index>;
+
+ public:
+  struct Op {
+    FusedOp kind;
+    // Bias or residual operand data, and the buffer that keeps it alive while
+    // the MatMul is evaluated asynchronously.
+    const T* data = nullptr;
+    RCReference<HostBuffer> buffer;
+    // LeakyRelu alpha.
+    Compute alpha = Compute(0);
+  };
+
+  FusedOutputKernel(llvm::SmallVector<Op, 4> ops, Index num_cols)
+      : ops_(std::make_shared<const llvm::SmallVector<Op, 4>>(std::move(ops))),
+        num_cols_(num_cols) {}
+
+  // Returns true if `kind` is supported for the element type T.
+  static bool IsSupported(FusedOp kind) {
+    switch (kind) {
+      case FusedOp::kBiasAdd:
+      case FusedOp::kAdd:
+      case FusedOp::kRelu:
+      case FusedOp::kRelu6:
+        return true;
+      default:
+        return !std::is_integral<Compute>::value;
+    }
+  }
+
+  EIGEN_ALWAYS_INLINE void operator()(
+      const compat::internal::ContractionOutputMapper<Compute>& output_mapper,
+      const Eigen::TensorContractionParams& params, Index i, Index j,
+      Index num_rows, Index num_cols) const {
+    // There is no guarantee that the block offsets are properly aligned.
+    using Operand = Eigen::TensorMap<OperandVec, Eigen::Unaligned>;
+    using OutputChannels = Eigen::TensorMap<Vec, Eigen::Unaligned>;
+
+    assert(params.swapped_arguments &&
+           "Unexpected contraction output kernel parameters");
+    assert(i + num_rows <= num_cols_ &&
+           "Output block inner dimension is larger than the output");
+
+    // Each output block column is a slice [i, i + num_rows) of the output row
+    // `j + col` (see contraction_output_kernel.h).
+    for (Index col = 0; col < num_cols; ++col) {
+      OutputChannels output(&output_mapper(0, col), num_rows);
+
+      for (const Op& op : *ops_) {
+        switch (op.kind) {
+          case FusedOp::kBiasAdd:
+            output += CastTo<Compute>(Operand(op.data + i, num_rows));
+            break;
+          case FusedOp::kAdd:
+            output += CastTo<Compute>(
+                Operand(op.data + (j + col) * num_cols_ + i, num_rows));
+            break;
+          case FusedOp::kRelu:
+            output = compat::Relu::apply(output);
+            break;
+          case FusedOp::kRelu6:
+            output = compat::Relu6::apply(output);
+            break;
+          default:
+            ApplyActivation(op, output, std::is_integral<Compute>());
+        }
+      }
+    }
+  }
+
+ private:
+  // Activations defined only for the floating point types.
+  template <typename Output>
+  static void ApplyActivation(const Op& op, Output& output, std::true_type) {
+    assert(false && "Unsupported fused operation for integer MatMul");
+  }
+
+  template <typename Output>
+  static void ApplyActivation(const Op& op, Output& output, std::false_type) {
+    switch (op.kind) {
+      case FusedOp::kElu:
+        output = compat::Elu::apply(output);
+        break;
+      case FusedOp::kLeakyRelu:
+        output = (output < Compute(0))
+                     .select(output * output.constant(op.alpha), output);
+        break;
+      case FusedOp::kSigmoid:
+        output = output.sigmoid();
+        break;
+      case FusedOp::kTanh:
+        output = output.tanh();
+        break;
+      case FusedOp::kGeluApproximate: {
+        // 0.5 * x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715 * x^3)))
+        const Compute kSqrt2OverPi = Compute(0.7978845608028654);
+        const Compute kCoefficient = Compute(0.044715);
+        output = output * Compute(0.5) *
+                 (((output + output.cube() * kCoefficient) * kSqrt2OverPi)
+                      .tanh() +
+                  Compute(1));
+        break;
+      }
+      case FusedOp::kGeluExact: {
+        // 0.5 * x * (1 + erf(x / sqrt(2)))
+        constexpr double kSqrtHalf = 0.70710678118654752440;
+        output = output * Compute(0.5) *
+                 ((output * Compute(kSqrtHalf)).erf() + Compute(1));
+        break;
+      }
+      default:
+        assert(false && "Unexpected fused operation");
+    }
+  }
+
+  std::shared_ptr<const llvm::SmallVector<Op, 4>> ops_;
+  Index num_cols_;
+};
+
+namespace internal {
+
+inline std::optional<FusedOp> ParseFusedOp(string_view name) {
+  if (name == "BiasAdd") return FusedOp::kBiasAdd;
+  if (name == "Add" || name == "AddV2") return FusedOp::kAdd;
+  if (name == "Relu") return FusedOp::kRelu;
+  if (name == "Relu6") return FusedOp::kRelu6;
+  if (name == "Elu") return FusedOp::kElu;
+  if (name == "LeakyRelu") return FusedOp::kLeakyRelu;
+  if (name == "Sigmoid") return FusedOp::kSigmoid;
+  if (name == "Tanh") return FusedOp::kTanh;
+  if (name == "GeluApproximate") return FusedOp::kGeluApproximate;
+  if (name == "GeluExact") return FusedOp::kGeluExact;
+  return std::nullopt;
 }
 
-}  // namespace
+}  // namespace internal
 
+// Computes `output = fused_ops(a * b)`, where `fused_ops` is a chain of the
+// element-wise operations applied in order. BiasAdd and Add operations take
+// their operands from `fusion_inputs` in order.
 template <typename T, typename EigenEvaluator, typename FuseInputsRange>
 typename EigenEvaluator::DependencyToken FusedMatMul(
     const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* output,
     FuseInputsRange fusion_inputs, bool transpose_a, bool transpose_b,
-    AggregateAttr fused_ops_attr, const ExecutionContext& exec_ctx) {
+    AggregateAttr fused_ops_attr, float leakyrelu_alpha,
+    const ExecutionContext& exec_ctx) {
   static_assert(std::is_same<std::decay_t<decltype(fusion_inputs[0])>,
                              DenseHostTensor>::value,
                 "fusion_inputs must be a range of DenseHostTensor");
+  using OutputKernel = FusedOutputKernel<T>;
 
   EigenEvaluator eigen{exec_ctx.host()};
 
-  // Parse the MatMul fusion config.
-  llvm::SmallVector<string_view, 4> fused_ops(fused_ops_attr.GetNumElements());
-  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i) {
-    fused_ops[i] = fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue();
-  }
-
-  if (fused_ops.empty()) {
+  if (fused_ops_attr.GetNumElements() == 0) {
     return eigen.MakeError("FusedMatMul must specify fused operations");
   }
 
-  // Match the fusion to Eigen contraction output kernel.
-  auto match_fusion = [&](std::initializer_list<string_view> ops) -> bool {
-    return fused_ops.size() == ops.size() &&
-           std::equal(fused_ops.begin(), fused_ops.end(), ops.begin());
-  };
+  const Index inner_dim = output->shape().GetDimensionSize(1);
 
-  // Dispatch fusion to correct Eigen contraction output kernel.
-  // Validate BiasAdd operands.
-  if (fused_ops[0] == "BiasAdd") {
-    auto& bias = fusion_inputs[0];
+  // Parse the MatMul fusion config into the output kernel operations, and
+  // validate the fusion inputs.
+  llvm::SmallVector<typename OutputKernel::Op, 4> ops;
+  size_t num_used_inputs = 0;
 
-    if (bias.shape().GetRank() != 1)
-      return eigen.MakeError("Bias tensor must a vector");
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i) {
+    string_view name =
+        fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue();
 
-    const Index inner_dim = output->shape().GetDimensionSize(1);
-    if (bias.NumElements() != inner_dim)
-      return eigen.MakeError("The number of bias elements ", bias.NumElements(),
-                             " doesn't match output inner dimension ",
-                             inner_dim);
-  }
+    std::optional<FusedOp> kind = internal::ParseFusedOp(name);
+    if (!kind) return eigen.MakeError("Unsupported fusion type: ", name);
+    if (!OutputKernel::IsSupported(*kind))
+      return eigen.MakeError("Unsupported fusion type ", name, " for ",
+                             GetDType<T>(), " MatMul");
 
-  // Fusion: BiasAdd
-  if (match_fusion({"BiasAdd"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
-  }
+    typename OutputKernel::Op op;
+    op.kind = *kind;
 
-  // Fusion: BiasAdd + Relu
-  if (match_fusion({"BiasAdd", "Relu"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Relu>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
-  }
+    if (*kind == FusedOp::kBiasAdd || *kind == FusedOp::kAdd) {
+      if (num_used_inputs == fusion_inputs.size())
+        return eigen.MakeError("Missing fusion input for ", name);
+      const DenseHostTensor& input = fusion_inputs[num_used_inputs++];
+
+      if (input.dtype() != output->dtype())
+        return eigen.MakeError("Fusion input of ", name, " has dtype ",
+                               input.dtype(), ", expected ", output->dtype());
+
+      if (*kind == FusedOp::kBiasAdd && input.shape().GetRank() != 1)
+        return eigen.MakeError("Bias tensor must a vector");
+
+      if (*kind == FusedOp::kBiasAdd && input.NumElements() != inner_dim)
+        return eigen.MakeError("The number of bias elements ",
+                               input.NumElements(),
+                               " doesn't match output inner dimension ",
+                               inner_dim);
 
-  // Fusion: BiasAdd + Relu6
-  if (match_fusion({"BiasAdd", "Relu6"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Relu6>,
-                               T>(a, b, output, fusion_inputs[0], transpose_a,
-                                  transpose_b, eigen);
+      if (*kind == FusedOp::kAdd && input.shape() != output->shape())
+        return eigen.MakeError("Residual tensor shape ", input.shape(),
+                               " doesn't match output shape ",
+                               output->shape());
+
+      op.data = static_cast<const T*>(input.data());
+      op.buffer = input.buffer().CopyRef();
+    }
+
+    if (*kind == FusedOp::kLeakyRelu) {
+      op.alpha = static_cast<ComputeType<T>>(leakyrelu_alpha);
+    }
+
+    ops.push_back(std::move(op));
   }
 
-  // Fusion: BiasAdd + Elu
-  if (match_fusion({"BiasAdd", "Elu"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Elu>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
+  if (num_used_inputs != fusion_inputs.size()) {
+    return eigen.MakeError("FusedMatMul has ", fusion_inputs.size(),
+                           " fusion inputs, fused operations use ",
+                           num_used_inputs);
   }
 
-  return eigen.MakeError("Unsupported fusion type");
+  return cpu::MatMul<T>(1.0, a, b, 0.0, output, transpose_a, transpose_b,
+                        OutputKernel(std::move(ops), inner_dim), eigen);
 }
 
 }  // namespace cpu
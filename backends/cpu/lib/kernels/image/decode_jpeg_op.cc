@@ -0,0 +1,140 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the functions to decode and resize jpeg images.
+
+#include "decode_jpeg_op.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "jpeg/jpeg_mem.h"
+#include "llvm/ADT/SmallVector.h"
+#include "resize_bilinear_op.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+namespace image {
+
+int jpeg_scale_denom(int width, int height, Index target_width,
+                     Index target_height) {
+  for (int denom : {8, 4, 2}) {
+    // libjpeg rounds up the scaled image size.
+    if ((width + denom - 1) / denom >= target_width &&
+        (height + denom - 1) / denom >= target_height)
+      return denom;
+  }
+  return 1;
+}
+
+Error decode_and_resize_jpeg(string_view data, Index height, Index width,
+                             float* output) {
+  if (!data.starts_with("\xff\xd8\xff")) {
+    return MakeStringError("image does not have jpeg format");
+  }
+
+  int image_width, image_height;
+  if (!jpeg::GetImageInfo(data.data(), data.size(), &image_width,
+                          &image_height, /*components=*/nullptr)) {
+    return MakeStringError("cannot read jpeg header");
+  }
+
+  jpeg::UncompressFlags flags;
+  flags.components = 3;
+  flags.dct_method = JDCT_IFAST;
+  flags.ratio = jpeg_scale_denom(image_width, image_height, width, height);
+
+  // The decoded image is only an input of the resize, and it is not allocated
+  // as a tensor.
+  std::unique_ptr<uint8_t[]> decoded;
+  Index decoded_height = 0, decoded_width = 0;
+  uint8_t* pixels = jpeg::Uncompress(
+      data.data(), data.size(), flags, nullptr /* nwarn */,
+      [&](int w, int h, int c) -> uint8_t* {
+        decoded_height = h;
+        decoded_width = w;
+        decoded.reset(new uint8_t[static_cast<size_t>(h) * w * c]);
+        return decoded.get();
+      });
+  if (pixels == nullptr) return MakeStringError("cannot decode jpeg image");
+
+  resize_image(pixels, decoded_height, decoded_width, /*channels=*/3, output,
+               height, width, ResizeOptions());
+  return Error::success();
+}
+
+AsyncValueRef<DenseHostTensor> decode_and_resize_jpeg_batch(
+    AsyncValueRef<StringHostTensor> images, Index height, Index width,
+    const ExecutionContext& exec_ctx) {
+  if (height <= 0 || width <= 0) {
+    return EmitErrorAsync(exec_ctx, "output image size must be positive");
+  }
+
+  HostContext* host = exec_ctx.host();
+  const Index batch = images->NumElements();
+  auto output = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({batch, height, width, 3}), host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "cannot allocate tensor");
+  }
+
+  // Images are decoded independently of each other on the blocking work
+  // queue, because the decode of a large image can take many milliseconds.
+  const Index image_size = height * width * 3;
+  float* data = static_cast<float*>(output->data());
+
+  llvm::SmallVector<RCReference<AsyncValue>, 8> decoded;
+  decoded.reserve(batch);
+  for (Index i = 0; i < batch; ++i) {
+    // The output buffer is kept alive by the tasks until all images are
+    // decoded, even if the result was already set to an error.
+    auto done = EnqueueBlockingWork(
+        host, [images = images.CopyRef(), buffer = output->CopyRef(), i,
+               height, width,
+               image = data + i * image_size]() -> Expected<Chain> {
+          TFRT_TRACE_SCOPE(Default, "DecodeAndResizeJpeg");
+          if (auto error = decode_and_resize_jpeg(images->strings()[i], height,
+                                                  width, image)) {
+            return MakeStringError("cannot decode image ", i, ": ",
+                                   toString(std::move(error)));
+          }
+          return Chain();
+        });
+    decoded.push_back(done.ReleaseRCRef());
+  }
+
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  llvm::SmallVector<AsyncValue*, 8> decoded_values;
+  decoded_values.reserve(batch);
+  for (auto& value : decoded) decoded_values.push_back(value.get());
+  RunWhenReady(decoded_values,
+               [result = result.CopyRef(), output = std::move(*output),
+                decoded = std::move(decoded)]() mutable {
+                 for (auto& value : decoded) {
+                   if (value->IsError()) {
+                     result.SetError(value->GetError());
+                     return;
+                   }
+                 }
+                 result.emplace(std::move(output));
+               });
+  return result;
+}
+
+}  // namespace image
+}  // namespace tfrt
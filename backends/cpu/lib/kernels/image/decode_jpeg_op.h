@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the functions to decode and resize jpeg images.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_DECODE_JPEG_OP_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_DECODE_JPEG_OP_H_
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+namespace image {
+
+// Returns the libjpeg scale denominator (1, 2, 4 or 8) that decodes the
+// `width` x `height` image to the smallest size that is still not smaller
+// than the `target_width` x `target_height`. Images are never upscaled.
+int jpeg_scale_denom(int width, int height, Index target_width,
+                     Index target_height);
+
+// Decodes the jpeg `data` into the float RGB [height, width, 3] `output` in
+// the caller thread. Large images are downscaled by libjpeg in the DCT domain,
+// and the decoded image is resized to the output size with the bilinear
+// resize.
+Error decode_and_resize_jpeg(string_view data, Index height, Index width,
+                             float* output);
+
+// Decodes the jpeg images of the string `images` tensor, and resizes them into
+// the float [batch, height, width, 3] tensor. Images are decoded in parallel
+// on the blocking work queue.
+AsyncValueRef<DenseHostTensor> decode_and_resize_jpeg_batch(
+    AsyncValueRef<StringHostTensor> images, Index height, Index width,
+    const ExecutionContext& exec_ctx);
+
+}  // namespace image
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_DECODE_JPEG_OP_H_
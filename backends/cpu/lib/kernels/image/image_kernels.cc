@@ -16,6 +16,7 @@
 
 #include <utility>
 
+#include "decode_jpeg_op.h"
 #include "jpeg/jpeg_mem.h"
 #include "resize_bilinear_op.h"
 #include "tfrt/host_context/async_dispatch.h"
@@ -26,6 +27,7 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
+#include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -72,56 +74,45 @@ static AsyncValueRef<DenseHostTensor> DecodeJpeg(
   return output;
 }
 
-// IDEA(donglin): allocate tensor buffer outside this kernel
 // Returns tf.compat.v1.image.resize(input, [height, width])
 static AsyncValueRef<DenseHostTensor> ResizeBilinear(
-    Argument<DenseHostTensor> input, Index height, Index width,
+    const DenseHostTensor& input, Index height, Index width,
     const ExecutionContext& exec_ctx) {
-  using ReturnTy = Expected<DenseHostTensor>;
-  return EnqueueWork(
-      exec_ctx,
-      [input = input.ValueRef(), height, width, exec_ctx]() -> ReturnTy {
-        TFRT_TRACE_SCOPE(Default, "ResizeBilinear");
-        const TensorShape& shape = input->shape();
-        if (shape.GetRank() != 3) {
-          auto diag = EmitError(exec_ctx, "input tensor shape must be 3");
-          return MakeStringError(diag.message());
-        }
+  TFRT_TRACE_SCOPE(Default, "ResizeBilinear");
+  const TensorShape& shape = input.shape();
+  if (shape.GetRank() != 3) {
+    return EmitErrorAsync(exec_ctx, "input tensor shape must be 3");
+  }
 
-        Index batch_size = 1;
-        Index input_height = shape.GetDimensionSize(0);
-        Index input_width = shape.GetDimensionSize(1);
-        Index channels = shape.GetDimensionSize(2);
-        float height_scale = input_height / static_cast<float>(height);
-        float width_scale = input_width / static_cast<float>(width);
+  Index channels = shape.GetDimensionSize(2);
+  auto output = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({height, width, channels}), exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "cannot allocate tensor");
+  }
 
-        // Create the temporary output tensor with batch_size=1. This follows
-        // the same logic in tf.image.resize which adds a batch dimension if the
-        // input image does not have the batch dimension. It is easier to port
-        // the code from TF to TFRT by following the same logic. And in the
-        // future we may also want this kernel to process input image with or
-        // without the batch dimension.
-        auto dht = DenseHostTensor::CreateUninitialized<float>(
-            TensorShape({batch_size, height, width, channels}),
-            exec_ctx.host());
-        if (!dht) {
-          auto diag = EmitError(exec_ctx, "cannot allocate tensor");
-          return MakeStringError(diag.message());
-        }
-        resize_image(input.get(), height_scale, width_scale, *dht);
+  AsyncValueRef<Chain> chain =
+      resize_image(input, ResizeOptions(), &*output, exec_ctx);
+  return ForwardValue(*output, std::move(chain));
+}
 
-        // Remove the batch_size dimension before returning the result.
-        TensorMetadata output_metadata(GetDType<float>(),
-                                       {height, width, channels});
-        DenseHostTensor output(output_metadata, dht->ReleaseBuffer());
-        return std::move(output);
-      });
+// Returns tf.stack([tf.compat.v1.image.resize(
+//     tf.image.decode_jpeg(image, channels=3), [height, width])
+//   for image in images])
+static AsyncValueRef<DenseHostTensor> DecodeAndResizeJpegBatch(
+    Argument<StringHostTensor> images, Index height, Index width,
+    const ExecutionContext& exec_ctx) {
+  TFRT_TRACE_SCOPE(Default, "DecodeAndResizeJpegBatch");
+  return decode_and_resize_jpeg_batch(images.ValueRef(), height, width,
+                                      exec_ctx);
 }
 
 // This is the entrypoint to the library.
 void RegisterImageKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_test.decode_jpeg", TFRT_KERNEL(DecodeJpeg));
   registry->AddKernel("tfrt_test.resize_bilinear", TFRT_KERNEL(ResizeBilinear));
+  registry->AddKernel("tfrt_test.decode_and_resize_jpeg_batch",
+                      TFRT_KERNEL(DecodeAndResizeJpegBatch));
 }
 
 }  // namespace image
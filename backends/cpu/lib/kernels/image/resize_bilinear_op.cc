@@ -16,25 +16,40 @@
 
 #include "resize_bilinear_op.h"
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
 namespace tfrt {
 namespace image {
 namespace {
 
-struct CachedInterpolation {
-  Index lower;  // Lower source index used in the interpolation
-  Index upper;  // Upper source index used in the interpolation
-  // 1-D linear iterpolation scale (see:
-  // https://en.wikipedia.org/wiki/Bilinear_interpolation)
-  float lerp;
-};
+float resize_scale(const Index in_size, const Index out_size,
+                   const bool align_corners) {
+  return (align_corners && out_size > 1)
+             ? (in_size - 1) / static_cast<float>(out_size - 1)
+             : in_size / static_cast<float>(out_size);
+}
 
 void compute_interpolation_weights(const Index out_size, const Index in_size,
                                    const float scale,
+                                   const bool half_pixel_centers,
                                    CachedInterpolation* interpolation) {
-  interpolation[out_size].lower = 0;
-  interpolation[out_size].upper = 0;
-  for (Index i = out_size - 1; i >= 0; --i) {
-    const float in = static_cast<float>(i) * scale;
+  for (Index i = 0; i < out_size; ++i) {
+    const float in = half_pixel_centers
+                         ? (static_cast<float>(i) + 0.5f) * scale - 0.5f
+                         : static_cast<float>(i) * scale;
     const float in_f = std::floor(in);
     interpolation[i].lower =
         std::max(static_cast<Index>(in_f), static_cast<Index>(0));
@@ -44,6 +59,41 @@ void compute_interpolation_weights(const Index out_size, const Index in_size,
   }
 }
 
+// Caches the interpolation tables of the recently resized image sizes.
+class InterpolationTableCache {
+ public:
+  std::shared_ptr<const InterpolationTable> Get(Index in_size, Index out_size,
+                                                const ResizeOptions& options) {
+    const Key key{in_size, out_size, options.align_corners,
+                  options.half_pixel_centers};
+
+    mutex_lock lock(mu_);
+    auto it = tables_.find(key);
+    if (it != tables_.end()) return it->second;
+
+    // Tables are shared with the running resizes, and the cache can be
+    // dropped at any time.
+    if (tables_.size() >= kMaxCachedTables) tables_.clear();
+
+    auto table = std::make_shared<InterpolationTable>(out_size);
+    compute_interpolation_weights(
+        out_size, in_size,
+        resize_scale(in_size, out_size, options.align_corners),
+        options.half_pixel_centers, table->data());
+    tables_.emplace(key, table);
+    return table;
+  }
+
+ private:
+  static constexpr size_t kMaxCachedTables = 256;
+
+  using Key = std::tuple<Index, Index, bool, bool>;
+
+  mutex mu_;
+  std::map<Key, std::shared_ptr<const InterpolationTable>> tables_
+      TFRT_GUARDED_BY(mu_);
+};
+
 float compute_lerp(const float top_left, const float top_right,
                    const float bottom_left, const float bottom_right,
                    const float x_lerp, const float y_lerp) {
@@ -51,84 +101,224 @@ float compute_lerp(const float top_left, const float top_right,
   const float bottom = bottom_left + (bottom_right - bottom_left) * x_lerp;
   return top + (bottom - top) * y_lerp;
 }
-}  // namespace
 
-void resize_image(const DenseHostTensor& input, const float height_scale,
-                  const float width_scale, DenseHostTensor& output) {
-  const TensorShape& input_shape = input.shape();
-  Index batch_size = 1;
-  Index input_height = input_shape.GetDimensionSize(0);
-  Index input_width = input_shape.GetDimensionSize(1);
-  Index channels = input_shape.GetDimensionSize(2);
-
-  const TensorShape& output_shape = output.shape();
-  Index output_height = output_shape.GetDimensionSize(1);
-  Index output_width = output_shape.GetDimensionSize(2);
-
-  std::vector<CachedInterpolation> ys(output_height + 1);
-  std::vector<CachedInterpolation> xs(output_width + 1);
-
-  compute_interpolation_weights(output_height, input_height, height_scale,
-                                ys.data());
-  compute_interpolation_weights(output_width, input_width, width_scale,
-                                xs.data());
-
-  // Scale x interpolation weights to avoid a multiplication during iteration.
-  for (int i = 0; i < xs.size(); ++i) {
-    xs[i].lower *= channels;
-    xs[i].upper *= channels;
+// Interpolates the output pixels [x_begin, x_end) of a row from the `top` and
+// `bottom` input rows.
+template <typename T>
+void resize_row(const T* top, const T* bottom, const float y_lerp,
+                const CachedInterpolation* xs, const Index x_begin,
+                const Index x_end, const Index channels, float* output) {
+  for (Index x = x_begin; x < x_end; ++x) {
+    const Index lower = xs[x].lower * channels;
+    const Index upper = xs[x].upper * channels;
+    const float x_lerp = xs[x].lerp;
+    for (Index c = 0; c < channels; ++c) {
+      const float top_left(top[lower + c]);
+      const float top_right(top[upper + c]);
+      const float bottom_left(bottom[lower + c]);
+      const float bottom_right(bottom[upper + c]);
+      output[x * channels + c] = compute_lerp(
+          top_left, top_right, bottom_left, bottom_right, x_lerp, y_lerp);
+    }
+  }
+}
+
+#if defined(__SSE2__)
+
+// Loads the four channels of a pixel as floats.
+inline __m128 load_pixel(const float* pixel) { return _mm_loadu_ps(pixel); }
+
+inline __m128 load_pixel(const uint8_t* pixel) {
+  int32_t bytes;
+  std::memcpy(&bytes, pixel, sizeof(bytes));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i ints = _mm_cvtsi32_si128(bytes);
+  ints = _mm_unpacklo_epi16(_mm_unpacklo_epi8(ints, zero), zero);
+  return _mm_cvtepi32_ps(ints);
+}
+
+// Interpolates all the channels of a pixel at once. Pixels are loaded and
+// stored as 4 floats, and for the 3 channels images the 4th lane reads the
+// next input pixel, and writes the next output pixel.
+template <int kChannels, typename T>
+void resize_row_interleaved(const T* top, const T* bottom, const float y_lerp,
+                            const CachedInterpolation* xs, const Index x_begin,
+                            const Index x_end, float* output) {
+  static_assert(kChannels == 3 || kChannels == 4, "Unsupported channels");
+  const __m128 y = _mm_set1_ps(y_lerp);
+  for (Index x = x_begin; x < x_end; ++x) {
+    const Index lower = xs[x].lower * kChannels;
+    const Index upper = xs[x].upper * kChannels;
+    const __m128 x_lerp = _mm_set1_ps(xs[x].lerp);
+
+    const __m128 top_left = load_pixel(top + lower);
+    const __m128 top_right = load_pixel(top + upper);
+    const __m128 bottom_left = load_pixel(bottom + lower);
+    const __m128 bottom_right = load_pixel(bottom + upper);
+
+    const __m128 top_x = _mm_add_ps(
+        top_left, _mm_mul_ps(_mm_sub_ps(top_right, top_left), x_lerp));
+    const __m128 bottom_x = _mm_add_ps(
+        bottom_left, _mm_mul_ps(_mm_sub_ps(bottom_right, bottom_left), x_lerp));
+    const __m128 pixel =
+        _mm_add_ps(top_x, _mm_mul_ps(_mm_sub_ps(bottom_x, top_x), y));
+    _mm_storeu_ps(output + x * kChannels, pixel);
+  }
+}
+
+#endif  // defined(__SSE2__)
+
+// Image sizes of the batched resize.
+struct ResizeDims {
+  Index batch;
+  Index input_height;
+  Index input_width;
+  Index output_height;
+  Index output_width;
+  Index channels;
+};
+
+// Resizes the output rows [begin, end) of the [batch * output_height] rows.
+template <typename T>
+void resize_rows(const T* input, const ResizeDims& dims,
+                 const InterpolationTable& ys, const InterpolationTable& xs,
+                 float* output, const Index begin, const Index end) {
+  const Index channels = dims.channels;
+  const Index in_row_size = dims.input_width * channels;
+  const Index in_image_size = dims.input_height * in_row_size;
+  const Index out_row_size = dims.output_width * channels;
+
+#if defined(__SSE2__)
+  // Output pixels reading the last input pixel of a row read one element past
+  // the row end with the 3 channels loads, which must stay inside the image.
+  Index x_last_pixel = 0;
+  while (x_last_pixel < dims.output_width &&
+         xs[x_last_pixel].upper < dims.input_width - 1) {
+    ++x_last_pixel;
   }
+#endif
+
+  for (Index row = begin; row < end; ++row) {
+    const Index b = row / dims.output_height;
+    const Index y = row % dims.output_height;
 
-  const Index in_row_size = input_width * channels;
-  const Index in_batch_num_values = input_height * in_row_size;
-  const Index out_row_size = output_width * channels;
-  const uint8_t* input_b_ptr = static_cast<const uint8_t*>(input.data());
-  float* output_y_ptr = static_cast<float*>(output.data());
-
-  for (int b = 0; b < batch_size; ++b) {
-    for (Index y = 0; y < output_height; ++y) {
-      const uint8_t* ys_input_lower_ptr =
-          input_b_ptr + ys[y].lower * in_row_size;
-      const uint8_t* ys_input_upper_ptr =
-          input_b_ptr + ys[y].upper * in_row_size;
-      const float ys_lerp = ys[y].lerp;
-      for (Index x = 0; x < output_width; ++x) {
-        const Index xs_lower = xs[x].lower;
-        const Index xs_upper = xs[x].upper;
-        const float xs_lerp = xs[x].lerp;
-
-        // Read channel 0.
-        const float top_left0(ys_input_lower_ptr[xs_lower + 0]);
-        const float top_right0(ys_input_lower_ptr[xs_upper + 0]);
-        const float bottom_left0(ys_input_upper_ptr[xs_lower + 0]);
-        const float bottom_right0(ys_input_upper_ptr[xs_upper + 0]);
-
-        // Read channel 1.
-        const float top_left1(ys_input_lower_ptr[xs_lower + 1]);
-        const float top_right1(ys_input_lower_ptr[xs_upper + 1]);
-        const float bottom_left1(ys_input_upper_ptr[xs_lower + 1]);
-        const float bottom_right1(ys_input_upper_ptr[xs_upper + 1]);
-
-        // Read channel 2.
-        const float top_left2(ys_input_lower_ptr[xs_lower + 2]);
-        const float top_right2(ys_input_lower_ptr[xs_upper + 2]);
-        const float bottom_left2(ys_input_upper_ptr[xs_lower + 2]);
-        const float bottom_right2(ys_input_upper_ptr[xs_upper + 2]);
-
-        // Compute output.
-        output_y_ptr[x * channels + 0] =
-            compute_lerp(top_left0, top_right0, bottom_left0, bottom_right0,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 1] =
-            compute_lerp(top_left1, top_right1, bottom_left1, bottom_right1,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 2] =
-            compute_lerp(top_left2, top_right2, bottom_left2, bottom_right2,
-                         xs_lerp, ys_lerp);
+    const T* image = input + b * in_image_size;
+    const T* top = image + ys[y].lower * in_row_size;
+    const T* bottom = image + ys[y].upper * in_row_size;
+    const float y_lerp = ys[y].lerp;
+    float* output_row = output + row * out_row_size;
+
+#if defined(__SSE2__)
+    if (channels == 4) {
+      resize_row_interleaved<4>(top, bottom, y_lerp, xs.data(), 0,
+                                dims.output_width, output_row);
+      continue;
+    }
+
+    if (channels == 3) {
+      // The last output pixel is written without the 4th lane store.
+      Index x_end = std::max<Index>(dims.output_width - 1, 0);
+      if (ys[y].upper == dims.input_height - 1) {
+        x_end = std::min(x_end, x_last_pixel);
       }
-      output_y_ptr += out_row_size;
+      resize_row_interleaved<3>(top, bottom, y_lerp, xs.data(), 0, x_end,
+                                output_row);
+      resize_row(top, bottom, y_lerp, xs.data(), x_end, dims.output_width,
+                 channels, output_row);
+      continue;
     }
-    input_b_ptr += in_batch_num_values;
+#endif
+
+    resize_row(top, bottom, y_lerp, xs.data(), 0, dims.output_width, channels,
+               output_row);
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<const InterpolationTable> GetInterpolationTable(
+    Index in_size, Index out_size, const ResizeOptions& options) {
+  static InterpolationTableCache* cache = new InterpolationTableCache;
+  return cache->Get(in_size, out_size, options);
+}
+
+void resize_image(const uint8_t* input, Index input_height, Index input_width,
+                  Index channels, float* output, Index output_height,
+                  Index output_width, const ResizeOptions& options) {
+  const ResizeDims dims{/*batch=*/1,   input_height, input_width,
+                        output_height, output_width, channels};
+  auto ys = GetInterpolationTable(input_height, output_height, options);
+  auto xs = GetInterpolationTable(input_width, output_width, options);
+  resize_rows(input, dims, *ys, *xs, output, 0, output_height);
+}
+
+AsyncValueRef<Chain> resize_image(const DenseHostTensor& input,
+                                  const ResizeOptions& options,
+                                  DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx) {
+  const TensorShape& input_shape = input.shape();
+  const TensorShape& output_shape = output->shape();
+  const int rank = input_shape.GetRank();
+
+  if ((rank != 3 && rank != 4) || output_shape.GetRank() != rank) {
+    return EmitErrorAsync(exec_ctx,
+                          "input and output images must have rank 3 or 4");
+  }
+  if (options.align_corners && options.half_pixel_centers) {
+    return EmitErrorAsync(
+        exec_ctx, "align_corners and half_pixel_centers can't both be true");
+  }
+  if (output->dtype() != DType(DType::F32)) {
+    return EmitErrorAsync(exec_ctx, "output image must be float");
+  }
+
+  const int d = rank - 3;
+  const ResizeDims dims{rank == 4 ? input_shape.GetDimensionSize(0) : 1,
+                        input_shape.GetDimensionSize(d),
+                        input_shape.GetDimensionSize(d + 1),
+                        output_shape.GetDimensionSize(d),
+                        output_shape.GetDimensionSize(d + 1),
+                        input_shape.GetDimensionSize(d + 2)};
+
+  if ((rank == 4 && output_shape.GetDimensionSize(0) != dims.batch) ||
+      output_shape.GetDimensionSize(d + 2) != dims.channels) {
+    return EmitErrorAsync(
+        exec_ctx, "output image batch and channels must match the input");
+  }
+  if (output->NumElements() == 0) return MakeAvailableAsyncValueRef<Chain>();
+  if (input.NumElements() == 0) {
+    return EmitErrorAsync(exec_ctx, "can't resize an empty image");
+  }
+
+  auto ys = GetInterpolationTable(dims.input_height, dims.output_height,
+                                  options);
+  auto xs = GetInterpolationTable(dims.input_width, dims.output_width,
+                                  options);
+
+  // Each output row loads two input rows and interpolates all its values.
+  const double row_values = dims.output_width * dims.channels;
+  const auto block_sizes = ParallelFor::BlockSizes::Cost(
+      4 * row_values * GetHostSize(input.dtype()), row_values * sizeof(float),
+      6 * row_values);
+
+  auto resize = [&](auto type_tag) {
+    using T = decltype(type_tag);
+    return ParallelFor(exec_ctx).Execute(
+        dims.batch * dims.output_height, block_sizes,
+        [input = input.CopyRef(), output = output->CopyRef(), dims,
+         ys = std::move(ys), xs = std::move(xs)](size_t begin, size_t end) {
+          resize_rows(static_cast<const T*>(input.data()), dims, *ys, *xs,
+                      static_cast<float*>(output.data()), begin, end);
+        });
+  };
+
+  switch (input.dtype()) {
+    case DType::UI8:
+      return resize(uint8_t{});
+    case DType::F32:
+      return resize(float{});
+    default:
+      return EmitErrorAsync(exec_ctx, "input image must be uint8 or float");
   }
 }
 
@@ -19,7 +19,14 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_RESIZE_BILINEAR_OP_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_RESIZE_BILINEAR_OP_H_
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "jpeg/jpeg_mem.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
@@ -30,8 +37,48 @@
 namespace tfrt {
 namespace image {
 
-void resize_image(const DenseHostTensor& input, float height_scale,
-                  float width_scale, DenseHostTensor& output);
+struct ResizeOptions {
+  // If true, the centers of the corner pixels of the input and output images
+  // are aligned, and the corner pixels values are preserved.
+  bool align_corners = false;
+
+  // If true, the pixel centers are at the half pixel offsets (this matches
+  // the image resize of the most image libraries). Can't be used together with
+  // the `align_corners`.
+  bool half_pixel_centers = false;
+};
+
+struct CachedInterpolation {
+  Index lower;  // Lower source index used in the interpolation
+  Index upper;  // Upper source index used in the interpolation
+  // 1-D linear iterpolation scale (see:
+  // https://en.wikipedia.org/wiki/Bilinear_interpolation)
+  float lerp;
+};
+
+using InterpolationTable = std::vector<CachedInterpolation>;
+
+// Returns the interpolation table for resizing a dimension of `in_size`
+// pixels into `out_size` pixels. Tables are cached for the recently used
+// sizes, because the same image sizes are resized again and again in the
+// input pipelines.
+std::shared_ptr<const InterpolationTable> GetInterpolationTable(
+    Index in_size, Index out_size, const ResizeOptions& options);
+
+// Resizes a single uint8 [input_height, input_width, channels] image into the
+// float [output_height, output_width, channels] `output` in the caller thread.
+void resize_image(const uint8_t* input, Index input_height, Index input_width,
+                  Index channels, float* output, Index output_height,
+                  Index output_width, const ResizeOptions& options);
+
+// Resizes the uint8 or float [height, width, channels] image, or the
+// [batch, height, width, channels] images, into the float `output` with the
+// same rank. Output rows are resized in parallel, and the uint8 pixels are
+// converted to float inside the interpolation.
+AsyncValueRef<Chain> resize_image(const DenseHostTensor& input,
+                                  const ResizeOptions& options,
+                                  DenseHostTensor* output,
+                                  const ExecutionContext& exec_ctx);
 
 }  // namespace image
 }  // namespace tfrt
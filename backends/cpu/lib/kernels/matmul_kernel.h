@@ -19,6 +19,7 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 
+#include "./reduced_precision.h"
 #include "tfrt/common/compat/eigen/contraction_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -31,6 +32,10 @@ namespace cpu {
 //   C = alpha * AB + beta * C
 //
 // Link: https://en.wikipedia.org/wiki/Basic_Linear_Algebra_Subprograms#Level_3
+//
+// Reduced precision inputs (F16 and BF16) are converted to float, and the
+// contraction accumulates in float. The output kernel sees the float output
+// block, and the results are converted back to T when they are written to C.
 template <typename T, typename OutputKernel, typename EigenEvaluator>
 typename EigenEvaluator::DependencyToken MatMul(
     float alpha, const DenseHostTensor& a, const DenseHostTensor& b, float beta,
@@ -45,8 +50,10 @@ typename EigenEvaluator::DependencyToken MatMul(
   contract_dim[0].first = transpose_a ? 0 : 1;
   contract_dim[0].second = transpose_b ? 1 : 0;
 
-  auto in0 = compat::AsEigenConstTensor(a_view);
-  auto in1 = compat::AsEigenConstTensor(b_view);
+  using Compute = ComputeType<T>;
+
+  auto in0 = CastTo<Compute>(compat::AsEigenConstTensor(a_view));
+  auto in1 = CastTo<Compute>(compat::AsEigenConstTensor(b_view));
   auto out = compat::AsEigenTensor(c_view);
 
   auto buffers = eigen.KeepAlive(&a, &b, c);
@@ -55,18 +62,23 @@ typename EigenEvaluator::DependencyToken MatMul(
 
   if (alpha == 1.0 && beta == 0.0) {
     // Expression: C = AB
-    return eigen.Evaluate(std::move(out), std::move(contract_expr),
+    return eigen.Evaluate(std::move(out), CastTo<T>(std::move(contract_expr)),
                           std::move(buffers));
 
   } else if (alpha == 1.0) {
     // Expression: C = AB + beta * C
-    auto expr = contract_expr + out.constant(beta) * out;
-    return eigen.Evaluate(std::move(out), std::move(expr), std::move(buffers));
+    auto out_c = CastTo<Compute>(out);
+    auto expr = contract_expr + out_c.constant(Compute(beta)) * out_c;
+    return eigen.Evaluate(std::move(out), CastTo<T>(std::move(expr)),
+                          std::move(buffers));
 
   } else {
     // Expression: C = alpha * AB + beta * C
-    auto expr = out.constant(alpha) * contract_expr + out.constant(beta) * out;
-    return eigen.Evaluate(std::move(out), std::move(expr), std::move(buffers));
+    auto out_c = CastTo<Compute>(out);
+    auto expr = out_c.constant(Compute(alpha)) * contract_expr +
+                out_c.constant(Compute(beta)) * out_c;
+    return eigen.Evaluate(std::move(out), CastTo<T>(std::move(expr)),
+                          std::move(buffers));
   }
 }
 
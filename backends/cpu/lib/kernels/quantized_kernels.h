@@ -0,0 +1,619 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Quantize, Dequantize and quantized (uint8 x int8 -> int32) MatMul kernels,
+// and the Tensorflow style affine quantization helpers.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
+
+#if defined(__AVX2__) || defined(__AVX512VNNI__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/eigen_kernel.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Affine quantization of the float range [min, max] into the range of the
+// integer type T, with the same rounding as the Tensorflow MIN_FIRST mode:
+//
+//   quantized = round(value * scale) - round(min * scale) + lowest(T)
+//
+// Zero is always exactly representable if the range contains it.
+template <typename T>
+class QuantizedRange {
+ public:
+  QuantizedRange(float min, float max) : min_(min), max_(max) {
+    // The range is slightly extended, so that `max` is quantized to one step
+    // below the next power of two.
+    const double num_steps = std::ldexp(1.0, sizeof(T) * 8);
+    const double range = (static_cast<double>(max) - min) * num_steps /
+                         (num_steps - 1.0);
+    scale_ = range == 0.0 ? 0.0 : num_steps / range;
+    step_ = range / num_steps;
+    offset_ = kLowest - std::round(min * scale_);
+    min_rounded_ = range == 0.0 ? min : std::round(min / step_) * step_;
+  }
+
+  float min() const { return min_; }
+  float max() const { return max_; }
+
+  T Quantize(float value) const {
+    if (min_ == max_) return static_cast<T>(kLowest);
+    const double quantized = std::round(value * scale_) + offset_;
+    return static_cast<T>(std::min<double>(
+        std::max<double>(quantized, kLowest), kHighest));
+  }
+
+  float Dequantize(T value) const {
+    if (min_ == max_) return min_;
+    return static_cast<float>(min_rounded_ + (value - kLowest) * step_);
+  }
+
+  // Returns the quantized value of zero, without clamping it to the T range.
+  // Zero points are passed to the quantized kernels as int32 values, so the
+  // zero point is saturated to the int32 range.
+  int32_t ZeroPoint() const {
+    if (min_ == max_) return static_cast<int32_t>(kLowest);
+    return static_cast<int32_t>(std::min<double>(
+        std::max<double>(offset_, std::numeric_limits<int32_t>::lowest()),
+        std::numeric_limits<int32_t>::max()));
+  }
+
+  // Returns the real value of the difference between two adjacent quantized
+  // values, as used by the quantized ops to derive their output ranges.
+  float FloatForOneLevel() const {
+    return (max_ - min_) / (static_cast<float>(kHighest) - kLowest);
+  }
+
+ private:
+  static constexpr int64_t kLowest = std::numeric_limits<T>::lowest();
+  static constexpr int64_t kHighest = std::numeric_limits<T>::max();
+
+  float min_;
+  float max_;
+  double scale_;
+  double step_;
+  double offset_;
+  // `min` rounded to a multiple of the step.
+  double min_rounded_;
+};
+
+// Computes the real range of the int32 products of the values quantized into
+// the `a` and `b` ranges: one int32 level is the product of one `a` level and
+// one `b` level.
+template <typename A, typename B>
+QuantizedRange<int32_t> QuantizationRangeForMultiplication(
+    const QuantizedRange<A>& a, const QuantizedRange<B>& b) {
+  const float level = a.FloatForOneLevel() * b.FloatForOneLevel();
+  return QuantizedRange<int32_t>(
+      level * static_cast<float>(std::numeric_limits<int32_t>::lowest()),
+      level * static_cast<float>(std::numeric_limits<int32_t>::max()));
+}
+
+namespace internal {
+
+// Returns the dot product of `k` uint8 and int8 values. Products of uint8 and
+// int8 values are exact in int16, so the SIMD paths do not saturate.
+inline int32_t DotUint8Int8(const uint8_t* a, const int8_t* b,
+                            Eigen::Index k) {
+  Eigen::Index i = 0;
+  int32_t sum = 0;
+
+#if defined(__AVX512VNNI__) && defined(__AVX512F__)
+  // VPDPBUSD multiplies 64 pairs of uint8 and int8 values, and adds every 4
+  // adjacent products to an int32 lane of the accumulator.
+  __m512i acc = _mm512_setzero_si512();
+  for (; i + 64 <= k; i += 64) {
+    acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(a + i),
+                              _mm512_loadu_si512(b + i));
+  }
+  sum += _mm512_reduce_add_epi32(acc);
+#elif defined(__AVX2__)
+  // Values are widened to int16, so that VPMADDWD computes the exact sums of
+  // the adjacent products (VPMADDUBSW would saturate them in int16).
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= k; i += 16) {
+    const __m256i a16 = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i b16 = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a16, b16));
+  }
+  __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                 _mm256_extracti128_si256(acc, 1));
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  acc128 = _mm_hadd_epi32(acc128, acc128);
+  sum += _mm_cvtsi128_si32(acc128);
+#endif
+
+  for (; i < k; ++i) sum += static_cast<int32_t>(a[i]) * b[i];
+  return sum;
+}
+
+#if defined(__AVX512VNNI__) && defined(__AVX512F__)
+// Returns the sums of the int32 lanes of the 4 accumulators.
+inline __m128i ReduceAdd4(__m512i acc0, __m512i acc1, __m512i acc2,
+                          __m512i acc3) {
+  auto fold = [](__m512i acc) {
+    return _mm256_add_epi32(_mm512_castsi512_si256(acc),
+                            _mm512_extracti64x4_epi64(acc, 1));
+  };
+  const __m256i acc01 = _mm256_hadd_epi32(fold(acc0), fold(acc1));
+  const __m256i acc23 = _mm256_hadd_epi32(fold(acc2), fold(acc3));
+  const __m256i acc0123 = _mm256_hadd_epi32(acc01, acc23);
+  return _mm_add_epi32(_mm256_castsi256_si128(acc0123),
+                       _mm256_extracti128_si256(acc0123, 1));
+}
+#elif defined(__AVX2__)
+// Returns the sums of the int32 lanes of the 4 accumulators.
+inline __m128i ReduceAdd4(__m256i acc0, __m256i acc1, __m256i acc2,
+                          __m256i acc3) {
+  const __m256i acc01 = _mm256_hadd_epi32(acc0, acc1);
+  const __m256i acc23 = _mm256_hadd_epi32(acc2, acc3);
+  const __m256i acc0123 = _mm256_hadd_epi32(acc01, acc23);
+  return _mm_add_epi32(_mm256_castsi256_si128(acc0123),
+                       _mm256_extracti128_si256(acc0123, 1));
+}
+
+// Loads 16 int8 or uint8 values widened to int16.
+inline __m256i LoadInt16(const int8_t* p) {
+  return _mm256_cvtepi8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+inline __m256i LoadInt16(const uint8_t* p) {
+  return _mm256_cvtepu8_epi16(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+#endif
+
+// Computes the dot products of `k` uint8 `a` values with 4 vectors of `k` int8
+// values, which start at `b` and are `b_stride` values apart. The `a` values
+// are loaded once for the 4 dot products, and the accumulators are reduced
+// together.
+inline void DotUint8Int8x4(const uint8_t* a, const int8_t* b,
+                           Eigen::Index b_stride, Eigen::Index k,
+                           int32_t* sums) {
+  const int8_t* b0 = b;
+  const int8_t* b1 = b + b_stride;
+  const int8_t* b2 = b + 2 * b_stride;
+  const int8_t* b3 = b + 3 * b_stride;
+  Eigen::Index i = 0;
+  std::fill(sums, sums + 4, 0);
+
+#if defined(__AVX512VNNI__) && defined(__AVX512F__)
+  __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+  __m512i acc2 = _mm512_setzero_si512(), acc3 = _mm512_setzero_si512();
+  for (; i + 64 <= k; i += 64) {
+    const __m512i a64 = _mm512_loadu_si512(a + i);
+    acc0 = _mm512_dpbusd_epi32(acc0, a64, _mm512_loadu_si512(b0 + i));
+    acc1 = _mm512_dpbusd_epi32(acc1, a64, _mm512_loadu_si512(b1 + i));
+    acc2 = _mm512_dpbusd_epi32(acc2, a64, _mm512_loadu_si512(b2 + i));
+    acc3 = _mm512_dpbusd_epi32(acc3, a64, _mm512_loadu_si512(b3 + i));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums),
+                   ReduceAdd4(acc0, acc1, acc2, acc3));
+#elif defined(__AVX2__)
+  __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+  __m256i acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+  for (; i + 16 <= k; i += 16) {
+    const __m256i a16 = LoadInt16(a + i);
+    acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a16, LoadInt16(b0 + i)));
+    acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(a16, LoadInt16(b1 + i)));
+    acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(a16, LoadInt16(b2 + i)));
+    acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(a16, LoadInt16(b3 + i)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums),
+                   ReduceAdd4(acc0, acc1, acc2, acc3));
+#endif
+
+  for (; i < k; ++i) {
+    const int32_t a_i = a[i];
+    sums[0] += a_i * b0[i];
+    sums[1] += a_i * b1[i];
+    sums[2] += a_i * b2[i];
+    sums[3] += a_i * b3[i];
+  }
+}
+
+// Computes the dot products of 2 vectors of `k` uint8 values, which start at
+// `a` and are `a_stride` values apart, with the 4 `b` vectors of
+// DotUint8Int8x4. Every loaded `b` value is used for both `a` vectors. The
+// dot products of the second `a` vector are stored at `sums + sums_stride`.
+inline void DotUint8Int8x2x4(const uint8_t* a, Eigen::Index a_stride,
+                             const int8_t* b, Eigen::Index b_stride,
+                             Eigen::Index k, int32_t* sums,
+                             Eigen::Index sums_stride) {
+  const uint8_t* a0 = a;
+  const uint8_t* a1 = a + a_stride;
+  const int8_t* b0 = b;
+  const int8_t* b1 = b + b_stride;
+  const int8_t* b2 = b + 2 * b_stride;
+  const int8_t* b3 = b + 3 * b_stride;
+  int32_t* sums0 = sums;
+  int32_t* sums1 = sums + sums_stride;
+  Eigen::Index i = 0;
+  std::fill(sums0, sums0 + 4, 0);
+  std::fill(sums1, sums1 + 4, 0);
+
+#if defined(__AVX512VNNI__) && defined(__AVX512F__)
+  __m512i acc00 = _mm512_setzero_si512(), acc01 = _mm512_setzero_si512();
+  __m512i acc02 = _mm512_setzero_si512(), acc03 = _mm512_setzero_si512();
+  __m512i acc10 = _mm512_setzero_si512(), acc11 = _mm512_setzero_si512();
+  __m512i acc12 = _mm512_setzero_si512(), acc13 = _mm512_setzero_si512();
+  for (; i + 64 <= k; i += 64) {
+    const __m512i a0_64 = _mm512_loadu_si512(a0 + i);
+    const __m512i a1_64 = _mm512_loadu_si512(a1 + i);
+    const __m512i b0_64 = _mm512_loadu_si512(b0 + i);
+    acc00 = _mm512_dpbusd_epi32(acc00, a0_64, b0_64);
+    acc10 = _mm512_dpbusd_epi32(acc10, a1_64, b0_64);
+    const __m512i b1_64 = _mm512_loadu_si512(b1 + i);
+    acc01 = _mm512_dpbusd_epi32(acc01, a0_64, b1_64);
+    acc11 = _mm512_dpbusd_epi32(acc11, a1_64, b1_64);
+    const __m512i b2_64 = _mm512_loadu_si512(b2 + i);
+    acc02 = _mm512_dpbusd_epi32(acc02, a0_64, b2_64);
+    acc12 = _mm512_dpbusd_epi32(acc12, a1_64, b2_64);
+    const __m512i b3_64 = _mm512_loadu_si512(b3 + i);
+    acc03 = _mm512_dpbusd_epi32(acc03, a0_64, b3_64);
+    acc13 = _mm512_dpbusd_epi32(acc13, a1_64, b3_64);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums0),
+                   ReduceAdd4(acc00, acc01, acc02, acc03));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums1),
+                   ReduceAdd4(acc10, acc11, acc12, acc13));
+#elif defined(__AVX2__)
+  __m256i acc00 = _mm256_setzero_si256(), acc01 = _mm256_setzero_si256();
+  __m256i acc02 = _mm256_setzero_si256(), acc03 = _mm256_setzero_si256();
+  __m256i acc10 = _mm256_setzero_si256(), acc11 = _mm256_setzero_si256();
+  __m256i acc12 = _mm256_setzero_si256(), acc13 = _mm256_setzero_si256();
+  for (; i + 16 <= k; i += 16) {
+    const __m256i a0_16 = LoadInt16(a0 + i);
+    const __m256i a1_16 = LoadInt16(a1 + i);
+    const __m256i b0_16 = LoadInt16(b0 + i);
+    acc00 = _mm256_add_epi32(acc00, _mm256_madd_epi16(a0_16, b0_16));
+    acc10 = _mm256_add_epi32(acc10, _mm256_madd_epi16(a1_16, b0_16));
+    const __m256i b1_16 = LoadInt16(b1 + i);
+    acc01 = _mm256_add_epi32(acc01, _mm256_madd_epi16(a0_16, b1_16));
+    acc11 = _mm256_add_epi32(acc11, _mm256_madd_epi16(a1_16, b1_16));
+    const __m256i b2_16 = LoadInt16(b2 + i);
+    acc02 = _mm256_add_epi32(acc02, _mm256_madd_epi16(a0_16, b2_16));
+    acc12 = _mm256_add_epi32(acc12, _mm256_madd_epi16(a1_16, b2_16));
+    const __m256i b3_16 = LoadInt16(b3 + i);
+    acc03 = _mm256_add_epi32(acc03, _mm256_madd_epi16(a0_16, b3_16));
+    acc13 = _mm256_add_epi32(acc13, _mm256_madd_epi16(a1_16, b3_16));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums0),
+                   ReduceAdd4(acc00, acc01, acc02, acc03));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums1),
+                   ReduceAdd4(acc10, acc11, acc12, acc13));
+#endif
+
+  for (; i < k; ++i) {
+    const int32_t a0_i = a0[i];
+    const int32_t a1_i = a1[i];
+    sums0[0] += a0_i * b0[i];
+    sums0[1] += a0_i * b1[i];
+    sums0[2] += a0_i * b2[i];
+    sums0[3] += a0_i * b3[i];
+    sums1[0] += a1_i * b0[i];
+    sums1[1] += a1_i * b1[i];
+    sums1[2] += a1_i * b2[i];
+    sums1[3] += a1_i * b3[i];
+  }
+}
+
+// Copies the [rows, cols] row major `src` matrix into the [cols, rows] row
+// major `dst` matrix. The matrix is copied in square blocks of a cache line,
+// because the column by column copy of a large matrix writes a new cache line
+// for every value.
+template <typename T>
+void TransposeMatrix(const T* src, Eigen::Index rows, Eigen::Index cols,
+                     T* dst) {
+  static constexpr Eigen::Index kBlock = 64 / sizeof(T);
+  for (Eigen::Index r0 = 0; r0 < rows; r0 += kBlock) {
+    const Eigen::Index r1 = std::min(rows, r0 + kBlock);
+    for (Eigen::Index c0 = 0; c0 < cols; c0 += kBlock) {
+      const Eigen::Index c1 = std::min(cols, c0 + kBlock);
+      for (Eigen::Index c = c0; c < c1; ++c)
+        for (Eigen::Index r = r0; r < r1; ++r)
+          dst[c * rows + r] = src[r * cols + c];
+    }
+  }
+}
+
+// Rough cost of quantizing or dequantizing a single value.
+static constexpr double kQuantizeCycles = 10;
+
+}  // namespace internal
+
+// Quantizes the float `input` into the `range`. T is the integer type
+// underlying the `output` quantized dtype.
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Quantize(
+    const DenseHostTensor& input, const QuantizedRange<T>& range,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  const float* input_data = static_cast<const float*>(input.data());
+  T* output_data = static_cast<T*>(output->data());
+
+  auto compute = [=](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      output_data[i] = range.Quantize(input_data[i]);
+  };
+
+  EigenEvaluator eigen{exec_ctx};
+  return eigen.ParallelExecute(
+      input.NumElements(),
+      ParallelFor::BlockSizes::Cost(sizeof(float), sizeof(T),
+                                    internal::kQuantizeCycles),
+      std::move(compute), eigen.KeepAlive(&input, output));
+}
+
+// Dequantizes the `input` from the `range` into the float `output`. T is the
+// integer type underlying the `input` quantized dtype.
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Dequantize(
+    const DenseHostTensor& input, const QuantizedRange<T>& range,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  const T* input_data = static_cast<const T*>(input.data());
+  float* output_data = static_cast<float*>(output->data());
+
+  auto compute = [=](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      output_data[i] = range.Dequantize(input_data[i]);
+  };
+
+  EigenEvaluator eigen{exec_ctx};
+  return eigen.ParallelExecute(
+      input.NumElements(),
+      ParallelFor::BlockSizes::Cost(sizeof(T), sizeof(float),
+                                    internal::kQuantizeCycles),
+      std::move(compute), eigen.KeepAlive(&input, output));
+}
+
+// Quantized MatMul output kernels. An output kernel is called with the int32
+// accumulators of the `count` output elements of the `row` starting at `col`.
+
+// Stores the accumulators into an int32 output.
+struct QuantizedMatMulInt32Output {
+  void operator()(Eigen::Index row, Eigen::Index col, const int32_t* acc,
+                  Eigen::Index count) const {
+    std::copy(acc, acc + count, output + row * num_cols + col);
+  }
+
+  int32_t* output;
+  Eigen::Index num_cols;
+};
+
+// Adds the float bias to the real values of the accumulators, and quantizes
+// the results into the output range.
+template <typename T>
+struct QuantizedMatMulRequantizeOutput {
+  void operator()(Eigen::Index row, Eigen::Index col, const int32_t* acc,
+                  Eigen::Index count) const {
+    T* out = output + row * num_cols + col;
+    const float* col_bias = bias.data() + col;
+    for (Eigen::Index i = 0; i < count; ++i)
+      out[i] = range.Quantize(acc[i] * acc_scale + col_bias[i]);
+  }
+
+  T* output;
+  Eigen::Index num_cols;
+  // Real value of one accumulator level.
+  float acc_scale;
+  std::vector<float> bias;
+  QuantizedRange<T> range;
+};
+
+// The int8 `b` operand of the quantized MatMul, packed into the [n, k] row
+// major layout, so that every output element is a dot product of two
+// contiguous vectors, with the column sums used to apply the `a` zero point.
+// Constant operands (e.g. weights) are packed once and shared by the MatMuls.
+struct QuantizedMatMulPackedRhs {
+  Eigen::Index k;
+  Eigen::Index n;
+  // Points either into `packed`, or into the `buffer` of a `b` operand which
+  // is already in the packed layout.
+  const int8_t* data;
+  std::vector<int8_t> packed;
+  // The buffer of `b`, which is kept alive with the packed operand.
+  RCReference<HostBuffer> buffer;
+  std::vector<int32_t> col_sums;
+};
+
+inline std::shared_ptr<const QuantizedMatMulPackedRhs> PackQuantizedMatMulRhs(
+    const DenseHostTensor& b, bool transpose_b) {
+  auto rhs = std::make_shared<QuantizedMatMulPackedRhs>();
+  const Eigen::Index k = b.shape().GetDimensionSize(transpose_b ? 1 : 0);
+  const Eigen::Index n = b.shape().GetDimensionSize(transpose_b ? 0 : 1);
+  rhs->k = k;
+  rhs->n = n;
+
+  rhs->buffer = b.buffer().CopyRef();
+  const int8_t* data = static_cast<const int8_t*>(b.data());
+  if (!transpose_b) {
+    rhs->packed.resize(n * k);
+    internal::TransposeMatrix(data, k, n, rhs->packed.data());
+    data = rhs->packed.data();
+  }
+  rhs->data = data;
+
+  rhs->col_sums.resize(n);
+  for (Eigen::Index j = 0; j < n; ++j) {
+    int32_t sum = 0;
+    for (Eigen::Index i = 0; i < k; ++i) sum += data[j * k + i];
+    rhs->col_sums[j] = sum;
+  }
+  return rhs;
+}
+
+// Computes the [m, n] product of the uint8 `a` and the packed int8 `b`
+// matrices, with the values offset by the zero points:
+//
+//   acc[i, j] = sum_k (a[i, k] - a_zero_point) * (b[k, j] - b_zero_point)
+//
+// and passes the int32 accumulators to the `output_kernel`. The zero points
+// are applied after the dot products using the row sums of `a` and the column
+// sums of `b`, so the inner loop multiplies the raw values.
+template <typename OutputKernel, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken QuantizedMatMul(
+    const DenseHostTensor& a, std::shared_ptr<const QuantizedMatMulPackedRhs> b,
+    int32_t a_zero_point, int32_t b_zero_point, bool transpose_a,
+    OutputKernel output_kernel, DenseHostTensor* output,
+    const ExecutionContext& exec_ctx) {
+  EigenEvaluator eigen{exec_ctx};
+
+  const Eigen::Index a_rows = a.shape().GetDimensionSize(0);
+  const Eigen::Index a_cols = a.shape().GetDimensionSize(1);
+
+  const Eigen::Index m = transpose_a ? a_cols : a_rows;
+  const Eigen::Index k = transpose_a ? a_rows : a_cols;
+  const Eigen::Index n = b->n;
+
+  if (b->k != k)
+    return eigen.MakeError("matrix size-incompatible for quantized matmul");
+
+  // `a` is packed into the k-contiguous layout as well.
+  std::shared_ptr<std::vector<uint8_t>> packed_a;
+  const uint8_t* a_data = static_cast<const uint8_t*>(a.data());
+  if (transpose_a) {
+    packed_a = std::make_shared<std::vector<uint8_t>>(m * k);
+    internal::TransposeMatrix(a_data, k, m, packed_a->data());
+    a_data = packed_a->data();
+  }
+
+  // Columns are processed in blocks, so that the block of packed `b` stays in
+  // the cache while it is multiplied with all the rows.
+  static constexpr Eigen::Index kColumnBlockBytes = 256 * 1024;
+  const Eigen::Index col_block =
+      std::min(n, std::max<Eigen::Index>(1, kColumnBlockBytes / (k + 1)));
+  // The zero point terms are computed in int64, as their intermediate values
+  // may overflow int32 even when the accumulators do not.
+  const int64_t zero_points_product =
+      static_cast<int64_t>(k) * a_zero_point * b_zero_point;
+
+  auto compute = [=, packed_a = std::move(packed_a),
+                  output_kernel = std::move(output_kernel)](size_t begin,
+                                                            size_t end) {
+    const int8_t* b_data = b->data;
+    const int32_t* b_col_sums = b->col_sums.data();
+
+    // The `b` zero point terms only depend on the row, and are computed once
+    // for all the column blocks.
+    std::vector<int64_t> row_offsets(end - begin);
+    for (size_t row = begin; row < end; ++row) {
+      const uint8_t* a_row = a_data + row * k;
+      int64_t a_row_sum = 0;
+      for (Eigen::Index i = 0; i < k; ++i) a_row_sum += a_row[i];
+      row_offsets[row - begin] = zero_points_product - b_zero_point * a_row_sum;
+    }
+
+    // Rows are multiplied in pairs, so that every loaded `b` value is used
+    // for two rows.
+    std::vector<int32_t> acc(2 * col_block);
+    auto finish_row = [&](size_t row, Eigen::Index col, Eigen::Index count,
+                          int32_t* row_acc) {
+      const int64_t row_offset = row_offsets[row - begin];
+      for (Eigen::Index j = 0; j < count; ++j) {
+        row_acc[j] = static_cast<int32_t>(
+            row_acc[j] + row_offset -
+            static_cast<int64_t>(a_zero_point) * b_col_sums[col + j]);
+      }
+      output_kernel(row, col, row_acc, count);
+    };
+
+    for (Eigen::Index col = 0; col < n; col += col_block) {
+      const Eigen::Index count = std::min(col_block, n - col);
+      const int8_t* b_block = b_data + col * k;
+      size_t row = begin;
+      for (; row + 2 <= end; row += 2) {
+        const uint8_t* a_rows = a_data + row * k;
+        Eigen::Index j = 0;
+        for (; j + 4 <= count; j += 4) {
+          internal::DotUint8Int8x2x4(a_rows, /*a_stride=*/k, b_block + j * k,
+                                     /*b_stride=*/k, k, &acc[j],
+                                     /*sums_stride=*/col_block);
+        }
+        for (; j < count; ++j) {
+          acc[j] = internal::DotUint8Int8(a_rows, b_block + j * k, k);
+          acc[col_block + j] =
+              internal::DotUint8Int8(a_rows + k, b_block + j * k, k);
+        }
+        finish_row(row, col, count, &acc[0]);
+        finish_row(row + 1, col, count, &acc[col_block]);
+      }
+      if (row < end) {
+        const uint8_t* a_row = a_data + row * k;
+        Eigen::Index j = 0;
+        for (; j + 4 <= count; j += 4) {
+          internal::DotUint8Int8x4(a_row, b_block + j * k, /*b_stride=*/k, k,
+                                   &acc[j]);
+        }
+        for (; j < count; ++j)
+          acc[j] = internal::DotUint8Int8(a_row, b_block + j * k, k);
+        finish_row(row, col, count, &acc[0]);
+      }
+    }
+  };
+
+  // A row multiplies its `k` values with the whole `b` matrix, at roughly
+  // four multiply-adds per cycle.
+  const double row_bytes_loaded = static_cast<double>(k) * (n + 1);
+  const double row_bytes_stored = static_cast<double>(n) * sizeof(int32_t);
+  const double row_cycles = static_cast<double>(n) * k / 4;
+
+  return eigen.ParallelExecute(
+      m,
+      ParallelFor::BlockSizes::Cost(row_bytes_loaded, row_bytes_stored,
+                                    row_cycles),
+      std::move(compute), eigen.KeepAlive(&a, output));
+}
+
+// Computes the quantized MatMul of the uint8 `a` and int8 `b` matrices, with
+// `b` packed for this MatMul only.
+template <typename OutputKernel, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken QuantizedMatMul(
+    const DenseHostTensor& a, const DenseHostTensor& b, int32_t a_zero_point,
+    int32_t b_zero_point, bool transpose_a, bool transpose_b,
+    OutputKernel output_kernel, DenseHostTensor* output,
+    const ExecutionContext& exec_ctx) {
+  const Eigen::Index k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+  if (b.shape().GetDimensionSize(transpose_b ? 1 : 0) != k) {
+    EigenEvaluator eigen{exec_ctx};
+    return eigen.MakeError("matrix size-incompatible for quantized matmul");
+  }
+  return QuantizedMatMul<OutputKernel, EigenEvaluator>(
+      a, PackQuantizedMatMulRhs(b, transpose_b), a_zero_point, b_zero_point,
+      transpose_a, std::move(output_kernel), output, exec_ctx);
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_KERNELS_H_
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Helpers for the kernels that store values in the reduced precision floating
+// point types (F16 and BF16), and compute in float.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCED_PRECISION_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCED_PRECISION_H_
+
+#include <type_traits>
+
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+
+namespace tfrt {
+namespace cpu {
+
+template <typename T>
+using IsReducedPrecision =
+    std::integral_constant<bool, std::is_same<T, Eigen::half>::value ||
+                                     std::is_same<T, Eigen::bfloat16>::value>;
+
+// The type used to compute values stored as T.
+template <typename T>
+using ComputeType =
+    std::conditional_t<IsReducedPrecision<T>::value, float, T>;
+
+namespace internal {
+
+template <typename To, typename Expr>
+auto CastTo(Expr expr, std::true_type) {
+  return expr;
+}
+
+template <typename To, typename Expr>
+auto CastTo(Expr expr, std::false_type) {
+  return expr.template cast<To>();
+}
+
+}  // namespace internal
+
+// Returns the Eigen Tensor expression `expr` converted to the scalar type To.
+// Conversions are only added to the expression if the scalar types differ.
+// Eigen vectorizes the conversions between float and the reduced precision
+// types (with F16C and AVX512-BF16 instructions when they are enabled).
+template <typename To, typename Expr>
+auto CastTo(Expr expr) {
+  return internal::CastTo<To>(
+      std::move(expr), std::is_same<To, typename Expr::Scalar>());
+}
+
+// Converts `size` contiguous values between types in the caller thread. The
+// pointers do not have to be aligned.
+template <typename From, typename To>
+void ConvertValues(const From* src, To* dst, Eigen::Index size) {
+  using Src = Eigen::TensorMap<const Eigen::Tensor<From, 1, Eigen::RowMajor>,
+                               Eigen::Unaligned>;
+  using Dst =
+      Eigen::TensorMap<Eigen::Tensor<To, 1, Eigen::RowMajor>, Eigen::Unaligned>;
+  Dst(dst, size) = Src(src, size).template cast<To>();
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCED_PRECISION_H_
@@ -0,0 +1,544 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reduction (Sum, Prod, Mean, Max, Min, All, Any) kernels implementation.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "reduced_precision.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "transpose_kernel.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Reducers define the reduction of the values of type T with the accumulator
+// of type Acc:
+//   Initialize() -> Acc        the identity of the reduction
+//   Reduce(Acc, Acc) -> Acc    associative and commutative reduction
+//   Finalize(Acc, Index) -> T  the result of the reduction of `n` values
+//
+// Reduced precision values are accumulated in float.
+//
+// Vectorizable reducers also define the reduction of the Eigen packets:
+//   ReducePacket(Packet, Packet) -> Packet
+
+template <typename T>
+struct SumReducer {
+  using Acc = ComputeType<T>;
+  static constexpr bool kVectorizable =
+      Eigen::internal::packet_traits<Acc>::Vectorizable &&
+      Eigen::internal::packet_traits<Acc>::HasAdd;
+  template <typename Packet>
+  static Packet ReducePacket(const Packet& lhs, const Packet& rhs) {
+    return Eigen::internal::padd(lhs, rhs);
+  }
+  static Acc Initialize() { return Acc(0); }
+  static Acc Reduce(Acc lhs, Acc rhs) { return lhs + rhs; }
+  static T Finalize(Acc acc, Index n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct MeanReducer : public SumReducer<T> {
+  using Acc = typename SumReducer<T>::Acc;
+  // The mean of zero floating point values is NaN (as in Tensorflow).
+  static T Finalize(Acc acc, Index n) {
+    return static_cast<T>(std::is_integral<Acc>::value && n == 0
+                              ? acc
+                              : acc / static_cast<Acc>(n));
+  }
+};
+
+template <typename T>
+struct ProdReducer {
+  using Acc = ComputeType<T>;
+  static constexpr bool kVectorizable =
+      Eigen::internal::packet_traits<Acc>::Vectorizable &&
+      Eigen::internal::packet_traits<Acc>::HasMul;
+  template <typename Packet>
+  static Packet ReducePacket(const Packet& lhs, const Packet& rhs) {
+    return Eigen::internal::pmul(lhs, rhs);
+  }
+  static Acc Initialize() { return Acc(1); }
+  static Acc Reduce(Acc lhs, Acc rhs) { return lhs * rhs; }
+  static T Finalize(Acc acc, Index n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct MaxReducer {
+  using Acc = ComputeType<T>;
+  static constexpr bool kVectorizable =
+      Eigen::internal::packet_traits<Acc>::Vectorizable &&
+      Eigen::internal::packet_traits<Acc>::HasMax;
+  template <typename Packet>
+  static Packet ReducePacket(const Packet& lhs, const Packet& rhs) {
+    return Eigen::internal::pmax(lhs, rhs);
+  }
+  static Acc Initialize() {
+    return std::numeric_limits<Acc>::has_infinity
+               ? -std::numeric_limits<Acc>::infinity()
+               : std::numeric_limits<Acc>::lowest();
+  }
+  static Acc Reduce(Acc lhs, Acc rhs) { return lhs < rhs ? rhs : lhs; }
+  static T Finalize(Acc acc, Index n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct MinReducer {
+  using Acc = ComputeType<T>;
+  static constexpr bool kVectorizable =
+      Eigen::internal::packet_traits<Acc>::Vectorizable &&
+      Eigen::internal::packet_traits<Acc>::HasMin;
+  template <typename Packet>
+  static Packet ReducePacket(const Packet& lhs, const Packet& rhs) {
+    return Eigen::internal::pmin(lhs, rhs);
+  }
+  static Acc Initialize() {
+    return std::numeric_limits<Acc>::has_infinity
+               ? std::numeric_limits<Acc>::infinity()
+               : std::numeric_limits<Acc>::max();
+  }
+  static Acc Reduce(Acc lhs, Acc rhs) { return rhs < lhs ? rhs : lhs; }
+  static T Finalize(Acc acc, Index n) { return static_cast<T>(acc); }
+};
+
+template <typename T>
+struct AllReducer {
+  static_assert(std::is_same<T, bool>::value, "All reduces bool values");
+  using Acc = bool;
+  static constexpr bool kVectorizable = false;
+  static Acc Initialize() { return true; }
+  static Acc Reduce(Acc lhs, Acc rhs) { return lhs && rhs; }
+  static T Finalize(Acc acc, Index n) { return acc; }
+};
+
+template <typename T>
+struct AnyReducer {
+  static_assert(std::is_same<T, bool>::value, "Any reduces bool values");
+  using Acc = bool;
+  static constexpr bool kVectorizable = false;
+  static Acc Initialize() { return false; }
+  static Acc Reduce(Acc lhs, Acc rhs) { return lhs || rhs; }
+  static T Finalize(Acc acc, Index n) { return acc; }
+};
+
+namespace internal {
+
+// Reduction of the input viewed as a [outer, reduced, inner] tensor, after the
+// input dimensions are permuted with `perm` (if it is not empty).
+struct ReductionPlan {
+  Index outer = 1;
+  Index reduced = 1;
+  Index inner = 1;
+
+  // Collapsed input dimensions, and the permutation that moves all the reduced
+  // dimensions after the kept dimensions. Reductions that do not need a
+  // transpose have an empty `perm`.
+  llvm::SmallVector<Index, 8> collapsed_dims;
+  llvm::SmallVector<Index, 8> perm;
+};
+
+inline ReductionPlan MakeReductionPlan(ArrayRef<Index> input_dims,
+                                       ArrayRef<int32_t> reduction_indices) {
+  llvm::SmallVector<bool, 8> reduced_dim(input_dims.size(), false);
+  for (int32_t index : reduction_indices) reduced_dim[index] = true;
+
+  // Drop the size 1 dimensions, and merge the adjacent dimensions that are
+  // both reduced or both kept.
+  llvm::SmallVector<Index, 8> dims;
+  llvm::SmallVector<bool, 8> reduced;
+  for (int i = 0; i < input_dims.size(); ++i) {
+    if (input_dims[i] == 1) continue;
+    if (!reduced.empty() && reduced.back() == reduced_dim[i]) {
+      dims.back() *= input_dims[i];
+    } else {
+      dims.push_back(input_dims[i]);
+      reduced.push_back(reduced_dim[i]);
+    }
+  }
+
+  ReductionPlan plan;
+  const int rank = dims.size();
+
+  // Reduction of the alternating kept and reduced dimensions: [K, R, K, R...].
+  // Transpose the input to [K..., R...] and reduce the inner dimension.
+  if (rank > 3 || (rank == 3 && reduced[0])) {
+    plan.collapsed_dims = dims;
+    for (int i = 0; i < rank; ++i) {
+      if (!reduced[i]) plan.perm.push_back(i);
+    }
+    for (int i = 0; i < rank; ++i) {
+      if (reduced[i]) plan.perm.push_back(i);
+    }
+    for (int i = 0; i < rank; ++i) {
+      (reduced[i] ? plan.reduced : plan.outer) *= dims[i];
+    }
+    return plan;
+  }
+
+  // At most one reduced dimension: [K?, R?, K?].
+  int i = 0;
+  if (i < rank && !reduced[i]) plan.outer = dims[i++];
+  if (i < rank && reduced[i]) plan.reduced = dims[i++];
+  if (i < rank) plan.inner = dims[i];
+  return plan;
+}
+
+// Number of the values reduced sequentially at the leaves of the pairwise
+// reduction tree. Rounding errors of the floating point sums grow with the
+// depth of the tree, and not with the number of reduced values.
+static constexpr Index kPairwiseReductionBlock = 128;
+
+// Number of the inner dimension values reduced together in the column
+// reductions.
+static constexpr Index kColumnReductionBlock = 256;
+
+template <typename Reducer>
+using IsVectorizable = std::integral_constant<bool, Reducer::kVectorizable>;
+
+// Returns the `n` values as the accumulator type values, converting them into
+// the `buffer` if the types differ.
+template <typename Acc, typename T>
+const Acc* AsAcc(const T* data, Index n, Acc* buffer, std::true_type) {
+  return data;
+}
+
+template <typename Acc, typename T>
+const Acc* AsAcc(const T* data, Index n, Acc* buffer, std::false_type) {
+  ConvertValues(data, buffer, n);
+  return buffer;
+}
+
+// Reduces at most kPairwiseReductionBlock contiguous values.
+template <typename Reducer, typename T>
+typename Reducer::Acc ReduceBlock(const T* data, Index n, std::true_type) {
+  using Acc = typename Reducer::Acc;
+  using Packet = typename Eigen::internal::packet_traits<Acc>::type;
+  static constexpr Index kSize = Eigen::internal::unpacket_traits<Packet>::size;
+
+  Acc buffer[kPairwiseReductionBlock];
+  const Acc* values = AsAcc(data, n, buffer, std::is_same<T, Acc>());
+
+  // Two independent packet accumulators hide the latency of the reductions.
+  Packet acc0 = Eigen::internal::pset1<Packet>(Reducer::Initialize());
+  Packet acc1 = acc0;
+  Index i = 0;
+  for (; i + 2 * kSize <= n; i += 2 * kSize) {
+    acc0 = Reducer::ReducePacket(
+        acc0, Eigen::internal::ploadu<Packet>(values + i));
+    acc1 = Reducer::ReducePacket(
+        acc1, Eigen::internal::ploadu<Packet>(values + i + kSize));
+  }
+
+  Acc lanes[kSize];
+  Eigen::internal::pstoreu(lanes, Reducer::ReducePacket(acc0, acc1));
+  Acc acc = Reducer::Initialize();
+  for (Index k = 0; k < kSize; ++k) acc = Reducer::Reduce(acc, lanes[k]);
+  for (; i < n; ++i) acc = Reducer::Reduce(acc, values[i]);
+  return acc;
+}
+
+template <typename Reducer, typename T>
+typename Reducer::Acc ReduceBlock(const T* data, Index n, std::false_type) {
+  using Acc = typename Reducer::Acc;
+  Acc acc = Reducer::Initialize();
+  for (Index i = 0; i < n; ++i) {
+    acc = Reducer::Reduce(acc, static_cast<Acc>(data[i]));
+  }
+  return acc;
+}
+
+// Reduces the `n` values into the `acc[0..n)` accumulators.
+template <typename Reducer, typename T>
+void ReduceInto(typename Reducer::Acc* acc, const T* data, Index n,
+                std::true_type) {
+  using Acc = typename Reducer::Acc;
+  using Packet = typename Eigen::internal::packet_traits<Acc>::type;
+  static constexpr Index kSize = Eigen::internal::unpacket_traits<Packet>::size;
+
+  Acc buffer[kColumnReductionBlock];
+  for (Index j0 = 0; j0 < n; j0 += kColumnReductionBlock) {
+    const Index cols = std::min(kColumnReductionBlock, n - j0);
+    const Acc* values = AsAcc(data + j0, cols, buffer, std::is_same<T, Acc>());
+    Acc* out = acc + j0;
+
+    Index j = 0;
+    for (; j + kSize <= cols; j += kSize) {
+      Eigen::internal::pstoreu(
+          out + j, Reducer::ReducePacket(
+                       Eigen::internal::ploadu<Packet>(out + j),
+                       Eigen::internal::ploadu<Packet>(values + j)));
+    }
+    for (; j < cols; ++j) out[j] = Reducer::Reduce(out[j], values[j]);
+  }
+}
+
+template <typename Reducer, typename T>
+void ReduceInto(typename Reducer::Acc* acc, const T* data, Index n,
+                std::false_type) {
+  using Acc = typename Reducer::Acc;
+  for (Index j = 0; j < n; ++j) {
+    acc[j] = Reducer::Reduce(acc[j], static_cast<Acc>(data[j]));
+  }
+}
+
+// Reduces `n` contiguous values.
+template <typename Reducer, typename T>
+typename Reducer::Acc ReduceContiguous(const T* data, Index n) {
+  if (n > kPairwiseReductionBlock) {
+    const Index half = n / 2;
+    return Reducer::Reduce(ReduceContiguous<Reducer>(data, half),
+                           ReduceContiguous<Reducer>(data + half, n - half));
+  }
+  return ReduceBlock<Reducer>(data, n, IsVectorizable<Reducer>());
+}
+
+// Reduces `rows` rows of `cols` contiguous values, separated by `stride`
+// values, into `acc`.
+template <typename Reducer, typename T>
+void ReduceRows(const T* data, Index rows, Index cols, Index stride,
+                typename Reducer::Acc* acc) {
+  using Acc = typename Reducer::Acc;
+
+  if (rows > kPairwiseReductionBlock) {
+    const Index half = rows / 2;
+    llvm::SmallVector<Acc, kColumnReductionBlock> rhs(cols);
+    ReduceRows<Reducer>(data, half, cols, stride, acc);
+    ReduceRows<Reducer>(data + half * stride, rows - half, cols, stride,
+                        rhs.data());
+    ReduceInto<Reducer>(acc, rhs.data(), cols, IsVectorizable<Reducer>());
+    return;
+  }
+
+  std::fill(acc, acc + cols, Reducer::Initialize());
+  for (Index r = 0; r < rows; ++r) {
+    ReduceInto<Reducer>(acc, data + r * stride, cols,
+                        IsVectorizable<Reducer>());
+  }
+}
+
+// Reduces the [outer, reduced, inner] `input` into the [outer, inner] `output`.
+template <typename Reducer, typename T>
+AsyncValueRef<Chain> Reduce3D(const DenseHostTensor& input, Index outer,
+                              Index reduced, Index inner,
+                              DenseHostTensor* output,
+                              const ExecutionContext& exec_ctx) {
+  using Acc = typename Reducer::Acc;
+
+  const T* input_data = static_cast<const T*>(input.data());
+  T* output_data = static_cast<T*>(output->data());
+
+  const Index num_outputs = outer * inner;
+  const Index num_col_blocks =
+      (inner + kColumnReductionBlock - 1) / kColumnReductionBlock;
+  const int num_threads = exec_ctx.host()->GetNumWorkerThreads();
+
+  // Cost of reducing one input value.
+  const double cycles = Eigen::NumTraits<Acc>::AddCost;
+
+  // Too few outputs to keep all threads busy: split the reduced dimension
+  // between the tasks, that reduce into the task local accumulators for all
+  // outputs. Accumulators are combined in a tree with ParallelFor::Reduce.
+  static constexpr Index kMaxSplitOutputs = 16384;
+  if (outer * num_col_blocks < num_threads && num_outputs <= kMaxSplitOutputs &&
+      reduced > kPairwiseReductionBlock) {
+    using Accs = std::vector<Acc>;
+
+    // Reduces the rows [begin, end) of the input viewed as an
+    // [outer * reduced, inner] matrix.
+    auto compute = [=](size_t begin, size_t end) -> Accs {
+      Accs accs(num_outputs, Reducer::Initialize());
+      while (begin < end) {
+        const Index o = begin / reduced;
+        const Index rows = std::min<Index>(end, (o + 1) * reduced) - begin;
+        Acc* acc = accs.data() + o * inner;
+        if (inner == 1) {
+          acc[0] = ReduceContiguous<Reducer>(input_data + begin, rows);
+        } else {
+          ReduceRows<Reducer>(input_data + begin * inner, rows, inner, inner,
+                              acc);
+        }
+        begin += rows;
+      }
+      return accs;
+    };
+
+    auto combine = [](Accs lhs, Accs rhs) -> Accs {
+      for (size_t j = 0; j < lhs.size(); ++j) {
+        lhs[j] = Reducer::Reduce(lhs[j], rhs[j]);
+      }
+      return lhs;
+    };
+
+    AsyncValueRef<Accs> accs = ParallelFor(exec_ctx).Reduce<Accs>(
+        outer * reduced,
+        ParallelFor::BlockSizes::Cost(inner * sizeof(T), 0, inner * cycles),
+        Accs(num_outputs, Reducer::Initialize()), std::move(compute),
+        std::move(combine));
+
+    auto chain = MakeConstructedAsyncValueRef<Chain>();
+    auto buffers = compat::KeepBuffers::alive(&input, output);
+    accs.AndThen([accs = accs.CopyRef(), chain = chain.CopyRef(), output_data,
+                  reduced, buffers = std::move(buffers)]() {
+      const Accs& value = accs.get();
+      for (size_t j = 0; j < value.size(); ++j) {
+        output_data[j] = Reducer::Finalize(value[j], reduced);
+      }
+      chain.SetStateConcrete();
+    });
+    return chain;
+  }
+
+  compat::AsyncEigenEvaluator eigen{exec_ctx};
+
+  // Reduce the contiguous rows of the input in parallel.
+  if (inner == 1) {
+    auto compute = [=](size_t begin, size_t end) {
+      for (size_t o = begin; o < end; ++o) {
+        output_data[o] = Reducer::Finalize(
+            ReduceContiguous<Reducer>(input_data + o * reduced, reduced),
+            reduced);
+      }
+    };
+    return eigen.ParallelExecute(
+        outer,
+        ParallelFor::BlockSizes::Cost(reduced * sizeof(T), sizeof(T),
+                                      reduced * cycles),
+        std::move(compute), eigen.KeepAlive(&input, output));
+  }
+
+  // Reduce the blocks of the inner dimension columns in parallel. Each task
+  // reads kColumnReductionBlock contiguous values from every reduced row.
+  auto compute = [=](size_t begin, size_t end) {
+    llvm::SmallVector<Acc, kColumnReductionBlock> acc;
+    for (size_t task = begin; task < end; ++task) {
+      const Index o = task / num_col_blocks;
+      const Index j0 = (task % num_col_blocks) * kColumnReductionBlock;
+      const Index cols = std::min(kColumnReductionBlock, inner - j0);
+
+      acc.resize(cols);
+      ReduceRows<Reducer>(input_data + o * reduced * inner + j0, reduced, cols,
+                          inner, acc.data());
+      for (Index j = 0; j < cols; ++j) {
+        output_data[o * inner + j0 + j] = Reducer::Finalize(acc[j], reduced);
+      }
+    }
+  };
+
+  const Index block = std::min(kColumnReductionBlock, inner);
+  return eigen.ParallelExecute(
+      outer * num_col_blocks,
+      ParallelFor::BlockSizes::Cost(reduced * block * sizeof(T),
+                                    block * sizeof(T),
+                                    reduced * block * cycles),
+      std::move(compute), eigen.KeepAlive(&input, output));
+}
+
+}  // namespace internal
+
+// Reduces the `input` along the `reduction_indices` dimensions into the
+// `output`, with the Reducer template instantiated for the input type T.
+// Reduction indices must be unique and in the [0, input_rank) range. The
+// output has the input kept dimensions (the output shape can also have size 1
+// dimensions for the `keep_dims` reductions).
+//
+// The input is viewed as a [outer, reduced, inner] tensor, and the reduction
+// is either a reduction of the contiguous rows (inner == 1), or a reduction of
+// the columns, with a pairwise reduction tree along the reduced dimension.
+// Reductions of the non-adjacent dimensions transpose the input first.
+template <template <typename> class Reducer, typename T>
+AsyncValueRef<Chain> Reduce(const DenseHostTensor& input,
+                            ArrayRef<int32_t> reduction_indices,
+                            DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  llvm::SmallVector<Index, 8> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  internal::ReductionPlan plan =
+      internal::MakeReductionPlan(input_dims, reduction_indices);
+
+  if (output->NumElements() != plan.outer * plan.inner) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("Reduction output shape ", output->shape(),
+                         " does not match the input shape ", input.shape()));
+  }
+
+  if (plan.perm.empty()) {
+    return internal::Reduce3D<Reducer<T>, T>(input, plan.outer, plan.reduced,
+                                             plan.inner, output, exec_ctx);
+  }
+
+  // Transpose the collapsed input to move the reduced dimensions inside.
+  DenseHostTensor collapsed(
+      TensorMetadata(input.dtype(), plan.collapsed_dims), input.buffer());
+  llvm::SmallVector<Index, 8> transposed_dims;
+  for (Index dim : plan.perm) {
+    transposed_dims.push_back(plan.collapsed_dims[dim]);
+  }
+  auto transposed = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(input.dtype(), transposed_dims), host);
+  if (!transposed) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+  }
+
+  auto transposed_chain = Transpose<compat::AsyncEigenEvaluator>(
+      collapsed, plan.perm, &*transposed, exec_ctx);
+
+  auto chain = MakeConstructedAsyncValueRef<Chain>();
+  transposed_chain.AndThen(
+      [transposed_chain = transposed_chain.CopyRef(), chain = chain.CopyRef(),
+       transposed = std::move(*transposed), output = output->CopyRef(),
+       outer = plan.outer, reduced = plan.reduced, exec_ctx]() mutable {
+        if (transposed_chain.IsError()) {
+          chain.SetError(transposed_chain.GetError());
+          return;
+        }
+        auto reduced_chain = internal::Reduce3D<Reducer<T>, T>(
+            transposed, outer, reduced, /*inner=*/1, &output, exec_ctx);
+        reduced_chain.AndThen([reduced_chain = reduced_chain.CopyRef(),
+                               chain = std::move(chain)]() {
+          if (reduced_chain.IsError()) {
+            chain.SetError(reduced_chain.GetError());
+          } else {
+            chain.SetStateConcrete();
+          }
+        });
+      });
+  return chain;
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
@@ -19,97 +19,224 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "./reduced_precision.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
 namespace cpu {
+namespace internal {
+
+// Computes softmax (or log softmax) of a single row of logits in two passes
+// over the row: the first pass computes the row max and the sum of the
+// exponentials together (online softmax), rescaling the sum every time the
+// max grows, and the second pass writes the normalized results. The result
+// row can alias the logits row.
+//
+// Masked (-inf) logits have zero probability. Rows with only masked logits
+// have zero probabilities for all classes (-inf for log softmax).
+template <typename T, bool log>
+struct SoftmaxRow {
+  static void Compute(const T* logits, T* softmax, Eigen::Index num_classes) {
+    using Vectorize = std::integral_constant<
+        bool, std::is_floating_point<T>::value &&
+                  Eigen::internal::packet_traits<T>::Vectorizable &&
+                  Eigen::internal::packet_traits<T>::HasExp>;
+    Compute(logits, softmax, num_classes, Vectorize());
+  }
+
+ private:
+  // Reduced precision types are accumulated in float.
+  using Acc = std::conditional_t<std::is_floating_point<T>::value, T, float>;
+
+  static constexpr Acc kMasked = -std::numeric_limits<Acc>::infinity();
+
+  // Updates the running `max` and `sum` of the exponentials with `value`. The
+  // exponential of a masked `value` is skipped, because it is NaN while the
+  // running max is also -inf.
+  static void Update(Acc value, Acc* max, Acc* sum) {
+    if (value > *max) {
+      *sum = *sum * std::exp(*max - value) + Acc(1);
+      *max = value;
+    } else if (value != kMasked) {
+      *sum += std::exp(value - *max);
+    }
+  }
+
+  // Writes the results of the row with only masked logits.
+  static void NormalizeMasked(T* softmax, Eigen::Index num_classes) {
+    std::fill(softmax, softmax + num_classes,
+              static_cast<T>(log ? kMasked : Acc(0)));
+  }
+
+  // Writes the normalized results for the [begin, num_classes) range.
+  static void Normalize(const T* logits, T* softmax, Eigen::Index begin,
+                        Eigen::Index num_classes, Acc max, Acc sum) {
+    const Acc log_sum = std::log(sum);
+    const Acc inv_sum = Acc(1) / sum;
+    for (Eigen::Index i = begin; i < num_classes; ++i) {
+      const Acc shifted = static_cast<Acc>(logits[i]) - max;
+      softmax[i] = static_cast<T>(log ? shifted - log_sum
+                                      : std::exp(shifted) * inv_sum);
+    }
+  }
+
+  static void Compute(const T* logits, T* softmax, Eigen::Index num_classes,
+                      std::false_type) {
+    Acc max = kMasked;
+    Acc sum = Acc(0);
+    for (Eigen::Index i = 0; i < num_classes; ++i)
+      Update(static_cast<Acc>(logits[i]), &max, &sum);
+    if (max == kMasked) {
+      NormalizeMasked(softmax, num_classes);
+      return;
+    }
+    Normalize(logits, softmax, 0, num_classes, max, sum);
+  }
+
+  static void Compute(const T* logits, T* softmax, Eigen::Index num_classes,
+                      std::true_type) {
+    using Packet = typename Eigen::internal::packet_traits<T>::type;
+    constexpr Eigen::Index kPacketSize =
+        Eigen::internal::unpacket_traits<Packet>::size;
+
+    if (num_classes < kPacketSize) {
+      Compute(logits, softmax, num_classes, std::false_type());
+      return;
+    }
+
+    using Eigen::internal::padd;
+    using Eigen::internal::pcmp_eq;
+    using Eigen::internal::pexp;
+    using Eigen::internal::ploadu;
+    using Eigen::internal::pmax;
+    using Eigen::internal::pmul;
+    using Eigen::internal::pselect;
+    using Eigen::internal::pset1;
+    using Eigen::internal::psub;
+    using Eigen::internal::pstoreu;
+    using Eigen::internal::pzero;
+
+    // Every packet lane keeps its own running max and sum. The lanes that
+    // have seen only masked logits keep a zero sum, instead of the NaN
+    // exponentials of -inf - -inf.
+    const Packet masked = pset1<Packet>(kMasked);
+    Packet max_packet = masked;
+    Packet sum_packet = pzero(masked);
+
+    const Eigen::Index vectorized_end =
+        num_classes - num_classes % kPacketSize;
+    for (Eigen::Index i = 0; i < vectorized_end; i += kPacketSize) {
+      const Packet x = ploadu<Packet>(logits + i);
+      const Packet new_max = pmax(max_packet, x);
+      sum_packet = pselect(
+          pcmp_eq(new_max, masked), sum_packet,
+          padd(pmul(sum_packet, pexp(psub(max_packet, new_max))),
+               pexp(psub(x, new_max))));
+      max_packet = new_max;
+    }
+
+    // Combine the lanes, and add the row tail.
+    Acc row_max = Eigen::internal::predux_max(max_packet);
+    Acc row_sum = Acc(0);
+    if (row_max != kMasked) {
+      row_sum = Eigen::internal::predux(
+          pmul(sum_packet, pexp(psub(max_packet, pset1<Packet>(row_max)))));
+    }
+    for (Eigen::Index i = vectorized_end; i < num_classes; ++i)
+      Update(logits[i], &row_max, &row_sum);
+    if (row_max == kMasked) {
+      NormalizeMasked(softmax, num_classes);
+      return;
+    }
+
+    // Normalize the vectorized part of the row, and the row tail.
+    const Packet shift = pset1<Packet>(row_max);
+    const Packet log_sum = pset1<Packet>(std::log(row_sum));
+    const Packet inv_sum = pset1<Packet>(T(1) / row_sum);
+    for (Eigen::Index i = 0; i < vectorized_end; i += kPacketSize) {
+      const Packet shifted = psub(ploadu<Packet>(logits + i), shift);
+      pstoreu(softmax + i,
+              log ? psub(shifted, log_sum) : pmul(pexp(shifted), inv_sum));
+    }
+    Normalize(logits, softmax, vectorized_end, num_classes, row_max, row_sum);
+  }
+};
+
+// Computes softmax for the rows [begin, end) in the caller thread.
+template <typename T, bool log>
+void SoftmaxRows(const T* logits, T* softmax, Eigen::Index num_classes,
+                 size_t begin, size_t end, std::false_type) {
+  for (size_t row = begin; row < end; ++row) {
+    SoftmaxRow<T, log>::Compute(logits + row * num_classes,
+                                softmax + row * num_classes, num_classes);
+  }
+}
+
+// Reduced precision rows are converted to a float scratch row, and computed
+// by the vectorized float row kernel.
+template <typename T, bool log>
+void SoftmaxRows(const T* logits, T* softmax, Eigen::Index num_classes,
+                 size_t begin, size_t end, std::true_type) {
+  std::vector<float> scratch(num_classes);
+  for (size_t row = begin; row < end; ++row) {
+    ConvertValues(logits + row * num_classes, scratch.data(), num_classes);
+    SoftmaxRow<float, log>::Compute(scratch.data(), scratch.data(),
+                                    num_classes);
+    ConvertValues(scratch.data(), softmax + row * num_classes, num_classes);
+  }
+}
+
+}  // namespace internal
 
 template <typename T, bool log, typename EigenEvaluator>
 static typename EigenEvaluator::DependencyToken Softmax(
     const DenseHostTensor& logits, DenseHostTensor* softmax,
     const ExecutionContext& exec_ctx) {
-  // TODO(b/172291736): Avoid creating another DHT by having a generic view
-  // class that operates on only a shape and a pointer.
-  DenseHostTensor reshaped_logits(
-      TensorMetadata(logits.dtype(), GetFlattenedInnerDimsShape(
-                                         logits.shape(), /*num_out_dims=*/2)),
-      logits.buffer());
-  DenseHostTensor reshaped_softmax(
-      TensorMetadata(
-          softmax->dtype(),
-          GetFlattenedInnerDimsShape(softmax->shape(), /*num_out_dims=*/2)),
-      softmax->buffer());
-  DHTIndexableView<T, 2> logits_view(&reshaped_logits);
-  MutableDHTIndexableView<T, 2> softmax_view(&reshaped_softmax);
-
-  auto logits_t = compat::AsEigenConstTensor(logits_view);
-  auto softmax_t = compat::AsEigenTensor(softmax_view);
+  // Softmax is computed independently for each row of the logits flattened
+  // into a [batch, num_classes] matrix.
+  TensorShape shape =
+      GetFlattenedInnerDimsShape(logits.shape(), /*num_out_dims=*/2);
 
   static constexpr int kBatchDim = 0;
   static constexpr int kClassDim = 1;
 
-  const int batch_size = logits_t.dimension(kBatchDim);
-  const int num_classes = logits_t.dimension(kClassDim);
-
-  // Reduce along the class dimension.
-  Eigen::IndexList<Eigen::type2index<kClassDim>> along_class;
-
-  // Broadcast from [num_classes] to [batch, num_classes]
-  Eigen::IndexList<int, Eigen::type2index<1>> batch_by_one;
-  batch_by_one.set(0, batch_size);
-
-  // Broadcast from [batch] to [batch, num_classes]
-  Eigen::IndexList<Eigen::type2index<1>, int> one_by_class;
-  one_by_class.set(1, num_classes);
-
-  // In both cases we first pre-compute temporary logits reduction into the
-  // output (softmax) tensor, and after that evaluate a second expression that
-  // uses pre-computed values to get a final result.
-
-  // shifted_logits = logits - max(logits along classes);
-  auto shifted_logits_expr = (logits_t - logits_t.maximum(along_class)
-                                             .eval()
-                                             .reshape(batch_by_one)
-                                             .broadcast(one_by_class));
-  EigenEvaluator eigen{exec_ctx.host()};
-
-  if (log) {
-    // softmax = logits - max(logits along classes);
-    auto logits_ready =
-        eigen.Evaluate(softmax_t, std::move(shifted_logits_expr),
-                       eigen.KeepAlive(&logits, softmax));
-
-    // softmax = softmax - log(sum(exp(softmax along classes)));
-    auto softmax_expr = (softmax_t - softmax_t.exp()
-                                         .sum(along_class)
-                                         .log()
-                                         .eval()
-                                         .reshape(batch_by_one)
-                                         .broadcast(one_by_class));
-
-    return eigen.Evaluate(logits_ready, softmax_t, std::move(softmax_expr),
-                          eigen.KeepAlive(&logits, softmax));
-
-  } else {
-    // softmax = exp(logits - max(logits along classes));
-    auto logits_ready =
-        eigen.Evaluate(softmax_t, std::move(shifted_logits_expr.exp()),
-                       eigen.KeepAlive(&logits, softmax));
-
-    // softmax = softmax * (1 / sum(softmax along classes));
-    auto softmax_expr = (softmax_t * softmax_t.sum(along_class)
-                                         .inverse()
-                                         .eval()
-                                         .reshape(batch_by_one)
-                                         .broadcast(one_by_class));
-
-    return eigen.Evaluate(logits_ready, softmax_t, std::move(softmax_expr),
-                          eigen.KeepAlive(&logits, softmax));
-  }
+  const Eigen::Index batch_size = shape.GetDimensionSize(kBatchDim);
+  const Eigen::Index num_classes = shape.GetDimensionSize(kClassDim);
+
+  const T* logits_data = static_cast<const T*>(logits.data());
+  T* softmax_data = static_cast<T*>(softmax->data());
+
+  // Computes softmax for the rows [begin, end) in the caller thread.
+  auto compute = [=](size_t begin, size_t end) {
+    internal::SoftmaxRows<T, log>(logits_data, softmax_data, num_classes,
+                                  begin, end, IsReducedPrecision<T>());
+  };
+
+  // The cost of a single row: logits are read twice, softmax is written once,
+  // and every class is exponentiated three times (twice in the first pass).
+  using ExpOp = Eigen::internal::scalar_exp_op<T>;
+  const double exp_cycles = Eigen::internal::functor_traits<ExpOp>::Cost;
+  const double row_bytes = num_classes * sizeof(T);
+  const double row_cycles =
+      num_classes * (3 * exp_cycles + 4 * Eigen::NumTraits<T>::AddCost);
+
+  EigenEvaluator eigen{exec_ctx};
+  return eigen.ParallelExecute(
+      batch_size,
+      ParallelFor::BlockSizes::Cost(2 * row_bytes, row_bytes, row_cycles),
+      std::move(compute), eigen.KeepAlive(&logits, softmax));
 }
 
 }  // namespace cpu
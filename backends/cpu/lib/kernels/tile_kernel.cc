@@ -46,37 +46,85 @@ Expected<llvm::SmallVector<Index, 5>> TileMultiples(
   return multiples;
 }
 
-void TileStringTensor(const StringHostTensor& input, StringHostTensor* output) {
-  // Compute strides from the shape.
-  auto strides = [](const TensorShape& shape) -> llvm::SmallVector<Index, 5> {
-    llvm::SmallVector<Index, 5> strides(shape.GetRank());
-    Index stride = 1;
-    for (int i = shape.GetRank() - 1; i >= 0; --i) {
-      strides[i] = stride;
-      stride *= shape.GetDimensionSize(i);
+namespace internal {
+
+// Tile is split into at least this many slabs for the parallel tiling (or
+// into the output elements if there are fewer).
+static constexpr Index kMinTileSlabs = 256;
+
+TilePlan MakeTilePlan(ArrayRef<Index> input_dims, ArrayRef<Index> multiples,
+                      Index element_size) {
+  TilePlan plan;
+
+  auto add_dim = [&](Index dim, Index multiple) {
+    if (dim == 1 && multiple == 1) return;
+    if (!plan.input_dims.empty()) {
+      // Not tiled dimension is a part of the outer dimension block.
+      if (multiple == 1) {
+        plan.input_dims.back() *= dim;
+        return;
+      }
+      // Tiled size 1 outer dimension repeats the inner dimension block.
+      if (plan.input_dims.back() == 1) {
+        plan.input_dims.back() = dim;
+        plan.multiples.back() *= multiple;
+        return;
+      }
     }
-    return strides;
+    plan.input_dims.push_back(dim);
+    plan.multiples.push_back(multiple);
   };
 
-  const int ndims = output->shape().GetRank();
-  const Index nelem = output->NumElements();
+  for (int i = 0; i < input_dims.size(); ++i) {
+    add_dim(input_dims[i], multiples[i]);
+  }
+  add_dim(element_size, 1);
 
-  auto in_strides = strides(input.shape());
-  auto out_strides = strides(output->shape());
+  // Scalar (or a single element) tile.
+  if (plan.input_dims.empty()) {
+    plan.input_dims.push_back(1);
+    plan.multiples.push_back(1);
+  }
 
-  ArrayRef<std::string> inp = input.strings();
-  MutableArrayRef<std::string> out = output->strings();
+  const int rank = plan.input_dims.size();
+  plan.input_block.resize(rank + 1);
+  plan.output_block.resize(rank + 1);
+  plan.input_block[rank] = 1;
+  plan.output_block[rank] = 1;
+  for (int k = rank - 1; k >= 0; --k) {
+    plan.input_block[k] = plan.input_block[k + 1] * plan.input_dims[k];
+    plan.output_block[k] =
+        plan.output_block[k + 1] * plan.input_dims[k] * plan.multiples[k];
+  }
 
-  for (Index o_idx = 0; o_idx < nelem; ++o_idx) {
-    Index i_idx = 0;
-    Index t = o_idx;
-    for (int i = 0; i < ndims; ++i) {
-      Index i_dim = input.shape().GetDimensionSize(i);
-      i_idx += t / out_strides[i] % i_dim * in_strides[i];
-      t %= out_strides[i];
-    }
-    out[o_idx] = inp[i_idx];
+  plan.split_dim = 0;
+  plan.num_slabs = plan.input_dims[0] * plan.multiples[0];
+  while (plan.split_dim < rank - 1 && plan.num_slabs < kMinTileSlabs) {
+    ++plan.split_dim;
+    plan.num_slabs *=
+        plan.input_dims[plan.split_dim] * plan.multiples[plan.split_dim];
+  }
+
+  return plan;
+}
+
+}  // namespace internal
+
+void TileStringTensor(const StringHostTensor& input, StringHostTensor* output) {
+  if (output->NumElements() == 0) return;
+
+  llvm::SmallVector<Index, 5> input_dims;
+  llvm::SmallVector<Index, 5> multiples;
+  input.shape().GetDimensions(&input_dims);
+  for (int i = 0; i < input_dims.size(); ++i) {
+    multiples.push_back(output->shape().GetDimensionSize(i) / input_dims[i]);
   }
+
+  internal::TilePlan plan =
+      internal::MakeTilePlan(input_dims, multiples, /*element_size=*/1);
+  internal::TileSlabs(plan, input.strings().data(), output->strings().data(),
+                      0, plan.num_slabs);
 }
+
 }  // namespace cpu
 }  // namespace tfrt
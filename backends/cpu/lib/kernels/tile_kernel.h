@@ -19,9 +19,17 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TILE_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TILE_KERNEL_H_
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
-#include "tfrt/common/compat/eigen/eigen_kernel.h"
-#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -34,51 +42,172 @@ namespace cpu {
 Expected<llvm::SmallVector<Index, 5>> TileMultiples(
     const DenseHostTensor& multiples_arg);
 
-template <int rank>
-using TileRankTag = std::integral_constant<int, rank>;
+namespace internal {
 
-template <typename T, typename EigenEvaluator>
-static typename EigenEvaluator::DependencyToken Tile(
-    const DenseHostTensor& input, const llvm::SmallVector<Index, 5>& multiples,
-    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
-  EigenEvaluator eigen{exec_ctx.host()};
+// Tile of the input dimensions with the adjacent dimensions collapsed: a
+// dimension that is not tiled is merged into the outer dimension, and a size 1
+// dimension is merged into the inner dimension. The output is split into the
+// `num_slabs` blocks of the dimensions [0, split_dim] for parallel tiling.
+struct TilePlan {
+  llvm::SmallVector<Index, 5> input_dims;
+  llvm::SmallVector<Index, 5> multiples;
 
-  auto rank_dispatch = [&](auto rank_tag) {
-    static constexpr int rank = decltype(rank_tag)::value;
+  // Number of elements in the input and output blocks of the dimensions
+  // [k, rank), with one trailing element for k == rank.
+  llvm::SmallVector<Index, 6> input_block;
+  llvm::SmallVector<Index, 6> output_block;
 
-    auto input_view = DHTIndexableView<T, rank>(&input);
-    auto output_view = MutableDHTIndexableView<T, rank>(output);
+  int split_dim;
+  Index num_slabs;
+};
 
-    auto input_t = compat::AsEigenConstTensor(input_view);
-    auto output_t = compat::AsEigenTensor(output_view);
+// Tiles `element_size` wide elements of the input dimensions (dense tensors
+// are tiled as bytes, strings as single elements).
+TilePlan MakeTilePlan(ArrayRef<Index> input_dims, ArrayRef<Index> multiples,
+                      Index element_size);
 
-    Eigen::DSizes<Eigen::Index, rank> broadcast;
-    for (int i = 0; i < rank; ++i) {
-      broadcast[i] = multiples[i];
-    }
+inline void CopyElements(const uint8_t* src, Index n, uint8_t* dst) {
+  std::memcpy(dst, src, n);
+}
 
-    return eigen.Evaluate(output_t, input_t.broadcast(broadcast),
-                          eigen.KeepAlive(&input, output));
-  };
+inline void CopyElements(const std::string* src, Index n, std::string* dst) {
+  std::copy_n(src, n, dst);
+}
+
+// Replicated blocks are doubled up to this size, and larger outputs are filled
+// with the copies of a block that stays in the L1 cache.
+static constexpr Index kReplicateBlockBytes = 16 * 1024;
+
+// Fills `data[size, total)` with the copies of `data[0, size)`, doubling the
+// size of the copied block with every copy.
+template <typename T>
+void ReplicateBlock(T* data, Index size, Index total) {
+  Index block = size;
+  for (Index written = size; written < total;) {
+    const Index n = std::min(block, total - written);
+    CopyElements(data, n, data + written);
+    written += n;
+    if (block * sizeof(T) < kReplicateBlockBytes) block = written;
+  }
+}
 
-  // Dispatch based on the output tensor rank.
-  const int rank = output->shape().GetRank();
-
-  if (rank == 1) {
-    return rank_dispatch(TileRankTag<1>{});
-  } else if (rank == 2) {
-    return rank_dispatch(TileRankTag<2>{});
-  } else if (rank == 3) {
-    return rank_dispatch(TileRankTag<3>{});
-  } else if (rank == 4) {
-    return rank_dispatch(TileRankTag<4>{});
-  } else if (rank == 5) {
-    return rank_dispatch(TileRankTag<5>{});
+// Writes the output block of the dimensions [k, rank) tiled from the input
+// block: the input dimension `k` is tiled from the inner blocks, and then
+// replicated `multiples[k]` times.
+template <typename T>
+void TileBlock(const TilePlan& plan, int k, const T* input, T* output) {
+  const int rank = plan.input_dims.size();
+  const Index dim = plan.input_dims[k];
+
+  if (k == rank - 1) {
+    CopyElements(input, dim, output);
   } else {
-    return eigen.MakeError("Unsupported tensor rank");
+    for (Index i = 0; i < dim; ++i) {
+      TileBlock(plan, k + 1, input + i * plan.input_block[k + 1],
+                output + i * plan.output_block[k + 1]);
+    }
+  }
+
+  ReplicateBlock(output, dim * plan.output_block[k + 1], plan.output_block[k]);
+}
+
+// Tiles the output slabs [begin, end). A slab is the output block of the
+// dimensions (split_dim, rank), and along the split dimension the slabs repeat
+// with a period of the input dimension size. Slabs of the first period are
+// tiled from the input, and the rest of the split dimension row is copied
+// from the already tiled slabs.
+template <typename T>
+void TileSlabs(const TilePlan& plan, const T* input, T* output, Index begin,
+               Index end) {
+  const int rank = plan.input_dims.size();
+  const int s = plan.split_dim;
+  const Index dim = plan.input_dims[s];
+  const Index row_size = dim * plan.multiples[s];
+  const Index slab = plan.output_block[s + 1];
+
+  for (Index q = begin; q < end;) {
+    const Index row = q / row_size;
+    const Index row_end = std::min(end, (row + 1) * row_size);
+    const Index tiled_end = std::min(row_end, q + dim);
+
+    // Input offset of the outer dimensions [0, split_dim).
+    Index input_offset = 0;
+    for (Index d = s - 1, r = row; d >= 0; --d) {
+      const Index out_dim = plan.input_dims[d] * plan.multiples[d];
+      const Index i = r % out_dim % plan.input_dims[d];
+      input_offset += i * plan.input_block[d + 1];
+      r /= out_dim;
+    }
+
+    if (s == rank - 1) {
+      // The slabs are elements: copy the contiguous runs of the input row,
+      // with at most one wrap around the end of the row.
+      Index i = q % row_size % dim;
+      for (Index p = q; p < tiled_end;) {
+        const Index n = std::min(tiled_end - p, dim - i);
+        CopyElements(input + input_offset + i, n, output + p);
+        p += n;
+        i = 0;
+      }
+    } else {
+      for (Index p = q; p < tiled_end; ++p) {
+        const Index i = p % row_size % dim;
+        TileBlock(plan, s + 1,
+                  input + input_offset + i * plan.input_block[s + 1],
+                  output + p * slab);
+      }
+    }
+
+    ReplicateBlock(output + q * slab, (tiled_end - q) * slab,
+                   (row_end - q) * slab);
+    q = row_end;
+  }
+}
+
+}  // namespace internal
+
+// Tiles the `input` `multiples[i]` times along the dimension `i` into the
+// `output`:
+//   output.shape[i] = input.shape[i] * multiples[i]
+//
+// Elements are copied as opaque bytes. The contiguous input runs are copied
+// with memcpy, and the tiled blocks are replicated with copies of doubling
+// size. Large outputs are tiled in parallel in blocks of the outer output
+// dimensions.
+template <typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Tile(
+    const DenseHostTensor& input, ArrayRef<Index> multiples,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  llvm::SmallVector<Index, 5> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  assert(multiples.size() == input_dims.size() && "Illegal multiples");
+
+  EigenEvaluator eigen{exec_ctx};
+  if (output->NumElements() == 0) {
+    return eigen.ParallelExecute(
+        0, ParallelFor::BlockSizes::Fixed(1), [](size_t, size_t) {},
+        eigen.KeepAlive(&input, output));
   }
+
+  internal::TilePlan plan = internal::MakeTilePlan(
+      input_dims, multiples, GetHostSize(input.dtype()));
+
+  const uint8_t* src = static_cast<const uint8_t*>(input.data());
+  uint8_t* dst = static_cast<uint8_t*>(output->data());
+
+  auto compute = [plan, src, dst](size_t begin, size_t end) {
+    internal::TileSlabs(plan, src, dst, begin, end);
+  };
+
+  const double slab_bytes = plan.output_block[plan.split_dim + 1];
+  return eigen.ParallelExecute(
+      plan.num_slabs, ParallelFor::BlockSizes::Cost(slab_bytes, slab_bytes, 0),
+      std::move(compute), eigen.KeepAlive(&input, output));
 }
 
+// Tiles the string `input` into the `output` in the caller thread, with the
+// same algorithm as the dense tensors Tile. String tensors are not reference
+// counted, and the input can't be kept alive for the asynchronous tasks.
 void TileStringTensor(const StringHostTensor& input, StringHostTensor* output);
 
 }  // namespace cpu
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Transpose (N-D permutation) kernel implementation.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+
+// Transpose of the input with the size 1 dimensions removed, and the input
+// dimensions that stay adjacent in the output merged into one dimension.
+struct TransposePlan {
+  // Dimensions of the output.
+  llvm::SmallVector<Index, 8> output_dims;
+  // Input strides (in elements) along each of the output dimensions.
+  llvm::SmallVector<Index, 8> input_strides;
+};
+
+inline TransposePlan MakeTransposePlan(ArrayRef<Index> input_dims,
+                                       ArrayRef<Index> perm) {
+  const int rank = input_dims.size();
+
+  // Drop the size 1 dimensions.
+  llvm::SmallVector<int, 8> collapsed_dim(rank, -1);
+  llvm::SmallVector<Index, 8> dims;
+  for (int i = 0; i < rank; ++i) {
+    if (input_dims[i] == 1) continue;
+    collapsed_dim[i] = dims.size();
+    dims.push_back(input_dims[i]);
+  }
+
+  llvm::SmallVector<Index, 8> strides(dims.size());
+  for (Index d = dims.size() - 1, stride = 1; d >= 0; --d) {
+    strides[d] = stride;
+    stride *= dims[d];
+  }
+
+  // Group the runs of the consecutive input dimensions in the output order.
+  llvm::SmallVector<std::pair<int, int>, 8> groups;
+  for (int i = 0; i < rank; ++i) {
+    const int dim = collapsed_dim[perm[i]];
+    if (dim < 0) continue;
+    if (!groups.empty() && groups.back().second + 1 == dim) {
+      groups.back().second = dim;
+    } else {
+      groups.emplace_back(dim, dim);
+    }
+  }
+
+  TransposePlan plan;
+  for (const auto& group : groups) {
+    Index size = 1;
+    for (int d = group.first; d <= group.second; ++d) size *= dims[d];
+    plan.output_dims.push_back(size);
+    plan.input_strides.push_back(strides[group.second]);
+  }
+  return plan;
+}
+
+// Opaque 16 byte element (e.g. complex128).
+struct Bytes16 {
+  uint64_t data[2];
+};
+
+// Transposes the square blocks of kSize x kSize elements in registers:
+//   dst[c * dst_stride + r] = src[r * src_stride + c]
+template <typename T>
+struct BlockTranspose {
+  static constexpr int kSize = 1;
+  static void Run(const T* src, Index src_stride, T* dst, Index dst_stride) {
+    *dst = *src;
+  }
+};
+
+#if defined(__AVX__)
+template <>
+struct BlockTranspose<uint32_t> {
+  static constexpr int kSize = 8;
+  static void Run(const uint32_t* src, Index src_stride, uint32_t* dst,
+                  Index dst_stride) {
+    auto load = [&](int r) {
+      return _mm256_loadu_ps(reinterpret_cast<const float*>(src) +
+                             r * src_stride);
+    };
+    const __m256 r0 = load(0), r1 = load(1), r2 = load(2), r3 = load(3);
+    const __m256 r4 = load(4), r5 = load(5), r6 = load(6), r7 = load(7);
+
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    auto store = [&](int c, __m256 value) {
+      _mm256_storeu_ps(reinterpret_cast<float*>(dst) + c * dst_stride, value);
+    };
+    store(0, _mm256_permute2f128_ps(s0, s4, 0x20));
+    store(1, _mm256_permute2f128_ps(s1, s5, 0x20));
+    store(2, _mm256_permute2f128_ps(s2, s6, 0x20));
+    store(3, _mm256_permute2f128_ps(s3, s7, 0x20));
+    store(4, _mm256_permute2f128_ps(s0, s4, 0x31));
+    store(5, _mm256_permute2f128_ps(s1, s5, 0x31));
+    store(6, _mm256_permute2f128_ps(s2, s6, 0x31));
+    store(7, _mm256_permute2f128_ps(s3, s7, 0x31));
+  }
+};
+
+template <>
+struct BlockTranspose<uint64_t> {
+  static constexpr int kSize = 4;
+  static void Run(const uint64_t* src, Index src_stride, uint64_t* dst,
+                  Index dst_stride) {
+    auto load = [&](int r) {
+      return _mm256_loadu_pd(reinterpret_cast<const double*>(src) +
+                             r * src_stride);
+    };
+    const __m256d r0 = load(0), r1 = load(1), r2 = load(2), r3 = load(3);
+
+    const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    auto store = [&](int c, __m256d value) {
+      _mm256_storeu_pd(reinterpret_cast<double*>(dst) + c * dst_stride, value);
+    };
+    store(0, _mm256_permute2f128_pd(t0, t2, 0x20));
+    store(1, _mm256_permute2f128_pd(t1, t3, 0x20));
+    store(2, _mm256_permute2f128_pd(t0, t2, 0x31));
+    store(3, _mm256_permute2f128_pd(t1, t3, 0x31));
+  }
+};
+#elif defined(__SSE2__)
+template <>
+struct BlockTranspose<uint32_t> {
+  static constexpr int kSize = 4;
+  static void Run(const uint32_t* src, Index src_stride, uint32_t* dst,
+                  Index dst_stride) {
+    const float* s = reinterpret_cast<const float*>(src);
+    float* d = reinterpret_cast<float*>(dst);
+    __m128 r0 = _mm_loadu_ps(s);
+    __m128 r1 = _mm_loadu_ps(s + src_stride);
+    __m128 r2 = _mm_loadu_ps(s + 2 * src_stride);
+    __m128 r3 = _mm_loadu_ps(s + 3 * src_stride);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(d, r0);
+    _mm_storeu_ps(d + dst_stride, r1);
+    _mm_storeu_ps(d + 2 * dst_stride, r2);
+    _mm_storeu_ps(d + 3 * dst_stride, r3);
+  }
+};
+#endif
+
+// Transposes the [rows, cols] block of the `src` matrix into the [cols, rows]
+// block of the `dst` matrix:
+//   dst[c * dst_stride + r] = src[r * src_stride + c]
+template <typename T>
+void TransposeBlock(const T* src, Index src_stride, T* dst, Index dst_stride,
+                    Index rows, Index cols) {
+  constexpr Index kSize = BlockTranspose<T>::kSize;
+  const Index rows_end = rows - rows % kSize;
+  const Index cols_end = cols - cols % kSize;
+
+  for (Index r = 0; r < rows_end; r += kSize) {
+    for (Index c = 0; c < cols_end; c += kSize) {
+      BlockTranspose<T>::Run(src + r * src_stride + c, src_stride,
+                             dst + c * dst_stride + r, dst_stride);
+    }
+  }
+
+  // Transpose the block edges that do not fill the register blocks.
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = r < rows_end ? cols_end : 0; c < cols; ++c) {
+      dst[c * dst_stride + r] = src[r * src_stride + c];
+    }
+  }
+}
+
+// Tiles of kTileSize x kTileSize elements are transposed while the source and
+// the destination tiles are in L1 cache.
+static constexpr Index kTransposeTileSize = 32;
+
+// Computes the `src` and `dst` offsets of the `index`-th element of the
+// output dimensions `dims` (and all the skipped dimensions at zero).
+inline std::pair<Index, Index> TransposeOffsets(
+    Index index, ArrayRef<Index> dims, ArrayRef<Index> src_strides,
+    ArrayRef<Index> dst_strides, int skip0, int skip1) {
+  Index src_offset = 0;
+  Index dst_offset = 0;
+  for (int d = dims.size() - 1; d >= 0; --d) {
+    if (d == skip0 || d == skip1) continue;
+    const Index i = index % dims[d];
+    index /= dims[d];
+    src_offset += i * src_strides[d];
+    dst_offset += i * dst_strides[d];
+  }
+  return {src_offset, dst_offset};
+}
+
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Transpose(
+    const DenseHostTensor& input, const TransposePlan& plan,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  const T* src = static_cast<const T*>(input.data());
+  T* dst = static_cast<T*>(output->data());
+
+  const int rank = plan.output_dims.size();
+  EigenEvaluator eigen{exec_ctx};
+
+  // Identity permutation (or empty tensor): copy the input.
+  if (rank <= 1 || input.NumElements() == 0) {
+    auto compute = [=](size_t begin, size_t end) {
+      std::memcpy(dst + begin, src + begin, (end - begin) * sizeof(T));
+    };
+    return eigen.ParallelExecute(
+        input.NumElements(),
+        ParallelFor::BlockSizes::Cost(sizeof(T), sizeof(T), 0),
+        std::move(compute), eigen.KeepAlive(&input, output));
+  }
+
+  llvm::SmallVector<Index, 8> dims(plan.output_dims);
+  llvm::SmallVector<Index, 8> src_strides(plan.input_strides);
+  llvm::SmallVector<Index, 8> dst_strides(rank);
+  for (Index d = rank - 1, stride = 1; d >= 0; --d) {
+    dst_strides[d] = stride;
+    stride *= dims[d];
+  }
+
+  // The innermost dimension is not permuted: copy the contiguous runs.
+  if (src_strides[rank - 1] == 1) {
+    const Index run = dims[rank - 1];
+    auto compute = [=](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        Index src_offset = TransposeOffsets(i, dims, src_strides, dst_strides,
+                                            /*skip0=*/rank - 1,
+                                            /*skip1=*/rank - 1)
+                               .first;
+        std::memcpy(dst + i * run, src + src_offset, run * sizeof(T));
+      }
+    };
+    return eigen.ParallelExecute(
+        output->NumElements() / run,
+        ParallelFor::BlockSizes::Cost(run * sizeof(T), run * sizeof(T), rank),
+        std::move(compute), eigen.KeepAlive(&input, output));
+  }
+
+  // The innermost input dimension becomes the output dimension `y`, and the
+  // output innermost dimension `x` is strided in the input. Transpose the
+  // [x, y] matrices of all the outer dimensions in tiles. Each task transposes
+  // a strip of kTransposeTileSize output rows along `y`.
+  const int x = rank - 1;
+  const int y = std::find(src_strides.begin(), src_strides.end(), 1) -
+                src_strides.begin();
+  assert(y < x && "Input innermost dimension must be in the output");
+
+  const Index num_x = dims[x];
+  const Index num_y = dims[y];
+  const Index src_stride = src_strides[x];
+  const Index dst_stride = dst_strides[y];
+  const Index num_strips =
+      (num_y + kTransposeTileSize - 1) / kTransposeTileSize;
+
+  auto compute = [=](size_t begin, size_t end) {
+    for (size_t task = begin; task < end; ++task) {
+      const Index outer = task / num_strips;
+      const Index y0 = (task % num_strips) * kTransposeTileSize;
+      const Index rows = std::min(kTransposeTileSize, num_y - y0);
+
+      const auto offsets =
+          TransposeOffsets(outer, dims, src_strides, dst_strides, x, y);
+      const T* src_strip = src + offsets.first + y0;
+      T* dst_strip = dst + offsets.second + y0 * dst_stride;
+
+      for (Index x0 = 0; x0 < num_x; x0 += kTransposeTileSize) {
+        const Index cols = std::min(kTransposeTileSize, num_x - x0);
+        TransposeBlock(src_strip + x0 * src_stride, src_stride,
+                       dst_strip + x0, dst_stride, cols, rows);
+      }
+    }
+  };
+
+  const double strip_bytes = kTransposeTileSize * num_x * sizeof(T);
+  return eigen.ParallelExecute(
+      output->NumElements() / (num_x * num_y) * num_strips,
+      ParallelFor::BlockSizes::Cost(strip_bytes, strip_bytes, 0),
+      std::move(compute), eigen.KeepAlive(&input, output));
+}
+
+}  // namespace internal
+
+// Returns true if the permutation moves only the size 1 dimensions, and the
+// transposed tensor has the same memory layout as the input.
+inline bool IsIdentityTranspose(ArrayRef<Index> input_dims,
+                                ArrayRef<Index> perm) {
+  return internal::MakeTransposePlan(input_dims, perm).output_dims.size() <= 1;
+}
+
+// Transposes the `input` with the permutation `perm` into the `output`:
+//   output.shape[i] = input.shape[perm[i]]
+//
+// Dimensions that stay adjacent in the output are collapsed. Permutations
+// that keep the innermost dimension copy contiguous runs, and all other
+// permutations transpose cache sized tiles with the in-register block
+// transposes.
+template <typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Transpose(
+    const DenseHostTensor& input, ArrayRef<Index> perm,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  llvm::SmallVector<Index, 8> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  assert(perm.size() == input_dims.size() && "Illegal permutation");
+
+  internal::TransposePlan plan = internal::MakeTransposePlan(input_dims, perm);
+
+  // Elements are copied as opaque values of the dtype size.
+  switch (GetHostSize(input.dtype())) {
+    case 1:
+      return internal::Transpose<uint8_t, EigenEvaluator>(input, plan, output,
+                                                          exec_ctx);
+    case 2:
+      return internal::Transpose<uint16_t, EigenEvaluator>(input, plan,
+                                                           output, exec_ctx);
+    case 4:
+      return internal::Transpose<uint32_t, EigenEvaluator>(input, plan,
+                                                           output, exec_ctx);
+    case 8:
+      return internal::Transpose<uint64_t, EigenEvaluator>(input, plan,
+                                                           output, exec_ctx);
+    case 16:
+      return internal::Transpose<internal::Bytes16, EigenEvaluator>(
+          input, plan, output, exec_ctx);
+    default:
+      return EigenEvaluator{exec_ctx}.MakeError(
+          "Unsupported dtype for transpose: ", input.dtype());
+  }
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
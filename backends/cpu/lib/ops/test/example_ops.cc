@@ -351,6 +351,7 @@ void RegisterTestCpuOps(CpuOpRegistry* op_registry) {
                      CpuOpFlags::NoSideEffects, {"value"});
   op_registry->AddOp("tfrt_test.add", TFRT_CPU_OP(TestAddOp),
                      CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar);
+  op_registry->SetElementwiseFn("tfrt_test.add", CpuElementwiseFn::kAdd);
   op_registry->AddOp("tfrt_test.add.denseonly", TFRT_CPU_OP(TestAddDenseOnlyOp),
                      CpuOpFlags::NoSideEffects);
   op_registry->AddOp("tfrt_test.add.denseonly2",
@@ -14,11 +14,13 @@
 
 // This file defines the tensor kernels for mnist.
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <utility>
 
 #include "../../kernels/cpu_kernels.h"
+#include "../tf/buffer_forwarding.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -30,6 +32,7 @@
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/tensor/btf.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
@@ -85,37 +88,20 @@ static AsyncValueRef<Chain> ReluInPlace(DenseHostTensor* A,
   return NullaryEigenKernelAsync<T>(A, std::move(fn), exec_ctx);
 }
 
-static AsyncValueRef<Chain> ReluInPlaceHelper(
-    DenseHostTensor* A, const ExecutionContext& exec_ctx) {
-  switch (A->dtype()) {
-    default:
-      return EmitErrorAsync(exec_ctx, "unsupported dtype for relu");
-#define DTYPE_NUMERIC(ENUM) \
-  case DType::ENUM:         \
-    return ReluInPlace<EigenTypeForDTypeKind<DType::ENUM>>(A, exec_ctx);
-#include "tfrt/dtype/dtype.def"
+// The input buffer is forwarded to the result by the op handler when possible,
+// in which case the relu is computed in place.
+static void ReluOp(const DenseHostTensor& A, const TensorMetadata& B_md,
+                   RCReference<AsyncValue>* B,
+                   const ExecutionContext& exec_ctx) {
+  auto dest = GetForwardedOrAllocateOutput(B_md, B, exec_ctx.host());
+  if (!dest) {
+    *B = EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    return;
   }
-}
-
-static AsyncValueRef<DenseHostTensor> ReluOp(Argument<DenseHostTensor> A,
-                                             const TensorMetadata& B_md,
-                                             const ExecutionContext& exec_ctx) {
-  HostContext* host = exec_ctx.host();
 
-  if (A.value()->IsUnique() && A->buffer()->IsUnique()) {
-    DenseHostTensor dest(B_md, A->buffer());
-    AsyncValueRef<Chain> chain = ReluInPlaceHelper(&dest, exec_ctx);
-    return WaitForChain(std::move(dest), std::move(chain), exec_ctx);
-  } else {
-    auto dest = DenseHostTensor::CreateUninitialized(B_md, host);
-    if (!dest) {
-      return EmitErrorAsync(exec_ctx, "out of memory allocating result");
-    }
-
-    AsyncValueRef<Chain> chain = ReluHelper(A.get(), &*dest, exec_ctx);
-
-    return WaitForChain(std::move(dest).value(), std::move(chain), exec_ctx);
-  }
+  AsyncValueRef<Chain> chain = ReluHelper(A, &*dest, exec_ctx);
+  *B = WaitForChain(std::move(*dest), std::move(chain), exec_ctx)
+           .ReleaseRCRef();
 }
 
 //===----------------------------------------------------------------------===//
@@ -241,7 +227,8 @@ static void CastOp(const DenseHostTensor& A, const TensorMetadata& B_md,
                    const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto dest = DenseHostTensor::CreateUninitialized(B_md, host);
+  // The input buffer is only forwarded when casting to the same dtype.
+  auto dest = GetForwardedOrAllocateOutput(B_md, B_tensor, host);
   if (!dest) {
     *B_tensor = EmitErrorAsync(exec_ctx, "out of memory allocating result");
     return;
@@ -373,19 +360,55 @@ static void Broadcast1DOp(const DenseHostTensor& src,
 
 // Take argmax along axis = Axis.
 // Argmax result tensor must be int32, not float.
+// Blocks of the outermost dimension are computed in parallel.
 template <typename T, size_t Rank, size_t Axis>
-static void ArgmaxKernel(const DenseHostTensor& A, DenseHostTensor* B) {
+static AsyncValueRef<Chain> ArgmaxKernel(const DenseHostTensor& A,
+                                         DenseHostTensor* B,
+                                         const ExecutionContext& exec_ctx) {
+  static_assert(Axis > 0, "Argmax is parallelized along the axis 0");
   DHTIndexableView<T, Rank> A_view(&A);
   MutableDHTIndexableView<int32_t, Rank - 1> B_view(B);
 
-  auto in = AsEigenConstTensor(A_view);
-  auto out = AsEigenTensor(B_view);
-  out = in.argmax(Axis).template cast<int32_t>();
+  Eigen::DSizes<Index, Rank> A_dims;
+  Eigen::DSizes<Index, Rank - 1> B_dims;
+  for (size_t i = 0; i < Rank; ++i) A_dims[i] = A_view.FixedShape()[i];
+  for (size_t i = 0; i < Rank - 1; ++i) B_dims[i] = B_view.FixedShape()[i];
+
+  // Number of elements in a single slice along the axis 0.
+  const Index A_row = A_dims.TotalSize() / std::max<Index>(A_dims[0], 1);
+  const Index B_row = B_dims.TotalSize() / std::max<Index>(B_dims[0], 1);
+
+  const T* A_data = A_view.data();
+  int32_t* B_data = B_view.data();
+
+  auto compute = [=](size_t begin, size_t end) {
+    using InputTensor = Eigen::Tensor<T, Rank, Eigen::RowMajor, Index>;
+    using OutputTensor =
+        Eigen::Tensor<int32_t, Rank - 1, Eigen::RowMajor, Index>;
+
+    Eigen::DSizes<Index, Rank> A_block = A_dims;
+    Eigen::DSizes<Index, Rank - 1> B_block = B_dims;
+    A_block[0] = B_block[0] = end - begin;
+
+    // Blocks do not start at the aligned address.
+    Eigen::TensorMap<const InputTensor> in(A_data + begin * A_row, A_block);
+    Eigen::TensorMap<OutputTensor> out(B_data + begin * B_row, B_block);
+    out = in.argmax(Axis).template cast<int32_t>();
+  };
+
+  return ParallelFor(exec_ctx).Execute(
+      A_dims[0],
+      ParallelFor::BlockSizes::Cost(A_row * sizeof(T), B_row * sizeof(int32_t),
+                                    A_row),
+      [compute = std::move(compute),
+       buffers = KeepBuffers::alive(&A, B)](size_t begin, size_t end) {
+        compute(begin, end);
+      });
 }
 
 template <typename T, size_t Rank, size_t Axis = 1>
-static Expected<DenseHostTensor> Argmax(const DenseHostTensor& A,
-                                        const ExecutionContext& exec_ctx) {
+static AsyncValueRef<DenseHostTensor> Argmax(const DenseHostTensor& A,
+                                             const ExecutionContext& exec_ctx) {
   // TODO(fishx): Try to reuse Metadata fn.
   static_assert(Axis < Rank, "Axis < Rank");
   DHTIndexableView<T, Rank> A_view(&A);
@@ -401,36 +424,41 @@ static Expected<DenseHostTensor> Argmax(const DenseHostTensor& A,
   auto tensor = DenseHostTensor::CreateUninitialized<int32_t>(
       TensorShape(result_dims), exec_ctx.host());
   if (!tensor.has_value()) {
-    return MakeStringError("Cannot allocate result tensor.");
+    return EmitErrorAsync(exec_ctx, "Cannot allocate result tensor.");
   }
 
-  ArgmaxKernel<T, Rank, Axis>(A, &*tensor);
+  AsyncValueRef<Chain> chain =
+      ArgmaxKernel<T, Rank, Axis>(A, &*tensor, exec_ctx);
 
-  return std::move(*tensor);
+  return WaitForChain(std::move(*tensor), std::move(chain), exec_ctx);
 }
 
 template <size_t Rank, size_t Axis>
-static void ArgmaxForAxisRank(const DenseHostTensor& A, DenseHostTensor* B) {
+static AsyncValueRef<Chain> ArgmaxForAxisRank(
+    const DenseHostTensor& A, DenseHostTensor* B,
+    const ExecutionContext& exec_ctx) {
   switch (A.dtype()) {
     default:
-      assert(0 && "shape function mismatch");
-#define DTYPE_NUMERIC(ENUM)                                             \
-  case DType::ENUM:                                                     \
-    ArgmaxKernel<EigenTypeForDTypeKind<DType::ENUM>, Rank, Axis>(A, B); \
-    break;
+      return EmitErrorAsync(exec_ctx, "shape function mismatch");
+#define DTYPE_NUMERIC(ENUM)                                                    \
+  case DType::ENUM:                                                            \
+    return ArgmaxKernel<EigenTypeForDTypeKind<DType::ENUM>, Rank, Axis>(A, B,  \
+                                                                     exec_ctx);
 #include "tfrt/dtype/dtype.def"
   }
 }
 
 template <size_t Axis>
-static void ArgmaxForAxis(const DenseHostTensor& A, DenseHostTensor* B) {
+static AsyncValueRef<Chain> ArgmaxForAxis(const DenseHostTensor& A,
+                                          DenseHostTensor* B,
+                                          const ExecutionContext& exec_ctx) {
   switch (A.shape().GetRank()) {
     case Axis + 1:
-      return ArgmaxForAxisRank<Axis + 1, Axis>(A, B);
+      return ArgmaxForAxisRank<Axis + 1, Axis>(A, B, exec_ctx);
     case Axis + 2:
-      return ArgmaxForAxisRank<Axis + 2, Axis>(A, B);
+      return ArgmaxForAxisRank<Axis + 2, Axis>(A, B, exec_ctx);
     default:
-      assert(0 && "shape function mismatch");
+      return EmitErrorAsync(exec_ctx, "shape function mismatch");
   }
 }
 
@@ -448,16 +476,17 @@ static void ArgmaxOp(const DenseHostTensor& src, const OpAttrsRef& attrs,
 
   auto& dest_tensor = dest_alloc.value();
 
+  AsyncValueRef<Chain> chain;
   switch (attrs.GetAsserting<int32_t>("axis")) {
     case 1:
-      ArgmaxForAxis<1>(src, &dest_tensor);
+      chain = ArgmaxForAxis<1>(src, &dest_tensor, exec_ctx);
       break;
     default:
       *dest = EmitErrorAsync(exec_ctx, "unsupported axis for argmax");
       return;
   }
 
-  *dest = MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(dest_tensor));
+  *dest = WaitForChain(std::move(dest_tensor), std::move(chain), exec_ctx);
 }
 
 //===----------------------------------------------------------------------===//
@@ -465,19 +494,16 @@ static void ArgmaxOp(const DenseHostTensor& src, const OpAttrsRef& attrs,
 //===----------------------------------------------------------------------===//
 
 template <typename T, size_t Rank, size_t Axis>
-static void ReduceMeanKernel(const DenseHostTensor& A, DenseHostTensor* B) {
-  DHTIndexableView<T, Rank> A_view(&A);
-  MutableDHTIndexableView<T, Rank - 1> B_view(B);
-
-  Eigen::IndexList<Eigen::type2index<Axis>> reduction_dims;
-  auto in = AsEigenConstTensor(A_view);
-  auto out = AsEigenTensor(B_view);
-  out = in.mean(reduction_dims);
+static AsyncValueRef<Chain> ReduceMeanKernel(const DenseHostTensor& A,
+                                             DenseHostTensor* B,
+                                             const ExecutionContext& exec_ctx) {
+  static_assert(Axis == 0, "Only the axis 0 reduction is supported");
+  return cpu::MeanAxisZero<T>(A, B, exec_ctx);
 }
 
 template <typename T, size_t Rank, size_t Axis = 0>
-static Expected<DenseHostTensor> ReduceMean(const DenseHostTensor& A,
-                                            const ExecutionContext& exec_ctx) {
+static AsyncValueRef<DenseHostTensor> ReduceMean(
+    const DenseHostTensor& A, const ExecutionContext& exec_ctx) {
   // TODO(fishx): Try to reuse Metadata fn.
   static_assert(Axis < Rank, "Axis < Rank");
   DHTIndexableView<T, Rank> A_view(&A);
@@ -493,36 +519,40 @@ static Expected<DenseHostTensor> ReduceMean(const DenseHostTensor& A,
   auto tensor = DenseHostTensor::CreateUninitialized<T>(
       TensorShape(result_dims), exec_ctx.host());
   if (!tensor.has_value())
-    return MakeStringError("cannot allocate result tensor");
+    return EmitErrorAsync(exec_ctx, "cannot allocate result tensor");
 
-  ReduceMeanKernel<T, Rank, Axis>(A, &*tensor);
+  AsyncValueRef<Chain> chain =
+      ReduceMeanKernel<T, Rank, Axis>(A, &*tensor, exec_ctx);
 
-  return std::move(*tensor);
+  return WaitForChain(std::move(*tensor), std::move(chain), exec_ctx);
 }
 
 template <size_t Rank, size_t Axis>
-static void ReduceMeanForAxisRank(const DenseHostTensor& A,
-                                  DenseHostTensor* B) {
+static AsyncValueRef<Chain> ReduceMeanForAxisRank(
+    const DenseHostTensor& A, DenseHostTensor* B,
+    const ExecutionContext& exec_ctx) {
   switch (A.dtype()) {
     default:
-      assert(0 && "shape function mismatch");
+      return EmitErrorAsync(exec_ctx, "shape function mismatch");
 #define DTYPE_NUMERIC(ENUM)                                                  \
   case DType::ENUM:                                                          \
     return ReduceMeanKernel<EigenTypeForDTypeKind<DType::ENUM>, Rank, Axis>( \
-        A, B);
+        A, B, exec_ctx);
 #include "tfrt/dtype/dtype.def"
   }
 }
 
 template <size_t Axis>
-static void ReduceMeanForAxis(const DenseHostTensor& A, DenseHostTensor* B) {
+static AsyncValueRef<Chain> ReduceMeanForAxis(
+    const DenseHostTensor& A, DenseHostTensor* B,
+    const ExecutionContext& exec_ctx) {
   switch (A.shape().GetRank()) {
     case Axis + 1:
-      return ReduceMeanForAxisRank<Axis + 1, Axis>(A, B);
+      return ReduceMeanForAxisRank<Axis + 1, Axis>(A, B, exec_ctx);
     case Axis + 2:
-      return ReduceMeanForAxisRank<Axis + 2, Axis>(A, B);
+      return ReduceMeanForAxisRank<Axis + 2, Axis>(A, B, exec_ctx);
     default:
-      assert(0 && "shape function mismatch");
+      return EmitErrorAsync(exec_ctx, "shape function mismatch");
   }
 }
 
@@ -540,16 +570,17 @@ static void ReduceMeanOp(const DenseHostTensor& src, const OpAttrsRef& attrs,
 
   auto& dest_tensor = dest_alloc.value();
 
+  AsyncValueRef<Chain> chain;
   switch (attrs.GetAsserting<int32_t>("axis")) {
     case 0:
-      ReduceMeanForAxis<0>(src, &dest_tensor);
+      chain = ReduceMeanForAxis<0>(src, &dest_tensor, exec_ctx);
       break;
     default:
       *dest = EmitErrorAsync(exec_ctx, "unsupported axis for reduce_mean");
       return;
   }
 
-  *dest = MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(dest_tensor));
+  *dest = WaitForChain(std::move(dest_tensor), std::move(chain), exec_ctx);
 }
 
 //===----------------------------------------------------------------------===//
@@ -691,11 +722,13 @@ void RegisterMNISTTensorKernels(KernelRegistry* registry) {
 
 void RegisterTestMnistCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tfrt_test.relu", TFRT_CPU_OP(ReluOp),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
   op_registry->AddOp("tfrt_test.equal", TFRT_CPU_OP(ElementwiseEqualOp),
                      CpuOpFlags::NoSideEffects);
   op_registry->AddOp("tfrt_test.cast", TFRT_CPU_OP(CastOp),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
+  op_registry->SetElementwiseFn("tfrt_test.relu", CpuElementwiseFn::kRelu);
+  op_registry->SetElementwiseFn("tfrt_test.cast", CpuElementwiseFn::kCast);
   op_registry->AddOp("tfrt_test.broadcast", TFRT_CPU_OP(Broadcast1DOp),
                      CpuOpFlags::NoSideEffects);
   op_registry->AddOp("tfrt_test.argmax", TFRT_CPU_OP(ArgmaxOp),
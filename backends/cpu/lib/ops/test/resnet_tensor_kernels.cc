@@ -17,6 +17,8 @@
 #include <cmath>
 
 #include "../../kernels/cpu_kernels.h"
+#include "../../kernels/transpose_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/cpu/ops/test/cpu_ops_and_kernels.h"
 #include "tfrt/host_context/diagnostic.h"
@@ -245,53 +247,41 @@ static AsyncValueRef<Chain> ElementwiseSubtractInPlace(
                                      exec_ctx);
 }
 
-template <typename T>
-static void TensorTranspose(ArgumentView<MutableDHTIndexableView<T, 2>> input,
-                            ArgumentView<MutableDHTIndexableView<T, 2>> output,
-                            Argument<Chain> in_chain, Result<Chain> out_chain,
-                            KernelErrorHandler handler,
-                            const ExecutionContext& exec_ctx) {
-  const auto& shape_output = output->FixedShape();
-  const auto& shape_input = input->FixedShape();
-
-  if (shape_output[1] != shape_input[0] || shape_output[0] != shape_input[1]) {
-    handler.ReportError("TensorTranspose output shape ", shape_output,
-                        " does not match the input shape ", shape_input);
-    return;
-  }
+static AsyncValueRef<Chain> TensorTranspose(const DenseHostTensor& input,
+                                            DenseHostTensor* output,
+                                            Chain chain_in,
+                                            const ExecutionContext& exec_ctx) {
+  const auto& shape_input = input.shape();
+  const auto& shape_output = output->shape();
 
-  for (int i = 0, end = shape_output[0]; i < end; i++) {
-    for (int j = 0, end = shape_output[1]; j < end; j++) {
-      output->ElementAt(i, j) = input->ElementAt(j, i);
-    }
+  if (shape_input.GetRank() != 2 || shape_output.GetRank() != 2 ||
+      shape_output.GetDimensionSize(1) != shape_input.GetDimensionSize(0) ||
+      shape_output.GetDimensionSize(0) != shape_input.GetDimensionSize(1)) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("TensorTranspose output shape ", shape_output,
+                         " does not match the input shape ", shape_input));
   }
 
-  out_chain.Set(in_chain);
+  static constexpr Index kPerm[] = {1, 0};
+  return cpu::Transpose<compat::AsyncEigenEvaluator>(input, kPerm, output,
+                                                     exec_ctx);
 }
 
-static void MeanAxisZero(ArgumentView<MutableDHTIndexableView<float, 2>> input,
-                         ArgumentView<MutableDHTIndexableView<float, 1>> output,
-                         Argument<Chain> chain_in, Result<Chain> chain_out,
-                         KernelErrorHandler handler,
-                         const ExecutionContext& exec_ctx) {
-  const auto& shape_input = input->FixedShape();
-  const auto& shape_output = output->FixedShape();
-
-  if (shape_input[1] != shape_output[0]) {
-    handler.ReportError("MeanAxisZero output shape ", shape_output,
-                        " does not match the input shape ", shape_input);
-    return;
-  }
+static AsyncValueRef<Chain> MeanAxisZero(const DenseHostTensor& input,
+                                         DenseHostTensor* output,
+                                         Chain chain_in,
+                                         const ExecutionContext& exec_ctx) {
+  const auto& shape_input = input.shape();
+  const auto& shape_output = output->shape();
 
-  for (int i = 0, e = shape_input[1]; i < e; i++) {
-    float sum = 0.0;
-    for (int j = 0, e = shape_input[0]; j < e; j++) {
-      sum += input->ElementAt(j, i);
-    }
-    output->ElementAt(i) = sum / shape_input[0];
+  if (shape_input.GetRank() != 2 || shape_output.GetRank() != 1 ||
+      shape_input.GetDimensionSize(1) != shape_output.GetDimensionSize(0)) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("MeanAxisZero output shape ", shape_output,
+                         " does not match the input shape ", shape_input));
   }
 
-  chain_out.Set(chain_in);
+  return cpu::MeanAxisZero<float>(input, output, exec_ctx);
 }
 
 static void Broadcast2D(ArgumentView<MutableDHTIndexableView<float, 2>> input,
@@ -336,7 +326,7 @@ void RegisterResNetTensorKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_test.subtract_inplace.f32",
                       TFRT_KERNEL(ElementwiseSubtractInPlace<float>));
   registry->AddKernel("tfrt_test.tensor_transpose.f32",
-                      TFRT_KERNEL(TensorTranspose<float>));
+                      TFRT_KERNEL(TensorTranspose));
   registry->AddKernel("tfrt_test.mean_axis_zero.f32",
                       TFRT_KERNEL(MeanAxisZero));
   registry->AddKernel("tfrt_test.broadcast_2d.f32", TFRT_KERNEL(Broadcast2D));
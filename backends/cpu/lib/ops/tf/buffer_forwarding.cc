@@ -16,44 +16,19 @@
 
 #include "buffer_forwarding.h"
 
-#include <utility>
-
-#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 
 namespace tfrt {
 
-AsyncValueRef<DenseHostTensor> ForwardInputOrAllocateOutput(
-    const ExecutionContext& exec_ctx, const TensorMetadata& output_md,
-    ArrayRef<Argument<DenseHostTensor>> inputs) {
-  HostContext* host = exec_ctx.host();
-
-  // Try to find a compatible input tensor.
-  for (size_t i = 0; i < inputs.size(); ++i) {
-    const Argument<DenseHostTensor>& input = inputs[i];
-
-    // Check that we are the last user of the async value.
-    if (!input.value()->IsUnique()) continue;
-
-    // Check that output metadata is compatible with the input.
-    if (input->dtype() != output_md.dtype) continue;
-    if (input->shape() != output_md.shape) continue;
-
-    // Check that no other tensors share the buffer with the input.
-    if (!input->buffer()->IsExclusiveDataOwner()) continue;
-
-    // We can't forward the input AsyncValue because we must return constructed
-    // but not yet available value.
-    auto dht = input->CopyRef();
-    return MakeConstructedAsyncValueRef<DenseHostTensor>(std::move(dht));
+std::optional<DenseHostTensor> GetForwardedOrAllocateOutput(
+    const TensorMetadata& output_md, RCReference<AsyncValue>* result,
+    HostContext* host) {
+  if (*result) {
+    const auto& forwarded = (*result)->get<DenseHostTensor>();
+    assert(forwarded.metadata() == output_md);
+    return forwarded.CopyRef();
   }
-
-  AsyncValueRef<DenseHostTensor> allocated =
-      DenseHostTensor::MakeConstructedAsyncValueRef(output_md, host);
-  if (!allocated)
-    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
-
-  return allocated;
+  return DenseHostTensor::CreateUninitialized(output_md, host);
 }
 
 }  // namespace tfrt
@@ -17,11 +17,15 @@
 #include "tfrt/cpu/ops/tf/cpu_ops.h"
 
 #include "../../kernels/cpu_kernels.h"
+#include "../../kernels/cwise_unary_kernels.h"
+#include "buffer_forwarding.h"
 #include "constant_ops.h"
 #include "cwise_binary_ops.h"
 #include "cwise_unary_ops.h"
 #include "matmul_fusion_ops.h"
 #include "matmul_ops.h"
+#include "quantized_ops.h"
+#include "reduction_ops.h"
 #include "shape_ops.h"
 #include "softmax_ops.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
@@ -37,6 +41,8 @@
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
 #include "tile_op.h"
+#include "transpose_op.h"
+#include "type_dispatch.h"
 
 namespace tfrt {
 namespace {
@@ -68,14 +74,15 @@ static Expected<DenseHostTensor> TfConstOp(const OpAttrsRef& attrs,
 // tf.Relu op
 //===----------------------------------------------------------------------===//
 
-static AsyncValueRef<DenseHostTensor> TfReluOp(
-    const DenseHostTensor& A, const TensorMetadata& B_md,
-    const ExecutionContext& exec_ctx) {
+static void TfReluOp(const DenseHostTensor& A, const TensorMetadata& B_md,
+                     RCReference<AsyncValue>* B,
+                     const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto dest = DenseHostTensor::CreateUninitialized(B_md, host);
+  auto dest = GetForwardedOrAllocateOutput(B_md, B, host);
   if (!dest) {
-    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    *B = EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    return;
   }
 
   AsyncValueRef<Chain> chain;
@@ -91,122 +98,59 @@ static AsyncValueRef<DenseHostTensor> TfReluOp(
 #include "tfrt/dtype/dtype.def"  // NOLINT
   }
 
-  return ForwardValue(dest.value(), std::move(chain));
+  *B = ForwardValue(dest.value(), std::move(chain)).ReleaseRCRef();
 }
 
 //===----------------------------------------------------------------------===//
-// tf.Mean op
+// tf.Cast op
 //===----------------------------------------------------------------------===//
 
-struct MeanHelper {
-  TensorMetadata output_metadata;
-  TensorMetadata final_output_metadata;
-
-  // Unlike the input reduction_indices, this one contains only positive
-  // numbers.
-  llvm::SmallVector<int32_t, 4> positive_reduction_indices;
-};
-
-static Expected<MeanHelper> TfMeanOutputMd(
-    const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
-    bool keep_dims) {
-  MeanHelper helper;
-
-  // Check if an input dimension is reduced or not.
-  // TODO(tfrt-devs): Support i64 reduction_indices.
-  DHTArrayView<int32_t> reduction_indices_view(&reduction_indices);
-  llvm::SmallVector<bool, 4> reduced_dim(input.shape().GetRank(), false);
-  helper.positive_reduction_indices.reserve(reduction_indices.NumElements());
-  for (auto reduction_index : reduction_indices_view.Elements()) {
-    int rank = input.shape().GetRank();
-    if (reduction_index < -rank || reduction_index >= rank) {
-      return MakeStringError(
-          "tf.Mean reduction index must be in [-input_rank, input_rank) range");
-    }
-    // Add the rank to get the corresponding positive index if it is negative.
-    reduction_index = (reduction_index + rank) % rank;
-    if (reduced_dim[reduction_index]) {
-      return MakeStringError("tf.Mean reduction indices must be unique");
-    }
-
-    reduced_dim[reduction_index] = true;
-
-    helper.positive_reduction_indices.push_back(reduction_index);
-  }
-
-  llvm::SmallVector<Index, 4> output_dims;
-  llvm::SmallVector<Index, 4> final_output_dims;
-  output_dims.reserve(input.shape().GetRank());
-  final_output_dims.reserve(input.shape().GetRank());
-  for (int i = 0; i < input.shape().GetRank(); ++i) {
-    if (!reduced_dim[i]) {
-      output_dims.push_back(input.shape().GetDimensionSize(i));
-      final_output_dims.push_back(input.shape().GetDimensionSize(i));
-    } else if (keep_dims) {
-      final_output_dims.push_back(1);
-    }
-  }
-
-  helper.output_metadata = TensorMetadata(input.dtype(), output_dims);
-  helper.final_output_metadata =
-      TensorMetadata(input.dtype(), final_output_dims);
-
-  return helper;
-}
-
-static AsyncValueRef<DenseHostTensor> TfMeanOp(
-    const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
-    const OpAttrsRef& op_attrs, const ExecutionContext& exec_ctx) {
+static AsyncValueRef<DenseHostTensor> TfCastOp(
+    const DenseHostTensor& input, const TensorMetadata& output_md,
+    const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  bool keep_dims = false;
-  if (auto attr = op_attrs.GetOptional<bool>("keep_dims"))
-    keep_dims = attr.value();
-
-  // Compute output tensor metadata from reduction indices.
-  auto helper = TfMeanOutputMd(input, reduction_indices, keep_dims);
-  if (auto err = helper.takeError())
-    return EmitErrorAsync(exec_ctx,
-                          absl::InternalError(toString(std::move(err))));
-
-  auto output =
-      DenseHostTensor::CreateUninitialized(helper->output_metadata, host);
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
   if (!output) {
-    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
-  }
-
-  AsyncValueRef<Chain> chain;
-  switch (input.dtype()) {
-    default:
-      chain = EmitErrorAsync(exec_ctx, "unsupported dtype for TfMeanOp");
-      break;
-#define DTYPE_NUMERIC(ENUM)                                             \
-  case DType::ENUM:                                                     \
-    chain = cpu::Mean<EigenTypeForDTypeKind<DType::ENUM>>(              \
-        input, helper->positive_reduction_indices, &*output, exec_ctx); \
-    break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
 
-  DenseHostTensor final_output(helper->final_output_metadata,
-                               output->ReleaseBuffer());
-
-  // TODO(tfrt-devs): ForwardValue() should be able to take an rvalue to
-  // indicate the variable cannot be used by caller after this call.
-  return ForwardValue(final_output, std::move(chain));
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported cast dtype: ", dtype));
+  };
+
+  // F16 and BF16 are converted to and from float with the vectorized Eigen
+  // conversions, so they can be used as a storage type for float compute.
+  using CastTypes = internal::TypeDispatch<float, double, Eigen::half,
+                                           Eigen::bfloat16, int32_t, int64_t>;
+
+  auto dispatch = [&](auto input_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(input_tag);
+    auto dispatch_output = [&](auto output_tag) -> AsyncValueRef<Chain> {
+      using R = decltype(output_tag);
+      return cpu::CastKernel<T, R>(input, &*output, exec_ctx);
+    };
+    return CastTypes(output_md.dtype)(dispatch_output, unsupported);
+  };
+
+  return ForwardValue(output.value(),
+                      CastTypes(input.dtype())(dispatch, unsupported));
 }
 
 //===----------------------------------------------------------------------===//
 // tf.BiadAdd op
 //===----------------------------------------------------------------------===//
 // TODO(b/161888722) Use Eigen broadcasting instead of dispatching by rank.
-static AsyncValueRef<DenseHostTensor> TfBiasAddOp(
-    const DenseHostTensor& input, const DenseHostTensor& bias,
-    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+static void TfBiasAddOp(const DenseHostTensor& input,
+                        const DenseHostTensor& bias,
+                        const TensorMetadata& output_md,
+                        RCReference<AsyncValue>* result,
+                        const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  auto output = GetForwardedOrAllocateOutput(output_md, result, host);
   if (!output) {
-    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+    *result = EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+    return;
   }
 
   AsyncValueRef<Chain> chain;
@@ -239,7 +183,7 @@ static AsyncValueRef<DenseHostTensor> TfBiasAddOp(
 #include "tfrt/dtype/dtype.def"  // NOLINT
   }
 
-  return ForwardValue(output.value(), std::move(chain));
+  *result = ForwardValue(output.value(), std::move(chain)).ReleaseRCRef();
 }
 
 }  // namespace
@@ -252,15 +196,21 @@ void RegisterTfCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tf.Const", TFRT_CPU_OP(TfConstOp),
                      CpuOpFlags::NoSideEffects, {"value"});
   op_registry->AddOp("tf.Relu", TFRT_CPU_OP(TfReluOp),
-                     CpuOpFlags::NoSideEffects);
-  op_registry->AddOp("tf.Mean", TFRT_CPU_OP(TfMeanOp),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
+  op_registry->SetElementwiseFn("tf.Relu", CpuElementwiseFn::kRelu);
+  op_registry->AddOp("tf.Cast", TFRT_CPU_OP(TfCastOp),
+                     CpuOpFlags::NoSideEffects, {"DstT"});
   op_registry->AddOp("tf.BiasAdd", TFRT_CPU_OP(TfBiasAddOp),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
 
   RegisterTfConstantCpuOps(op_registry);
   RegisterTfShapeCpuOps(op_registry);
   RegisterTfMatmulCpuOps(op_registry);
+  RegisterTfMatmulFusionCpuOps(op_registry);
+  RegisterTfQuantizedCpuOps(op_registry);
+  RegisterTfReductionCpuOps(op_registry);
+  RegisterTfTileCpuOp(op_registry);
+  RegisterTfTransposeCpuOp(op_registry);
 }
 
 }  // namespace tfrt
@@ -32,6 +32,7 @@
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -44,10 +45,10 @@ namespace tfrt {
 namespace {
 
 template <typename BinaryFunctor, typename TypeDispatch>
-static AsyncValueRef<HostTensor> TfBinaryOp(Argument<HostTensor> lhs,
-                                            Argument<HostTensor> rhs,
-                                            const TensorMetadata& output_md,
-                                            const ExecutionContext& exec_ctx) {
+static void TfBinaryOp(Argument<HostTensor> lhs, Argument<HostTensor> rhs,
+                       const TensorMetadata& output_md,
+                       RCReference<AsyncValue>* result,
+                       const ExecutionContext& exec_ctx) {
   TypeDispatch type_dispatch(lhs->dtype());
 
   auto unsupported = [&](DType dtype) -> AsyncValueRef<HostTensor> {
@@ -64,20 +65,26 @@ static AsyncValueRef<HostTensor> TfBinaryOp(Argument<HostTensor> lhs,
       using R = typename F::Output;
       auto output = MakeAvailableAsyncValueRef<ScalarHostTensor<R>>(output_md);
       cpu::BinaryKernel<F, compat::AsyncEigenEvaluator>(
-          *lhs, *rhs, &output.get(), *exec_ctx.host(), [](Error err) {});
+          *lhs, *rhs, &output.get(), exec_ctx, [](Error err) {});
       return output;
     };
 
-    return type_dispatch(dispatch, unsupported);
+    *result = type_dispatch(dispatch, unsupported).ReleaseRCRef();
+    return;
   }
 
   // ------------------------------------------------------------------------ //
   // Handle dense host tensor case, output is a dense host tensor.
   // ------------------------------------------------------------------------ //
   auto dispatch = [&](auto type_tag) -> AsyncValueRef<HostTensor> {
-    // Forward input tensor or allocate new output tensor.
-    auto output = ForwardInputOrAllocateOutput(exec_ctx, output_md, lhs, rhs);
-    if (output.IsError()) return output;
+    // Reuse the forwarded input buffer or allocate new output tensor.
+    auto dest =
+        GetForwardedOrAllocateOutput(output_md, result, exec_ctx.host());
+    if (!dest) {
+      return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    }
+    auto output =
+        MakeConstructedAsyncValueRef<DenseHostTensor>(std::move(*dest));
 
     using T = decltype(type_tag);
     using F = typename BinaryFunctor::template Functor<T>;
@@ -88,24 +95,24 @@ static AsyncValueRef<HostTensor> TfBinaryOp(Argument<HostTensor> lhs,
           : output.SetStateConcrete();
     };
     cpu::BinaryKernel<F, compat::AsyncEigenEvaluator>(
-        *lhs, *rhs, &output.get(), *exec_ctx.host(), std::move(on_done));
+        *lhs, *rhs, &output.get(), exec_ctx, std::move(on_done));
 
     return output;
   };
 
-  return type_dispatch(dispatch, unsupported);
+  *result = type_dispatch(dispatch, unsupported).ReleaseRCRef();
 }
 
 // clang-format off
 using Numeric = typename internal::GetTypeDispatch<
     DType::UI8, DType::UI16, DType::UI32, DType::UI64,
     DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64>::Type;
+    DType::F16, DType::BF16, DType::F32, DType::F64>::Type;
 
 using NumericAndComplex = typename internal::GetTypeDispatch<
     DType::UI8, DType::UI16, DType::UI32, DType::UI64,
     DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64,
+    DType::F16, DType::BF16, DType::F32, DType::F64,
     DType::Complex64, DType::Complex128>::Type;
 // clang-format on
 
@@ -114,7 +121,8 @@ void RegisterTfBinaryOp(CpuOpRegistry* op_registry, string_view op_name) {
   using TypeDispatch =
       typename std::conditional<complex, NumericAndComplex, Numeric>::type;
   op_registry->AddOp(op_name, TFRT_CPU_OP(TfBinaryOp<Functor, TypeDispatch>),
-                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar |
+                         CpuOpFlags::ForwardsArg0 | CpuOpFlags::ForwardsArg1);
 }
 
 }  // namespace
@@ -125,6 +133,11 @@ void RegisterTfBinaryCpuOps(CpuOpRegistry* op_registry) {
   RegisterTfBinaryOp<cpu::functor::Div>(op_registry, "tf.RealDiv");
   RegisterTfBinaryOp<cpu::functor::Sub>(op_registry, "tf.Sub");
 
+  // Operations that can be fused by the lazy mode of CpuOpHandler.
+  op_registry->SetElementwiseFn("tf.AddV2", CpuElementwiseFn::kAdd);
+  op_registry->SetElementwiseFn("tf.Mul", CpuElementwiseFn::kMul);
+  op_registry->SetElementwiseFn("tf.Sub", CpuElementwiseFn::kSub);
+
   // Operations that do not support compex data types.
   RegisterTfBinaryOp<cpu::functor::Less, false>(op_registry, "tf.Less");
 }
@@ -36,18 +36,23 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
+#include "type_dispatch.h"
 
 namespace tfrt {
 namespace {
 
 template <typename UnaryFunctor>
-static AsyncValueRef<DenseHostTensor> TfUnaryOp(
-    Argument<DenseHostTensor> input, const TensorMetadata& output_md,
-    const ExecutionContext& exec_ctx) {
-  // Forward input tensor or allocate new output tensor.
-  AsyncValueRef<DenseHostTensor> output =
-      ForwardInputOrAllocateOutput(exec_ctx, output_md, input);
-  if (output.IsError()) return output;
+static void TfUnaryOp(Argument<DenseHostTensor> input,
+                      const TensorMetadata& output_md,
+                      RCReference<AsyncValue>* result,
+                      const ExecutionContext& exec_ctx) {
+  // Reuse the forwarded input buffer or allocate new output tensor.
+  auto dest = GetForwardedOrAllocateOutput(output_md, result, exec_ctx.host());
+  if (!dest) {
+    *result = EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    return;
+  }
+  auto output = MakeConstructedAsyncValueRef<DenseHostTensor>(std::move(*dest));
 
   auto on_done = [output = output.CopyRef()](Error err) {
     // Forward errors to the tensor output.
@@ -55,27 +60,32 @@ static AsyncValueRef<DenseHostTensor> TfUnaryOp(
         : output.SetStateConcrete();
   };
 
-  switch (input->dtype()) {
-    default:
-      return EmitErrorAsync(exec_ctx, "unsupported dtype");
-      break;
-#define DTYPE_FLOAT(ENUM)                                      \
-  case DType::ENUM: {                                          \
-    using F = typename UnaryFunctor::template Functor<         \
-        EigenTypeForDTypeKind<DType::ENUM>>;                   \
-    tfrt::cpu::UnaryKernel<F>(*input, &output.get(), exec_ctx, \
-                              std::move(on_done));             \
-  } break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
-  }
+  // Dispatch based on the input data type. F16 and BF16 values are computed
+  // in float by the Eigen packet math.
+  auto unsupported = [&](DType dtype) -> bool {
+    *result = EmitErrorAsync(exec_ctx, "unsupported dtype");
+    return false;
+  };
+
+  auto dispatch = [&](auto type_tag) -> bool {
+    using T = decltype(type_tag);
+    using F = typename UnaryFunctor::template Functor<T>;
+    tfrt::cpu::UnaryKernel<F>(*input, &output.get(), exec_ctx,
+                              std::move(on_done));
+    return true;
+  };
+
+  internal::TypeDispatch<float, double, Eigen::half, Eigen::bfloat16>
+      type_dispatch(input->dtype());
+  if (!type_dispatch(dispatch, unsupported)) return;
 
-  return output;
+  *result = output.ReleaseRCRef();
 }
 
 template <typename Functor>
 void RegisterTfUnaryOp(CpuOpRegistry* op_registry, string_view op_name) {
   op_registry->AddOp(op_name, TFRT_CPU_OP(TfUnaryOp<Functor>),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
 }
 
 }  // namespace
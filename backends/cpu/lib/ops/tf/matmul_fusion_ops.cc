@@ -49,6 +49,9 @@ static AsyncValueRef<DenseHostTensor> TfFusedMatMulOp(
   bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
   bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
   auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+  // Tensorflow default for the LeakyRelu fused into the MatMul.
+  float leakyrelu_alpha =
+      attrs.GetOptional<float>("leakyrelu_alpha").value_or(0.2f);
 
   // Dispatch based on the input data type.
   auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
@@ -59,12 +62,13 @@ static AsyncValueRef<DenseHostTensor> TfFusedMatMulOp(
     using T = decltype(type_tag);
     return cpu::FusedMatMul<T, compat::AsyncEigenEvaluator>(
         a, b, &*output, fusion_inputs, transpose_a, transpose_b, fused_ops_attr,
-        exec_ctx);
+        leakyrelu_alpha, exec_ctx);
   };
 
   // TODO(ezhulenev): Keep these types consistent with graph rewrite that
   // does fusion (kernel matcher pass).
-  internal::TypeDispatch<float, int32_t> type_dispatch(a.dtype());
+  internal::TypeDispatch<float, Eigen::half, Eigen::bfloat16, int32_t>
+      type_dispatch(a.dtype());
   return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
 }
 
@@ -73,7 +77,8 @@ static AsyncValueRef<DenseHostTensor> TfFusedMatMulOp(
 void RegisterTfMatmulFusionCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tf._FusedMatMul", TFRT_CPU_OP(TfFusedMatMulOp),
                      CpuOpFlags::NoSideEffects,
-                     {"transpose_a", "transpose_b", "fused_ops"});
+                     {"transpose_a", "transpose_b", "fused_ops",
+                      "leakyrelu_alpha"});
 }
 
 }  // namespace tfrt
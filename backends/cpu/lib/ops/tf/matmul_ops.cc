@@ -64,8 +64,10 @@ static AsyncValueRef<DenseHostTensor> TfMatMulOp(
                           Eigen::NoOpOutputKernel(), evaluator);
   };
 
-  internal::TypeDispatch<float, double, int32_t, int64_t, uint32_t, uint64_t,
-                         std::complex<float>, std::complex<double>>
+  // F16 and BF16 inputs are multiplied with float accumulation.
+  internal::TypeDispatch<float, double, Eigen::half, Eigen::bfloat16, int32_t,
+                         int64_t, uint32_t, uint64_t, std::complex<float>,
+                         std::complex<double>>
       type_dispatch(a.dtype());
   return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
 }
@@ -0,0 +1,381 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow quantization and quantized MatMul operations.
+//
+// Only the MIN_FIRST (affine) quantization mode is supported, and it must be
+// set explicitly: the quantized MatMul derives the zero points of its operands
+// from their float ranges, which is only valid for the affine quantization.
+//
+// The quantized MatMuls pack their `b` operand for the dot products. When the
+// optional `is_weight_const` attribute is true, `b` is a constant weight, and
+// it is packed only once per HostContext.
+
+#include "quantized_ops.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "../../kernels/quantized_kernels.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/dtype/quantized_types.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/shared_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+using compat::AsyncEigenEvaluator;
+
+// Quantized ops return the quantized tensor and its float range.
+using QuantizedOpResults = std::array<AsyncValueRef<DenseHostTensor>, 3>;
+
+static QuantizedOpResults EmitErrorResults(const ExecutionContext& exec_ctx,
+                                           Error error) {
+  AsyncValueRef<DenseHostTensor> result =
+      EmitErrorAsync(exec_ctx, std::move(error));
+  return {result.CopyRef(), result.CopyRef(), result.CopyRef()};
+}
+
+// Returns the results of the op that computes the `output` quantized into the
+// [min, max] range, when the `chain` is ready.
+static QuantizedOpResults MakeQuantizedResults(
+    DenseHostTensor& output, AsyncValueRef<Chain> chain, float min, float max,
+    const ExecutionContext& exec_ctx) {
+  auto output_min = DenseHostTensor::CreateScalar(min, exec_ctx.host());
+  auto output_max = DenseHostTensor::CreateScalar(max, exec_ctx.host());
+  if (!output_min || !output_max)
+    return EmitErrorResults(
+        exec_ctx, MakeStringError("out of memory allocating result"));
+
+  return {ForwardValue(output, std::move(chain)),
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*output_min)),
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*output_max))};
+}
+
+// Reads the float scalar bound of a quantization range.
+static Expected<float> GetRangeBound(const DenseHostTensor& tensor,
+                                     string_view name) {
+  if (tensor.dtype() != DType::F32 || tensor.NumElements() != 1)
+    return MakeStringError("`", name, "` must be a float scalar");
+  return *tensor.data<float>();
+}
+
+// The `mode` attribute is required, because the Tensorflow default is the
+// unsupported MIN_COMBINED mode.
+static Error CheckQuantizeMode(const OpAttrsRef& attrs) {
+  auto mode = attrs.GetStringOptional("mode");
+  if (!mode.has_value()) return MakeStringError("missing quantization mode");
+  if (mode->str() != "MIN_FIRST")
+    return MakeStringError("unsupported quantization mode: ", *mode);
+  return Error::success();
+}
+
+//===----------------------------------------------------------------------===//
+// tf.QuantizeV2 op
+//===----------------------------------------------------------------------===//
+
+static QuantizedOpResults TfQuantizeV2Op(
+    const DenseHostTensor& input, const DenseHostTensor& min_range,
+    const DenseHostTensor& max_range, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const TensorMetadata& output_min_md,
+    const TensorMetadata& output_max_md, const ExecutionContext& exec_ctx) {
+  if (auto error = CheckQuantizeMode(attrs))
+    return EmitErrorResults(exec_ctx, std::move(error));
+
+  auto input_min = GetRangeBound(min_range, "min_range");
+  if (!input_min) return EmitErrorResults(exec_ctx, input_min.takeError());
+  auto input_max = GetRangeBound(max_range, "max_range");
+  if (!input_max) return EmitErrorResults(exec_ctx, input_max.takeError());
+
+  // Same as in Tensorflow, the range is extended to contain zero, and to be
+  // at least 1% of the largest magnitude of its bounds.
+  const float epsilon =
+      std::max(1.0f, std::max(std::fabs(*input_min), std::fabs(*input_max))) *
+      0.01f;
+  const float min = std::min(0.0f, *input_min);
+  const float max = std::max(0.0f, std::max(*input_max, min + epsilon));
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output)
+    return EmitErrorResults(
+        exec_ctx, MakeStringError("out of memory allocating result"));
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("Unsupported output dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(decltype(type_tag)::value);
+    return cpu::Quantize<T, AsyncEigenEvaluator>(
+        input, cpu::QuantizedRange<T>(min, max), &*output, exec_ctx);
+  };
+
+  internal::TypeDispatch<quint8, qint8, qint32> type_dispatch(output_md.dtype);
+  return MakeQuantizedResults(*output, type_dispatch(dispatch, unsupported),
+                              min, max, exec_ctx);
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Dequantize op
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfDequantizeOp(
+    const DenseHostTensor& input, const DenseHostTensor& min_range,
+    const DenseHostTensor& max_range, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  if (auto error = CheckQuantizeMode(attrs))
+    return EmitErrorAsync(exec_ctx, std::move(error));
+
+  auto min = GetRangeBound(min_range, "min_range");
+  if (!min) return EmitErrorAsync(exec_ctx, min.takeError());
+  auto max = GetRangeBound(max_range, "max_range");
+  if (!max) return EmitErrorAsync(exec_ctx, max.takeError());
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(decltype(type_tag)::value);
+    return cpu::Dequantize<T, AsyncEigenEvaluator>(
+        input, cpu::QuantizedRange<T>(*min, *max), &*output, exec_ctx);
+  };
+
+  internal::TypeDispatch<quint8, qint8, qint32> type_dispatch(input.dtype());
+  return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
+}
+
+//===----------------------------------------------------------------------===//
+// tf.QuantizedMatMul and tf.QuantizedMatMulWithBiasAndRequantize ops
+//===----------------------------------------------------------------------===//
+
+// Float ranges of the quantized MatMul operands.
+struct QuantizedMatMulRanges {
+  cpu::QuantizedRange<uint8_t> a;
+  cpu::QuantizedRange<int8_t> b;
+};
+
+static Expected<QuantizedMatMulRanges> GetQuantizedMatMulRanges(
+    const DenseHostTensor& a, const DenseHostTensor& b,
+    const DenseHostTensor& min_a, const DenseHostTensor& max_a,
+    const DenseHostTensor& min_b, const DenseHostTensor& max_b) {
+  // The kernel multiplies unsigned and signed 8 bit values, which is the only
+  // combination supported by the VNNI instructions.
+  if (a.dtype() != DType::QUI8 || b.dtype() != DType::QI8)
+    return MakeStringError("unsupported dtypes for quantized matmul: In[0]: ",
+                           a.dtype(), ", In[1]: ", b.dtype());
+
+  TFRT_ASSIGN_OR_RETURN(float a_min, GetRangeBound(min_a, "min_a"));
+  TFRT_ASSIGN_OR_RETURN(float a_max, GetRangeBound(max_a, "max_a"));
+  TFRT_ASSIGN_OR_RETURN(float b_min, GetRangeBound(min_b, "min_b"));
+  TFRT_ASSIGN_OR_RETURN(float b_max, GetRangeBound(max_b, "max_b"));
+
+  return QuantizedMatMulRanges{cpu::QuantizedRange<uint8_t>(a_min, a_max),
+                               cpu::QuantizedRange<int8_t>(b_min, b_max)};
+}
+
+// Caches the packed constant `b` operands of the quantized MatMuls, keyed by
+// their buffers. A packed operand keeps its buffer alive, so the buffer of a
+// cached operand is never reused for another tensor.
+class PackedQuantizedWeights : public SharedContext {
+ public:
+  explicit PackedQuantizedWeights(HostContext* host) {}
+
+  std::shared_ptr<const cpu::QuantizedMatMulPackedRhs> Get(
+      const DenseHostTensor& b, bool transpose_b) {
+    const Key key{b.buffer().get(), b.shape().GetDimensionSize(0),
+                  b.shape().GetDimensionSize(1), transpose_b};
+
+    mutex_lock lock(mu_);
+    auto it = weights_.find(key);
+    if (it != weights_.end()) return it->second;
+
+    // Packed weights are shared with the running MatMuls, and the cache can
+    // be dropped at any time.
+    if (weights_.size() >= kMaxCachedWeights) weights_.clear();
+
+    auto packed = cpu::PackQuantizedMatMulRhs(b, transpose_b);
+    weights_.emplace(key, packed);
+    return packed;
+  }
+
+ private:
+  static constexpr size_t kMaxCachedWeights = 1024;
+
+  using Key = std::tuple<const HostBuffer*, Index, Index, bool>;
+
+  mutex mu_;
+  std::map<Key, std::shared_ptr<const cpu::QuantizedMatMulPackedRhs>> weights_
+      TFRT_GUARDED_BY(mu_);
+};
+
+// Returns the packed `b` operand of the quantized MatMul, which is cached when
+// the op attributes declare it a constant weight.
+static std::shared_ptr<const cpu::QuantizedMatMulPackedRhs> PackMatMulWeights(
+    const DenseHostTensor& b, bool transpose_b, const OpAttrsRef& attrs,
+    const ExecutionContext& exec_ctx) {
+  if (!attrs.GetOptional<bool>("is_weight_const").value_or(false))
+    return cpu::PackQuantizedMatMulRhs(b, transpose_b);
+  return exec_ctx.host()
+      ->GetOrCreateSharedContext<PackedQuantizedWeights>()
+      .Get(b, transpose_b);
+}
+
+// Quantized MatMul with the int32 output.
+static QuantizedOpResults TfQuantizedMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b,
+    const DenseHostTensor& min_a, const DenseHostTensor& max_a,
+    const DenseHostTensor& min_b, const DenseHostTensor& max_b,
+    const OpAttrsRef& attrs, const TensorMetadata& output_md,
+    const TensorMetadata& output_min_md, const TensorMetadata& output_max_md,
+    const ExecutionContext& exec_ctx) {
+  auto ranges = GetQuantizedMatMulRanges(a, b, min_a, max_a, min_b, max_b);
+  if (!ranges) return EmitErrorResults(exec_ctx, ranges.takeError());
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output)
+    return EmitErrorResults(
+        exec_ctx, MakeStringError("out of memory allocating result"));
+
+  bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
+  bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
+  auto packed_b = PackMatMulWeights(b, transpose_b, attrs, exec_ctx);
+
+  // The typed data accessor asserts on the qint32 dtype of the output.
+  cpu::QuantizedMatMulInt32Output output_kernel{
+      static_cast<int32_t*>(output->data()),
+      output_md.shape.GetDimensionSize(1)};
+
+  auto chain = cpu::QuantizedMatMul<cpu::QuantizedMatMulInt32Output,
+                                    AsyncEigenEvaluator>(
+      a, std::move(packed_b), ranges->a.ZeroPoint(), ranges->b.ZeroPoint(),
+      transpose_a, output_kernel, &*output, exec_ctx);
+
+  auto output_range =
+      cpu::QuantizationRangeForMultiplication(ranges->a, ranges->b);
+  return MakeQuantizedResults(*output, std::move(chain), output_range.min(),
+                              output_range.max(), exec_ctx);
+}
+
+// Quantized MatMul with the bias added to the int32 products, and the results
+// requantized into the 8 bit output range given by the attributes. Requantizing
+// in the MatMul output kernel avoids materializing the int32 products.
+static QuantizedOpResults TfQuantizedMatMulWithBiasAndRequantizeOp(
+    const DenseHostTensor& a, const DenseHostTensor& b,
+    const DenseHostTensor& bias, const DenseHostTensor& min_a,
+    const DenseHostTensor& max_a, const DenseHostTensor& min_b,
+    const DenseHostTensor& max_b, const DenseHostTensor& min_freezed_output,
+    const DenseHostTensor& max_freezed_output, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const TensorMetadata& output_min_md,
+    const TensorMetadata& output_max_md, const ExecutionContext& exec_ctx) {
+  auto ranges = GetQuantizedMatMulRanges(a, b, min_a, max_a, min_b, max_b);
+  if (!ranges) return EmitErrorResults(exec_ctx, ranges.takeError());
+
+  auto min = GetRangeBound(min_freezed_output, "min_freezed_output");
+  if (!min) return EmitErrorResults(exec_ctx, min.takeError());
+  auto max = GetRangeBound(max_freezed_output, "max_freezed_output");
+  if (!max) return EmitErrorResults(exec_ctx, max.takeError());
+
+  const Index num_cols = output_md.shape.GetDimensionSize(1);
+  if (bias.dtype() != DType::F32 || bias.NumElements() != num_cols)
+    return EmitErrorResults(
+        exec_ctx,
+        MakeStringError("bias must be a float vector of the output columns"));
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output)
+    return EmitErrorResults(
+        exec_ctx, MakeStringError("out of memory allocating result"));
+
+  bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
+  bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
+  auto packed_b = PackMatMulWeights(b, transpose_b, attrs, exec_ctx);
+
+  const float acc_scale =
+      ranges->a.FloatForOneLevel() * ranges->b.FloatForOneLevel();
+  const float* bias_data = bias.data<float>();
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("Unsupported output dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(decltype(type_tag)::value);
+    using OutputKernel = cpu::QuantizedMatMulRequantizeOutput<T>;
+
+    OutputKernel output_kernel{
+        static_cast<T*>(output->data()), num_cols, acc_scale,
+        std::vector<float>(bias_data, bias_data + num_cols),
+        cpu::QuantizedRange<T>(*min, *max)};
+
+    return cpu::QuantizedMatMul<OutputKernel, AsyncEigenEvaluator>(
+        a, packed_b, ranges->a.ZeroPoint(), ranges->b.ZeroPoint(),
+        transpose_a, std::move(output_kernel), &*output, exec_ctx);
+  };
+
+  internal::TypeDispatch<quint8, qint8> type_dispatch(output_md.dtype);
+  return MakeQuantizedResults(*output, type_dispatch(dispatch, unsupported),
+                              *min, *max, exec_ctx);
+}
+
+}  // namespace
+
+void RegisterTfQuantizedCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.QuantizeV2", TFRT_CPU_OP(TfQuantizeV2Op),
+                     CpuOpFlags::NoSideEffects, {"T", "mode"});
+  op_registry->AddOp("tf.Dequantize", TFRT_CPU_OP(TfDequantizeOp),
+                     CpuOpFlags::NoSideEffects, {"mode"});
+  op_registry->AddOp("tf.QuantizedMatMul", TFRT_CPU_OP(TfQuantizedMatMulOp),
+                     CpuOpFlags::NoSideEffects,
+                     {"transpose_a", "transpose_b", "Toutput",
+                      "is_weight_const"});
+  op_registry->AddOp("tf.QuantizedMatMulWithBiasAndRequantize",
+                     TFRT_CPU_OP(TfQuantizedMatMulWithBiasAndRequantizeOp),
+                     CpuOpFlags::NoSideEffects,
+                     {"transpose_a", "transpose_b", "Toutput",
+                      "is_weight_const"});
+}
+
+}  // namespace tfrt
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow reduction operations.
+
+#include "reduction_ops.h"
+
+#include <cstdint>
+
+#include "../../kernels/reduction_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+struct ReductionHelper {
+  TensorMetadata output_metadata;
+  TensorMetadata final_output_metadata;
+
+  // Unlike the input reduction_indices, this one contains only positive
+  // numbers.
+  llvm::SmallVector<int32_t, 4> positive_reduction_indices;
+};
+
+template <typename IndexT>
+static Expected<ReductionHelper> ReductionOutputMd(
+    const DenseHostTensor& input, ArrayRef<IndexT> reduction_indices,
+    bool keep_dims) {
+  ReductionHelper helper;
+
+  // Check if an input dimension is reduced or not.
+  const int rank = input.shape().GetRank();
+  llvm::SmallVector<bool, 4> reduced_dim(rank, false);
+  helper.positive_reduction_indices.reserve(reduction_indices.size());
+  for (IndexT reduction_index : reduction_indices) {
+    if (reduction_index < -rank || reduction_index >= rank) {
+      return MakeStringError(
+          "Reduction index must be in [-input_rank, input_rank) range");
+    }
+    // Add the rank to get the corresponding positive index if it is negative.
+    reduction_index = (reduction_index + rank) % rank;
+    if (reduced_dim[reduction_index]) {
+      return MakeStringError("Reduction indices must be unique");
+    }
+
+    reduced_dim[reduction_index] = true;
+
+    helper.positive_reduction_indices.push_back(reduction_index);
+  }
+
+  llvm::SmallVector<Index, 4> output_dims;
+  llvm::SmallVector<Index, 4> final_output_dims;
+  output_dims.reserve(rank);
+  final_output_dims.reserve(rank);
+  for (int i = 0; i < rank; ++i) {
+    if (!reduced_dim[i]) {
+      output_dims.push_back(input.shape().GetDimensionSize(i));
+      final_output_dims.push_back(input.shape().GetDimensionSize(i));
+    } else if (keep_dims) {
+      final_output_dims.push_back(1);
+    }
+  }
+
+  helper.output_metadata = TensorMetadata(input.dtype(), output_dims);
+  helper.final_output_metadata =
+      TensorMetadata(input.dtype(), final_output_dims);
+
+  return helper;
+}
+
+static Expected<ReductionHelper> ReductionOutputMd(
+    const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
+    bool keep_dims) {
+  if (reduction_indices.shape().GetRank() > 1)
+    return MakeStringError("Reduction indices must be a scalar or a vector");
+
+  if (reduction_indices.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&reduction_indices);
+    return ReductionOutputMd(input, view.Elements(), keep_dims);
+  } else if (reduction_indices.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&reduction_indices);
+    return ReductionOutputMd(input, view.Elements(), keep_dims);
+  } else {
+    return MakeStringError("Unsupported reduction indices dtype");
+  }
+}
+
+// The output shape depends on the reduction indices values, and the reduction
+// ops compute the output metadata themselves.
+template <template <typename> class Reducer, typename TypeDispatch>
+static AsyncValueRef<DenseHostTensor> TfReductionOp(
+    const DenseHostTensor& input, const DenseHostTensor& reduction_indices,
+    const OpAttrsRef& op_attrs, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  bool keep_dims = op_attrs.GetOptional<bool>("keep_dims").value_or(false);
+
+  // Compute output tensor metadata from reduction indices.
+  auto helper = ReductionOutputMd(input, reduction_indices, keep_dims);
+  if (auto err = helper.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(helper->output_metadata, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+  }
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::Reduce<Reducer, T>(input, helper->positive_reduction_indices,
+                                   &*output, exec_ctx);
+  };
+
+  TypeDispatch type_dispatch(input.dtype());
+  AsyncValueRef<Chain> chain = type_dispatch(dispatch, unsupported);
+
+  DenseHostTensor final_output(helper->final_output_metadata,
+                               output->ReleaseBuffer());
+
+  // TODO(tfrt-devs): ForwardValue() should be able to take an rvalue to
+  // indicate the variable cannot be used by caller after this call.
+  return ForwardValue(final_output, std::move(chain));
+}
+
+// clang-format off
+using Numeric = typename internal::GetTypeDispatch<
+    DType::UI8, DType::UI16, DType::UI32, DType::UI64,
+    DType::I8,  DType::I16,  DType::I32,  DType::I64,
+    DType::F16, DType::BF16, DType::F32, DType::F64>::Type;
+
+using Bool = typename internal::GetTypeDispatch<DType::I1>::Type;
+// clang-format on
+
+template <template <typename> class Reducer, typename TypeDispatch>
+void RegisterTfReductionOp(CpuOpRegistry* op_registry, string_view op_name) {
+  op_registry->AddOp(op_name, TFRT_CPU_OP(TfReductionOp<Reducer, TypeDispatch>),
+                     CpuOpFlags::NoSideEffects, {"keep_dims"});
+}
+
+}  // namespace
+
+void RegisterTfReductionCpuOps(CpuOpRegistry* op_registry) {
+  RegisterTfReductionOp<cpu::SumReducer, Numeric>(op_registry, "tf.Sum");
+  RegisterTfReductionOp<cpu::ProdReducer, Numeric>(op_registry, "tf.Prod");
+  RegisterTfReductionOp<cpu::MeanReducer, Numeric>(op_registry, "tf.Mean");
+  RegisterTfReductionOp<cpu::MaxReducer, Numeric>(op_registry, "tf.Max");
+  RegisterTfReductionOp<cpu::MinReducer, Numeric>(op_registry, "tf.Min");
+  RegisterTfReductionOp<cpu::AllReducer, Bool>(op_registry, "tf.All");
+  RegisterTfReductionOp<cpu::AnyReducer, Bool>(op_registry, "tf.Any");
+}
+
+}  // namespace tfrt
@@ -19,6 +19,7 @@
 #include "softmax_ops.h"
 
 #include "../../kernels/softmax_kernel.h"
+#include "buffer_forwarding.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/core_runtime/op_utils.h"
@@ -29,45 +30,51 @@
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
 
 namespace tfrt {
 namespace {
 
 template <bool log>
-static AsyncValueRef<DenseHostTensor> TfSoftmaxOp(
-    const DenseHostTensor& logits, const TensorMetadata& output_md,
-    const ExecutionContext& exec_ctx) {
+static void TfSoftmaxOp(const DenseHostTensor& logits,
+                        const TensorMetadata& output_md,
+                        RCReference<AsyncValue>* result,
+                        const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
 
-  auto dest = DenseHostTensor::CreateUninitialized(output_md, host);
+  // Softmax of a row only reads the logits before writing the row, so the
+  // logits buffer can be forwarded to the result.
+  auto dest = GetForwardedOrAllocateOutput(output_md, result, host);
   if (!dest) {
-    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    *result = EmitErrorAsync(exec_ctx, "out of memory allocating result");
+    return;
   }
 
-  AsyncValueRef<Chain> chain;
-  switch (logits.dtype()) {
-    default:
-      chain = EmitErrorAsync(exec_ctx, "unsupported dtype");
-      break;
-#define DTYPE_FLOAT(ENUM)                                                     \
-  case DType::ENUM: {                                                         \
-    chain = ::tfrt::cpu::Softmax<EigenTypeForDTypeKind<DType::ENUM>, log,     \
-                                 compat::AsyncEigenEvaluator>(logits, &*dest, \
-                                                              exec_ctx);      \
-  } break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
-  }
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, "unsupported dtype");
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return ::tfrt::cpu::Softmax<T, log, compat::AsyncEigenEvaluator>(
+        logits, &*dest, exec_ctx);
+  };
+
+  // F16 and BF16 logits are computed in float.
+  internal::TypeDispatch<float, double, Eigen::half, Eigen::bfloat16>
+      type_dispatch(logits.dtype());
+  AsyncValueRef<Chain> chain = type_dispatch(dispatch, unsupported);
 
-  return ForwardValue(dest.value(), std::move(chain));
+  *result = ForwardValue(dest.value(), std::move(chain)).ReleaseRCRef();
 }
 
 }  // namespace
 
 void RegisterTfSofmaxCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tf.Softmax", TFRT_CPU_OP(TfSoftmaxOp<false>),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
   op_registry->AddOp("tf.LogSoftmax", TFRT_CPU_OP(TfSoftmaxOp<true>),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::ForwardsArg0);
 }
 
 }  // namespace tfrt
@@ -18,12 +18,10 @@
 
 #include "tile_op.h"
 
-#include <sys/types.h>
-
 #include <cstdint>
 
 #include "../../kernels/tile_kernel.h"
-#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/core_runtime/op_utils.h"
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/host_context/async_value_ref.h"
@@ -54,6 +52,12 @@ static AsyncValueRef<HostTensor> TfTileOp(const HostTensor& input_arg,
         exec_ctx, "Tile multiples must have the same size as input rank");
   }
 
+  for (Index multiple : *expected_multiples) {
+    if (multiple < 0) {
+      return EmitErrorAsync(exec_ctx, "Tile multiples must be non-negative");
+    }
+  }
+
   // Compute the output shape from the input shape and multiples.
   llvm::SmallVector<Index, 5> output_dims;
   for (int d = 0; d < expected_multiples->size(); ++d) {
@@ -74,26 +78,8 @@ static AsyncValueRef<HostTensor> TfTileOp(const HostTensor& input_arg,
     }
 
     // Call tile kernel.
-    AsyncValueRef<Chain> chain;
-
-    switch (input.dtype()) {
-      default:
-        chain = EmitErrorAsync(exec_ctx,
-                               StrCat("Unsupported dtype: ", input.dtype()));
-        break;
-      case DType::I1: {
-        using T = EigenTypeForDTypeKind<DType::I1>;
-        chain = ::tfrt::cpu::Tile<T, compat::AsyncEigenEvaluator>(
-            input, *expected_multiples, &*dest, exec_ctx);
-      } break;
-#define DTYPE_NUMERIC(ENUM)                                    \
-  case DType::ENUM: {                                          \
-    using T = EigenTypeForDTypeKind<DType::ENUM>;              \
-    chain = ::tfrt::cpu::Tile<T, compat::AsyncEigenEvaluator>( \
-        input, *expected_multiples, &*dest, exec_ctx);         \
-  } break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
-    }
+    AsyncValueRef<Chain> chain = cpu::Tile<compat::AsyncEigenEvaluator>(
+        input, *expected_multiples, &*dest, exec_ctx);
 
     return ForwardValue(dest.value(), std::move(chain));
 
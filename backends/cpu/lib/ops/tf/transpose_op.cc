@@ -0,0 +1,160 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Transpose operation.
+
+#include "transpose_op.h"
+
+#include <cstdint>
+
+#include "../../kernels/transpose_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+namespace tfrt {
+namespace {
+
+template <typename T>
+static llvm::SmallVector<Index, 5> ToPerm(ArrayRef<T> values) {
+  return llvm::SmallVector<Index, 5>(values.begin(), values.end());
+}
+
+static Expected<llvm::SmallVector<Index, 5>> TransposePerm(
+    const DenseHostTensor& perm) {
+  if (perm.shape().GetRank() != 1)
+    return MakeStringError("Transpose perm must be a vector");
+
+  if (perm.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&perm);
+    return ToPerm(view.Elements());
+  } else if (perm.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&perm);
+    return ToPerm(view.Elements());
+  } else {
+    return MakeStringError("Unsupported perm data type");
+  }
+}
+
+// Computes the output metadata of the transpose, and checks that the `perm`
+// is a valid permutation of the input dimensions.
+static Expected<TensorMetadata> TransposeOutputMd(const TensorMetadata& input,
+                                                  ArrayRef<Index> perm) {
+  const int rank = input.shape.GetRank();
+  if (perm.size() != rank)
+    return MakeStringError("Transpose perm size must match input rank");
+
+  llvm::SmallVector<bool, 5> permuted_dim(rank, false);
+  llvm::SmallVector<Index, 5> output_dims;
+  for (Index dim : perm) {
+    if (dim < 0 || dim >= rank)
+      return MakeStringError("Transpose perm values must be in [0, ", rank,
+                             ") range");
+    if (permuted_dim[dim])
+      return MakeStringError("Transpose perm values must be unique");
+    permuted_dim[dim] = true;
+    output_dims.push_back(input.shape.GetDimensionSize(dim));
+  }
+
+  return TensorMetadata(input.dtype, output_dims);
+}
+
+static AsyncValueRef<DenseHostTensor> Transpose(
+    const DenseHostTensor& input, ArrayRef<Index> perm,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  // Transposes that do not move any elements share the input buffer.
+  llvm::SmallVector<Index, 5> input_dims;
+  input.shape().GetDimensions(&input_dims);
+  if (cpu::IsIdentityTranspose(input_dims, perm)) {
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(output_md,
+                                                       input.buffer());
+  }
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::Transpose<compat::AsyncEigenEvaluator>(input, perm,
+                                                           &*output, exec_ctx);
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Transpose op
+//===----------------------------------------------------------------------===//
+
+// The output shape depends on the `perm` values, and the op computes the
+// output metadata itself.
+static AsyncValueRef<DenseHostTensor> TfTransposeOp(
+    const DenseHostTensor& input, const DenseHostTensor& perm_arg,
+    const ExecutionContext& exec_ctx) {
+  auto perm = TransposePerm(perm_arg);
+  if (auto err = perm.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+
+  auto output_md = TransposeOutputMd(input.metadata(), *perm);
+  if (auto err = output_md.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+
+  return Transpose(input, *perm, *output_md, exec_ctx);
+}
+
+//===----------------------------------------------------------------------===//
+// _tf.Transpose op with the `perm` folded into the dense attribute
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<DenseHostTensor> TfTransposeFoldedOp(
+    const DenseHostTensor& input, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  // The `perm` attribute is validated by the metadata function.
+  DenseView perm_view = CreateDenseView(attrs.GetAsserting<DenseAttr>("perm"));
+
+  llvm::SmallVector<Index, 5> perm;
+  if (perm_view.dtype() == DType::I32) {
+    perm = ToPerm(perm_view.GetFlat<int32_t>());
+  } else if (perm_view.dtype() == DType::I64) {
+    perm = ToPerm(perm_view.GetFlat<int64_t>());
+  } else {
+    return EmitErrorAsync(exec_ctx, "Unsupported perm data type");
+  }
+
+  return Transpose(input, perm, output_md, exec_ctx);
+}
+
+}  // namespace
+
+void RegisterTfTransposeCpuOp(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Transpose", TFRT_CPU_OP(TfTransposeOp),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddOp("_tf.Transpose", TFRT_CPU_OP(TfTransposeFoldedOp),
+                     CpuOpFlags::NoSideEffects, {"perm"});
+}
+
+}  // namespace tfrt
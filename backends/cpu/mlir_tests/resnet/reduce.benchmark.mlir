@@ -0,0 +1,90 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- reduce.benchmark.mlir ----------------------------------------------===//
+//
+// These benchmarks measure the test reduction kernels with large batches,
+// which are split into blocks by ParallelFor.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: bef_executor --work_queue_type=mstd:8 %s.bef | FileCheck %s
+
+// CHECK-LABEL: --- Running 'BM_MeanAxisZero_8192x256'
+func.func @BM_MeanAxisZero_8192x256() {
+  %ch0 = tfrt.new.chain
+
+  %input = "tfrt_dht.create_uninitialized_tensor.f32.2"()
+    { shape = [8192 : i64, 256 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  %output = "tfrt_dht.create_uninitialized_tensor.f32.1"()
+    { shape = [256 : i64] }
+    : () -> !tfrt_tensor.tensor
+
+  tfrt_test.benchmark "BM_MeanAxisZero_8192x256"(
+    %input : !tfrt_tensor.tensor,
+    %output : !tfrt_tensor.tensor,
+    %ch1 : !tfrt.chain
+  ) duration_secs = 5, max_count = 1000, num_warmup_runs = 10 {
+    %ch2 = "tfrt_test.mean_axis_zero.f32"(%input, %output, %ch1)
+      : (!tfrt_tensor.tensor, !tfrt_tensor.tensor, !tfrt.chain) -> !tfrt.chain
+    tfrt.return %ch2 : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'BM_ReduceMean_1M'
+func.func @BM_ReduceMean_1M() {
+  %ch0 = tfrt.new.chain
+
+  %input = "tfrt_dht.create_uninitialized_tensor.f32.1"()
+    { shape = [1048576 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  tfrt_test.benchmark "BM_ReduceMean_1M"(
+    %input : !tfrt_tensor.tensor,
+    %ch1 : !tfrt.chain
+  ) duration_secs = 5, max_count = 1000, num_warmup_runs = 10 {
+    %output = "tfrt_test.reduce_mean.f32.1"(%input)
+      : (!tfrt_tensor.tensor) -> !tfrt_tensor.tensor
+    tfrt.return %output : !tfrt_tensor.tensor
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'BM_Argmax_8192x10'
+func.func @BM_Argmax_8192x10() {
+  %ch0 = tfrt.new.chain
+
+  %input = "tfrt_dht.create_uninitialized_tensor.f32.2"()
+    { shape = [8192 : i64, 10 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %input, %ch0 1.0 : f32
+
+  tfrt_test.benchmark "BM_Argmax_8192x10"(
+    %input : !tfrt_tensor.tensor,
+    %ch1 : !tfrt.chain
+  ) duration_secs = 5, max_count = 1000, num_warmup_runs = 10 {
+    %output = "tfrt_test.argmax.f32.2"(%input)
+      : (!tfrt_tensor.tensor) -> !tfrt_tensor.tensor
+    tfrt.return %output : !tfrt_tensor.tensor
+  }
+
+  tfrt.return
+}
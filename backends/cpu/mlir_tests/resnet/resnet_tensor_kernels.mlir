@@ -74,3 +74,43 @@ func.func @test_max_pool_2d_f32_shape_error() {
 
   tfrt.return
 }
+
+// CHECK-LABEL: --- Running 'test_mean_axis_zero_f32'
+func.func @test_mean_axis_zero_f32() {
+  %ch0 = tfrt.new.chain
+
+  %input = "tfrt_dht.create_uninitialized_tensor.f32.2"()
+    { shape = [3 : i64, 2 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %ch1 = "tfrt_dht.set_tensor_with_constant_values.f32"(%input, %ch0)
+    { values = [1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32, 5.0 : f32, 6.0 : f32] }
+    : (!tfrt_tensor.tensor, !tfrt.chain) -> !tfrt.chain
+
+  %output = "tfrt_dht.create_uninitialized_tensor.f32.1"()
+    { shape = [2 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %ch2 = "tfrt_test.mean_axis_zero.f32"(%input, %output, %ch1)
+    : (!tfrt_tensor.tensor, !tfrt_tensor.tensor, !tfrt.chain) -> !tfrt.chain
+
+  // CHECK: shape = [2], values = [3.000000e+00, 4.000000e+00]
+  tfrt_dht.print_tensor %output, %ch2
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'test_mean_axis_zero_f32_shape_error'
+func.func @test_mean_axis_zero_f32_shape_error() {
+  %ch0 = tfrt.new.chain
+
+  %input = "tfrt_dht.create_uninitialized_tensor.f32.2"()
+    { shape = [3 : i64, 2 : i64] }
+    : () -> !tfrt_tensor.tensor
+  %output = "tfrt_dht.create_uninitialized_tensor.f32.1"()
+    { shape = [3 : i64] }
+    : () -> !tfrt_tensor.tensor
+
+  // expected-error @+1 {{MeanAxisZero output shape [3] does not match the input shape [3, 2]}}
+  "tfrt_test.mean_axis_zero.f32"(%input, %output, %ch0)
+    : (!tfrt_tensor.tensor, !tfrt_tensor.tensor, !tfrt.chain) -> !tfrt.chain
+
+  tfrt.return
+}
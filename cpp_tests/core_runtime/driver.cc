@@ -90,6 +90,14 @@ void CoreRuntimeCpuDriver::Execute(const ExecutionContext& exec_ctx,
                    &chain_);
 }
 
+CpuOpHandler* CoreRuntimeCpuDriver::GetCpuOpHandler() const {
+  return static_cast<CpuOpHandler*>(op_handler_);
+}
+
+void CoreRuntimeCpuDriver::SetLazyFusion(bool enabled) {
+  GetCpuOpHandler()->SetLazyFusion(enabled);
+}
+
 CoreRuntimeOp CoreRuntimeCpuDriver::MakeOp(string_view op_name) {
   auto handle = corert_->MakeOp(op_name, op_handler_);
   assert(handle);
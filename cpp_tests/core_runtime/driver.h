@@ -30,6 +30,7 @@
 namespace tfrt {
 
 class CoreRuntimeOp;
+class CpuOpHandler;
 class Function;
 class OpHandler;
 class OpAttrsRef;
@@ -55,6 +56,12 @@ class CoreRuntimeCpuDriver final : public LocationHandler {
 
   HostContext* GetHostContext() const { return corert_->GetHostContext(); }
 
+  CpuOpHandler* GetCpuOpHandler() const;
+
+  // Enables the lazy fusion of the elementwise ops (see
+  // CpuOpHandler::SetLazyFusion).
+  void SetLazyFusion(bool enabled);
+
   ExecutionContext CreateExecutionContext(const char* filename,
                                           int line_number);
 
@@ -17,7 +17,10 @@
 
 #include "driver.h"
 
+#include <array>
+#include <cstring>
 #include <memory>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
@@ -25,6 +28,7 @@
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
@@ -61,6 +65,48 @@ TEST_F(CpuDriverTest, ReluTest_InputForward) {
             buffer_pointer);
 }
 
+TEST_F(CpuDriverTest, BufferForwardingStatsTest) {
+  auto exec_ctx = driver_.CreateExecutionContext(__FILE__, __LINE__);
+  CpuOpHandler* op_handler = driver_.GetCpuOpHandler();
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{2, 2});
+  attrs.SetArray("values", tfrt::ArrayRef<float>{-1.0});
+  tfrt::TensorHandle a1;
+  driver_.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {},
+                  attrs.freeze(), a1);
+  driver_.WaitForHostContextQuiesce();
+
+  auto stats = op_handler->GetBufferForwardingStats();
+
+  // The argument is still used by `a1`, the result needs a new buffer.
+  tfrt::OpAttrs empty_attrs;
+  tfrt::TensorHandle arg = a1.CopyRef();
+  tfrt::TensorHandle a2;
+  driver_.Execute(exec_ctx, "tfrt_test.relu", arg, empty_attrs.freeze(), a2);
+  driver_.WaitForHostContextQuiesce();
+  EXPECT_EQ(op_handler->GetBufferForwardingStats().allocated,
+            stats.allocated + 1);
+
+  // The relu result is only used by the cast to the same dtype, which reuses
+  // its buffer.
+  auto buffer_pointer =
+      a2.GetAsyncTensor()->get<DenseHostTensor>().buffer().get();
+  tfrt::OpAttrs cast_attrs;
+  cast_attrs.SetString("type", "f32");
+  tfrt::TensorHandle a3;
+  driver_.Execute(exec_ctx, "tfrt_test.cast", a2, cast_attrs.freeze(), a3);
+  driver_.WaitForHostContextQuiesce();
+  EXPECT_EQ(op_handler->GetBufferForwardingStats().forwarded,
+            stats.forwarded + 1);
+  EXPECT_EQ(a3.GetAsyncTensor()->get<DenseHostTensor>().buffer().get(),
+            buffer_pointer);
+
+  auto a3_view =
+      DHTArrayView<float>(&a3.GetAsyncTensor()->get<DenseHostTensor>());
+  for (float value : a3_view.Elements()) EXPECT_EQ(value, 0.0f);
+}
+
 TEST_F(CpuDriverTest, CompositeOpTest) {
   tfrt::OpAttrs attrs;
   attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
@@ -129,6 +175,46 @@ TEST_F(CpuDriverTest, CompositeOpTest) {
   ASSERT_EQ(a2_view.Elements()[0], 2);
 }
 
+TEST_F(CpuDriverTest, CompositeOpArgumentCountMismatch) {
+  bool called = false;
+  tfrt::NativeCallable callable =
+      [&called](AsyncValue* const* arguments, int num_arguments,
+                RCReference<AsyncValue>* results, int num_results,
+                HostContext* host) { called = true; };
+
+  TypeName chain_type =
+      driver_.GetHostContext()->GetKernelRegistry().GetType("!tfrt.chain");
+  TypeName tensor_handle_type =
+      driver_.GetHostContext()->GetKernelRegistry().GetType(
+          CoreRuntime::kTensorHandleType);
+  NativeFunction fn(
+      "test_fn",
+      /*argument_types=*/{chain_type, tensor_handle_type, tensor_handle_type},
+      /*result_types=*/{chain_type, tensor_handle_type}, callable);
+  auto op = driver_.MakeCompositeOp(&fn);
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1});
+  tfrt::TensorHandle arg;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.create_dense_tensor", {}, attrs.freeze(), arg);
+
+  // The function takes two arguments, the invocation only provides one.
+  tfrt::TensorHandle result;
+  AsyncValueRef<Chain> chain;
+  op(driver_.CreateExecutionContext(__FILE__, __LINE__), arg, OpAttrsRef(),
+     result, &chain);
+  driver_.WaitForHostContextQuiesce();
+
+  EXPECT_FALSE(called);
+  ASSERT_TRUE(result.GetAsyncTensor()->IsError());
+  EXPECT_TRUE(chain.IsError());
+  EXPECT_EQ(result.GetAsyncTensor()->GetError().message(),
+            "composite op test_fn takes 2 arguments and returns 1 results, "
+            "but the invocation has 1 arguments and 1 results");
+}
+
 TEST_F(CpuDriverTest, NativeCompositeOpTest) {
   // Add 2 scalar int32.
   tfrt::NativeCallable add_callable =
@@ -165,5 +251,314 @@ TEST_F(CpuDriverTest, NativeCompositeOpTest) {
   ASSERT_EQ(a2->get<int32_t>(), 2);
 }
 
+TEST_F(CpuDriverTest, RepeatedExecuteTest) {
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1});
+  tfrt::TensorHandle a1;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.create_dense_tensor", {}, attrs.freeze(), a1);
+
+  // Subsequent executions of the same op reuse the op prepared by the first
+  // one, and must produce the same results.
+  tfrt::OpAttrs empty_attrs;
+  for (int i = 0; i < 3; ++i) {
+    tfrt::TensorHandle add_args[2] = {a1.CopyRef(), a1.CopyRef()};
+    tfrt::TensorHandle a2;
+    driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                    "tfrt_test.add", add_args, empty_attrs.freeze(), a2);
+    driver_.WaitForHostContextQuiesce();
+
+    auto a2_view =
+        DHTArrayView<int32_t>(&a2.GetAsyncTensor()->get<DenseHostTensor>());
+    ASSERT_EQ(a2_view.Elements()[0], 2);
+  }
+
+  // Unknown ops are reported as errors on every execution.
+  for (int i = 0; i < 2; ++i) {
+    tfrt::TensorHandle a3;
+    driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                    "tfrt_test.unknown_op", {}, empty_attrs.freeze(), a3);
+    ASSERT_TRUE(a3.GetAsyncTensor()->IsError());
+  }
+}
+
+TEST_F(CpuDriverTest, BatchExecuteTest) {
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1});
+  tfrt::TensorHandle a1;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.create_dense_tensor", {}, attrs.freeze(), a1);
+  driver_.WaitForHostContextQuiesce();
+
+  auto op = driver_.MakeOp("tfrt_test.add");
+  auto exec_ctx = driver_.CreateExecutionContext(__FILE__, __LINE__);
+  tfrt::OpAttrs empty_attrs;
+  tfrt::OpAttrsRef empty_attrs_ref = empty_attrs.freeze();
+
+  for (bool parallel : {false, true}) {
+    constexpr int kBatchSize = 16;
+    std::vector<std::array<tfrt::TensorHandle, 2>> args(kBatchSize);
+    std::vector<tfrt::TensorHandle> results(kBatchSize);
+    std::vector<OpInvocation> invocations;
+    invocations.reserve(kBatchSize);
+    for (int i = 0; i < kBatchSize; ++i) {
+      args[i][0] = a1.CopyRef();
+      args[i][1] = a1.CopyRef();
+      invocations.push_back(OpInvocation{string_view{}, exec_ctx, args[i],
+                                         empty_attrs_ref, results[i],
+                                         /*chain=*/nullptr});
+    }
+    op.ExecuteBatch(invocations, parallel);
+    driver_.WaitForHostContextQuiesce();
+
+    for (auto& result : results) {
+      ASSERT_TRUE(result.IsMetadataAvailable());
+      ASSERT_EQ(result.GetAvailableMetadata().shape.GetNumElements(), 1);
+      auto& tensor = result.GetAsyncTensor()->get<DenseHostTensor>();
+      ASSERT_EQ(DHTArrayView<int32_t>(&tensor).Elements()[0], 2);
+    }
+  }
+}
+
+// Executes `cast(relu(a + b) + a)` with the lazy fusion enabled or disabled.
+TensorHandle ExecuteElementwiseChain(example::CoreRuntimeCpuDriver* driver,
+                                     const ExecutionContext& exec_ctx,
+                                     const TensorHandle& a,
+                                     const TensorHandle& b,
+                                     string_view cast_type, bool lazy) {
+  driver->SetLazyFusion(lazy);
+  tfrt::OpAttrs empty_attrs;
+  tfrt::OpAttrsRef empty_attrs_ref = empty_attrs.freeze();
+
+  tfrt::TensorHandle add_args[2] = {a.CopyRef(), b.CopyRef()};
+  tfrt::TensorHandle sum;
+  driver->Execute(exec_ctx, "tfrt_test.add", add_args, empty_attrs_ref, sum);
+  tfrt::TensorHandle relu;
+  driver->Execute(exec_ctx, "tfrt_test.relu", sum, empty_attrs_ref, relu);
+  tfrt::TensorHandle add2_args[2] = {std::move(relu), a.CopyRef()};
+  tfrt::TensorHandle sum2;
+  driver->Execute(exec_ctx, "tfrt_test.add", add2_args, empty_attrs_ref, sum2);
+
+  tfrt::OpAttrs cast_attrs;
+  cast_attrs.SetString("type", cast_type);
+  tfrt::TensorHandle result;
+  driver->Execute(exec_ctx, "tfrt_test.cast", sum2, cast_attrs.freeze(),
+                  result);
+  driver->SetLazyFusion(false);
+  return result;
+}
+
+TEST_F(CpuDriverTest, LazyFusionTest) {
+  auto exec_ctx = driver_.CreateExecutionContext(__FILE__, __LINE__);
+
+  // Use enough elements for several blocks of the fused loop, with a partial
+  // last block.
+  constexpr Index kNumElements = 3 * 1024 + 5;
+  std::vector<float> a_values(kNumElements), b_values(kNumElements);
+  for (Index i = 0; i < kNumElements; ++i) {
+    a_values[i] = 0.37f * (i % 11) - 1.5f;
+    b_values[i] = 0.21f * (i % 7) - 0.4f;
+  }
+
+  auto make_tensor = [&](ArrayRef<float> values) {
+    tfrt::OpAttrs attrs;
+    attrs.SetArray("shape", tfrt::ArrayRef<Index>{kNumElements});
+    attrs.SetArray("values", values);
+    tfrt::TensorHandle tensor;
+    driver_.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {},
+                    attrs.freeze(), tensor);
+    return tensor;
+  };
+  tfrt::TensorHandle a = make_tensor(a_values);
+  tfrt::TensorHandle b = make_tensor(b_values);
+  driver_.WaitForHostContextQuiesce();
+
+  // Casting to f32 is fused, casting to f16 materializes the fused add, relu
+  // and add ops.
+  for (string_view cast_type : {"f32", "f16"}) {
+    tfrt::TensorHandle expected = ExecuteElementwiseChain(
+        &driver_, exec_ctx, a, b, cast_type, /*lazy=*/false);
+    tfrt::TensorHandle lazy = ExecuteElementwiseChain(
+        &driver_, exec_ctx, a, b, cast_type, /*lazy=*/true);
+    driver_.WaitForHostContextQuiesce();
+
+    ASSERT_TRUE(lazy.IsMetadataAvailable());
+    ASSERT_EQ(lazy.GetAvailableMetadata(), expected.GetAvailableMetadata());
+    if (cast_type == "f32") {
+      ASSERT_EQ(lazy.GetAsyncTensor()->get<Tensor>().tensor_type().name(),
+                "LazyHost");
+    }
+
+    tfrt::TensorHandle lazy_dense = lazy.TransferTo(
+        exec_ctx, lazy.GetAvailableDevice().CopyRef(),
+        DenseHostTensor::kTensorType);
+    driver_.WaitForHostContextQuiesce();
+
+    // The fused loop evaluates the same expressions as the ops, so the results
+    // are bitwise identical.
+    const auto& expected_tensor =
+        expected.GetAsyncTensor()->get<DenseHostTensor>();
+    const auto& lazy_tensor =
+        lazy_dense.GetAsyncTensor()->get<DenseHostTensor>();
+    ASSERT_EQ(expected_tensor.DataSizeInBytes(),
+              lazy_tensor.DataSizeInBytes());
+    ASSERT_EQ(std::memcmp(expected_tensor.data(), lazy_tensor.data(),
+                          expected_tensor.DataSizeInBytes()),
+              0);
+  }
+}
+
+// The result metadata of an op without metadata function is read from its
+// result when the op runs synchronously. The result handles hold it inline,
+// i.e. no AsyncValue<TensorMetadata> is allocated for them.
+TEST_F(CpuDriverTest, InlineResultMetadataTest) {
+  auto exec_ctx = driver_.CreateExecutionContext(__FILE__, __LINE__);
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{4});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1, 2, 3, 4});
+  tfrt::TensorHandle input;
+  driver_.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {},
+                  attrs.freeze(), input);
+  driver_.WaitForHostContextQuiesce();
+  ASSERT_TRUE(input.GetAsyncTensor()->IsConcrete());
+
+  // The input is available, so both ops run synchronously.
+  int num_metadata_async_values = 0;
+  auto execute = [&](string_view op_name, MutableArrayRef<TensorHandle> args,
+                     TensorHandle& result) {
+    tfrt::OpAttrs empty_attrs;
+    driver_.Execute(exec_ctx, op_name, args, empty_attrs.freeze(), result);
+    ASSERT_TRUE(result.GetAsyncTensor()->IsConcrete());
+    if (!result.IsMetadataInline()) ++num_metadata_async_values;
+  };
+
+  // tfrt_test.odd_collector has no metadata function, tfrt_test.add has one.
+  tfrt::TensorHandle odd_args[1] = {input.CopyRef()};
+  tfrt::TensorHandle odd;
+  execute("tfrt_test.odd_collector", odd_args, odd);
+  tfrt::TensorHandle add_args[2] = {input.CopyRef(), input.CopyRef()};
+  tfrt::TensorHandle add;
+  execute("tfrt_test.add", add_args, add);
+  driver_.WaitForHostContextQuiesce();
+
+  EXPECT_EQ(num_metadata_async_values, 0);
+  EXPECT_EQ(odd.GetAvailableMetadata().shape, TensorShape({2}));
+  EXPECT_EQ(add.GetAvailableMetadata().shape, TensorShape({4}));
+}
+
+void BM_EagerAdd(benchmark::State& state) {
+  example::CoreRuntimeCpuDriver driver;
+  auto exec_ctx = driver.CreateExecutionContext(__FILE__, __LINE__);
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1});
+  tfrt::TensorHandle a1;
+  driver.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {}, attrs.freeze(),
+                 a1);
+  driver.WaitForHostContextQuiesce();
+
+  tfrt::OpAttrs empty_attrs;
+  tfrt::OpAttrsRef empty_attrs_ref = empty_attrs.freeze();
+  for (auto _ : state) {
+    tfrt::TensorHandle add_args[2] = {a1.CopyRef(), a1.CopyRef()};
+    tfrt::TensorHandle a2;
+    driver.Execute(exec_ctx, "tfrt_test.add", add_args, empty_attrs_ref, a2);
+  }
+  driver.WaitForHostContextQuiesce();
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EagerAdd);
+
+// Executes batches of `tfrt_test.add` invocations, to compare against the
+// single invocations of BM_EagerAdd.
+void BM_EagerAddBatch(benchmark::State& state) {
+  example::CoreRuntimeCpuDriver driver;
+  auto exec_ctx = driver.CreateExecutionContext(__FILE__, __LINE__);
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{1});
+  attrs.SetArray("values", tfrt::ArrayRef<int32_t>{1});
+  tfrt::TensorHandle a1;
+  driver.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {}, attrs.freeze(),
+                 a1);
+  driver.WaitForHostContextQuiesce();
+
+  auto op = driver.MakeOp("tfrt_test.add");
+  tfrt::OpAttrs empty_attrs;
+  tfrt::OpAttrsRef empty_attrs_ref = empty_attrs.freeze();
+  const int batch_size = state.range(0);
+  const bool parallel = state.range(1);
+
+  for (auto _ : state) {
+    std::vector<std::array<tfrt::TensorHandle, 2>> args(batch_size);
+    std::vector<tfrt::TensorHandle> results(batch_size);
+    std::vector<OpInvocation> invocations;
+    invocations.reserve(batch_size);
+    for (int i = 0; i < batch_size; ++i) {
+      args[i][0] = a1.CopyRef();
+      args[i][1] = a1.CopyRef();
+      invocations.push_back(OpInvocation{string_view{}, exec_ctx, args[i],
+                                         empty_attrs_ref, results[i],
+                                         /*chain=*/nullptr});
+    }
+    op.ExecuteBatch(invocations, parallel);
+  }
+  driver.WaitForHostContextQuiesce();
+
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+BENCHMARK(BM_EagerAddBatch)
+    ->ArgPair(/*batch_size=*/16, /*parallel=*/0)
+    ->ArgPair(/*batch_size=*/256, /*parallel=*/0)
+    ->ArgPair(/*batch_size=*/256, /*parallel=*/1);
+
+// Executes `chain_length` add and relu pairs on 1M element tensors, with the
+// lazy fusion enabled or disabled.
+void BM_EagerElementwiseChain(benchmark::State& state) {
+  example::CoreRuntimeCpuDriver driver;
+  auto exec_ctx = driver.CreateExecutionContext(__FILE__, __LINE__);
+
+  constexpr Index kNumElements = 1 << 20;
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{kNumElements});
+  attrs.SetArray("values", tfrt::ArrayRef<float>{-0.5f});
+  tfrt::TensorHandle a;
+  driver.Execute(exec_ctx, "tfrt_test.create_dense_tensor", {}, attrs.freeze(),
+                 a);
+  driver.WaitForHostContextQuiesce();
+
+  const int chain_length = state.range(0);
+  driver.SetLazyFusion(state.range(1));
+  auto device = a.GetAvailableDevice().CopyRef();
+  tfrt::OpAttrs empty_attrs;
+  tfrt::OpAttrsRef empty_attrs_ref = empty_attrs.freeze();
+
+  for (auto _ : state) {
+    tfrt::TensorHandle x = a.CopyRef();
+    for (int i = 0; i < chain_length; ++i) {
+      tfrt::TensorHandle add_args[2] = {std::move(x), a.CopyRef()};
+      tfrt::TensorHandle sum;
+      driver.Execute(exec_ctx, "tfrt_test.add", add_args, empty_attrs_ref,
+                     sum);
+      driver.Execute(exec_ctx, "tfrt_test.relu", sum, empty_attrs_ref, x);
+    }
+    tfrt::TensorHandle result =
+        x.TransferTo(exec_ctx, device.CopyRef(), DenseHostTensor::kTensorType);
+    driver.WaitForHostContextQuiesce();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kNumElements);
+}
+BENCHMARK(BM_EagerElementwiseChain)
+    ->ArgPair(/*chain_length=*/3, /*lazy=*/0)
+    ->ArgPair(/*chain_length=*/3, /*lazy=*/1)
+    ->ArgPair(/*chain_length=*/5, /*lazy=*/0)
+    ->ArgPair(/*chain_length=*/5, /*lazy=*/1);
+
 }  // namespace
 }  // namespace tfrt
@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -219,6 +220,71 @@ TEST(OpAttrsTest, ArrayAsserting) {
   ASSERT_EQ(op_attrs_ref.GetArrayAsserting<int32_t>("bar"), empty_ref);
 }
 
+TEST(OpAttrsTest, FrozenLookup) {
+  OpAttrs op_attrs;
+  for (int i = 0; i < 26; ++i) {
+    ASSERT_TRUE(op_attrs.Set<int32_t>(std::string(1, 'z' - i), i));
+  }
+
+  OpAttrsRef frozen_attrs = op_attrs.freeze();
+  for (int i = 0; i < 26; ++i) {
+    ASSERT_EQ(frozen_attrs.GetAsserting<int32_t>(std::string(1, 'z' - i)), i);
+  }
+  ASSERT_EQ(frozen_attrs.GetRaw("A"), nullptr);
+  ASSERT_EQ(frozen_attrs.GetRaw("aa"), nullptr);
+  ASSERT_EQ(frozen_attrs.GetRaw("~"), nullptr);
+}
+
+TEST(OpAttrsTest, FreezeInternsIdenticalSets) {
+  int32_t values[3] = {1, 2, 3};
+
+  OpAttrs attrs1;
+  ASSERT_TRUE(attrs1.Set<bool>("transpose", false));
+  ASSERT_TRUE(attrs1.SetArray<int32_t>("values", values));
+
+  // Same attributes set in the different order.
+  OpAttrs attrs2;
+  ASSERT_TRUE(attrs2.SetArray<int32_t>("values", values));
+  ASSERT_TRUE(attrs2.Set<bool>("transpose", false));
+
+  OpAttrsRef frozen1 = attrs1.freeze();
+  OpAttrsRef frozen2 = attrs2.freeze();
+
+  ASSERT_EQ(frozen1.GetHash(), frozen2.GetHash());
+  ASSERT_EQ(frozen1.GetHash(), OpAttrsRef(attrs1).GetHash());
+  ASSERT_TRUE(frozen1.IsEqual(frozen2));
+  ASSERT_TRUE(frozen1.IsEqual(OpAttrsRef(attrs2)));
+
+  // Both frozen sets refer to the same interned copy.
+  ASSERT_EQ(frozen1.GetRaw("values"), frozen2.GetRaw("values"));
+
+  OpAttrs attrs3;
+  ASSERT_TRUE(attrs3.Set<bool>("transpose", true));
+  ASSERT_TRUE(attrs3.SetArray<int32_t>("values", values));
+
+  OpAttrsRef frozen3 = attrs3.freeze();
+  ASSERT_FALSE(frozen1.IsEqual(frozen3));
+  ASSERT_FALSE(frozen1.IsEqual(OpAttrsRef()));
+}
+
+TEST(OpAttrsTest, FreezeDoesNotInternExternalArrays) {
+  int32_t values[3] = {1, 2, 3};
+
+  OpAttrs attrs1;
+  ASSERT_TRUE(attrs1.SetArray<int32_t>("values", values));
+
+  OpAttrs attrs2;
+  ASSERT_TRUE(attrs2.SetArrayExternal<int32_t>("values", values));
+
+  OpAttrsRef frozen1 = attrs1.freeze();
+  OpAttrsRef frozen2 = attrs2.freeze();
+
+  // External arrays are not copied, and the frozen set is not shared.
+  ASSERT_EQ(frozen2.GetRaw("values")->GetData(), values);
+  ASSERT_NE(frozen1.GetRaw("values"), frozen2.GetRaw("values"));
+  ASSERT_TRUE(frozen1.IsEqual(frozen2));
+}
+
 void BM_OpAttrSetBool(benchmark::State& state) {
   for (auto _ : state) {
     tfrt::OpAttrs attrs;
@@ -294,5 +360,30 @@ void BM_OpAttrGetRankedShape(benchmark::State& state) {
 }
 BENCHMARK(BM_OpAttrGetRankedShape);
 
+void BM_OpAttrFreeze(benchmark::State& state) {
+  int32_t values[4] = {1, 2, 3, 4};
+  for (auto _ : state) {
+    tfrt::OpAttrs attrs;
+    attrs.Set<bool>("transpose_a", false);
+    attrs.Set<bool>("transpose_b", false);
+    attrs.SetArray<int32_t>("values", values);
+    benchmark::DoNotOptimize(attrs.freeze());
+  }
+}
+BENCHMARK(BM_OpAttrFreeze);
+
+void BM_OpAttrFrozenGet(benchmark::State& state) {
+  tfrt::OpAttrs attrs;
+  for (int i = 0; i < state.range(0); ++i) {
+    attrs.Set<int32_t>(std::to_string(i), i);
+  }
+  tfrt::OpAttrsRef frozen_attrs = attrs.freeze();
+  std::string last = std::to_string(state.range(0) - 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(frozen_attrs.GetAsserting<int32_t>(last));
+  }
+}
+BENCHMARK(BM_OpAttrFrozenGet)->Arg(4)->Arg(16)->Arg(64);
+
 }  // namespace
 }  // namespace tfrt
@@ -16,16 +16,31 @@
 
 #include "tfrt/core_runtime/op_handler.h"
 
+#include <atomic>
+#include <fstream>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/logging_op_handler.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 #include "tfrt/cpu/core_runtime/null_op_handler.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/btf_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
 
 namespace tfrt {
 namespace {
@@ -40,6 +55,49 @@ class DummyOpHandler : public OpHandler {
   }
 };
 
+// Counts the single and batch invocations of its ops.
+class BatchCountingOpHandler : public OpHandler {
+ public:
+  explicit BatchCountingOpHandler(CoreRuntime* runtime)
+      : OpHandler("batch_counting", runtime, /*fallback=*/nullptr) {}
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
+    return CoreRuntimeOp(
+        [this](const OpInvocation& invocation) { ++num_invocations; },
+        [this](ArrayRef<OpInvocation> invocations, bool parallel) {
+          ++num_batches;
+        },
+        /*is_fallback=*/false, /*device=*/{});
+  }
+
+  int num_invocations = 0;
+  int num_batches = 0;
+};
+
+// Counts the ops it prepares and their invocations. The ops record the
+// version of the op handler they were prepared by.
+class PrepareCountingOpHandler : public OpHandler {
+ public:
+  explicit PrepareCountingOpHandler(CoreRuntime* runtime)
+      : OpHandler("prepare_counting", runtime, /*fallback=*/nullptr) {}
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
+    ++num_prepared;
+    return CoreRuntimeOp(
+        [this, prepared_version = version.load()](
+            const OpInvocation& invocation) {
+          ++num_invocations;
+          last_version = prepared_version;
+        },
+        /*is_fallback=*/false, /*device=*/{});
+  }
+
+  std::atomic<int> version{0};
+  std::atomic<int> num_prepared{0};
+  std::atomic<int> num_invocations{0};
+  std::atomic<int> last_version{-1};
+};
+
 static std::unique_ptr<CoreRuntime> CreateCoreRuntime() {
   constexpr const char* kCpuOpHandlerName = "cpu";
   auto diag_handler = [](const DecodedDiagnostic& diag) {
@@ -85,5 +143,213 @@ TEST(OpHandlerTest, Registration) {
   ASSERT_EQ(core_runtime->GetOpHandler(chain_name), chain_root);
   ASSERT_FALSE(core_runtime->GetOpHandler(op_handler_name));
 }
+
+TEST(OpHandlerTest, MakeOpKeepsBatchFunction) {
+  auto core_runtime = CreateCoreRuntime();
+  auto* host = core_runtime->GetHostContext();
+  auto exec_ctx = ExecutionContext(
+      *RequestContextBuilder(host, /*resource_context=*/nullptr).build());
+
+  BatchCountingOpHandler op_handler(core_runtime.get());
+  // The op is wrapped with a trace scope when tracing is enabled, the wrapper
+  // must still execute batches with the batch function.
+  auto op = core_runtime->MakeOp("test.op", &op_handler);
+  ASSERT_TRUE(!!op);
+
+  OpAttrs attrs;
+  OpAttrsRef attrs_ref = attrs.freeze();
+  AsyncValueRef<Chain> chains[3];
+  std::vector<OpInvocation> invocations;
+  for (auto& chain : chains) {
+    invocations.push_back(
+        OpInvocation{string_view{}, exec_ctx, {}, attrs_ref, {}, &chain});
+  }
+
+  op->ExecuteBatch(invocations);
+  EXPECT_EQ(op_handler.num_batches, 1);
+  EXPECT_EQ(op_handler.num_invocations, 0);
+
+  (*op)(invocations[0]);
+  EXPECT_EQ(op_handler.num_batches, 1);
+  EXPECT_EQ(op_handler.num_invocations, 1);
+}
+
+TEST(OpHandlerTest, ExecuteReusesPreparedOps) {
+  auto core_runtime = CreateCoreRuntime();
+  auto* host = core_runtime->GetHostContext();
+  auto exec_ctx = ExecutionContext(
+      *RequestContextBuilder(host, /*resource_context=*/nullptr).build());
+
+  PrepareCountingOpHandler op_handler0(core_runtime.get());
+  PrepareCountingOpHandler op_handler1(core_runtime.get());
+  OpAttrs attrs;
+  OpAttrsRef attrs_ref = attrs.freeze();
+  auto execute = [&](string_view op_name, OpHandler* op_handler) {
+    core_runtime->Execute(exec_ctx, op_name, op_handler, {}, attrs_ref, {},
+                          /*chain=*/nullptr);
+  };
+
+  for (int i = 0; i < 3; ++i) execute("test.op0", &op_handler0);
+  EXPECT_EQ(op_handler0.num_prepared, 1);
+  EXPECT_EQ(op_handler0.num_invocations, 3);
+
+  // The ops are cached per op name and op handler.
+  execute("test.op1", &op_handler0);
+  EXPECT_EQ(op_handler0.num_prepared, 2);
+  execute("test.op0", &op_handler1);
+  EXPECT_EQ(op_handler1.num_prepared, 1);
+  execute("test.op0", &op_handler0);
+  execute("test.op1", &op_handler0);
+  EXPECT_EQ(op_handler0.num_prepared, 2);
+  EXPECT_EQ(op_handler0.num_invocations, 6);
+}
+
+TEST(OpHandlerTest, RegistrationInvalidatesPreparedOps) {
+  auto core_runtime = CreateCoreRuntime();
+  auto* host = core_runtime->GetHostContext();
+  auto exec_ctx = ExecutionContext(
+      *RequestContextBuilder(host, /*resource_context=*/nullptr).build());
+
+  auto op_handler =
+      std::make_unique<PrepareCountingOpHandler>(core_runtime.get());
+  auto* op_handler_ptr = op_handler.get();
+  OpAttrs attrs;
+  OpAttrsRef attrs_ref = attrs.freeze();
+  auto execute = [&]() {
+    core_runtime->Execute(exec_ctx, "test.op", op_handler_ptr, {}, attrs_ref,
+                          {}, /*chain=*/nullptr);
+  };
+
+  execute();
+  EXPECT_EQ(op_handler_ptr->last_version, 0);
+
+  // The cached op is executed until an op handler is registered.
+  op_handler_ptr->version = 1;
+  execute();
+  EXPECT_EQ(op_handler_ptr->num_prepared, 1);
+  EXPECT_EQ(op_handler_ptr->last_version, 0);
+
+  core_runtime->RegisterOpHandler("prepare_counting", op_handler_ptr);
+  execute();
+  EXPECT_EQ(op_handler_ptr->num_prepared, 2);
+  EXPECT_EQ(op_handler_ptr->last_version, 1);
+
+  op_handler_ptr->version = 2;
+  core_runtime->TakeOpHandler(std::move(op_handler));
+  execute();
+  EXPECT_EQ(op_handler_ptr->num_prepared, 3);
+  EXPECT_EQ(op_handler_ptr->last_version, 2);
+  EXPECT_EQ(op_handler_ptr->num_invocations, 4);
+}
+
+TEST(OpHandlerTest, ConcurrentExecuteAndRegistration) {
+  auto core_runtime = CreateCoreRuntime();
+  auto* host = core_runtime->GetHostContext();
+  auto exec_ctx = ExecutionContext(
+      *RequestContextBuilder(host, /*resource_context=*/nullptr).build());
+
+  PrepareCountingOpHandler op_handler(core_runtime.get());
+  OpAttrs attrs;
+  OpAttrsRef attrs_ref = attrs.freeze();
+
+  constexpr int kNumThreads = 4;
+  constexpr int kNumExecutions = 1000;
+  constexpr int kNumRegistrations = 100;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i] {
+      std::string op_names[] = {StrCat("test.op", i), "test.shared_op"};
+      for (int j = 0; j < kNumExecutions; ++j) {
+        core_runtime->Execute(exec_ctx, op_names[j % 2], &op_handler, {},
+                              attrs_ref, {}, /*chain=*/nullptr);
+      }
+    });
+  }
+  // Every registration drops the prepared ops while they are executed.
+  for (int i = 0; i < kNumRegistrations; ++i) {
+    core_runtime->RegisterOpHandler(StrCat("prepare_counting", i),
+                                    &op_handler);
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(op_handler.num_invocations, kNumThreads * kNumExecutions);
+  EXPECT_GE(op_handler.num_prepared, kNumThreads + 1);
+  EXPECT_LE(op_handler.num_prepared, kNumThreads * kNumExecutions);
+}
+
+TEST(OpHandlerTest, SamplingLoggingDumpsTensorsToBTF) {
+  auto core_runtime = CreateCoreRuntime();
+  auto* host = core_runtime->GetHostContext();
+  auto exec_ctx = ExecutionContext(
+      *RequestContextBuilder(host, /*resource_context=*/nullptr).build());
+
+  // Samples the even invocations, and all the invocations of tfrt_test.add.
+  LoggingSamplingOptions options;
+  options.sample_every_n = 2;
+  options.op_names = {"tfrt_test.add"};
+  options.dump_prefix = StrCat(testing::TempDir(), "/sampling_");
+  auto op_handler = CreateSamplingLoggingOpHandler(
+      core_runtime.get(), core_runtime->GetOpHandler("cpu"), options);
+  ASSERT_TRUE(!!op_handler);
+
+  auto execute = [&](string_view op_name, MutableArrayRef<TensorHandle> args,
+                     const OpAttrsRef& attrs, TensorHandle& result) {
+    core_runtime->Execute(exec_ctx, op_name, *op_handler, args, attrs, result,
+                          /*chain=*/nullptr);
+  };
+
+  OpAttrs attrs;
+  attrs.SetArray("shape", ArrayRef<Index>{2});
+  attrs.SetArray("values", ArrayRef<int32_t>{1, 2});
+  TensorHandle a;
+  execute("tfrt_test.create_dense_tensor", {}, attrs.freeze(), a);
+
+  // Not sampled.
+  TensorHandle b_arg = a.CopyRef();
+  TensorHandle b;
+  execute("tfrt_test.identity", b_arg, OpAttrs().freeze(), b);
+
+  // Sampled, as both an even invocation and a tfrt_test.add invocation.
+  TensorHandle c_args[2] = {a.CopyRef(), b.CopyRef()};
+  TensorHandle c;
+  execute("tfrt_test.add", c_args, OpAttrs().freeze(), c);
+
+  // Sampled as a tfrt_test.add invocation.
+  TensorHandle d_args[2] = {c.CopyRef(), c.CopyRef()};
+  TensorHandle d;
+  execute("tfrt_test.add", d_args, OpAttrs().freeze(), d);
+
+  host->Quiesce();
+
+  auto read_btf_file = [&](int id_number, string_view op_name) {
+    std::ifstream stream(
+        StrCat(options.dump_prefix, "op_", id_number, "_", op_name, ".btf"),
+        std::ios::binary);
+    EXPECT_TRUE(stream.good());
+    std::vector<std::vector<int32_t>> tensors;
+    auto offsets = ReadBTFOffsets(&stream);
+    EXPECT_TRUE(!!offsets);
+    if (!offsets) return tensors;
+    for (uint64_t offset : *offsets) {
+      auto dht = ReadDHTFromBTF(&stream, offset, host);
+      EXPECT_TRUE(!!dht);
+      if (!dht) return tensors;
+      auto elements = DHTArrayView<int32_t>(&*dht).Elements();
+      tensors.emplace_back(elements.begin(), elements.end());
+    }
+    return tensors;
+  };
+
+  using Tensors = std::vector<std::vector<int32_t>>;
+  EXPECT_EQ(read_btf_file(0, "tfrt_test.create_dense_tensor"),
+            Tensors({{1, 2}}));
+  std::ifstream not_sampled(
+      StrCat(options.dump_prefix, "op_1_tfrt_test.identity.btf"));
+  EXPECT_FALSE(not_sampled.good());
+  EXPECT_EQ(read_btf_file(2, "tfrt_test.add"),
+            Tensors({{1, 2}, {1, 2}, {2, 4}}));
+  EXPECT_EQ(read_btf_file(3, "tfrt_test.add"),
+            Tensors({{2, 4}, {2, 4}, {4, 8}}));
+}
 }  // namespace
 }  // namespace tfrt
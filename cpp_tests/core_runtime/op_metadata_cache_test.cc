@@ -0,0 +1,198 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file has unit tests for tfrt::OpMetadataCache.
+
+#include "tfrt/core_runtime/op_metadata_cache.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace {
+
+// The cache never calls the metadata functions, they only identify the op.
+RCReference<AsyncValue> IdentityMd(const ExecutionContext& exec_ctx,
+                                   ArrayRef<TensorMetadata> inputs,
+                                   const OpAttrsRef& attrs,
+                                   MutableArrayRef<TensorMetadata> results) {
+  return {};
+}
+
+RCReference<AsyncValue> OtherMd(const ExecutionContext& exec_ctx,
+                                ArrayRef<TensorMetadata> inputs,
+                                const OpAttrsRef& attrs,
+                                MutableArrayRef<TensorMetadata> results) {
+  return {};
+}
+
+TensorMetadata MakeMetadata(ArrayRef<Index> dims) {
+  return TensorMetadata(DType(DType::F32), dims);
+}
+
+TEST(OpMetadataCacheTest, MissThenHit) {
+  OpMetadataCache cache(64);
+  TensorMetadata input = MakeMetadata({2, 3});
+  TensorMetadata expected = MakeMetadata({3, 2});
+
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.Set<int32_t>("axis", 1));
+  OpAttrsRef attrs_ref(attrs);
+
+  TensorMetadata result;
+  EXPECT_FALSE(cache.Lookup(IdentityMd, input, attrs_ref, result));
+  cache.Insert(IdentityMd, input, attrs_ref, expected);
+  ASSERT_TRUE(cache.Lookup(IdentityMd, input, attrs_ref, result));
+  EXPECT_EQ(result, expected);
+
+  OpMetadataCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 0);
+  EXPECT_DOUBLE_EQ(stats.HitRate(), 0.5);
+}
+
+TEST(OpMetadataCacheTest, KeyDependsOnInputsAttrsAndFunction) {
+  OpMetadataCache cache(64);
+  TensorMetadata input = MakeMetadata({2, 3});
+
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.Set<int32_t>("axis", 1));
+  OpAttrsRef attrs_ref(attrs);
+  cache.Insert(IdentityMd, input, attrs_ref, input);
+
+  TensorMetadata result;
+  EXPECT_FALSE(cache.Lookup(IdentityMd, MakeMetadata({2, 4}), attrs_ref,
+                            result));
+  EXPECT_FALSE(cache.Lookup(IdentityMd, MakeMetadata({2, 3, 1}), attrs_ref,
+                            result));
+  EXPECT_FALSE(cache.Lookup(
+      IdentityMd, TensorMetadata(DType(DType::I32), input.shape), attrs_ref,
+      result));
+  EXPECT_FALSE(cache.Lookup(OtherMd, input, attrs_ref, result));
+
+  OpAttrs other_attrs;
+  ASSERT_TRUE(other_attrs.Set<int32_t>("axis", 0));
+  EXPECT_FALSE(
+      cache.Lookup(IdentityMd, input, OpAttrsRef(other_attrs), result));
+
+  EXPECT_TRUE(cache.Lookup(IdentityMd, input, attrs_ref, result));
+}
+
+TEST(OpMetadataCacheTest, AttrsOrderDoesNotMatter) {
+  OpMetadataCache cache(64);
+  TensorMetadata input = MakeMetadata({4});
+
+  OpAttrs attrs1;
+  ASSERT_TRUE(attrs1.Set<int32_t>("a", 1));
+  ASSERT_TRUE(attrs1.Set<float>("b", 2.0f));
+  cache.Insert(IdentityMd, input, OpAttrsRef(attrs1), input);
+
+  OpAttrs attrs2;
+  ASSERT_TRUE(attrs2.Set<float>("b", 2.0f));
+  ASSERT_TRUE(attrs2.Set<int32_t>("a", 1));
+  TensorMetadata result;
+  EXPECT_TRUE(cache.Lookup(IdentityMd, input, OpAttrsRef(attrs2), result));
+  EXPECT_TRUE(cache.Lookup(IdentityMd, input, attrs2.freeze(), result));
+}
+
+TEST(OpMetadataCacheTest, KeyIsUsedForLookupAndInsert) {
+  OpMetadataCache cache(64);
+  TensorMetadata input = MakeMetadata({2, 3});
+
+  {
+    // The cache keeps its own copy of the attributes.
+    OpAttrs attrs;
+    ASSERT_TRUE(attrs.Set<int32_t>("axis", 1));
+    OpAttrsRef attrs_ref(attrs);
+    OpMetadataCache::Key key(IdentityMd, input, attrs_ref);
+    ASSERT_TRUE(key.IsCacheable());
+
+    TensorMetadata result;
+    EXPECT_FALSE(cache.Lookup(key, attrs_ref, result));
+    cache.Insert(key, attrs_ref, input);
+    EXPECT_TRUE(cache.Lookup(key, attrs_ref, result));
+  }
+
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.Set<int32_t>("axis", 1));
+  TensorMetadata result;
+  EXPECT_TRUE(cache.Lookup(IdentityMd, input, OpAttrsRef(attrs), result));
+  EXPECT_EQ(result, input);
+}
+
+TEST(OpMetadataCacheTest, GlobalCanBeDisabled) {
+  EXPECT_TRUE(OpMetadataCache::IsGlobalEnabled());
+  OpMetadataCache::SetGlobalEnabled(false);
+  EXPECT_FALSE(OpMetadataCache::IsGlobalEnabled());
+  OpMetadataCache::SetGlobalEnabled(true);
+  EXPECT_TRUE(OpMetadataCache::IsGlobalEnabled());
+}
+
+TEST(OpMetadataCacheTest, LargeAttrsAreNotCached) {
+  OpMetadataCache cache(64);
+  TensorMetadata input = MakeMetadata({4});
+
+  std::vector<int64_t> values(1024);
+  OpAttrs attrs;
+  ASSERT_TRUE(attrs.SetArray<int64_t>("values", values));
+  OpAttrsRef attrs_ref(attrs);
+  EXPECT_FALSE(
+      OpMetadataCache::Key(IdentityMd, input, attrs_ref).IsCacheable());
+  cache.Insert(IdentityMd, input, attrs_ref, input);
+
+  TensorMetadata result;
+  EXPECT_FALSE(cache.Lookup(IdentityMd, input, attrs_ref, result));
+  EXPECT_EQ(cache.GetStats().misses, 0);
+}
+
+TEST(OpMetadataCacheTest, EvictsLeastRecentlyUsed) {
+  // One entry per shard.
+  OpMetadataCache cache(16);
+  OpAttrsRef attrs_ref;
+
+  constexpr int kNumEntries = 100;
+  for (int i = 0; i < kNumEntries; ++i) {
+    TensorMetadata input = MakeMetadata({i});
+    cache.Insert(IdentityMd, input, attrs_ref, input);
+  }
+  EXPECT_GE(cache.GetStats().evictions, kNumEntries - 16);
+
+  // The most recently inserted entry is never evicted.
+  TensorMetadata result;
+  EXPECT_TRUE(cache.Lookup(IdentityMd, MakeMetadata({kNumEntries - 1}),
+                           attrs_ref, result));
+  EXPECT_EQ(result, MakeMetadata({kNumEntries - 1}));
+
+  int num_cached = 0;
+  for (int i = 0; i < kNumEntries; ++i) {
+    if (cache.Lookup(IdentityMd, MakeMetadata({i}), attrs_ref, result))
+      ++num_cached;
+  }
+  EXPECT_LE(num_cached, 16);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Lookup(IdentityMd, MakeMetadata({kNumEntries - 1}),
+                            attrs_ref, result));
+}
+
+}  // namespace
+}  // namespace tfrt
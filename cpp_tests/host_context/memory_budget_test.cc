@@ -0,0 +1,145 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for TFRT MemoryBudget.
+
+#include "tfrt/host_context/memory_budget.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+TEST(MemoryBudgetTest, ChargeAndRelease) {
+  MemoryBudget budget(/*limit_bytes=*/100);
+  EXPECT_FALSE(budget.IsExceeded());
+
+  budget.Charge(60);
+  budget.Charge(60);
+  EXPECT_TRUE(budget.IsExceeded());
+  EXPECT_EQ(budget.outstanding_bytes(), 120);
+
+  budget.Release(60);
+  EXPECT_FALSE(budget.IsExceeded());
+  EXPECT_EQ(budget.outstanding_bytes(), 60);
+  EXPECT_EQ(budget.peak_bytes(), 120);
+
+  budget.ResetPeak();
+  EXPECT_EQ(budget.peak_bytes(), 60);
+}
+
+TEST(MemoryBudgetTest, Allocator) {
+  MemoryBudget budget(/*limit_bytes=*/1024);
+  auto allocator = CreateMemoryBudgetAllocator(CreateMallocAllocator());
+
+  void* ptr0;
+  void* ptr1;
+  {
+    MemoryBudget::Scope scope(&budget);
+    EXPECT_EQ(MemoryBudget::Current(), &budget);
+    ptr0 = allocator->AllocateBytes(512, 64);
+    ptr1 = allocator->AllocateBytes(1024, 256);
+  }
+  EXPECT_EQ(MemoryBudget::Current(), nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr0) % 64, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr1) % 256, 0);
+  EXPECT_EQ(budget.outstanding_bytes(), 1536);
+  EXPECT_TRUE(budget.IsExceeded());
+
+  // Allocations without a budget are not charged.
+  void* ptr2 = allocator->AllocateBytes(4096, 8);
+  EXPECT_EQ(budget.outstanding_bytes(), 1536);
+
+  // Deallocations release the charged budget, whatever the current budget.
+  allocator->DeallocateBytes(ptr1, 1024);
+  EXPECT_FALSE(budget.IsExceeded());
+  allocator->DeallocateBytes(ptr0, 512);
+  allocator->DeallocateBytes(ptr2, 4096);
+  EXPECT_EQ(budget.outstanding_bytes(), 0);
+  EXPECT_EQ(budget.peak_bytes(), 1536);
+}
+
+TEST(MemoryBudgetTest, ConcurrentRequests) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {},
+      CreateMemoryBudgetAllocator(CreateMallocAllocator()),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/4,
+                                   /*num_blocking_threads=*/1));
+  ResourceContext resource_context;
+
+  // Both requests allocate concurrently on the same threads, and each one is
+  // charged to its own budget.
+  constexpr int kNumAllocations = 64;
+  MemoryBudget budgets[2] = {MemoryBudget(/*limit_bytes=*/1024),
+                             MemoryBudget(/*limit_bytes=*/1 << 20)};
+  const size_t sizes[2] = {32, 1024};
+  void* ptrs[2][kNumAllocations];
+
+  for (int i = 0; i < kNumAllocations; ++i) {
+    for (int r = 0; r < 2; ++r) {
+      auto req_ctx = RequestContextBuilder(host.get(), &resource_context)
+                         .set_memory_budget(&budgets[r])
+                         .build();
+      ASSERT_FALSE(!req_ctx);
+      ExecutionContext exec_ctx(std::move(*req_ctx));
+      EnqueueWork(exec_ctx, [&, i, r] {
+        ptrs[r][i] = host->AllocateBytes(sizes[r], alignof(std::max_align_t));
+      });
+    }
+  }
+  host->Quiesce();
+
+  EXPECT_EQ(budgets[0].outstanding_bytes(), kNumAllocations * sizes[0]);
+  EXPECT_EQ(budgets[1].outstanding_bytes(), kNumAllocations * sizes[1]);
+  EXPECT_TRUE(budgets[0].IsExceeded());
+  EXPECT_FALSE(budgets[1].IsExceeded());
+
+  for (int r = 0; r < 2; ++r) {
+    for (void* ptr : ptrs[r]) host->DeallocateBytes(ptr, sizes[r]);
+    EXPECT_EQ(budgets[r].outstanding_bytes(), 0);
+  }
+}
+
+TEST(MemoryBudgetTest, RequestContext) {
+  MemoryBudget budget(/*limit_bytes=*/1024);
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {},
+      CreateMemoryBudgetAllocator(CreateMallocAllocator()),
+      CreateSingleThreadedWorkQueue());
+  ResourceContext resource_context;
+
+  auto req_ctx = RequestContextBuilder(host.get(), &resource_context)
+                     .set_memory_budget(&budget)
+                     .build();
+  ASSERT_FALSE(!req_ctx);
+  ExecutionContext exec_ctx(std::move(*req_ctx));
+  EXPECT_EQ(exec_ctx.memory_budget(), &budget);
+
+  auto no_budget_ctx =
+      RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!no_budget_ctx);
+  EXPECT_EQ(no_budget_ctx.get()->memory_budget(), nullptr);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -19,6 +19,7 @@
 #include "tfrt/host_context/parallel_for.h"
 
 #include <chrono>
+#include <string>
 #include <thread>
 #include <utility>
 
@@ -102,6 +103,60 @@ TEST(ParallelForTest, MinBlockSize) {
   ASSERT_EQ(ranges, expected);
 }
 
+TEST(ParallelForTest, CheapCostExecutesInline) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  std::vector<Range> ranges;
+  std::thread::id caller = std::this_thread::get_id();
+  std::thread::id executor;
+
+  AsyncValueRef<Chain> done = pfor.Execute(
+      1000, BlockSizes::Cost(/*bytes_loaded=*/4, /*bytes_stored=*/4,
+                             /*compute_cycles=*/1),
+      [&](size_t begin, size_t end) {
+        ranges.push_back({begin, end});
+        executor = std::this_thread::get_id();
+      });
+
+  // Cheap range must be executed as a single block in the caller thread.
+  ASSERT_TRUE(done.IsAvailable());
+  ASSERT_EQ(executor, caller);
+  const std::vector<Range> expected = {{0, 1000}};
+  ASSERT_EQ(ranges, expected);
+}
+
+TEST(ParallelForTest, ExpensiveCostSplitsIntoBlocks) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  latch barrier(1);
+  mutex mu;
+  std::vector<Range> ranges;
+
+  AsyncValueRef<Chain> done = pfor.Execute(
+      1000, BlockSizes::Cost(/*bytes_loaded=*/4, /*bytes_stored=*/4,
+                             /*compute_cycles=*/1000),
+      [&](size_t begin, size_t end) {
+        mutex_lock lock(mu);
+        ranges.push_back({begin, end});
+      });
+  done.AndThen([&]() { barrier.count_down(); });
+
+  barrier.wait();
+
+  // Expensive range is split into at most 4 blocks per worker thread.
+  ASSERT_EQ(ranges.size(), 16);
+
+  std::sort(ranges.begin(), ranges.end());
+  size_t next = 0;
+  for (const Range& range : ranges) {
+    ASSERT_EQ(range.first, next);
+    next = range.second;
+  }
+  ASSERT_EQ(next, 1000);
+}
+
 TEST(ParallelForTest, BlockTasksCompletion) {
   auto host = CreateTestHostContext(4);
   ParallelFor pfor(CreateTestExecutionContext(host.get()));
@@ -156,4 +211,52 @@ TEST(ParallelForTest, ExecuteNestedParallelism) {
   ASSERT_EQ(ranges, expected);
 }
 
+TEST(ParallelForTest, ReduceSum) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  AsyncValueRef<int64_t> sum = pfor.Reduce<int64_t>(
+      1000, BlockSizes::Fixed(7), 0,
+      [](size_t begin, size_t end) -> int64_t {
+        int64_t partial = 0;
+        for (size_t i = begin; i < end; ++i) partial += i;
+        return partial;
+      },
+      [](int64_t lhs, int64_t rhs) { return lhs + rhs; });
+
+  host->Await(sum.CopyRCRef());
+  ASSERT_EQ(sum.get(), 999 * 1000 / 2);
+}
+
+TEST(ParallelForTest, ReduceEmptyRange) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  AsyncValueRef<int64_t> sum = pfor.Reduce<int64_t>(
+      0, BlockSizes::Fixed(1), 42,
+      [](size_t begin, size_t end) -> int64_t { return 1; },
+      [](int64_t lhs, int64_t rhs) { return lhs + rhs; });
+
+  host->Await(sum.CopyRCRef());
+  ASSERT_EQ(sum.get(), 42);
+}
+
+TEST(ParallelForTest, ReducePreservesOrder) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  // String concatenation is not commutative, blocks must be combined in order.
+  AsyncValueRef<std::string> str = pfor.Reduce<std::string>(
+      26, BlockSizes::Fixed(3), "",
+      [](size_t begin, size_t end) -> std::string {
+        std::string partial;
+        for (size_t i = begin; i < end; ++i) partial.push_back('a' + i);
+        return partial;
+      },
+      [](std::string lhs, std::string rhs) { return lhs + rhs; });
+
+  host->Await(str.CopyRCRef());
+  ASSERT_EQ(str.get(), "abcdefghijklmnopqrstuvwxyz");
+}
+
 }  // namespace tfrt
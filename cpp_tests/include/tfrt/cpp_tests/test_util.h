@@ -18,8 +18,11 @@
 #ifndef TFRT_CPP_TESTS_TEST_UTIL_H_
 #define TFRT_CPP_TESTS_TEST_UTIL_H_
 
+#include "gtest/gtest.h"
 #include "tfrt/dtype/dtype.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
@@ -45,6 +48,22 @@ inline std::unique_ptr<HostContext> CreateHostContext() {
                                        std::move(work_queue));
 }
 
+// Creates a host context with a multi-threaded work queue for kernel tests and
+// benchmarks. The diagnostics are ignored, because the tests check the
+// returned errors.
+inline std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+inline ExecutionContext CreateTestExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  EXPECT_FALSE(!req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
 template <typename T>
 DenseHostTensor CreateDummyTensor(ArrayRef<Index> dims, HostContext* host_ctx) {
   const TensorMetadata metadata(GetDType<T>(), dims);
@@ -56,6 +75,26 @@ DenseHostTensor CreateDummyTensor(ArrayRef<Index> dims, HostContext* host_ctx) {
   return dht;
 }
 
+// Creates a tensor whose elements are set to `fill(i)`, where i is the row
+// major index of the element.
+template <typename T, typename F>
+DenseHostTensor CreateTestTensor(ArrayRef<Index> dims, F fill,
+                                 HostContext* host) {
+  auto tensor = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(GetDType<T>(), TensorShape(dims)), host);
+  MutableDHTArrayView<T> view(&*tensor);
+  for (size_t i = 0; i < view.NumElements(); ++i) view[i] = fill(i);
+  return std::move(*tensor);
+}
+
+// Creates a tensor with the elements i % 127, which are exactly representable
+// in all the numeric dtypes.
+template <typename T>
+DenseHostTensor CreateTestTensor(ArrayRef<Index> dims, HostContext* host) {
+  return CreateTestTensor<T>(
+      dims, [](size_t i) { return T(i % 127); }, host);
+}
+
 inline RCReference<HostBuffer> CreateHostBufferOnHeap(size_t byte_size) {
   std::unique_ptr<char[]> buf{new char[byte_size]};
   auto ptr = buf.get();
@@ -21,6 +21,8 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
@@ -129,6 +131,54 @@ TEST(TensorTest, CopyTo) {
   EXPECT_FALSE(CopyTo(a, &c));
 }
 
+TEST(TensorTest, ConvertDenseHostTensorSharesBuffer) {
+  auto context = CreateHostContext();
+  RegisterTensorConversionFns(context.get());
+  auto exec_ctx = CreateTestExecutionContext(context.get());
+
+  auto dht = DenseHostTensor::CreateUninitialized(
+                 TensorMetadata::Create<int>(3, 2), context.get())
+                 .value();
+  MutableDHTArrayView<int> view(&dht);
+  for (int i = 0; i < view.NumElements(); i++) view[i] = i;
+
+  auto result =
+      ConvertTensorOnHost(exec_ctx, dht, DenseHostTensor::kTensorType);
+  ASSERT_TRUE(result.IsAvailable());
+  EXPECT_EQ(result.GetAsyncValue()->get<DenseHostTensor>().data(), dht.data());
+
+  // The second row is not aligned for a DHT buffer, so it is copied.
+  auto row = Chip(dht, {1});
+  auto row_result =
+      ConvertTensorOnHost(exec_ctx, row, DenseHostTensor::kTensorType);
+  ASSERT_TRUE(row_result.IsAvailable());
+  auto& row_copy = row_result.GetAsyncValue()->get<DenseHostTensor>();
+  EXPECT_NE(row_copy.data(), row.data());
+  EXPECT_EQ(row_copy, row);
+}
+
+TEST(TensorTest, ConvertLargeUnalignedDenseHostTensor) {
+  auto context = CreateHostContext();
+  RegisterTensorConversionFns(context.get());
+  auto exec_ctx = CreateTestExecutionContext(context.get());
+
+  const Index num_columns = (1 << 19) + 1;
+  auto dht = DenseHostTensor::CreateUninitialized(
+                 TensorMetadata::Create<int>(2, num_columns), context.get())
+                 .value();
+  MutableDHTArrayView<int> view(&dht);
+  for (int i = 0; i < view.NumElements(); i++) view[i] = i;
+
+  auto row = Chip(dht, {1});
+  auto result =
+      ConvertTensorOnHost(exec_ctx, row, DenseHostTensor::kTensorType);
+  context->Await(result.CopyRCRef());
+  ASSERT_FALSE(result.IsError());
+  auto& copy = result.GetAsyncValue()->get<DenseHostTensor>();
+  EXPECT_NE(copy.data(), row.data());
+  EXPECT_EQ(copy, row);
+}
+
 TEST(TensorTest, FlattenScalar) {
   auto context = CreateHostContext();
   auto dht = DenseHostTensor::CreateScalar(1, context.get()).value();
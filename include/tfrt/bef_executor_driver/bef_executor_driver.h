@@ -28,6 +28,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/memory_budget.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -57,6 +58,9 @@ struct RunBefConfig {
   std::string work_queue_type;
   tfrt::HostAllocatorType host_allocator_type;
   bool print_error_code = false;
+  // If set, the requests of the default execution context are charged to this
+  // budget, and enable memory bounded scheduling with it. Not owned.
+  MemoryBudget* memory_budget = nullptr;
 };
 
 // Run the BEF program with default execution context.
@@ -108,6 +108,10 @@ class CoreRuntime final {
   // This Function must take TensorHandle as inputs and produce TensorHandle
   // as output. Right now the Function cannot have side effect since it cannot
   // handle chain properly.
+  //
+  // If the Function is a sync BEF function (tfrt.sync), it takes and returns
+  // no chains. It is executed inline by the BEF interpreter when all arguments
+  // are available, and when the last argument becomes available otherwise.
   Expected<CoreRuntimeOp> MakeCompositeOp(const Function* fn);
 
   // Similar to the above API, but this function takes and returns AsyncValues
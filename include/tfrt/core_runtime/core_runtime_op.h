@@ -43,6 +43,15 @@ class CoreRuntimeOp {
                 bool is_fallback, RCReference<Device> device,
                 TensorType arg_tensor_type = DenseHostTensor::kTensorType);
 
+  // Creates an op that executes batches of invocations with `batch_fn` instead
+  // of calling `fn` once for each invocation of the batch.
+  CoreRuntimeOp(
+      llvm::unique_function<void(const OpInvocation&) const>&& fn,
+      llvm::unique_function<void(ArrayRef<OpInvocation>, bool) const>&&
+          batch_fn,
+      bool is_fallback, RCReference<Device> device,
+      TensorType arg_tensor_type = DenseHostTensor::kTensorType);
+
   // Creates a "native function" in that it takes and returns AsyncValues of
   // any types, and not having to going through TensorHandle.
   explicit CoreRuntimeOp(
@@ -75,6 +84,16 @@ class CoreRuntimeOp {
 
   void operator()(const CompositeOpInvocation& invocation) const;
 
+  // Execute the prepared op once for each of `invocations`.
+  //
+  // This amortizes the per op dispatch overhead when the same op runs over many
+  // small inputs. The invocations must be independent, i.e. an invocation can
+  // not use the results of another invocation of the same batch. If `parallel`
+  // is true, the op handler may execute the invocations concurrently; their
+  // results and out chains are then resolved asynchronously.
+  void ExecuteBatch(ArrayRef<OpInvocation> invocations,
+                    bool parallel = false) const;
+
   explicit operator bool() const { return static_cast<bool>(fn_); }
 
   bool IsFallback() const { return is_fallback_; }
@@ -92,6 +111,9 @@ class CoreRuntimeOp {
   // llvm::unique_function::operator() is non-const for some reason.
   llvm::unique_function<void(const OpInvocation&) const> fn_;
   llvm::unique_function<void(const CompositeOpInvocation&) const> native_fn_;
+  // Optional, if not set the batches are executed by calling fn_ for each
+  // invocation.
+  llvm::unique_function<void(ArrayRef<OpInvocation>, bool) const> batch_fn_;
   bool is_fallback_;
 
   // The target device that the op requires the arguments to be placed on.
@@ -178,6 +178,8 @@ class AsyncOpDispatcher {
     return result_missing_md_avs_;
   }
 
+  // Runs the dispatch function of the op. If `chain` is not null, it is
+  // fulfilled with the out chain of the op, or set to it if it is empty.
   static void RunDispatchFunctionSync(
       typename OpHandlerTraits::OpEntryTy& op_entry,
       typename OpHandlerTraits::OpHandlerInfoTy op_handler_info,
@@ -309,7 +311,12 @@ template <typename OpHandlerTraits>
 
     // If this is a side effecting operation, propagate the error through the
     // result.
-    if (chain && *chain) chain->SetError(cancel_error->GetError());
+    if (chain) {
+      if (*chain)
+        chain->SetError(cancel_error->GetError());
+      else
+        *chain = AsyncValueRef<Chain>(FormRef(cancel_error));
+    }
     return;
   }
   // Finally, run the dispatch function.
@@ -324,20 +331,25 @@ template <typename OpHandlerTraits>
     OpHandlerTraits::Dispatch(op_entry, op_handler_info, arg_tensors, attrs,
                               result_mds, *results, &op_chain, exec_ctx);
   }
-  if (chain && *chain) {
+  if (chain) {
     assert(op_chain && "the op does not produce a required out chain.");
-    op_chain.AndThen(
-        [op_chain = op_chain.CopyRef(), chain = chain->CopyRef()]() {
-          if (op_chain.IsError()) {
-            chain.SetError(op_chain.GetError());
-          } else {
-            chain.emplace();
-          }
-        });
+    if (*chain) {
+      op_chain.AndThen(
+          [op_chain = op_chain.CopyRef(), chain = chain->CopyRef()]() {
+            if (op_chain.IsError()) {
+              chain.SetError(op_chain.GetError());
+            } else {
+              chain.emplace();
+            }
+          });
+    } else {
+      *chain = std::move(op_chain);
+    }
   }
 
   // result_missing_md_avs will be empty if there was a metadata function
-  // which already computed these results.
+  // which already computed these results, or if the caller reads the metadata
+  // from the results (see GetResultMetadataAsync).
   if (result_missing_md_avs.empty()) {
     return;
   }
@@ -358,6 +370,27 @@ template <typename OpHandlerTraits>
   }
 }
 
+// Returns the metadata of `result_tensor`, a result of an op without metadata
+// function, as an async value. Returns a null reference if the tensor is
+// concrete, in which case the TensorHandle can hold its metadata inline.
+inline AsyncValueRef<TensorMetadata> GetResultMetadataAsync(
+    AsyncValue* result_tensor) {
+  if (result_tensor->IsConcrete()) return AsyncValueRef<TensorMetadata>();
+  if (result_tensor->IsError())
+    return AsyncValueRef<TensorMetadata>(
+        MakeErrorAsyncValueRef(result_tensor->GetError()));
+
+  auto md = MakeUnconstructedAsyncValueRef<TensorMetadata>();
+  result_tensor->AndThen([md = md.CopyRef(), result_tensor]() mutable {
+    if (result_tensor->IsError()) {
+      md.SetError(result_tensor->GetError());
+    } else {
+      md.emplace(result_tensor->get<Tensor>().metadata());
+    }
+  });
+  return md;
+}
+
 // Execute the dispatch function for an op when the metadata for the results is
 // resolved (assuming there is a metadata function).  This fills in
 // result_tensor_avs with AsyncValues that are the futures of the result of the
@@ -370,7 +403,9 @@ template <typename OpHandlerTraits>
 //
 // If there is no shape function, then result_mds is empty, and result_md_avs
 // must be filled in with the AsyncValue's for the eventually computed shape
-// results of the tensor op.
+// results of the tensor op. If the op is dispatched synchronously, the entries
+// of the results that are already computed are null: their metadata is read
+// from the tensors instead, and no async value is allocated for it.
 template <typename OpHandlerTraits>
 void ExecuteWithResultMetadataResolved(
     const ExecutionContext& exec_ctx, MutableArrayRef<TensorHandle> arguments,
@@ -381,16 +416,6 @@ void ExecuteWithResultMetadataResolved(
     AsyncValueRef<Chain>* chain, bool update_chain,
     typename OpHandlerTraits::OpEntryTy op_entry,
     typename OpHandlerTraits::OpHandlerInfoTy op_handler_info) {
-  // If we have no input metadatas (from a metadata function) then we need to
-  // resolve the TensorHandle metadata's from the op results.
-  if (result_md_avs) {
-    result_md_avs->reserve(num_results);
-    for (size_t i = 0; i != num_results; ++i) {
-      result_md_avs->push_back(
-          MakeUnconstructedAsyncValueRef<TensorMetadata>());
-    }
-  }
-
   // Keep track of all the non-resolved values to see if we can dispatch the
   // kernel immediately. If not we will "and then" on these non-resolved values.
   llvm::SmallVector<AsyncValue*, 4> async_args;
@@ -400,13 +425,8 @@ void ExecuteWithResultMetadataResolved(
 
   assert((!update_chain || (chain && *chain)) &&
          "the op requires an in chain.");
-  if (chain && *chain) {
-    if (!chain->IsAvailable()) async_args.push_back(chain->GetAsyncValue());
-    if (update_chain) {
-      // TODO(fishx): Avoid this heap allocation.
-      *chain = MakeUnconstructedAsyncValueRef<Chain>();
-    }
-  }
+  if (chain && *chain && !chain->IsAvailable())
+    async_args.push_back(chain->GetAsyncValue());
 
   for (auto& argument : arguments) {
     AsyncValue* async_tensor = argument.GetAsyncTensor();
@@ -422,22 +442,39 @@ void ExecuteWithResultMetadataResolved(
 
   if (async_args.empty()) {
     // All input tensor and input chain are available. We can immediately
-    // dispatch the kernel synchronously.
+    // dispatch the kernel synchronously. The out chain is the chain produced
+    // by the op, and the result metadata are only allocated for the results
+    // that are not computed yet.
+    if (update_chain) *chain = AsyncValueRef<Chain>();
     llvm::SmallVector<RCReference<AsyncValue>, 4> result_tensors;
-    llvm::SmallVector<AsyncValueRef<TensorMetadata>, 0> empty_md_avs;
     internal::AsyncOpDispatcher<OpHandlerTraits>::RunDispatchFunctionSync(
         op_entry, op_handler_info, arg_tensors, attrs, num_results, result_mds,
-        result_md_avs ? *result_md_avs : empty_md_avs, &result_tensors,
+        /*result_missing_md_avs=*/{}, &result_tensors,
         update_chain ? chain : nullptr, exec_ctx);
     result_tensor_avs->reserve(num_results);
+    if (result_md_avs) result_md_avs->reserve(num_results);
     // Fulfill the result async values with the results of the op.
     for (size_t i = 0; i != num_results; ++i) {
+      if (result_md_avs) {
+        result_md_avs->push_back(
+            GetResultMetadataAsync(result_tensors[i].get()));
+      }
       result_tensor_avs->push_back(
           AsyncValueRef<Tensor>(std::move(result_tensors[i])));
     }
     return;
   }
 
+  // The out chain and the result metadata are fulfilled when the op runs.
+  if (update_chain) *chain = MakeUnconstructedAsyncValueRef<Chain>();
+  if (result_md_avs) {
+    result_md_avs->reserve(num_results);
+    for (size_t i = 0; i != num_results; ++i) {
+      result_md_avs->push_back(
+          MakeUnconstructedAsyncValueRef<TensorMetadata>());
+    }
+  }
+
   // We have at least one async tensor input, so we need to run the
   // kernel when it resolves.
   internal::AsyncOpDispatcher<OpHandlerTraits> op_dispatcher(
@@ -565,13 +602,22 @@ bool ExecuteOnOpHandlerImpl(
       results[i] = TensorHandle(
           std::move(result_device.get<AsyncValueRef<RCReference<Device>>>()),
           result_mds[i], std::move(result_tensor_avs[i]));
-    } else if (!op_entry.metadata_fn &&
-               result_device.is<RCReference<Device>>()) {
+    } else if (!result_md_avs[i] && result_device.is<RCReference<Device>>()) {
+      // The op has no metadata function, but its result is already computed.
+      results[i] =
+          TensorHandle(std::move(result_device.get<RCReference<Device>>()),
+                       result_tensor_avs[i]->metadata(),
+                       std::move(result_tensor_avs[i]));
+    } else if (!result_md_avs[i] &&
+               result_device.is<AsyncValueRef<RCReference<Device>>>()) {
+      results[i] = TensorHandle(
+          std::move(result_device.get<AsyncValueRef<RCReference<Device>>>()),
+          result_tensor_avs[i]->metadata(), std::move(result_tensor_avs[i]));
+    } else if (result_device.is<RCReference<Device>>()) {
       results[i] = TensorHandle(
           std::move(result_device.get<RCReference<Device>>()),
           std::move(result_md_avs[i]), std::move(result_tensor_avs[i]));
-    } else if (!op_entry.metadata_fn &&
-               result_device.is<AsyncValueRef<RCReference<Device>>>()) {
+    } else {
       results[i] = TensorHandle(
           std::move(result_device.get<AsyncValueRef<RCReference<Device>>>()),
           std::move(result_md_avs[i]), std::move(result_tensor_avs[i]));
@@ -19,6 +19,10 @@
 #ifndef TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
 #define TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -29,6 +33,28 @@ class CoreRuntime;
 llvm::Expected<tfrt::OpHandler*> CreateLoggingOpHandler(
     tfrt::CoreRuntime* runtime, OpHandler* fallback, bool sync_log_results);
 
+// Options for the sampling mode of the LoggingOpHandler.
+struct LoggingSamplingOptions {
+  // Samples one in every `sample_every_n` invocations. 0 samples none of them.
+  uint32_t sample_every_n = 0;
+  // Samples every invocation of these ops.
+  std::vector<std::string> op_names;
+  // The tensors of the sampled invocation with id N are written to the BTF
+  // file "<dump_prefix>op_<N>_<op name>.btf", inputs first.
+  std::string dump_prefix;
+  // Maximum number of sampled invocations waiting to be written. Invocations
+  // sampled while the queue is full are dropped.
+  int max_pending_samples = 16;
+};
+
+// Creates a LoggingOpHandler in sampling mode, which is cheap enough to stay
+// enabled in production. It does not print the invocations, and does not wait
+// for the tensors of the sampled invocations: they are captured by reference
+// and written by a blocking task once they are available.
+llvm::Expected<tfrt::OpHandler*> CreateSamplingLoggingOpHandler(
+    tfrt::CoreRuntime* runtime, OpHandler* fallback,
+    LoggingSamplingOptions options);
+
 }  // namespace tfrt
 
 #endif  // TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
@@ -390,7 +390,8 @@ class OpAttrs final {
 
   // Produce an immutable copy of this OpAttrs set on the heap and return a
   // reference to it.  This is the primary way to extend the lifetime of an
-  // attribute set.
+  // attribute set.  Freezing identical attribute sets returns references to
+  // the same interned copy, unless the set refers to external buffers.
   OpAttrsRef freeze() const;
 
   bool IsOutOfLine() const { return out_of_line_representation_ != nullptr; }
@@ -629,6 +630,16 @@ class OpAttrsRef {
   // Return a reference that is guaranteed stable on the heap.
   OpAttrsRef freeze() const;
 
+  // Return the structural hash of the attribute names, types and values. It is
+  // precomputed for frozen attribute sets, which makes it cheap enough to use
+  // attributes as cache keys.
+  size_t GetHash() const;
+
+  // Return true if both sets have the same attribute names, types and values.
+  // Frozen sets are interned unless they refer to external buffers, so this is
+  // a pointer comparison in the common case.
+  bool IsEqual(const OpAttrsRef& other) const;
+
   // Print the state of this attribute set, this is only intended for debugging.
   void Print(raw_ostream& os) const;
   void Dump() const;
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares OpMetadataCache, which memoizes the results of op
+// metadata functions.
+
+#ifndef TFRT_CORE_RUNTIME_OP_METADATA_CACHE_H_
+#define TFRT_CORE_RUNTIME_OP_METADATA_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <utility>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_metadata_function.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+// OpMetadataCache memoizes the result metadata computed by op metadata
+// functions. Metadata functions are pure functions of the input metadata and
+// the op attributes, so the results are cached per metadata function, keyed by
+// the input dtypes and shapes and by the structural hash of the attributes
+// (OpAttrsRef::GetHash, which is precomputed for frozen attributes). Cached
+// results keep a frozen copy of the attributes, which is compared on lookup so
+// that hash collisions are never reported as hits. Only successful results are
+// cached, errors are always reported by the metadata function.
+//
+// The cache is a bounded LRU, sharded by the key hash to reduce lock
+// contention. Ops with large attributes (e.g. dense constants) are not cached,
+// so that the cache does not keep large attribute copies alive.
+//
+// OpMetadataCache is thread-safe.
+class OpMetadataCache {
+ public:
+  // Lookups of the invocations that are not cached are not counted.
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+
+    double HitRate() const {
+      int64_t lookups = hits + misses;
+      return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+  };
+
+  // Key identifies an invocation of a metadata function. It is built once per
+  // invocation, and used both to look up the results and to insert them on a
+  // miss, together with the attributes it was built from.
+  class Key {
+   public:
+    Key(OpMetadataFn metadata_fn, ArrayRef<TensorMetadata> inputs,
+        const OpAttrsRef& attrs);
+
+    // Returns false if the invocation should not be cached.
+    bool IsCacheable() const { return cacheable_; }
+
+   private:
+    friend class OpMetadataCache;
+
+    // The metadata function, the input metadata and the attributes hash.
+    llvm::SmallString<128> bytes_;
+    bool cacheable_;
+  };
+
+  explicit OpMetadataCache(size_t capacity);
+
+  OpMetadataCache(const OpMetadataCache&) = delete;
+  OpMetadataCache& operator=(const OpMetadataCache&) = delete;
+
+  // Returns the cache used by the op dispatch (see dispatch_utils.h).
+  static OpMetadataCache& Global();
+
+  // Enables or disables the use of the Global cache by the op dispatch, which
+  // then always runs the metadata functions. It is enabled by default.
+  static void SetGlobalEnabled(bool enabled);
+  static bool IsGlobalEnabled();
+
+  // Fills in `results` and returns true if the results of the invocation
+  // identified by `key` and `attrs` are in the cache. `key` must be built from
+  // `attrs`.
+  bool Lookup(const Key& key, const OpAttrsRef& attrs,
+              MutableArrayRef<TensorMetadata> results);
+
+  // Adds the results of the invocation identified by `key` and `attrs` to the
+  // cache, evicting the least recently used results if it is full. `key` must
+  // be built from `attrs`.
+  void Insert(const Key& key, const OpAttrsRef& attrs,
+              ArrayRef<TensorMetadata> results);
+
+  // Same as above, for a single lookup or insert.
+  bool Lookup(OpMetadataFn metadata_fn, ArrayRef<TensorMetadata> inputs,
+              const OpAttrsRef& attrs,
+              MutableArrayRef<TensorMetadata> results) {
+    return Lookup(Key(metadata_fn, inputs, attrs), attrs, results);
+  }
+  void Insert(OpMetadataFn metadata_fn, ArrayRef<TensorMetadata> inputs,
+              const OpAttrsRef& attrs, ArrayRef<TensorMetadata> results) {
+    Insert(Key(metadata_fn, inputs, attrs), attrs, results);
+  }
+
+  // Drops all cached results. Does not reset the stats.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  struct CachedResults {
+    CachedResults(OpAttrsRef attrs, ArrayRef<TensorMetadata> results)
+        : attrs(std::move(attrs)), results(results.begin(), results.end()) {}
+
+    // Frozen copy of the attributes, to tell apart the attributes that have
+    // the same hash.
+    OpAttrsRef attrs;
+    llvm::SmallVector<TensorMetadata, 2> results;
+    // Position of the key in the shard LRU list.
+    std::list<string_view>::iterator lru_position;
+  };
+
+  struct Shard {
+    mutex mu;
+    llvm::StringMap<CachedResults> entries TFRT_GUARDED_BY(mu);
+    // Keys of the entries, from the most to the least recently used. The keys
+    // refer to the strings owned by `entries`.
+    std::list<string_view> lru TFRT_GUARDED_BY(mu);
+  };
+
+  Shard& GetShard(string_view key);
+
+  const size_t shard_capacity_;
+  std::array<Shard, kNumShards> shards_;
+
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> evictions_{0};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_OP_METADATA_CACHE_H_
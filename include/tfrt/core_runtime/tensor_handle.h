@@ -114,6 +114,12 @@ class TensorHandle final {
            GetAsyncTensor()->IsError();
   }
 
+  // Returns true if the metadata is held inline rather than in an async value.
+  // Use GetAsyncMetadata() only if this returns false.
+  bool IsMetadataInline() const {
+    return tensor_and_flags_.getInt() & Flags::MetadataInline;
+  }
+
   const AsyncValueRef<TensorMetadata>& GetAsyncMetadata() const;
 
   // Return reference of the TensorMetadata.
@@ -172,10 +178,6 @@ class TensorHandle final {
     return tensor_and_flags_.getInt() & Flags::DeviceInline;
   }
 
-  bool IsMetadataInline() const {
-    return tensor_and_flags_.getInt() & Flags::MetadataInline;
-  }
-
   // Reset both tensor and metadata to default initialized state.
   void Reset() {
     if (IsMetadataInline()) {
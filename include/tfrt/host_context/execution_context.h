@@ -32,6 +32,7 @@ namespace tfrt {
 
 class HostContext;
 class ConcurrentWorkQueue;
+class MemoryBudget;
 
 class CancellationContext : public ReferenceCounted<CancellationContext> {
  public:
@@ -97,14 +98,22 @@ class RequestContext : public ReferenceCounted<RequestContext> {
 
   int64_t id() const { return id_; }
 
+  // The memory budget of this request, or nullptr if the request has no
+  // memory budget. The budget is charged for the allocations of the request's
+  // work by the allocator that the caller installed (see
+  // CreateMemoryBudgetAllocator()), and the BEFExecutor uses it to defer
+  // allocating kernels when the budget is exceeded.
+  MemoryBudget* memory_budget() const { return memory_budget_; }
+
  private:
   friend class RequestContextBuilder;
 
   RequestContext(HostContext* host, ResourceContext* resource_context,
-                 ContextData ctx_data, int64_t id)
+                 ContextData ctx_data, int64_t id, MemoryBudget* memory_budget)
       : id_{id},
         host_{host},
         resource_context_{resource_context},
+        memory_budget_{memory_budget},
         context_data_{std::move(ctx_data)},
         cancellation_{TakeRef(new CancellationContext)} {}
 
@@ -119,6 +128,7 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   // time. The look up requires only a simple array index without
   // synchronization overhead.
   ResourceContext* const resource_context_ = nullptr;
+  MemoryBudget* const memory_budget_ = nullptr;
   ContextData context_data_;
 
   RCReference<CancellationContext> cancellation_;
@@ -155,9 +165,22 @@ class RequestContextBuilder {
     return std::move(*this);
   }
 
+  // Enable memory bounded scheduling for this request. `memory_budget` is not
+  // owned and must outlive the request.
+  RequestContextBuilder& set_memory_budget(MemoryBudget* memory_budget) & {
+    memory_budget_ = memory_budget;
+    return *this;
+  }
+
+  RequestContextBuilder&& set_memory_budget(MemoryBudget* memory_budget) && {
+    memory_budget_ = memory_budget;
+    return std::move(*this);
+  }
+
   int64_t id() const { return id_; }
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
+  MemoryBudget* memory_budget() const { return memory_budget_; }
   const RequestOptions& request_options() const { return request_options_; }
   RequestContext::ContextData& context_data() { return context_data_; }
 
@@ -172,6 +195,7 @@ class RequestContextBuilder {
   HostContext* host_;
   RequestOptions request_options_;
   ResourceContext* resource_context_ = nullptr;
+  MemoryBudget* memory_budget_ = nullptr;
   RequestContext::ContextData context_data_;
   bool enable_cost_measurement_ = false;
 };
@@ -216,6 +240,8 @@ class ExecutionContext {
     return request_ctx_->resource_context();
   }
 
+  MemoryBudget* memory_budget() const { return request_ctx_->memory_budget(); }
+
  private:
   RCReference<RequestContext> request_ctx_;
   // If set, this work queue will be used for running async tasks in the
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares MemoryBudget, a per-request byte budget that is charged
+// by a decorating HostAllocator and consulted by the BEFExecutor to bound the
+// number of live intermediate values.
+//
+// The allocator charges the budget of the request whose work runs on the
+// allocating thread: the BEFExecutor and EnqueueWork(exec_ctx, ...) make the
+// budget of the request current (see MemoryBudget::Scope) while they run its
+// work, so concurrent requests are charged to their own budgets.
+
+#ifndef TFRT_HOST_CONTEXT_MEMORY_BUDGET_H_
+#define TFRT_HOST_CONTEXT_MEMORY_BUDGET_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+
+// MemoryBudget tracks the number of outstanding bytes allocated on behalf of a
+// request. The budget is soft: allocations are never rejected, but when the
+// outstanding bytes exceed the limit the BEFExecutor switches to a memory
+// bounded scheduling mode (see bef_executor.cc) that defers outlined kernels
+// which would allocate new values until memory is released.
+//
+// MemoryBudget is thread-safe. It must outlive the requests that refer to it,
+// and the memory that was charged to it.
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t limit_bytes) : limit_bytes_(limit_bytes) {}
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  // Makes `budget` the budget of the current thread, which is charged by the
+  // memory budget allocator, until the scope is destroyed. `budget` can be
+  // nullptr for the work of the requests without a budget.
+  class Scope {
+   public:
+    explicit Scope(MemoryBudget* budget);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    MemoryBudget* previous_;
+  };
+
+  // Returns the budget of the current thread, or nullptr if there is none.
+  static MemoryBudget* Current();
+
+  void Charge(size_t bytes) {
+    int64_t outstanding =
+        outstanding_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = peak_bytes_.load(std::memory_order_relaxed);
+    // Note that compare_exchange_weak updates `peak` on failure.
+    while (peak < outstanding &&
+           !peak_bytes_.compare_exchange_weak(peak, outstanding,
+                                              std::memory_order_relaxed)) {
+    }
+  }
+
+  void Release(size_t bytes) {
+    outstanding_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  // Returns true if the outstanding bytes are above the limit.
+  bool IsExceeded() const {
+    return outstanding_bytes_.load(std::memory_order_relaxed) >
+           static_cast<int64_t>(limit_bytes_);
+  }
+
+  size_t limit_bytes() const { return limit_bytes_; }
+
+  int64_t outstanding_bytes() const {
+    return outstanding_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // The high watermark of outstanding bytes since construction or the last
+  // call to ResetPeak().
+  int64_t peak_bytes() const {
+    return peak_bytes_.load(std::memory_order_relaxed);
+  }
+
+  void ResetPeak() {
+    peak_bytes_.store(outstanding_bytes_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+  }
+
+ private:
+  const size_t limit_bytes_;
+  std::atomic<int64_t> outstanding_bytes_{0};
+  std::atomic<int64_t> peak_bytes_{0};
+};
+
+// Decorate an allocator so that allocations are charged to the budget of the
+// current thread (see MemoryBudget::Scope), and released from the same budget
+// when they are deallocated, possibly on another thread.
+std::unique_ptr<HostAllocator> CreateMemoryBudgetAllocator(
+    std::unique_ptr<HostAllocator> allocator);
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_MEMORY_BUDGET_H_
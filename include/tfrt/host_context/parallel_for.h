@@ -19,10 +19,15 @@
 #ifndef TFRT_SUPPORT_PARALLEL_FOR_H_
 #define TFRT_SUPPORT_PARALLEL_FOR_H_
 
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/execution_context.h"
@@ -48,12 +53,22 @@ class ParallelFor {
     static BlockSizes Fixed(size_t n);
     // Splits range into a block sizes not smaller than `min`.
     static BlockSizes Min(size_t min);
+    // Splits range into blocks based on the cost of processing a single
+    // element: the number of bytes loaded from and stored to memory, and the
+    // number of compute cycles. Ranges that are too cheap to amortize the
+    // overhead of parallel tasks are executed in the caller thread. This is
+    // similar to the Eigen TensorOpCost based parallelization.
+    static BlockSizes Cost(double bytes_loaded, double bytes_stored,
+                           double compute_cycles);
 
    private:
     friend class ParallelFor;
 
-    explicit BlockSizes(llvm::unique_function<size_t(size_t)> impl)
-        : impl_(std::move(impl)) {}
+    // Block sizes policy signature: (num_worker_threads, total_size,
+    // default_block_size) -> block_size.
+    using Impl = llvm::unique_function<size_t(size_t, size_t, size_t)>;
+
+    explicit BlockSizes(Impl impl) : impl_(std::move(impl)) {}
 
     // Returns a parallel block size for a range of `total_size` and the
     // specified number of worker threads.
@@ -63,7 +78,7 @@ class ParallelFor {
     // parallel for parameters to the block size. This is an internal detail,
     // a contract between ParallelFor and BlockSizes. Users of ParallelFor
     // must rely only on public static methods to choose block sizes policy.
-    mutable llvm::unique_function<size_t(size_t)> impl_;
+    mutable Impl impl_;
   };
 
   //===--------------------------------------------------------------------===//
@@ -141,6 +156,31 @@ class ParallelFor {
       llvm::unique_function<AsyncValueRef<T>(size_t, size_t)> compute,
       llvm::unique_function<R(ArrayRef<AsyncValueRef<T>>)> on_done) const;
 
+  // Computes a reduction of the [0, total_size) range in parallel. `compute`
+  // is called for non-overlapping subranges [start, end) and returns a block
+  // local accumulator. Block accumulators are combined pairwise with `combine`
+  // in a balanced binary tree, as soon as both subtrees are completed. The
+  // tree shape depends only on the block sizes, so the result does not depend
+  // on the order in which blocks are completed. Returns `init` if the range is
+  // empty.
+  //
+  // Both `compute` and `combine` can be called concurrently from multiple
+  // threads.
+  //
+  // Example: sum of a vector of floats.
+  //
+  //   AsyncValueRef<float> sum = parallel_for.Reduce<float>(
+  //       data.size(), block_sizes, /*init=*/0.0f,
+  //       [&](size_t start, size_t end) -> float {
+  //         return std::accumulate(&data[start], &data[end], 0.0f);
+  //       },
+  //       [](float lhs, float rhs) -> float { return lhs + rhs; });
+  template <typename R>
+  AsyncValueRef<R> Reduce(size_t total_size, const BlockSizes& block_sizes,
+                          R init,
+                          llvm::unique_function<R(size_t, size_t)> compute,
+                          llvm::unique_function<R(R, R)> combine) const;
+
  private:
   ExecutionContext exec_ctx_;  // The data in exec_ctx_ must outlive all
                                // parallel operations in flight
@@ -212,6 +252,94 @@ AsyncValueRef<R> ParallelFor::Execute(
   return result;
 }
 
+template <typename R>
+AsyncValueRef<R> ParallelFor::Reduce(
+    size_t total_size, const BlockSizes& block_sizes, R init,
+    llvm::unique_function<R(size_t, size_t)> compute,
+    llvm::unique_function<R(R, R)> combine) const {
+  // Immediately return the initial value if nothing to reduce.
+  if (total_size == 0) return MakeAvailableAsyncValueRef<R>(std::move(init));
+
+  using ComputeFn = llvm::unique_function<R(size_t, size_t)>;
+  using CombineFn = llvm::unique_function<R(R, R)>;
+
+  // Fix the block size to map block ranges to the leaves of the tree.
+  const size_t block_size = block_sizes.GetBlockSize(
+      exec_ctx_.host()->GetNumWorkerThreads(), total_size);
+  assert(block_size > 0 && "Illegal block size");
+  const size_t num_blocks = (total_size + block_size - 1) / block_size;
+
+  // Block accumulators are combined in a binary tree stored as an implicit
+  // heap: node `i` has children `2 * i` and `2 * i + 1`, the root is node `1`,
+  // and the accumulator of block `b` enters the tree at leaf `num_leaves + b`.
+  // Leaves beyond `num_blocks` are empty, and internal nodes wait only for the
+  // non-empty children.
+  struct ReduceContext {
+    ReduceContext(size_t num_blocks, ComputeFn compute, CombineFn combine)
+        : num_leaves(llvm::PowerOf2Ceil(num_blocks)),
+          compute(std::move(compute)),
+          combine(std::move(combine)),
+          children(num_leaves),
+          pending(num_leaves) {
+      auto non_empty = [&](size_t node) -> int {
+        if (node >= num_leaves) return node - num_leaves < num_blocks;
+        return pending[node].load(std::memory_order_relaxed) > 0;
+      };
+      for (size_t node = num_leaves - 1; node >= 1; --node)
+        pending[node] = non_empty(2 * node) + non_empty(2 * node + 1);
+    }
+
+    // Moves the accumulator of the `node` towards the root, and combines it
+    // with the sibling accumulator if the sibling subtree is completed.
+    void Propagate(size_t node, R value) {
+      for (; node > 1; node /= 2) {
+        std::array<Optional<R>, 2>& siblings = children[node / 2];
+        siblings[node % 2].emplace(std::move(value));
+        // Last completed child combines the accumulators.
+        if (pending[node / 2].fetch_sub(1) != 1) return;
+        if (siblings[0] && siblings[1]) {
+          value = combine(std::move(*siblings[0]), std::move(*siblings[1]));
+        } else {
+          value = std::move(siblings[0] ? *siblings[0] : *siblings[1]);
+        }
+        siblings[0].reset();
+        siblings[1].reset();
+      }
+      result.emplace(std::move(value));
+    }
+
+    const size_t num_leaves;
+    ComputeFn compute;
+    CombineFn combine;
+    std::vector<std::array<Optional<R>, 2>> children;
+    std::vector<std::atomic<int>> pending;
+    Optional<R> result;
+  };
+
+  auto ctx = std::make_unique<ReduceContext>(num_blocks, std::move(compute),
+                                             std::move(combine));
+  ReduceContext* ctx_ptr = ctx.get();
+
+  AsyncValueRef<R> result = MakeUnconstructedAsyncValueRef<R>();
+
+  Execute(
+      total_size, BlockSizes::Fixed(block_size),
+      // -------------------------------------------------------------------- //
+      // Compute block accumulators and combine completed subtrees.
+      [ctx = ctx_ptr, block_size](size_t begin, size_t end) -> void {
+        ctx->Propagate(ctx->num_leaves + begin / block_size,
+                       ctx->compute(begin, end));
+      },
+      // -------------------------------------------------------------------- //
+      // All blocks are completed, and the root accumulator is ready.
+      [ctx = std::move(ctx), result = result.CopyRef()]() mutable -> void {
+        assert(ctx->result.has_value());
+        result.emplace(std::move(*ctx->result));
+      });
+
+  return result;
+}
+
 }  // namespace tfrt
 
 #endif  // TFRT_SUPPORT_PARALLEL_FOR_H_
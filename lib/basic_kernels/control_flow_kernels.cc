@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <utility>
 
 #include "llvm/ADT/STLExtras.h"
@@ -27,9 +28,13 @@
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/rc_array.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 
@@ -301,14 +306,125 @@ static void TFRTWhileInlineImpl(
   }
 }
 
-static void TFRTWhileAsyncImpl(
-    const ExecutionContext& exec_ctx, const Function* body_fn,
-    RCReference<AsyncValue> condition,
-    std::vector<RCReference<AsyncValue>> body_args,
-    std::vector<RCReference<IndirectAsyncValue>> while_results) {
+// PipelinedWhileLoop runs the iterations of a tfrt.while asynchronously. The
+// body of iteration N+1 is launched as soon as the condition of iteration N
+// resolves, so that independent iterations are pipelined, but at most
+// `parallel_iterations` body invocations are in flight at any time. An
+// invocation is in flight until all of its results are available. If the
+// window is full, the next iteration is parked until the oldest iteration
+// completes, which bounds the number of live loop-carried values.
+class PipelinedWhileLoop : public ReferenceCounted<PipelinedWhileLoop> {
+ public:
+  PipelinedWhileLoop(const ExecutionContext& exec_ctx, const Function* body_fn,
+                     int64_t parallel_iterations,
+                     std::vector<RCReference<IndirectAsyncValue>> while_results)
+      : exec_ctx_(exec_ctx),
+        body_fn_(FormRef(body_fn)),
+        parallel_iterations_(parallel_iterations),
+        while_results_(std::move(while_results)) {
+    assert(parallel_iterations_ > 0);
+  }
+
+  // Run the next iteration with `body_args` if `condition` is true, or finish
+  // the loop with `body_args` as the results otherwise. `condition` must be
+  // available.
+  void Run(RCReference<AsyncValue> condition,
+           std::vector<RCReference<AsyncValue>> body_args);
+
+ private:
+  // Launch the body with `body_args` and set up the next iteration.
+  void LaunchIteration(std::vector<RCReference<AsyncValue>> body_args);
+
+  // Called when all results of an in flight iteration are available.
+  void OnIterationDone();
+
+  void Finish(RCReference<AsyncValue> condition,
+              std::vector<RCReference<AsyncValue>> body_args);
+
+  ExecutionContext exec_ctx_;
+  RCReference<const Function> body_fn_;
+  const int64_t parallel_iterations_;
+  std::vector<RCReference<IndirectAsyncValue>> while_results_;
+
+  mutex mu_;
+  int64_t num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  // The arguments of the next iteration if it is waiting for the window. There
+  // is at most one parked iteration as iterations are launched in order.
+  Optional<std::vector<RCReference<AsyncValue>>> parked_body_args_
+      TFRT_GUARDED_BY(mu_);
+};
+
+void PipelinedWhileLoop::Run(RCReference<AsyncValue> condition,
+                             std::vector<RCReference<AsyncValue>> body_args) {
   assert(condition->IsAvailable());
-  assert(body_args.size() == while_results.size());
+  assert(body_args.size() == while_results_.size());
+
+  if (condition->IsError() || !condition->get<bool>()) {
+    Finish(std::move(condition), std::move(body_args));
+    return;
+  }
+
+  {
+    mutex_lock lock(mu_);
+    if (num_in_flight_ >= parallel_iterations_) {
+      assert(!parked_body_args_.has_value());
+      parked_body_args_ = std::move(body_args);
+      return;
+    }
+    ++num_in_flight_;
+  }
+
+  LaunchIteration(std::move(body_args));
+}
+
+void PipelinedWhileLoop::LaunchIteration(
+    std::vector<RCReference<AsyncValue>> body_args) {
+  std::vector<RCReference<AsyncValue>> body_results;
+  body_results.resize(body_args.size() + 1);
+
+  body_fn_->ExecuteAsync(exec_ctx_, std::move(body_args), body_results);
+
+  // The iteration leaves the window once all of its results are available.
+  RunWhenReady(body_results,
+               [loop = FormRef(this)]() { loop->OnIterationDone(); });
+
+  // The last result from the body is the condition for the next iteration.
+  RCReference<AsyncValue> next_condition = std::move(body_results.back());
+  body_results.pop_back();
+
+  auto* next_condition_av = next_condition.get();
+  next_condition_av->AndThen([loop = FormRef(this),
+                              next_condition = std::move(next_condition),
+                              next_body_args =
+                                  std::move(body_results)]() mutable {
+    loop->Run(std::move(next_condition), std::move(next_body_args));
+  });
+}
+
+void PipelinedWhileLoop::OnIterationDone() {
+  std::vector<RCReference<AsyncValue>> body_args;
+  {
+    mutex_lock lock(mu_);
+    if (!parked_body_args_.has_value()) {
+      --num_in_flight_;
+      return;
+    }
+    // Hand over the window slot of the completed iteration to the parked one.
+    body_args = std::move(*parked_body_args_);
+    parked_body_args_.reset();
+  }
+
+  // Launch the parked iteration in a separate task to avoid running it in the
+  // thread that completed the previous iteration, and to bound the stack depth.
+  EnqueueWork(exec_ctx_, [loop = FormRef(this),
+                          body_args = std::move(body_args)]() mutable {
+    loop->LaunchIteration(std::move(body_args));
+  });
+}
 
+void PipelinedWhileLoop::Finish(
+    RCReference<AsyncValue> condition,
+    std::vector<RCReference<AsyncValue>> body_args) {
   // When the loop finishes, we set the results of the while op, excluding the
   // last result that is the condition.
   if (condition->IsError()) {
@@ -316,40 +432,21 @@ static void TFRTWhileAsyncImpl(
     // first before setting them to errors, so that there won't be outstanding
     // ops when the downstream receives these ready async values.
     RunWhenReady(body_args,
-                 [body_args, while_results = std::move(while_results),
+                 [body_args, while_results = std::move(while_results_),
                   error = std::move(condition)]() mutable {
                    for (auto& result : while_results) {
                      result->ForwardTo(error);
                    }
                  });
     return;
-  } else if (!condition->get<bool>()) {
-    // If the condition is not an error, we simply forward the body results to
-    // the while results, even if any of the body results are errors.
-    assert(while_results.size() == body_args.size());
-    for (int i = 0; i < while_results.size(); ++i) {
-      while_results[i]->ForwardTo(std::move(body_args[i]));
-    }
-    return;
   }
 
-  std::vector<RCReference<AsyncValue>> body_results;
-  body_results.resize(body_args.size() + 1);
-
-  body_fn->ExecuteAsync(exec_ctx, std::move(body_args), body_results);
-
-  // The last result from the body is the condition for the next iteration.
-  RCReference<AsyncValue> next_condition = std::move(body_results.back());
-  body_results.pop_back();
-
-  auto* next_condition_av = next_condition.get();
-  next_condition_av->AndThen(
-      [exec_ctx, body_fn, next_condition = std::move(next_condition),
-       next_body_args = std::move(body_results),
-       while_results = std::move(while_results)]() mutable {
-        TFRTWhileAsyncImpl(exec_ctx, body_fn, std::move(next_condition),
-                           std::move(next_body_args), std::move(while_results));
-      });
+  // If the condition is not an error, we simply forward the body results to
+  // the while results, even if any of the body results are errors.
+  assert(while_results_.size() == body_args.size());
+  for (int i = 0; i < while_results_.size(); ++i) {
+    while_results_[i]->ForwardTo(std::move(body_args[i]));
+  }
 }
 
 // TFRTWhile() implements the tfrt.while kernel, eg.
@@ -406,12 +503,12 @@ static void TFRTWhile(RemainingArguments args, RemainingResults results,
 
   if (parallel_iterations.get() > 1) {
     // Invoke execution of the iterations asynchronously. If there are no data
-    // dependencies between iterations, they will be executed in parallel using
-    // the work_queue in `exec_ctx`.
-    //
-    // TODO(chky): Implement concurrency control based on `parallel_iterations`.
-    TFRTWhileAsyncImpl(exec_ctx, body_fn, std::move(condition),
-                       std::move(body_args), std::move(while_results));
+    // dependencies between iterations, up to `parallel_iterations` of them
+    // will be executed in parallel using the work_queue in `exec_ctx`.
+    auto loop = TakeRef(new PipelinedWhileLoop(exec_ctx, body_fn,
+                                               parallel_iterations.get(),
+                                               std::move(while_results)));
+    loop->Run(std::move(condition), std::move(body_args));
   } else {
     // Invoke execution of the iterations inline.
     TFRTWhileInlineImpl(exec_ctx, body_fn, std::move(condition),
@@ -533,12 +630,95 @@ static void TFRTRepeatI32Block(
   }
 }
 
+// This is a helper function that runs independent iterations of a repeat loop
+// in parallel. Every iteration is passed the same `args`, iterations are
+// sharded into blocks of `block_size` on the work queue, and `result_refs` are
+// forwarded to the results of the last iteration once all iterations are
+// completed. If any iteration fails or the loop is cancelled, `result_refs`
+// are forwarded to the error instead.
+static void TFRTRepeatI32Parallel(
+    int32_t block_size, int32_t count_value, const ExecutionContext& exec_ctx,
+    RCReference<const Function> body_fn_ref, RCArray<AsyncValue> args,
+    llvm::SmallVector<RCReference<IndirectAsyncValue>, 4>&& result_refs) {
+  assert(count_value > 0 && block_size > 0);
+
+  // Results of the last iteration. They are written by the block that runs the
+  // last iteration and read after all blocks are completed.
+  auto last_results =
+      std::make_shared<llvm::SmallVector<RCReference<AsyncValue>, 4>>(
+          result_refs.size());
+
+  auto compute = [exec_ctx, count_value, body_fn_ref = std::move(body_fn_ref),
+                  args = std::move(args), last_results](
+                     size_t start, size_t end) -> AsyncValueRef<Chain> {
+    llvm::SmallVector<RCReference<AsyncValue>, 8> block_results;
+    block_results.reserve((end - start) * last_results->size());
+
+    for (size_t i = start; i < end; ++i) {
+      if (auto cancel_av = exec_ctx.GetCancelAsyncValue())
+        return AsyncValueRef<Chain>(FormRef(cancel_av));
+
+      llvm::SmallVector<RCReference<AsyncValue>, 4> results(
+          last_results->size());
+      body_fn_ref->Execute(exec_ctx, args.values(), results);
+
+      for (auto& result : results) block_results.push_back(result.CopyRef());
+      if (i + 1 == static_cast<size_t>(count_value))
+        *last_results = std::move(results);
+    }
+
+    // The block is completed when all of its iterations are completed.
+    auto done = MakeConstructedAsyncValueRef<Chain>();
+    llvm::SmallVector<AsyncValue*, 8> block_values;
+    block_values.reserve(block_results.size());
+    for (auto& result : block_results) block_values.push_back(result.get());
+    RunWhenReady(block_values, [done = done.CopyRef(),
+                                block_results = std::move(block_results)]() {
+      for (auto& result : block_results) {
+        if (result->IsError()) {
+          done.SetError(result->GetError());
+          return;
+        }
+      }
+      done.SetStateConcrete();
+    });
+    return done;
+  };
+
+  auto on_done = [last_results, result_refs = std::move(result_refs)](
+                     ArrayRef<AsyncValueRef<Chain>> blocks) mutable {
+    for (auto& block : blocks) {
+      if (block.IsError()) {
+        for (auto& result : result_refs)
+          result->ForwardTo(FormRef(block.GetAsyncValue()));
+        return Chain();
+      }
+    }
+    for (int i = 0, e = result_refs.size(); i != e; ++i)
+      result_refs[i]->ForwardTo(std::move((*last_results)[i]));
+    return Chain();
+  };
+
+  ParallelFor(exec_ctx).Execute<Chain, Chain>(
+      count_value, ParallelFor::BlockSizes::Fixed(block_size),
+      std::move(compute), std::move(on_done));
+}
+
 // This takes a single i32 iteration count, plus arguments that are passed to
 // the body_fn and eventually returned.
+//
+// The optional attributes are sorted by name: `block_size` is the number of
+// iterations dispatched at a time (32 by default), and `independent_iterations`
+// runs the iterations in parallel with TFRTRepeatI32Parallel. BEF doesn't keep
+// the attribute names, but the op verifier checks that `independent_iterations`
+// is always accompanied by a positive `block_size`, so `block_size` is always
+// the first attribute.
 static void TFRTRepeatI32(RemainingArguments args, RemainingResults results,
                           Attribute<Function> body_fn_const,
+                          RemainingAttributes attributes,
                           const ExecutionContext& exec_ctx) {
   assert(args.size() > 0 && args.size() - 1 == results.size());
+  assert(attributes.size() <= 2);
 
   const Function* body_fn = &(*body_fn_const);
 
@@ -546,13 +726,16 @@ static void TFRTRepeatI32(RemainingArguments args, RemainingResults results,
   assert(body_fn->argument_types() == body_fn->result_types() &&
          "Argument and result types of repeat body_fn must match");
 
-  auto while_impl = [exec_ctx](
+  int32_t block_size = 32;
+  if (attributes.size() > 0) block_size = *attributes.Get<int32_t>(0);
+  bool independent_iterations =
+      attributes.size() > 1 && *attributes.Get<bool>(1);
+
+  auto while_impl = [exec_ctx, block_size, independent_iterations](
                         RCReference<const Function> body_fn_ref,
                         RCArray<AsyncValue> arg_refs,
                         llvm::SmallVector<RCReference<IndirectAsyncValue>, 4>
                             result_refs) mutable {
-    // TODO(xldrx,jingdong): Get the block_size from an optional attribute.
-    int32_t block_size = 32;
     auto args = arg_refs.values();
     auto* count = args[0];
     args = args.drop_front();
@@ -586,6 +769,13 @@ static void TFRTRepeatI32(RemainingArguments args, RemainingResults results,
     // Run 'body_fn' at least once.
     assert(count_value > 0);
 
+    if (independent_iterations) {
+      TFRTRepeatI32Parallel(block_size, count_value, exec_ctx,
+                            std::move(body_fn_ref), RCArray<AsyncValue>(args),
+                            std::move(result_refs));
+      return;
+    }
+
     TFRTRepeatI32Block(0, block_size, count_value, exec_ctx,
                        std::move(body_fn_ref), RCArray<AsyncValue>(args),
                        std::move(result_refs));
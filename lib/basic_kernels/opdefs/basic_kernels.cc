@@ -325,6 +325,14 @@ ParseResult RepeatI32Op::parse(OpAsmParser& parser, OperationState& result) {
     if (parser.parseOptionalAttrDict(result.attributes)) return failure();
   }
 
+  // The kernel identifies the optional attributes by their position, so
+  // `independent_iterations` is always accompanied by `block_size`.
+  if (result.attributes.get("independent_iterations") &&
+      !result.attributes.get("block_size")) {
+    result.addAttribute("block_size",
+                        parser.getBuilder().getI32IntegerAttr(32));
+  }
+
   SmallVector<Type, 4> types;
   llvm::SMLoc type_loc = parser.getCurrentLocation();
   if (parser.parseOptionalColonTypeList(types) ||
@@ -353,6 +361,7 @@ void RepeatI32Op::print(OpAsmPrinter& p) {
   p << " ";
   p.printOperands(getOperands());
   if (!(*this)->getAttrs().empty()) {
+    p << " attributes";
     p.printOptionalAttrDict((*this)->getAttrs());
   }
   if (getNumOperands() > 1) {
@@ -378,6 +387,13 @@ LogicalResult RepeatI32Op::verify() {
     if (op.getOperand(i + 1).getType() != op.getResult(i).getType())
       return op.emitOpError("operand/result type mismatch");
 
+  IntegerAttr block_size = op.getBlockSizeAttr();
+  if (block_size && block_size.getInt() <= 0)
+    return op.emitOpError("block_size must be positive");
+
+  if (op.getIndependentIterationsAttr() && !block_size)
+    return op.emitOpError("independent_iterations requires block_size");
+
   return checkTFRTReturn(op, &op.getRegion(), op.getResultTypes());
 }
 
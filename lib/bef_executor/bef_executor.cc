@@ -26,6 +26,7 @@
 #include "absl/strings/string_view.h"  // from @com_google_absl
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
@@ -36,6 +37,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/memory_budget.h"
 #include "tfrt/metrics/metrics.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
@@ -183,6 +185,11 @@ class ReadyKernelQueue {
   // thread.
   std::vector<unsigned>& outline_kernel_ids() { return outline_kernel_ids_; }
 
+  // `deferred_kernel_ids` contains the outline kernels that are held back
+  // because the request's memory budget is exceeded. They are only used in the
+  // memory bounded scheduling mode.
+  std::vector<unsigned>& deferred_kernel_ids() { return deferred_kernel_ids_; }
+
   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array() const {
     return kernel_array_;
   }
@@ -196,6 +203,7 @@ class ReadyKernelQueue {
 
   std::vector<unsigned> inline_kernel_ids_;
   std::vector<unsigned> outline_kernel_ids_;
+  std::vector<unsigned> deferred_kernel_ids_;
 };
 
 }  // namespace
@@ -269,6 +277,19 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   // executed in a dfferent thread in parallel.
   void EnqueueReadyKernels(std::vector<unsigned>& kernel_ids);
 
+  // Switch the stream of `ready_kernel_queue` if it has no inline kernels and
+  // launch its outline kernels.
+  void ScheduleReadyKernels(ReadyKernelQueue& ready_kernel_queue);
+
+  // Apply the memory budget of the request to `ready_kernel_queue`. This might
+  // defer outline kernels or resume previously deferred kernels.
+  void ApplyMemoryBudget(ReadyKernelQueue& ready_kernel_queue);
+
+  // Returns true if running the kernel is expected to increase the memory held
+  // by this execution, i.e. it produces used results and it is not the last
+  // user of any of its arguments.
+  bool MayIncreaseMemory(unsigned kernel_id);
+
   HostContext* GetHost() const { return exec_ctx_.host(); }
   BEFFileImpl* BefFile() const { return bef_file_.get(); }
 
@@ -294,6 +315,10 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   BEFFileImpl::FunctionInfo function_info_;
 
   RCReference<BEFFileImpl> bef_file_;
+
+  /// The memory budget of the request, or nullptr if memory bounded scheduling
+  /// is disabled.
+  MemoryBudget* memory_budget_;
 };
 
 //===----------------------------------------------------------------------===//
@@ -616,24 +641,98 @@ LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::EnqueueReadyKernels(
   kernel_ids.clear();
 }
 
+// Returns true if running the kernel is expected to increase the memory held
+// by this execution. This is a static approximation: a kernel that is the only
+// user of one of its arguments releases that argument once it runs, and a
+// kernel without used results can't materialize new intermediates.
+bool BEFExecutor::MayIncreaseMemory(unsigned kernel_id) {
+  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+
+  assert(kernel_infos()[kernel_id].offset % kKernelEntryAlignment == 0);
+  BEFKernel kernel(kernels().data() +
+                   kernel_infos()[kernel_id].offset / kKernelEntryAlignment);
+
+  auto arguments = kernel.GetKernelEntries(0, kernel.num_arguments());
+  for (auto reg_idx : arguments) {
+    if (register_array[reg_idx].user_count == 1) return false;
+  }
+
+  int entry_offset =
+      arguments.size() + kernel.num_attributes() + kernel.num_functions();
+  auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
+  return llvm::any_of(results, [&](unsigned reg_idx) {
+    return register_array[reg_idx].user_count > 0;
+  });
+}
+
+// In the memory bounded scheduling mode, outline kernels that may increase
+// memory usage are not launched to other threads while the request is over its
+// memory budget. Instead they are kept in the queue of the current thread, and
+// either resumed in parallel once the budget is available again, or run inline
+// one at a time when the current thread has nothing else to do. The latter
+// guarantees forward progress: deferred kernels are never left without a thread
+// that is going to run them.
+LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::ApplyMemoryBudget(
+    ReadyKernelQueue& ready_kernel_queue) {
+  auto& outline_kernel_ids = ready_kernel_queue.outline_kernel_ids();
+  auto& deferred_kernel_ids = ready_kernel_queue.deferred_kernel_ids();
+
+  if (!memory_budget_->IsExceeded()) {
+    // Memory is available again, launch all deferred kernels.
+    outline_kernel_ids.insert(outline_kernel_ids.end(),
+                              deferred_kernel_ids.begin(),
+                              deferred_kernel_ids.end());
+    deferred_kernel_ids.clear();
+    return;
+  }
+
+  // Keep launching the kernels that release their inputs, as they help to get
+  // back under the budget, and defer the ones that allocate.
+  auto deferred_begin = std::stable_partition(
+      outline_kernel_ids.begin(), outline_kernel_ids.end(),
+      [&](unsigned id) { return !MayIncreaseMemory(id); });
+  deferred_kernel_ids.insert(deferred_kernel_ids.end(), deferred_begin,
+                             outline_kernel_ids.end());
+  outline_kernel_ids.erase(deferred_begin, outline_kernel_ids.end());
+
+  auto& inline_kernel_ids = ready_kernel_queue.inline_kernel_ids();
+  if (inline_kernel_ids.empty() && !deferred_kernel_ids.empty()) {
+    inline_kernel_ids.push_back(deferred_kernel_ids.back());
+    deferred_kernel_ids.pop_back();
+  }
+}
+
+// Switch the stream of `ready_kernel_queue` if it has no inline kernels and
+// launch its outline kernels.
+LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ScheduleReadyKernels(
+    ReadyKernelQueue& ready_kernel_queue) {
+  // Switch stream id if there are no inline kernels to process.
+  if (ready_kernel_queue.inline_kernel_ids().empty())
+    ready_kernel_queue.SwitchStreamId();
+
+  if (LLVM_UNLIKELY(memory_budget_ != nullptr))
+    ApplyMemoryBudget(ready_kernel_queue);
+
+  // Enqueue outline kernels into the concurrent work queue.
+  if (!ready_kernel_queue.outline_kernel_ids().empty())
+    EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
+  assert(ready_kernel_queue.outline_kernel_ids().empty());
+}
+
 // Iteratively process ready kernels in `ready_kernel_queue` and inserts ready
 // users back for next round of processing, until there are no more ready
 // kernels.
 void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
+  // Allocations of the kernels are charged to the budget of this request.
+  MemoryBudget::Scope memory_budget_scope(memory_budget_);
+
   // Process the kernel record to get information about what argument
   // registers, result registers, and attributes should be passed.
   KernelFrameBuilder kernel_frame(exec_ctx_);
   kernel_frame.SetAttributeSection(BefFile()->attribute_section_);
   kernel_frame.SetFunctions(BefFile()->functions_);
 
-  // Switch stream id if there are no inline kernels to process.
-  if (ready_kernel_queue.inline_kernel_ids().empty())
-    ready_kernel_queue.SwitchStreamId();
-
-  // Enqueue outline kernels into the concurrent work queue.
-  if (!ready_kernel_queue.outline_kernel_ids().empty())
-    EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
-  assert(ready_kernel_queue.outline_kernel_ids().empty());
+  ScheduleReadyKernels(ready_kernel_queue);
 
   // The loop below process inline kernels in a LIFO order for cache locality.
   // Outline kernels are enqueued to the concurrent work queue immediately.
@@ -644,15 +743,10 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
 
     ProcessReadyKernel(kernel_id, &kernel_frame, ready_kernel_queue);
 
-    // Switch stream id if there are no inline kernels to process.
-    if (ready_kernel_queue.inline_kernel_ids().empty())
-      ready_kernel_queue.SwitchStreamId();
-
-    // Enqueue outline kernels into the concurrent work queue.
-    if (!ready_kernel_queue.outline_kernel_ids().empty())
-      EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
-    assert(ready_kernel_queue.outline_kernel_ids().empty());
+    ScheduleReadyKernels(ready_kernel_queue);
   }
+
+  assert(ready_kernel_queue.deferred_kernel_ids().empty());
 }
 
 //===----------------------------------------------------------------------===//
@@ -660,7 +754,9 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
 //===----------------------------------------------------------------------===//
 
 BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file)
-    : exec_ctx_(std::move(exec_ctx)), bef_file_(FormRef(bef_file)) {}
+    : exec_ctx_(std::move(exec_ctx)),
+      bef_file_(FormRef(bef_file)),
+      memory_budget_(exec_ctx_.memory_budget()) {}
 
 BEFExecutor::~BEFExecutor() {}
 
@@ -43,6 +43,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/memory_budget.h"
 #include "tfrt/host_context/profiled_allocator.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/host_context/value.h"
@@ -62,9 +63,12 @@ static void RunBefFunction(
 int RunBefExecutor(const RunBefConfig& run_config) {
   return RunBefExecutor(
       run_config,
-      [](HostContext* host, ResourceContext* resource_context)
+      [memory_budget = run_config.memory_budget](
+          HostContext* host, ResourceContext* resource_context)
           -> llvm::Expected<ExecutionContext> {
-        auto req_ctx = RequestContextBuilder(host, resource_context).build();
+        auto req_ctx = RequestContextBuilder(host, resource_context)
+                           .set_memory_budget(memory_budget)
+                           .build();
         if (!req_ctx) return req_ctx.takeError();
         return ExecutionContext{std::move(req_ctx.get())};
       });
@@ -131,6 +135,11 @@ int RunBefExecutor(
       host_allocator = CreateLeakCheckAllocator(std::move(host_allocator));
       tfrt::outs() << "Choosing memory leak check allocator.\n";
   }
+  if (run_config.memory_budget) {
+    host_allocator = CreateMemoryBudgetAllocator(std::move(host_allocator));
+    tfrt::outs() << "Choosing memory budget of "
+                 << run_config.memory_budget->limit_bytes() << " bytes.\n";
+  }
   tfrt::outs().flush();
 
   auto buffer = file->getBuffer();
@@ -243,8 +252,14 @@ int RunBefExecutor(
   // Loop over each of the functions, running each as a standalone testcase.
   for (auto* fn : function_list) {
     if (fn != test_init_function) {
+      if (run_config.memory_budget) run_config.memory_budget->ResetPeak();
       RunBefFunction(host, *fn, create_execution_context,
                      run_config.print_error_code);
+      if (run_config.memory_budget) {
+        tfrt::outs() << "Peak memory budget usage: "
+                     << run_config.memory_budget->peak_bytes() << " bytes\n";
+        tfrt::outs().flush();
+      }
     }
   }
 
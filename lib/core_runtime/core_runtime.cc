@@ -16,12 +16,20 @@
 
 #include "tfrt/core_runtime/core_runtime.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include "tfrt/bef_executor/bef_interpreter.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/core_runtime/op_invocation.h"
 #include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
@@ -33,9 +41,11 @@
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/shared_context.h"
+#include "tfrt/host_context/value.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tracing/tracing.h"
@@ -70,6 +80,213 @@ class OpHandlerRegistry {
   std::vector<std::unique_ptr<OpHandler>> all_op_handlers_;
 };
 
+// PreparedOpCache maps (op_name, op_handler) pairs to the CoreRuntimeOp
+// prepared by the op_handler, so that the name based CoreRuntime::Execute does
+// not resolve the op on every call.
+//
+// Lookups are lock free. Entries live in an open addressing hash table whose
+// slots are only ever written once (from empty to an entry). Inserts are
+// serialized by a mutex, and when the table becomes half full it is rehashed
+// into a new table that is published atomically.
+//
+// Replaced tables, and the entries dropped by Invalidate, are retired: they are
+// freed once no reader can still be probing them or running their ops. Readers
+// register in the reader slots of the current epoch. Retiring advances the
+// epoch, and the retired objects are freed when the readers of the previous
+// epoch are done, so that a steady stream of new readers does not delay the
+// reclamation. Readers are counted in a few cache line sized slots per epoch,
+// so that concurrent lookups from different threads do not contend on a single
+// counter.
+class PreparedOpCache {
+ public:
+  // Reader protects the ops looked up from the cache from being freed while it
+  // is alive.
+  class Reader {
+   public:
+    explicit Reader(const PreparedOpCache& cache) {
+      // Retry if the epoch advanced before the reader registered, so that the
+      // reader is always counted in the slots of an epoch it observed.
+      for (;;) {
+        uint64_t epoch = cache.epoch_.load(std::memory_order_seq_cst);
+        count_ = &cache.reader_slots_[epoch & 1][ReaderSlotIndex()].count;
+        count_->fetch_add(1, std::memory_order_seq_cst);
+        if (cache.epoch_.load(std::memory_order_seq_cst) == epoch) break;
+        count_->fetch_sub(1, std::memory_order_release);
+      }
+    }
+    ~Reader() { count_->fetch_sub(1, std::memory_order_release); }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+   private:
+    std::atomic<int64_t>* count_;
+  };
+
+  PreparedOpCache() : table_owner_(std::make_unique<Table>(kInitialCapacity)) {
+    table_.store(table_owner_.get(), std::memory_order_seq_cst);
+  }
+
+  // Returns the cached op, or nullptr if the op is not in the cache. The op
+  // stays valid while `reader` is alive.
+  const CoreRuntimeOp* Lookup(const Reader& reader, string_view op_name,
+                              OpHandler* op_handler) const {
+    return Find(table_.load(std::memory_order_seq_cst),
+                Hash(op_name, op_handler), op_name, op_handler);
+  }
+
+  // Adds `op` to the cache and returns the cached op. If another thread added
+  // an op for the same key first, `op` is dropped and the existing op returned.
+  // The op stays valid while `reader` is alive.
+  const CoreRuntimeOp* Insert(const Reader& reader, string_view op_name,
+                              OpHandler* op_handler, CoreRuntimeOp op) {
+    size_t hash = Hash(op_name, op_handler);
+
+    mutex_lock lock(mu_);
+    Table* table = table_owner_.get();
+    if (auto* cached = Find(table, hash, op_name, op_handler)) return cached;
+
+    entries_.push_back(std::make_unique<Entry>(
+        Entry{op_name.str(), op_handler, hash, std::move(op)}));
+    const Entry* entry = entries_.back().get();
+
+    if (2 * (table->size + 1) <= table->slots.size()) {
+      Place(table, entry);
+    } else {
+      auto grown = std::make_unique<Table>(2 * table->slots.size());
+      for (auto& slot : table->slots) {
+        if (auto* existing = slot.load(std::memory_order_relaxed)) {
+          Place(grown.get(), existing);
+        }
+      }
+      Place(grown.get(), entry);
+      Publish(std::move(grown));
+    }
+
+    ReclaimRetired();
+    return &entry->op;
+  }
+
+  // Drops all cached ops. Ops returned by previous lookups stay valid while
+  // their readers are alive.
+  void Invalidate() {
+    mutex_lock lock(mu_);
+    if (table_owner_->size > 0) {
+      for (auto& entry : entries_) retired_.entries.push_back(std::move(entry));
+      entries_.clear();
+      Publish(std::make_unique<Table>(kInitialCapacity));
+    }
+    ReclaimRetired();
+  }
+
+ private:
+  static constexpr size_t kInitialCapacity = 64;
+  static constexpr size_t kNumReaderSlots = 16;
+
+  struct Entry {
+    std::string op_name;
+    OpHandler* op_handler;
+    size_t hash;
+    CoreRuntimeOp op;
+  };
+
+  struct Table {
+    explicit Table(size_t capacity) : slots(capacity) {}
+    // Capacity is a power of two and at least half of the slots are empty.
+    std::vector<std::atomic<const Entry*>> slots;
+    size_t size = 0;
+  };
+
+  struct alignas(64) ReaderSlot {
+    std::atomic<int64_t> count{0};
+  };
+
+  struct Retired {
+    bool empty() const { return tables.empty() && entries.empty(); }
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<std::unique_ptr<Entry>> entries;
+  };
+
+  // Threads are assigned to the reader slots round robin.
+  static size_t ReaderSlotIndex() {
+    static std::atomic<size_t> next_index{0};
+    thread_local const size_t index =
+        next_index.fetch_add(1, std::memory_order_relaxed) % kNumReaderSlots;
+    return index;
+  }
+
+  static size_t Hash(string_view op_name, OpHandler* op_handler) {
+    return llvm::hash_combine(llvm::hash_value(op_name), op_handler);
+  }
+
+  static const CoreRuntimeOp* Find(const Table* table, size_t hash,
+                                   string_view op_name, OpHandler* op_handler) {
+    const size_t mask = table->slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr) return nullptr;
+      if (entry->hash == hash && entry->op_handler == op_handler &&
+          entry->op_name == op_name)
+        return &entry->op;
+    }
+  }
+
+  static void Place(Table* table, const Entry* entry) {
+    const size_t mask = table->slots.size() - 1;
+    size_t i = entry->hash & mask;
+    while (table->slots[i].load(std::memory_order_relaxed)) i = (i + 1) & mask;
+    table->slots[i].store(entry, std::memory_order_release);
+    ++table->size;
+  }
+
+  // Makes `table` visible to the readers and retires the replaced table. The
+  // table is fully populated before it is published, so that readers do not
+  // miss any of the cached ops.
+  void Publish(std::unique_ptr<Table> table) TFRT_REQUIRES(mu_) {
+    table_.store(table.get(), std::memory_order_seq_cst);
+    retired_.tables.push_back(std::move(table_owner_));
+    table_owner_ = std::move(table);
+  }
+
+  // Starts a grace period for the retired objects by advancing the epoch, and
+  // frees the objects of the pending grace period once there are no readers
+  // of the previous epoch. The readers of the calling thread are counted too,
+  // so a grace period can only end in a later call.
+  //
+  // Objects are retired before the epoch advances, and readers load the table
+  // after they registered in an epoch (all sequentially consistent), so a
+  // reader that is not counted in the previous epoch can only see the tables
+  // published after the objects were retired. A new grace period is only
+  // started when the previous one is over, so that the slots of the previous
+  // epoch are not shared by the readers of two epochs.
+  void ReclaimRetired() TFRT_REQUIRES(mu_) {
+    if (draining_.empty()) {
+      if (retired_.empty()) return;
+      draining_ = std::move(retired_);
+      retired_ = Retired();
+      epoch_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    const uint64_t previous = epoch_.load(std::memory_order_relaxed) - 1;
+    for (auto& slot : reader_slots_[previous & 1]) {
+      if (slot.count.load(std::memory_order_seq_cst) != 0) return;
+    }
+    draining_ = Retired();
+  }
+
+  std::atomic<const Table*> table_{nullptr};
+  std::atomic<uint64_t> epoch_{0};
+  mutable ReaderSlot reader_slots_[2][kNumReaderSlots];
+
+  mutex mu_;
+  std::unique_ptr<Table> table_owner_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<Entry>> entries_ TFRT_GUARDED_BY(mu_);
+  // Objects retired since the last grace period started.
+  Retired retired_ TFRT_GUARDED_BY(mu_);
+  // Objects waiting for the readers of the previous epoch.
+  Retired draining_ TFRT_GUARDED_BY(mu_);
+};
+
 }  // namespace
 
 OpHandler::~OpHandler() {}
@@ -96,10 +313,12 @@ class CoreRuntime::Impl {
 
   void TakeOpHandler(std::unique_ptr<OpHandler> op_handler) {
     op_handler_registry_.AddOpHandler(std::move(op_handler));
+    prepared_ops_.Invalidate();
   }
 
   void RegisterOpHandlerChain(string_view name, OpHandler* op_handler) {
     op_handler_registry_.AddOpHandlerChain(name, op_handler);
+    prepared_ops_.Invalidate();
   }
 
  private:
@@ -113,6 +332,9 @@ class CoreRuntime::Impl {
   HostContext context_;
 
   OpHandlerRegistry op_handler_registry_;
+
+  // Ops prepared by the name based Execute.
+  PreparedOpCache prepared_ops_;
 };
 
 void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
@@ -121,10 +343,23 @@ void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
                                 const OpAttrsRef& attrs,
                                 MutableArrayRef<TensorHandle> results,
                                 AsyncValueRef<Chain>* chain) {
-  // Ask the op_handler to execute the op.  If successful, we're done.
-  auto op_handle = op_handler->MakeOp(op_name);
-  if (op_handle) {
-    op_handle.get()(exec_ctx, arguments, attrs, results, chain);
+  // Ask the op_handler to prepare the op, unless it was already prepared by a
+  // previous call. If successful, execute it and we're done. The reader keeps
+  // the cached op alive until the op returns.
+  PreparedOpCache::Reader reader(prepared_ops_);
+  const CoreRuntimeOp* op = prepared_ops_.Lookup(reader, op_name, op_handler);
+  if (!op) {
+    auto op_handle = op_handler->MakeOp(op_name);
+    if (op_handle) {
+      op = prepared_ops_.Insert(reader, op_name, op_handler,
+                                std::move(*op_handle));
+    } else {
+      llvm::consumeError(op_handle.takeError());
+    }
+  }
+
+  if (op) {
+    (*op)(exec_ctx, arguments, attrs, results, chain);
     return;
   }
 
@@ -226,20 +461,300 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
   if (!op) return op;
   bool is_fallback = op->IsFallback();
   auto device = op->GetDeviceRef();
-  // TODO(b/155801998): Avoid this string copy.
+  auto tensor_type = op->GetTensorType();
+  // The op is shared by the traced single and batch invocations, so that the
+  // batches still run with the batch function of the op handler.
+  auto shared_op = std::make_shared<CoreRuntimeOp>(std::move(op.get()));
+  // Build the trace names once, instead of on every op invocation.
+  std::string trace_name =
+      StrCat(op_name, "#op_handler=", op_handler->GetName(), "#");
+  std::string batch_trace_name = StrCat(trace_name, "batch=true#");
   return CoreRuntimeOp(
-      [op_name = op_name.str(), op = std::move(op.get()),
-       op_handler](const OpInvocation& invocation) {
-        TFRT_TRACE_SCOPE(
-            Default,
-            StrCat(op_name, "#op_handler=", op_handler->GetName(), "#"));
-        op(invocation);
+      [trace_name = std::move(trace_name),
+       op = shared_op](const OpInvocation& invocation) {
+        TFRT_TRACE_SCOPE(Default, trace_name);
+        (*op)(invocation);
+      },
+      [trace_name = std::move(batch_trace_name), op = shared_op](
+          ArrayRef<OpInvocation> invocations, bool parallel) {
+        TFRT_TRACE_SCOPE(Default, trace_name);
+        op->ExecuteBatch(invocations, parallel);
       },
-      is_fallback, std::move(device), op->GetTensorType());
+      is_fallback, std::move(device), tensor_type);
 }
 
+namespace {
+
+// Sets the results and the out chain of a composite op invocation from the
+// results of its function. The first result is the out chain.
+void SetCompositeOpResults(const OpInvocation& invocation,
+                           MutableArrayRef<RCReference<AsyncValue>> results) {
+  // The first result is the a chain for side-effects.
+  if (invocation.chain)
+    *invocation.chain = AsyncValueRef<Chain>(std::move(results[0]));
+
+  for (const auto& iter : llvm::enumerate(llvm::drop_begin(results, 1))) {
+    size_t i = iter.index();
+    auto& result_av = iter.value();
+    if (result_av->IsAvailable()) {
+      if (result_av->IsError()) {
+        invocation.results[i] =
+            TensorHandle(AsyncValueRef<TensorHandle>(std::move(result_av)));
+      } else {
+        assert(result_av->IsType<TensorHandle>());
+        invocation.results[i] = result_av->get<TensorHandle>().CopyRef();
+      }
+    } else {
+      auto device_av = MakeUnconstructedAsyncValueRef<RCReference<Device>>();
+      auto metadata_av = MakeUnconstructedAsyncValueRef<TensorMetadata>();
+      auto tensor_ind_av = MakeIndirectAsyncValue();
+
+      result_av->AndThen([result_av = result_av,
+                          device_av = device_av.CopyRef(),
+                          metadata_av = metadata_av.CopyRef(),
+                          tensor_ind_av = tensor_ind_av]() mutable {
+        if (result_av->IsError()) {
+          device_av.SetError(result_av->GetError());
+          metadata_av.SetError(result_av->GetError());
+          tensor_ind_av->SetError(result_av->GetError());
+          return;
+        }
+        auto& th = result_av->get<TensorHandle>();
+
+        if (th.IsDeviceAvailable()) {
+          device_av.emplace(th.GetAvailableDevice());
+        } else {
+          th.GetAsyncDevice().AndThen(
+              [th_device = th.GetAsyncDevice().CopyRef(),
+               device_av = std::move(device_av)]() {
+                if (th_device.IsError()) {
+                  device_av.SetError(th_device.GetError());
+                } else {
+                  device_av.emplace(th_device.get());
+                }
+              });
+        }
+
+        if (th.IsMetadataAvailable()) {
+          metadata_av.emplace(th.GetAvailableMetadata());
+        } else {
+          th.GetAsyncMetadata().AndThen(
+              [th_metadata = th.GetAsyncMetadata().CopyRef(),
+               metadata_av = std::move(metadata_av)]() {
+                if (th_metadata.IsError()) {
+                  metadata_av.SetError(th_metadata.GetError());
+                } else {
+                  metadata_av.emplace(th_metadata.get());
+                }
+              });
+        }
+
+        tensor_ind_av->ForwardTo(FormRef(th.GetAsyncTensor()));
+      });
+
+      invocation.results[i] =
+          TensorHandle(std::move(device_av), std::move(metadata_av),
+                       AsyncValueRef<Tensor>(std::move(tensor_ind_av)));
+    }
+  }
+}
+
+// Returns an error if the number of arguments or results of `invocation` does
+// not match the composite op function `fn`, whose first `num_chains` arguments
+// and results are chains.
+Error CheckCompositeOpInvocation(const OpInvocation& invocation,
+                                 const Function& fn, size_t num_chains) {
+  const size_t num_arguments = fn.argument_types().size() - num_chains;
+  const size_t num_results = fn.result_types().size() - num_chains;
+  if (invocation.arguments.size() != num_arguments ||
+      invocation.results.size() != num_results) {
+    return MakeStringError(
+        "composite op ", fn.name(), " takes ", num_arguments,
+        " arguments and returns ", num_results,
+        " results, but the invocation has ", invocation.arguments.size(),
+        " arguments and ", invocation.results.size(), " results");
+  }
+  return Error::success();
+}
+
+// Sets the results and the out chain of `invocation` to `error_av`.
+void SetCompositeOpError(const OpInvocation& invocation,
+                         RCReference<AsyncValue> error_av) {
+  for (auto& result : invocation.results)
+    result = TensorHandle::CreateError(error_av.CopyRef());
+  if (invocation.chain)
+    *invocation.chain = AsyncValueRef<Chain>(std::move(error_av));
+}
+
+// SyncCompositeOp executes a composite op whose function is a SyncBEFFunction.
+// The function is run inline by a BEFInterpreter, without the async values and
+// the work queue tasks the BEF executor creates for every kernel. Invocations
+// whose arguments are not available yet are run when they become available.
+//
+// A BEFInterpreter can only run one invocation at a time, so the interpreters
+// are pooled and reused across invocations.
+class SyncCompositeOp : public std::enable_shared_from_this<SyncCompositeOp> {
+ public:
+  explicit SyncCompositeOp(const Function* fn) : fn_(fn) {}
+
+  void Execute(const OpInvocation& invocation);
+
+ private:
+  // Runs the function inline. `arguments` must be available.
+  Error Run(const ExecutionContext& exec_ctx,
+            MutableArrayRef<TensorHandle> arguments,
+            MutableArrayRef<TensorHandle> results);
+
+  std::unique_ptr<BEFInterpreter> AcquireInterpreter();
+  void ReleaseInterpreter(std::unique_ptr<BEFInterpreter> interpreter);
+
+  const Function* fn_;
+
+  mutex mu_;
+  llvm::SmallVector<std::unique_ptr<BEFInterpreter>, 2> interpreters_
+      TFRT_GUARDED_BY(mu_);
+};
+
+void SyncCompositeOp::Execute(const OpInvocation& invocation) {
+  if (auto error = CheckCompositeOpInvocation(invocation, *fn_,
+                                              /*num_chains=*/0)) {
+    SetCompositeOpError(invocation,
+                        EmitErrorAsync(invocation.exec_ctx, std::move(error)));
+    return;
+  }
+
+  AsyncValue* in_chain = invocation.chain && *invocation.chain
+                             ? invocation.chain->GetAsyncValue()
+                             : nullptr;
+
+  llvm::SmallVector<AsyncValue*, 4> pending;
+  if (in_chain && !in_chain->IsAvailable()) pending.push_back(in_chain);
+  for (auto& argument : invocation.arguments) {
+    if (!argument.GetAsyncTensor()->IsAvailable())
+      pending.push_back(argument.GetAsyncTensor());
+  }
+
+  if (pending.empty()) {
+    RCReference<AsyncValue> error_av;
+    if (in_chain && in_chain->IsError()) {
+      error_av = FormRef(in_chain);
+    } else if (auto error = Run(invocation.exec_ctx, invocation.arguments,
+                                invocation.results)) {
+      error_av = EmitErrorAsync(invocation.exec_ctx, std::move(error));
+    } else {
+      if (invocation.chain) *invocation.chain = GetReadyChain();
+      return;
+    }
+
+    SetCompositeOpError(invocation, std::move(error_av));
+    return;
+  }
+
+  // Some arguments are not available, run the function when they are. The
+  // results are returned as async values, like the results of a BEFFunction.
+  llvm::SmallVector<RCReference<AsyncValue>, 4> results;
+  results.reserve(invocation.results.size() + 1);
+  auto out_chain = MakeUnconstructedAsyncValueRef<Chain>();
+  results.push_back(out_chain.CopyRCRef());
+  llvm::SmallVector<AsyncValueRef<TensorHandle>, 4> result_ths;
+  result_ths.reserve(invocation.results.size());
+  for (size_t i = 0, e = invocation.results.size(); i != e; ++i) {
+    result_ths.push_back(MakeUnconstructedAsyncValueRef<TensorHandle>());
+    results.push_back(result_ths.back().CopyRCRef());
+  }
+
+  llvm::SmallVector<TensorHandle, 4> arguments;
+  arguments.reserve(invocation.arguments.size());
+  for (auto& argument : invocation.arguments)
+    arguments.push_back(std::move(argument));
+
+  RunWhenReady(pending, [op = shared_from_this(),
+                         exec_ctx = invocation.exec_ctx,
+                         in_chain = in_chain ? FormRef(in_chain)
+                                             : RCReference<AsyncValue>(),
+                         arguments = std::move(arguments),
+                         out_chain = std::move(out_chain),
+                         result_ths = std::move(result_ths)]() mutable {
+    RCReference<AsyncValue> error_av;
+    if (in_chain && in_chain->IsError()) {
+      error_av = std::move(in_chain);
+    } else {
+      llvm::SmallVector<TensorHandle, 4> results;
+      results.resize(result_ths.size());
+      if (auto error = op->Run(exec_ctx, arguments, results)) {
+        error_av = EmitErrorAsync(exec_ctx, std::move(error));
+      } else {
+        for (size_t i = 0, e = results.size(); i != e; ++i)
+          result_ths[i].emplace(std::move(results[i]));
+        out_chain.SetStateConcrete();
+        return;
+      }
+    }
+
+    for (auto& result_th : result_ths) result_th.SetError(error_av->GetError());
+    out_chain.SetError(error_av->GetError());
+  });
+
+  SetCompositeOpResults(invocation, results);
+}
+
+Error SyncCompositeOp::Run(const ExecutionContext& exec_ctx,
+                           MutableArrayRef<TensorHandle> arguments,
+                           MutableArrayRef<TensorHandle> results) {
+  // Move the arguments into the function, which may consume them (see
+  // CoreRuntime::Execute). This does not forward their buffers to the ops of
+  // the function: ExecuteOpImplSync passes copies of its arguments to the ops.
+  llvm::SmallVector<Value, 4> argument_values;
+  llvm::SmallVector<Value*, 4> argument_ptrs;
+  argument_values.reserve(arguments.size());
+  argument_ptrs.reserve(arguments.size());
+  for (auto& argument : arguments) {
+    argument_values.emplace_back(std::move(argument));
+    argument_ptrs.push_back(&argument_values.back());
+  }
+
+  llvm::SmallVector<Value, 4> result_values;
+  llvm::SmallVector<Value*, 4> result_ptrs;
+  result_values.resize(results.size());
+  result_ptrs.reserve(results.size());
+  for (auto& value : result_values) result_ptrs.push_back(&value);
+
+  std::unique_ptr<BEFInterpreter> interpreter = AcquireInterpreter();
+  // An interpreter that failed might hold the values of the failed execution,
+  // so it is not reused.
+  if (auto error = interpreter->Execute(exec_ctx, argument_ptrs, result_ptrs))
+    return error;
+  ReleaseInterpreter(std::move(interpreter));
+
+  for (size_t i = 0, e = results.size(); i != e; ++i)
+    results[i] = std::move(result_values[i].get<TensorHandle>());
+  return Error::success();
+}
+
+std::unique_ptr<BEFInterpreter> SyncCompositeOp::AcquireInterpreter() {
+  {
+    mutex_lock lock(mu_);
+    if (!interpreters_.empty()) return interpreters_.pop_back_val();
+  }
+  return std::make_unique<BEFInterpreter>(*fn_);
+}
+
+void SyncCompositeOp::ReleaseInterpreter(
+    std::unique_ptr<BEFInterpreter> interpreter) {
+  mutex_lock lock(mu_);
+  interpreters_.push_back(std::move(interpreter));
+}
+
+}  // namespace
+
 Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
-  for (const auto& iter : llvm::enumerate(fn->argument_types().drop_front())) {
+  // The first argument and result of a BEFFunction are chains. A
+  // SyncBEFFunction runs its kernels in order, and does not take chains.
+  const bool is_sync = fn->function_kind() == FunctionKind::kSyncBEFFunction;
+  const size_t num_chains = is_sync ? 0 : 1;
+
+  for (const auto& iter :
+       llvm::enumerate(fn->argument_types().drop_front(num_chains))) {
     size_t i = iter.index();
     auto& type = iter.value();
     if (type.GetName() != kTensorHandleType) {
@@ -248,7 +763,8 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
                              "-th argument is type [", type.GetName(), "].");
     }
   }
-  for (const auto& iter : llvm::enumerate(fn->result_types().drop_front())) {
+  for (const auto& iter :
+       llvm::enumerate(fn->result_types().drop_front(num_chains))) {
     size_t i = iter.index();
     auto& type = iter.value();
     if (type.GetName() != kTensorHandleType) {
@@ -257,10 +773,21 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
                              "-th results is type [", type.GetName(), "].");
     }
   }
+
+  if (is_sync) {
+    return CoreRuntimeOp(
+        [op = std::make_shared<SyncCompositeOp>(fn)](
+            const OpInvocation& invocation) { op->Execute(invocation); },
+        false);
+  }
+
   auto execute_fn = [fn = fn](const OpInvocation& invocation) {
-    // TODO(fishx): Return an error to the client instead of asserting.
-    assert(invocation.arguments.size() + 1 == fn->argument_types().size());
-    assert(invocation.results.size() + 1 == fn->result_types().size());
+    if (auto error = CheckCompositeOpInvocation(invocation, *fn,
+                                                /*num_chains=*/1)) {
+      SetCompositeOpError(
+          invocation, EmitErrorAsync(invocation.exec_ctx, std::move(error)));
+      return;
+    }
 
     llvm::SmallVector<AsyncValue*, 4> arguments;
     llvm::SmallVector<RCReference<AsyncValue>, 4> arguments_ref;
@@ -289,74 +816,7 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
 
     fn->Execute(invocation.exec_ctx, arguments, results);
 
-    // The first result is the a chain for side-effects.
-    if (invocation.chain)
-      *invocation.chain = AsyncValueRef<Chain>(std::move(results[0]));
-
-    for (const auto& iter : llvm::enumerate(llvm::drop_begin(results, 1))) {
-      size_t i = iter.index();
-      auto& result_av = iter.value();
-      if (result_av->IsAvailable()) {
-        if (result_av->IsError()) {
-          invocation.results[i] =
-              TensorHandle(AsyncValueRef<TensorHandle>(std::move(result_av)));
-        } else {
-          assert(result_av->IsType<TensorHandle>());
-          invocation.results[i] = result_av->get<TensorHandle>().CopyRef();
-        }
-      } else {
-        auto device_av = MakeUnconstructedAsyncValueRef<RCReference<Device>>();
-        auto metadata_av = MakeUnconstructedAsyncValueRef<TensorMetadata>();
-        auto tensor_ind_av = MakeIndirectAsyncValue();
-
-        result_av->AndThen([result_av = result_av,
-                            device_av = device_av.CopyRef(),
-                            metadata_av = metadata_av.CopyRef(),
-                            tensor_ind_av = tensor_ind_av]() mutable {
-          if (result_av->IsError()) {
-            device_av.SetError(result_av->GetError());
-            metadata_av.SetError(result_av->GetError());
-            tensor_ind_av->SetError(result_av->GetError());
-            return;
-          }
-          auto& th = result_av->get<TensorHandle>();
-
-          if (th.IsDeviceAvailable()) {
-            device_av.emplace(th.GetAvailableDevice());
-          } else {
-            th.GetAsyncDevice().AndThen(
-                [th_device = th.GetAsyncDevice().CopyRef(),
-                 device_av = std::move(device_av)]() {
-                  if (th_device.IsError()) {
-                    device_av.SetError(th_device.GetError());
-                  } else {
-                    device_av.emplace(th_device.get());
-                  }
-                });
-          }
-
-          if (th.IsMetadataAvailable()) {
-            metadata_av.emplace(th.GetAvailableMetadata());
-          } else {
-            th.GetAsyncMetadata().AndThen(
-                [th_metadata = th.GetAsyncMetadata().CopyRef(),
-                 metadata_av = std::move(metadata_av)]() {
-                  if (th_metadata.IsError()) {
-                    metadata_av.SetError(th_metadata.GetError());
-                  } else {
-                    metadata_av.emplace(th_metadata.get());
-                  }
-                });
-          }
-
-          tensor_ind_av->ForwardTo(FormRef(th.GetAsyncTensor()));
-        });
-
-        invocation.results[i] =
-            TensorHandle(std::move(device_av), std::move(metadata_av),
-                         AsyncValueRef<Tensor>(std::move(tensor_ind_av)));
-      }
-    }
+    SetCompositeOpResults(invocation, results);
   };
   return CoreRuntimeOp(std::move(execute_fn), false);
 }
@@ -35,6 +35,16 @@ CoreRuntimeOp::CoreRuntimeOp(
       device_(std::move(device)),
       arg_tensor_type_(std::move(arg_tensor_type)) {}
 
+CoreRuntimeOp::CoreRuntimeOp(
+    llvm::unique_function<void(const OpInvocation&) const>&& fn,
+    llvm::unique_function<void(ArrayRef<OpInvocation>, bool) const>&& batch_fn,
+    bool is_fallback, RCReference<Device> device, TensorType arg_tensor_type)
+    : fn_(std::move(fn)),
+      batch_fn_(std::move(batch_fn)),
+      is_fallback_(is_fallback),
+      device_(std::move(device)),
+      arg_tensor_type_(std::move(arg_tensor_type)) {}
+
 // is_fallback_ is not relevant.
 CoreRuntimeOp::CoreRuntimeOp(
     llvm::unique_function<void(const CompositeOpInvocation&) const>&& native_fn)
@@ -72,4 +82,16 @@ void CoreRuntimeOp::operator()(const CompositeOpInvocation& invocation) const {
   native_fn_(invocation);
 }
 
+void CoreRuntimeOp::ExecuteBatch(ArrayRef<OpInvocation> invocations,
+                                 bool parallel) const {
+#ifndef NDEBUG
+  for (const OpInvocation& invocation : invocations)
+    assert((invocation.chain || !invocation.results.empty()) &&
+           "Op invocation must have results or a chain");
+#endif
+
+  if (batch_fn_) return batch_fn_(invocations, parallel);
+  for (const OpInvocation& invocation : invocations) fn_(invocation);
+}
+
 }  // namespace tfrt
@@ -17,11 +17,38 @@
 
 #include "tfrt/core_runtime/dispatch_utils.h"
 
+#include "tfrt/core_runtime/op_metadata_cache.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 
 namespace tfrt {
 namespace internal {
+
+// Runs `metadata_fn`, unless its results for the same argument metadata and
+// attributes are memoized in the OpMetadataCache. Returns the error produced by
+// the metadata function, or null on success. The cache is not used if it is
+// disabled with OpMetadataCache::SetGlobalEnabled.
+static RCReference<AsyncValue> RunMetadataFunction(
+    const OpMetadataFn& metadata_fn, const ExecutionContext& exec_ctx,
+    ArrayRef<TensorMetadata> argument_mds, const OpAttrsRef& attrs,
+    MutableArrayRef<TensorMetadata> result_mds) {
+  if (!OpMetadataCache::IsGlobalEnabled()) {
+    TFRT_TRACE_SCOPE(Verbose, "RunMetadataFunction");
+    return metadata_fn(exec_ctx, argument_mds, attrs, result_mds);
+  }
+
+  OpMetadataCache& cache = OpMetadataCache::Global();
+  OpMetadataCache::Key key(metadata_fn, argument_mds, attrs);
+  if (cache.Lookup(key, attrs, result_mds)) return {};
+
+  // TODO(tfrt-devs): Remove this tracing tag when finished debugging
+  // dispatch performance.
+  TFRT_TRACE_SCOPE(Verbose, "RunMetadataFunction");
+  auto error = metadata_fn(exec_ctx, argument_mds, attrs, result_mds);
+  if (!error) cache.Insert(key, attrs, result_mds);
+  return error;
+}
+
 MDFunctionExecResult ExecuteMetadataFunction(
     const OpMetadataFn& metadata_fn, const OpInvocation& invocation,
     llvm::SmallVectorImpl<TensorMetadata>& result_mds) {
@@ -68,11 +95,9 @@ MDFunctionExecResult ExecuteMetadataFunction(
   // Okay, the shapes are available as we expect, get the result metadata.
   result_mds.resize(invocation.results.size());
 
-  // TODO(tfrt-devs): Remove this tracing tag when finished debugging
-  // dispatch performance.
-  TFRT_TRACE_SCOPE(Verbose, "RunMetadataFunction");
-  if (auto error = metadata_fn(invocation.exec_ctx, argument_mds,
-                               invocation.attrs, result_mds)) {
+  if (auto error = RunMetadataFunction(metadata_fn, invocation.exec_ctx,
+                                      argument_mds, invocation.attrs,
+                                      result_mds)) {
     // If the metadata function produced an error, propagate it.
     propagate_error(std::move(error));
     return MDFunctionExecResult::kError;
@@ -175,8 +200,8 @@ void ExecuteWhenMetadataIsReady(const OpInvocation& invocation,
     // Okay, the shapes are available as we expect, run the metadata
     // function to get the result shapes.
     llvm::SmallVector<TensorMetadata, 4> result_mds(num_results);
-    if (auto error =
-            metadata_fn(exec_ctx, argument_mds, frozen_attrs, result_mds)) {
+    if (auto error = RunMetadataFunction(metadata_fn, exec_ctx, argument_mds,
+                                        frozen_attrs, result_mds)) {
       // If the metadata function produced an error, propagate it.
       return propagate_error(error.get());
     }
@@ -33,6 +33,7 @@
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/ref_count.h"
@@ -316,6 +317,34 @@ static Chain RegisterOpHandler(Argument<OpHandler*> root,
   return Chain();
 }
 
+// ExecuteOpSync is the sync kernel of corert_sync.executeop, used by the
+// composite ops that run in the BEF interpreter.
+static void ExecuteOpSync(SyncKernelFrame* frame) {
+  const ExecutionContext& exec_ctx = frame->GetExecutionContext();
+  auto* op_handler = frame->GetArgAt<OpHandler*>(0);
+  StringAttr op_name(frame->GetAttributeAt(1));
+
+  auto expected_op = GetCoreRuntimeOp(op_name.GetValue(), op_handler, exec_ctx);
+  if (!expected_op) return frame->SetError(expected_op.takeError());
+
+  RepeatedSyncArguments<TensorHandle> args(frame->GetArguments().drop_front(),
+                                           frame->GetRegisters());
+  ExecuteOpImplSync(expected_op.get(), args, /*op_chain=*/nullptr, frame,
+                    frame->GetAggregateAttr(0), exec_ctx);
+}
+
+static void GetOpHandlerSync(SyncKernelFrame* frame) {
+  auto* runtime = CoreRuntime::GetFromHostContext(frame->GetHostContext());
+  assert(runtime);
+
+  StringAttribute op_handler_name = frame->GetStringAttribute(0);
+  if (auto* op_handler = runtime->GetOpHandler(op_handler_name.get())) {
+    return frame->EmplaceResultAt<OpHandler*>(0, op_handler);
+  }
+  frame->SetError(
+      MakeStringError("op_handler not found: ", op_handler_name.get()));
+}
+
 void CreateLoggingOpHandlerKernel(Argument<OpHandler*> fallback,
                                   Result<OpHandler*> op_handler,
                                   Attribute<bool> sync_log_results,
@@ -933,6 +962,8 @@ void RegisterCoreRuntimeKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(CoreRtGetDstTensorType));
   registry->AddKernel("corert.tensorhandle_to_int32",
                       TFRT_KERNEL(CoreRtTensorHandleToInt32));
+  registry->AddSyncKernel("corert_sync.executeop", ExecuteOpSync);
+  registry->AddSyncKernel("corert_sync.get_op_handler", GetOpHandlerSync);
 
   RegisterCreateDenseTensor(registry);
 }
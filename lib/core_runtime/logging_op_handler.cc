@@ -31,22 +31,31 @@
 #include <unistd.h>
 #endif
 
+#include <atomic>
+#include <fstream>
+#include <memory>
 #include <system_error>
 
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/kernels.h"
+#include "tfrt/core_runtime/logging_op_handler.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/core_runtime/op_invocation.h"
 #include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/dtype/dtype_formatter.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/btf_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
@@ -231,6 +240,132 @@ class LoggingOpHandler : public OpHandler {
   mutable mutex mu_;
   std::unique_ptr<llvm::raw_fd_ostream> metadata_ostream_ TFRT_GUARDED_BY(mu_);
 };
+
+// Waits for `tensor_handles`, copies them to the host and writes them to the
+// BTF file `filename`.
+Error WriteTensorHandlesToBTF(const ExecutionContext& exec_ctx,
+                              const std::string& filename,
+                              ArrayRef<TensorHandle> tensor_handles) {
+  auto* host = exec_ctx.host();
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> async_tensors;
+  async_tensors.reserve(tensor_handles.size());
+  for (auto& th : tensor_handles)
+    async_tensors.push_back(FormRef(th.GetAsyncTensor()));
+  host->Await(async_tensors);
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> async_dhts;
+  async_dhts.reserve(tensor_handles.size());
+  for (auto& th : tensor_handles) {
+    AsyncValue* tensor = th.GetAsyncTensor();
+    if (tensor->IsError()) return MakeStringError(tensor->GetError().message());
+    if (tensor->get<Tensor>().tensor_type() == DenseHostTensor::kTensorType) {
+      async_dhts.push_back(FormRef(tensor));
+    } else {
+      async_dhts.push_back(th.TransferTo(exec_ctx, host->GetHostDeviceRef(),
+                                         DenseHostTensor::kTensorType)
+                               .ReleaseTensorRef());
+    }
+  }
+  host->Await(async_dhts);
+
+  llvm::SmallVector<const Tensor*, 4> tensors;
+  tensors.reserve(async_dhts.size());
+  for (auto& async_dht : async_dhts) {
+    if (async_dht->IsError())
+      return MakeStringError(async_dht->GetError().message());
+    tensors.push_back(&async_dht->get<DenseHostTensor>());
+  }
+
+  std::ofstream stream(filename, std::ios::binary);
+  if (!stream) return MakeStringError("cannot open file ", filename);
+  return WriteTensorsToBTF(&stream, tensors);
+}
+
+// SampleWriter writes the tensors of the sampled invocations from blocking
+// tasks. The tasks share its ownership, so it can outlive the op handler.
+class SampleWriter : public std::enable_shared_from_this<SampleWriter> {
+ public:
+  SampleWriter(std::string dump_prefix, int max_pending_samples)
+      : dump_prefix_(std::move(dump_prefix)),
+        max_pending_samples_(max_pending_samples) {}
+
+  // Reserves a place in the queue for a sample. Returns false, and counts the
+  // sample as dropped, if the queue is full.
+  bool TryReserve() {
+    if (num_pending_.fetch_add(1, std::memory_order_relaxed) >=
+        max_pending_samples_) {
+      num_pending_.fetch_sub(1, std::memory_order_relaxed);
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Writes `tensor_handles` in the background, in the place reserved by
+  // TryReserve.
+  void Write(const ExecutionContext& exec_ctx, uint32_t id_number,
+             string_view op_name,
+             llvm::SmallVector<TensorHandle, 4> tensor_handles) {
+    bool enqueued = EnqueueBlockingWork(
+        exec_ctx.host(),
+        [writer = shared_from_this(), exec_ctx,
+         filename = StrCat(dump_prefix_, "op_", id_number, "_", op_name,
+                           ".btf"),
+         tensor_handles = std::move(tensor_handles)]() {
+          if (auto error =
+                  WriteTensorHandlesToBTF(exec_ctx, filename, tensor_handles))
+            TFRT_LOG(WARNING) << "Failed to write " << filename << ": "
+                              << std::move(error);
+          writer->num_pending_.fetch_sub(1, std::memory_order_relaxed);
+        });
+    if (!enqueued) {
+      num_pending_.fetch_sub(1, std::memory_order_relaxed);
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  int64_t num_dropped() const {
+    return num_dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  const std::string dump_prefix_;
+  const int max_pending_samples_;
+  std::atomic<int> num_pending_{0};
+  std::atomic<int64_t> num_dropped_{0};
+};
+
+// SamplingLoggingOpHandler is the sampling mode of the LoggingOpHandler. The
+// invocations that are not sampled only pay for an atomic increment.
+class SamplingLoggingOpHandler : public OpHandler {
+ public:
+  SamplingLoggingOpHandler(CoreRuntime* runtime, OpHandler* fallback,
+                           LoggingSamplingOptions options)
+      : OpHandler("sampling_logging", runtime, fallback),
+        sample_every_n_(options.sample_every_n),
+        writer_(std::make_shared<SampleWriter>(
+            std::move(options.dump_prefix), options.max_pending_samples)) {
+    for (const auto& op_name : options.op_names) op_names_.insert(op_name);
+  }
+
+  ~SamplingLoggingOpHandler() override {
+    if (auto num_dropped = writer_->num_dropped())
+      TFRT_LOG(WARNING) << "Dropped " << num_dropped << " sampled invocations";
+  }
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override;
+
+ private:
+  bool IsSampled(uint32_t id_number) const {
+    return sample_every_n_ != 0 && id_number % sample_every_n_ == 0;
+  }
+
+  const uint32_t sample_every_n_;
+  llvm::StringSet<> op_names_;
+  std::atomic<uint32_t> invocation_counter_{0};
+  std::shared_ptr<SampleWriter> writer_;
+};
 }  // namespace
 
 Expected<CoreRuntimeOp> LoggingOpHandler::MakeOp(string_view op_name) {
@@ -293,6 +428,36 @@ Expected<CoreRuntimeOp> LoggingOpHandler::MakeOp(string_view op_name) {
       /*is_fallback=*/false);
 }
 
+Expected<CoreRuntimeOp> SamplingLoggingOpHandler::MakeOp(string_view op_name) {
+  auto fallback_handle = GetFallback()->MakeOp(op_name);
+  if (!fallback_handle) return fallback_handle.takeError();
+  return CoreRuntimeOp(
+      [this, op_name = op_name.str(), sample_all = op_names_.contains(op_name),
+       fallback_handle =
+           std::move(fallback_handle.get())](const OpInvocation& invocation) {
+        auto id_number =
+            invocation_counter_.fetch_add(1, std::memory_order_relaxed);
+        if ((!sample_all && !IsSampled(id_number)) || !writer_->TryReserve())
+          return fallback_handle(invocation);
+
+        // The op can consume its arguments, keep references to them. This
+        // disables the buffer forwarding of the sampled invocations.
+        llvm::SmallVector<TensorHandle, 4> tensor_handles;
+        tensor_handles.reserve(invocation.arguments.size() +
+                               invocation.results.size());
+        for (auto& argument : invocation.arguments)
+          tensor_handles.push_back(argument.CopyRef());
+
+        fallback_handle(invocation);
+
+        for (auto& result : invocation.results)
+          tensor_handles.push_back(result.CopyRef());
+        writer_->Write(invocation.exec_ctx, id_number, op_name,
+                       std::move(tensor_handles));
+      },
+      /*is_fallback=*/false);
+}
+
 llvm::Expected<tfrt::OpHandler*> CreateLoggingOpHandler(
     tfrt::CoreRuntime* runtime, OpHandler* fallback, bool sync_log_results) {
   auto op_handler =
@@ -305,4 +470,14 @@ llvm::Expected<tfrt::OpHandler*> CreateLoggingOpHandler(
   return op_handler_ptr;
 }
 
+llvm::Expected<tfrt::OpHandler*> CreateSamplingLoggingOpHandler(
+    tfrt::CoreRuntime* runtime, OpHandler* fallback,
+    LoggingSamplingOptions options) {
+  auto op_handler = std::make_unique<SamplingLoggingOpHandler>(
+      runtime, fallback, std::move(options));
+  auto op_handler_ptr = op_handler.get();
+  runtime->TakeOpHandler(std::move(op_handler));
+  return op_handler_ptr;
+}
+
 }  // namespace tfrt
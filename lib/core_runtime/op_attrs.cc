@@ -16,6 +16,10 @@
 
 #include "tfrt/core_runtime/op_attrs.h"
 
+#include <algorithm>
+#include <unordered_map>
+
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Alignment.h"
@@ -26,6 +30,7 @@
 #include "tfrt/core_runtime/op_attr_type.h"
 #include "tfrt/dtype/quantized_types.h"
 #include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
 
 namespace tfrt {
@@ -112,6 +117,10 @@ OpAttrType GetOpAttrTypeFromBEFAttributeType(BEFAttributeType kind) {
 // to do at most one allocation to store the entire attribute set - no matter
 // how small or large the attribute set is.
 //
+// Entries are sorted by name, and the structural hash of the set is computed
+// once when it is created. Sets that do not refer to external buffers are
+// interned, so freezing identical attribute sets returns the same object.
+//
 class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
  public:
   // Note: users should not directly interface with this class, they should
@@ -121,18 +130,36 @@ class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
   void IterateEntries(
       const std::function<void(const OpAttrsRawEntry& entry)>& fn) const;
 
+  size_t GetHash() const { return hash_; }
+  bool IsInterned() const { return interned_; }
+
+  // Returns true if this set holds the same entries as `sorted_attrs`.
+  bool IsEqual(ArrayRef<const OpAttrsRawEntry*> sorted_attrs) const;
+
  private:
   friend class ReferenceCounted<ImmutableOpAttrs>;
   friend class OpAttrs;
+  friend class OpAttrsInterner;
 
   static RCReference<ImmutableOpAttrs> create(const OpAttrs& attrs);
-  explicit ImmutableOpAttrs(size_t num_entries) : num_entries_(num_entries) {}
+  static RCReference<ImmutableOpAttrs> create(
+      ArrayRef<const OpAttrsRawEntry*> sorted_attrs, size_t hash,
+      bool interned);
+
+  ImmutableOpAttrs(size_t num_entries, size_t hash, bool interned)
+      : num_entries_(num_entries), hash_(hash), interned_(interned) {}
 
   void Destroy();
 
   // This is the number of entries in this set.
   size_t num_entries_;
 
+  // The structural hash of the entries, see HashSortedAttrs.
+  size_t hash_;
+
+  // True if this set is owned by the OpAttrsInterner.
+  bool interned_;
+
   // The entries_ array is tail allocated here, and followed by the payload
   // data for the attributes.
   OpAttrsRawEntry entries_[];
@@ -320,6 +347,92 @@ static void GetSortedAttrs(
                        });
 }
 
+// Return the size of the payload of the specified attribute entry in bytes.
+static size_t GetPayloadSize(const OpAttrsRawEntry& entry) {
+  return GetHostSizeAndAlignment(entry.GetData(), entry.type).first *
+         entry.element_count;
+}
+
+static ArrayRef<char> GetPayload(const OpAttrsRawEntry& entry) {
+  return ArrayRef<char>(static_cast<const char*>(entry.GetData()),
+                        GetPayloadSize(entry));
+}
+
+// Return true if the entries have the same names, types and values. Entries
+// that only differ in where the value is stored are considered equal.
+static bool IsEqualEntry(const OpAttrsRawEntry& lhs,
+                         const OpAttrsRawEntry& rhs) {
+  return lhs.type == rhs.type && lhs.IsArray() == rhs.IsArray() &&
+         lhs.element_count == rhs.element_count &&
+         !strcmp(lhs.name, rhs.name) && GetPayload(lhs) == GetPayload(rhs);
+}
+
+// Return the structural hash of the sorted attribute entries.
+static size_t HashSortedAttrs(ArrayRef<const OpAttrsRawEntry*> sorted_attrs) {
+  llvm::hash_code hash = llvm::hash_value(sorted_attrs.size());
+  for (auto* entry : sorted_attrs) {
+    hash = llvm::hash_combine(hash, string_view(entry->name), entry->type,
+                              entry->IsArray(), entry->element_count,
+                              llvm::hash_value(GetPayload(*entry)));
+  }
+  return hash;
+}
+
+//===----------------------------------------------------------------------===//
+// OpAttrsInterner implementation
+//===----------------------------------------------------------------------===//
+
+// OpAttrsInterner is a process wide table of frozen attribute sets keyed by
+// their structural hash. The table keeps a reference to all interned sets, and
+// sets that are referenced only by the table are released when the table
+// grows beyond its capacity.
+class OpAttrsInterner {
+ public:
+  static OpAttrsInterner& Global() {
+    // Leaked intentionally, so that frozen attributes held by static objects
+    // can be released during static destruction.
+    static OpAttrsInterner* interner = new OpAttrsInterner();
+    return *interner;
+  }
+
+  // Return the interned set with the `sorted_attrs` entries, creating it if
+  // needed.
+  RCReference<ImmutableOpAttrs> GetOrCreate(
+      ArrayRef<const OpAttrsRawEntry*> sorted_attrs, size_t hash) {
+    mutex_lock lock(mu_);
+
+    auto range = attrs_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second->IsEqual(sorted_attrs)) return it->second.CopyRef();
+    }
+
+    if (attrs_.size() >= capacity_) ReleaseUnused();
+
+    auto attrs = ImmutableOpAttrs::create(sorted_attrs, hash,
+                                          /*interned=*/true);
+    attrs_.emplace(hash, attrs.CopyRef());
+    return attrs;
+  }
+
+ private:
+  static constexpr size_t kInitialCapacity = 1024;
+
+  // Release the sets that are referenced only by the table. The capacity is
+  // doubled if the table is still more than half full, so that the cost of
+  // releasing is amortized over the inserts.
+  void ReleaseUnused() TFRT_REQUIRES(mu_) {
+    for (auto it = attrs_.begin(); it != attrs_.end();) {
+      it = it->second->IsUnique() ? attrs_.erase(it) : std::next(it);
+    }
+    if (attrs_.size() > capacity_ / 2) capacity_ *= 2;
+  }
+
+  mutex mu_;
+  size_t capacity_ TFRT_GUARDED_BY(mu_) = kInitialCapacity;
+  std::unordered_multimap<size_t, RCReference<ImmutableOpAttrs>> attrs_
+      TFRT_GUARDED_BY(mu_);
+};
+
 //===----------------------------------------------------------------------===//
 // OpAttrs::OutOfLineRepresentation implementation
 //===----------------------------------------------------------------------===//
@@ -589,6 +702,22 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs& attrs) {
   llvm::SmallVector<const OpAttrsRawEntry*, 16> sorted_attrs;
   GetSortedAttrs(OpAttrsRef(attrs), &sorted_attrs);
 
+  size_t hash = HashSortedAttrs(sorted_attrs);
+
+  // Externally allocated buffers are only guaranteed to be alive as long as the
+  // frozen set created from them, so sets referring to them are not shared.
+  bool has_external = llvm::any_of(
+      sorted_attrs, [](const OpAttrsRawEntry* entry) {
+        return entry->IsExternal();
+      });
+  if (has_external) return create(sorted_attrs, hash, /*interned=*/false);
+
+  return OpAttrsInterner::Global().GetOrCreate(sorted_attrs, hash);
+}
+
+RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(
+    ArrayRef<const OpAttrsRawEntry*> sorted_attrs, size_t hash,
+    bool interned) {
   // Figure out how much space we need to hold these attributes.
   size_t alloc_size =
       sizeof(ImmutableOpAttrs) + sizeof(OpAttrsRawEntry) * sorted_attrs.size();
@@ -616,7 +745,8 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs& attrs) {
 
   // Now that we know the size, create the result.
   auto* raw_memory = AlignedAlloc(alignof(ImmutableOpAttrs), alloc_size);
-  auto* result = new (raw_memory) ImmutableOpAttrs(sorted_attrs.size());
+  auto* result =
+      new (raw_memory) ImmutableOpAttrs(sorted_attrs.size(), hash, interned);
 
   char* data_ptr = static_cast<char*>(raw_memory);
 
@@ -678,12 +808,25 @@ void ImmutableOpAttrs::Destroy() {
 // Look up an attribute by name, regardless of its underlying type.
 // On lookup failure, the result is null.
 const OpAttrsRawEntry* ImmutableOpAttrs::GetRaw(string_view attr_name) const {
-  // If we only have a few entries, do a linear search for the name.
-  // TODO(tf_runtime_team): implement a binary search for more elements.
+  // Entries are sorted by name, so we can binary search for the name.
+  const OpAttrsRawEntry* begin = entries_;
+  const OpAttrsRawEntry* end = entries_ + num_entries_;
+  auto* it = std::lower_bound(
+      begin, end, attr_name,
+      [](const OpAttrsRawEntry& entry, string_view name) {
+        return string_view(entry.name) < name;
+      });
+  if (it != end && string_view(it->name) == attr_name) return it;
+  return nullptr;
+}
+
+bool ImmutableOpAttrs::IsEqual(
+    ArrayRef<const OpAttrsRawEntry*> sorted_attrs) const {
+  if (num_entries_ != sorted_attrs.size()) return false;
   for (size_t i = 0, e = num_entries_; i != e; ++i) {
-    if (!strcmp(entries_[i].name, attr_name.data())) return &entries_[i];
+    if (!IsEqualEntry(entries_[i], *sorted_attrs[i])) return false;
   }
-  return nullptr;
+  return true;
 }
 
 // Iterate over all of the entries in the attribute set, allowing dynamic
@@ -827,6 +970,35 @@ static void PrintElement(const void* ptr, OpAttrType type, raw_ostream& os) {
   }
 }
 
+size_t OpAttrsRef::GetHash() const {
+  if (auto* ptr = attrs_.dyn_cast<ImmutableOpAttrs*>()) return ptr->GetHash();
+
+  llvm::SmallVector<const OpAttrsRawEntry*, 16> sorted_attrs;
+  GetSortedAttrs(*this, &sorted_attrs);
+  return HashSortedAttrs(sorted_attrs);
+}
+
+bool OpAttrsRef::IsEqual(const OpAttrsRef& other) const {
+  auto* lhs = attrs_.dyn_cast<ImmutableOpAttrs*>();
+  auto* rhs = other.attrs_.dyn_cast<ImmutableOpAttrs*>();
+
+  if (lhs && rhs) {
+    if (lhs == rhs) return true;
+    // Interned sets are unique, so different interned sets are never equal.
+    if (lhs->IsInterned() && rhs->IsInterned()) return false;
+    if (lhs->GetHash() != rhs->GetHash()) return false;
+  }
+  if (GetNumEntries() != other.GetNumEntries()) return false;
+
+  llvm::SmallVector<const OpAttrsRawEntry*, 16> lhs_attrs, rhs_attrs;
+  GetSortedAttrs(*this, &lhs_attrs);
+  GetSortedAttrs(other, &rhs_attrs);
+  for (size_t i = 0, e = lhs_attrs.size(); i != e; ++i) {
+    if (!IsEqualEntry(*lhs_attrs[i], *rhs_attrs[i])) return false;
+  }
+  return true;
+}
+
 OpAttrsRef OpAttrsRef::freeze() const {
   if (auto* ptr = attrs_.dyn_cast<const OpAttrs*>()) return ptr->freeze();
   if (auto* ptr = attrs_.dyn_cast<ImmutableOpAttrs*>())
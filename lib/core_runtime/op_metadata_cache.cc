@@ -0,0 +1,167 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements OpMetadataCache.
+
+#include "tfrt/core_runtime/op_metadata_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "tfrt/core_runtime/op_attr_type.h"
+#include "tfrt/core_runtime/op_attrs.h"
+
+namespace tfrt {
+namespace {
+
+// Attributes with larger payloads are not cached.
+constexpr size_t kMaxAttrsPayloadSize = 1024;
+
+// The cache used by the op dispatch.
+constexpr size_t kGlobalCapacity = 4096;
+
+template <typename T>
+void AppendToKey(llvm::SmallString<128>* key, const T& value) {
+  static_assert(std::is_trivially_copyable<T>::value, "must be a POD");
+  key->append(reinterpret_cast<const char*>(&value),
+              reinterpret_cast<const char*>(&value) + sizeof(T));
+}
+
+// Returns true if the attribute payloads are small enough to be cached.
+bool HasSmallPayload(const OpAttrsRef& attrs) {
+  size_t payload_size = 0;
+  attrs.IterateEntries([&](const OpAttrsRawEntry& entry) {
+    payload_size +=
+        GetHostSizeAndAlignment(entry.GetData(), entry.type).first *
+        entry.element_count;
+  });
+  return payload_size <= kMaxAttrsPayloadSize;
+}
+
+std::atomic<bool> global_enabled{true};
+
+}  // namespace
+
+OpMetadataCache::Key::Key(OpMetadataFn metadata_fn,
+                          ArrayRef<TensorMetadata> inputs,
+                          const OpAttrsRef& attrs)
+    : cacheable_(HasSmallPayload(attrs)) {
+  if (!cacheable_) return;
+
+  AppendToKey(&bytes_, metadata_fn);
+  AppendToKey(&bytes_, inputs.size());
+  for (const TensorMetadata& md : inputs) {
+    AppendToKey(&bytes_, md.dtype);
+    int rank = md.shape.GetRank();
+    AppendToKey(&bytes_, rank);
+    for (int i = 0; i < rank; ++i)
+      AppendToKey(&bytes_, md.shape.GetDimensionSize(i));
+  }
+  // The attributes are only hashed, they are compared with the cached copy on
+  // lookup.
+  AppendToKey(&bytes_, attrs.GetHash());
+}
+
+OpMetadataCache::OpMetadataCache(size_t capacity)
+    : shard_capacity_(std::max<size_t>(1, capacity / kNumShards)) {}
+
+OpMetadataCache& OpMetadataCache::Global() {
+  static OpMetadataCache* cache = new OpMetadataCache(kGlobalCapacity);
+  return *cache;
+}
+
+void OpMetadataCache::SetGlobalEnabled(bool enabled) {
+  global_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool OpMetadataCache::IsGlobalEnabled() {
+  return global_enabled.load(std::memory_order_relaxed);
+}
+
+OpMetadataCache::Shard& OpMetadataCache::GetShard(string_view key) {
+  return shards_[llvm::hash_value(key) % kNumShards];
+}
+
+bool OpMetadataCache::Lookup(const Key& key, const OpAttrsRef& attrs,
+                             MutableArrayRef<TensorMetadata> results) {
+  if (!key.IsCacheable()) return false;
+
+  Shard& shard = GetShard(key.bytes_);
+  {
+    mutex_lock lock(shard.mu);
+    auto it = shard.entries.find(key.bytes_);
+    if (it != shard.entries.end() && it->second.attrs.IsEqual(attrs)) {
+      CachedResults& cached = it->second;
+      assert(cached.results.size() == results.size());
+      llvm::copy(cached.results, results.begin());
+      shard.lru.splice(shard.lru.begin(), shard.lru, cached.lru_position);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void OpMetadataCache::Insert(const Key& key, const OpAttrsRef& attrs,
+                             ArrayRef<TensorMetadata> results) {
+  if (!key.IsCacheable()) return;
+
+  // Freeze the attributes before taking the lock, freezing mutable attributes
+  // allocates.
+  OpAttrsRef frozen_attrs = attrs.freeze();
+
+  Shard& shard = GetShard(key.bytes_);
+  mutex_lock lock(shard.mu);
+
+  auto inserted =
+      shard.entries.try_emplace(key.bytes_, std::move(frozen_attrs), results);
+  // Another thread might have inserted the same results, or the results of
+  // attributes with the same hash, which are kept.
+  if (!inserted.second) return;
+
+  CachedResults& cached = inserted.first->second;
+  shard.lru.push_front(inserted.first->first());
+  cached.lru_position = shard.lru.begin();
+
+  if (shard.entries.size() > shard_capacity_) {
+    string_view evicted = shard.lru.back();
+    shard.lru.pop_back();
+    shard.entries.erase(evicted);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void OpMetadataCache::Clear() {
+  for (Shard& shard : shards_) {
+    mutex_lock lock(shard.mu);
+    shard.lru.clear();
+    shard.entries.clear();
+  }
+}
+
+OpMetadataCache::Stats OpMetadataCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace tfrt
@@ -21,6 +21,7 @@
 #include <utility>
 
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/memory_budget.h"
 #include "tfrt/host_context/task_function.h"
 
 namespace tfrt {
@@ -36,6 +37,14 @@ void Await(HostContext* host, ArrayRef<RCReference<AsyncValue>> values) {
 
 void EnqueueWork(const ExecutionContext& exec_ctx,
                  llvm::unique_function<void()> work) {
+  // The work of a request with a memory budget is charged to its budget.
+  if (MemoryBudget* budget = exec_ctx.memory_budget()) {
+    work = [budget, work = std::move(work)]() mutable {
+      MemoryBudget::Scope memory_budget_scope(budget);
+      work();
+    };
+  }
+
   auto& work_queue = exec_ctx.work_queue();
   work_queue.AddTask(TaskFunction(std::move(work)));
 }
@@ -53,7 +53,8 @@ void RequestContext::Cancel() { cancellation_->Cancel(); }
 
 Expected<RCReference<RequestContext>> RequestContextBuilder::build() && {
   return TakeRef(new RequestContext(host_, resource_context_,
-                                    std::move(context_data_), id_));
+                                    std::move(context_data_), id_,
+                                    memory_budget_));
 };
 
 ExecutionContext::ExecutionContext(RCReference<RequestContext> req_ctx,
@@ -0,0 +1,97 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- memory_budget.cc - Memory Budget Allocator -------------------------===//
+//
+// This file implements the host allocator that charges a MemoryBudget.
+
+#include "tfrt/host_context/memory_budget.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+
+static thread_local MemoryBudget* current_budget = nullptr;
+
+MemoryBudget::Scope::Scope(MemoryBudget* budget) : previous_(current_budget) {
+  current_budget = budget;
+}
+
+MemoryBudget::Scope::~Scope() { current_budget = previous_; }
+
+MemoryBudget* MemoryBudget::Current() { return current_budget; }
+
+namespace {
+
+// Every allocation is prefixed with a header that records the charged budget,
+// because the memory may be deallocated by another thread or request.
+struct AllocationHeader {
+  MemoryBudget* budget;
+  // The offset of the allocation from the underlying allocation.
+  size_t offset;
+};
+
+class MemoryBudgetAllocator : public HostAllocator {
+ public:
+  explicit MemoryBudgetAllocator(std::unique_ptr<HostAllocator> allocator)
+      : allocator_(std::move(allocator)) {
+    assert(allocator_);
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    // The offset keeps the allocation aligned, and is a multiple of the
+    // header alignment.
+    const size_t offset = std::max(alignment, kHeaderSize);
+    auto* base =
+        static_cast<char*>(allocator_->AllocateBytes(size + offset, offset));
+    if (!base) return nullptr;
+
+    MemoryBudget* budget = MemoryBudget::Current();
+    if (budget) budget->Charge(size);
+
+    char* ptr = base + offset;
+    new (ptr - kHeaderSize) AllocationHeader{budget, offset};
+    return ptr;
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    auto* header = reinterpret_cast<AllocationHeader*>(static_cast<char*>(ptr) -
+                                                       kHeaderSize);
+    if (header->budget) header->budget->Release(size);
+    allocator_->DeallocateBytes(static_cast<char*>(ptr) - header->offset,
+                                size + header->offset);
+  }
+
+ private:
+  static constexpr size_t kHeaderSize = 16;
+  static_assert(sizeof(AllocationHeader) <= kHeaderSize,
+                "allocation header does not fit");
+
+  std::unique_ptr<HostAllocator> allocator_;
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateMemoryBudgetAllocator(
+    std::unique_ptr<HostAllocator> allocator) {
+  return std::make_unique<MemoryBudgetAllocator>(std::move(allocator));
+}
+
+}  // namespace tfrt
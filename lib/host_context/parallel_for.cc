@@ -18,6 +18,8 @@
 
 #include "tfrt/host_context/parallel_for.h"
 
+#include <algorithm>
+
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
@@ -26,30 +28,69 @@ namespace tfrt {
 
 using BlockSizes = ParallelFor::BlockSizes;
 
+// Do not create too many small blocks.
+static constexpr size_t kMaxOversharding = 4;
+
 //===----------------------------------------------------------------------===//
 // BlockSizes configures how a range is split into blocks executed in parallel.
 //===----------------------------------------------------------------------===//
 
 BlockSizes ParallelFor::BlockSizes::Fixed(size_t n) {
-  return BlockSizes([n](size_t) { return n; });
+  return BlockSizes([n](size_t, size_t, size_t) { return n; });
 }
 
 BlockSizes ParallelFor::BlockSizes::Min(size_t min) {
-  return BlockSizes(
-      [min](size_t block_size) { return std::max(min, block_size); });
+  return BlockSizes([min](size_t, size_t, size_t block_size) {
+    return std::max(min, block_size);
+  });
+}
+
+BlockSizes ParallelFor::BlockSizes::Cost(double bytes_loaded,
+                                         double bytes_stored,
+                                         double compute_cycles) {
+  // Cost model constants are the same as in the Eigen TensorCostModel.
+  static constexpr double kLoadCycles = 11.0 / 64;
+  static constexpr double kStoreCycles = 11.0 / 64;
+  // Cost of starting the first parallel task, and of each additional thread.
+  static constexpr double kStartupCycles = 100000;
+  static constexpr double kPerThreadCycles = 100000;
+  // Target cost of a single block.
+  static constexpr double kTaskSize = 40000;
+
+  const double cost_per_element = bytes_loaded * kLoadCycles +
+                                  bytes_stored * kStoreCycles + compute_cycles;
+
+  return BlockSizes([cost_per_element](size_t num_worker_threads,
+                                       size_t total_size, size_t) -> size_t {
+    const double total_cost = cost_per_element * total_size;
+
+    // Execute cheap ranges as a single block in the caller thread.
+    if (total_cost <= kStartupCycles) return total_size;
+
+    // Number of threads that can be kept busy amortizing the startup cost.
+    const double threads =
+        (total_cost - kStartupCycles) / kPerThreadCycles + 0.9;
+    const size_t num_threads = static_cast<size_t>(
+        std::min(static_cast<double>(num_worker_threads), threads));
+    if (num_threads <= 1) return total_size;
+
+    // Split the range into blocks of roughly `kTaskSize` cycles, to balance
+    // the load between threads, without creating too many small blocks.
+    size_t num_blocks = static_cast<size_t>(total_cost / kTaskSize);
+    num_blocks = std::min(num_blocks, kMaxOversharding * num_threads);
+    num_blocks = std::max(num_blocks, num_threads);
+    return (total_size + num_blocks - 1) / num_blocks;
+  });
 }
 
 size_t ParallelFor::BlockSizes::GetBlockSize(size_t num_worker_threads,
                                              size_t total_size) const {
-  // Do not create too many small blocks.
-  static constexpr size_t kMaxOversharding = 4;
-
   // Split input range to assign `kMaxOversharding` tasks to each worker thread.
   assert(total_size > 0 && "Illegal total size");
   size_t block_size = total_size / (kMaxOversharding * num_worker_threads);
 
   // Compute final block sizes using implementation function if it is specified.
-  if (impl_) block_size = impl_(block_size);
+  if (impl_) block_size = impl_(num_worker_threads, total_size, block_size);
   assert(block_size >= 0 && "Illegal block size");
   block_size = std::min(block_size, total_size);
 
@@ -17,6 +17,7 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <optional>
 #include <utility>
@@ -29,6 +30,7 @@
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/conversion_utils.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
@@ -105,29 +107,53 @@ bool operator==(const DenseHostTensor& a, const DenseHostTensor& b) {
              0;
 }
 
+// Copies larger than this are split into parallel blocks of at least this size.
+static constexpr size_t kMinParallelCopyBlockSize = 1 << 20;
+
 static AsyncValueRef<DenseHostTensor> ConvertDenseHostTensorToDenseHostTensor(
     const DenseHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
     const ExecutionContext& exec_ctx) {
-  auto* host = exec_ctx.host();
-  // We need to make a copy of the data, because the source and result
-  // buffers are logically independent.
-  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  // All CPU devices share the host memory, so the result shares the source
+  // buffer, unless it does not meet the alignment requirement for DHT buffers.
+  // The result aliases the source tensor: kernels that write through a
+  // MutableDHTArrayView (e.g. tfrt_dht.set_tensor_with_values) modify both of
+  // them. Such kernels must only be applied to tensors that are not converted
+  // or otherwise shared, as for any other DenseHostTensor::CopyRef.
+  size_t alignment =
+      std::max(GetHostAlignment(tensor.dtype()), kTensorBufferAlignment);
+  if (reinterpret_cast<uintptr_t>(tensor.data()) % alignment == 0)
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(tensor.CopyRef());
 
+  auto* host = exec_ctx.host();
   auto result_alloc =
       DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
   if (!result_alloc)
     return MakeErrorAsyncValueRef("out of memory copying tensor");
 
-  auto& result_tensor = result_alloc.value();
-
-  // TODO(tfrt-devs): This could be done in parallel in the background for
-  // large tensors.  We could also detect when the tensor is full of broadcasted
-  // data and convert to ScalarHostTensor.
+  auto* dst_data = static_cast<char*>(result_alloc->data());
+  auto* src_data = static_cast<const char*>(tensor.data());
+  size_t size = tensor.DataSizeInBytes();
 
-  // Copy over the data.
-  memcpy(result_tensor.data(), tensor.data(), tensor.DataSizeInBytes());
+  // TODO(tfrt-devs): We could also detect when the tensor is full of
+  // broadcasted data and convert to ScalarHostTensor.
+  if (size <= kMinParallelCopyBlockSize) {
+    memcpy(dst_data, src_data, size);
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(
+        std::move(result_alloc.value()));
+  }
 
-  result.emplace(std::move(result_tensor));
+  // Copy large tensors in parallel. The source buffer is kept alive until the
+  // copy completes.
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  ParallelFor(exec_ctx).Execute(
+      size, ParallelFor::BlockSizes::Min(kMinParallelCopyBlockSize),
+      [dst_data, src_data](size_t begin, size_t end) {
+        memcpy(dst_data + begin, src_data + begin, end - begin);
+      },
+      [result = result.CopyRef(), src_buffer = tensor.buffer().CopyRef(),
+       dst = std::move(result_alloc.value())]() mutable {
+        result.emplace(std::move(dst));
+      });
   return result;
 }
 
@@ -41,6 +41,18 @@ static Chain TestAtomicAddI32(Argument<std::atomic<int32_t>> in,
   return Chain();
 }
 
+// Increments `in` and raises `max` to the incremented value, which records the
+// peak value of a counter of concurrent events.
+static Chain TestAtomicIncMaxI32(Argument<std::atomic<int32_t>> in,
+                                 Argument<std::atomic<int32_t>> max) {
+  const int32_t value = in->fetch_add(1) + 1;
+  int32_t current_max = max->load();
+  while (current_max < value &&
+         !max->compare_exchange_weak(current_max, value)) {
+  }
+  return Chain();
+}
+
 static std::pair<int32_t, Chain> TestAtomicGetI32(
     Argument<std::atomic<int32_t>> in) {
   return {in->load(), Chain()};
@@ -54,6 +66,8 @@ void RegisterAtomicTestKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(TestAtomicIncI32));
   registry->AddKernel("tfrt_test.atomic.add.i32",
                       TFRT_KERNEL(TestAtomicAddI32));
+  registry->AddKernel("tfrt_test.atomic.inc_max.i32",
+                      TFRT_KERNEL(TestAtomicIncMaxI32));
   registry->AddKernel("tfrt_test.atomic.get.i32",
                       TFRT_KERNEL(TestAtomicGetI32));
 }
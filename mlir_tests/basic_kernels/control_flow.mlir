@@ -134,6 +134,46 @@ func.func @controlflow_repeat_large() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'controlflow_repeat_block_size'
+func.func @controlflow_repeat_block_size() {
+  %count = tfrt.constant.i32 10
+  %v0 = tfrt.constant.i32 42
+
+  // The loop-carried value is waited on after every 4 iterations.
+  %sum = tfrt.repeat.i32 %count, %v0 attributes {block_size = 4 : i32} : i32 {
+    %one = tfrt.constant.i32 1
+    %v2 = "tfrt_test.async_add.i32"(%v0, %one) : (i32, i32) -> i32
+    tfrt.return %v2: i32
+  }
+
+  %ch0 = tfrt.new.chain
+  // CHECK-NEXT: int32 = 52
+  tfrt.print.i32 %sum, %ch0
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'controlflow_repeat_independent'
+func.func @controlflow_repeat_independent() {
+  %count = tfrt.constant.i32 100
+  %v0 = tfrt.constant.i32 42
+
+  // Every iteration gets the initial value, so the result of the last
+  // iteration is 43 regardless of how the iterations are sharded.
+  %res = tfrt.repeat.i32 %count, %v0
+      attributes {block_size = 8 : i32, independent_iterations = true} : i32 {
+    %one = tfrt.constant.i32 1
+    %v2 = "tfrt_test.async_add.i32"(%v0, %one) : (i32, i32) -> i32
+    tfrt.return %v2: i32
+  }
+
+  %ch0 = tfrt.new.chain
+  // CHECK-NEXT: int32 = 43
+  tfrt.print.i32 %res, %ch0
+
+  tfrt.return
+}
+
 // CHECK-LABEL: --- Running 'controlflow_repeat_cancel'
 func.func @controlflow_repeat_cancel() -> i32 {
   %ch0 = tfrt.new.chain
@@ -305,6 +345,51 @@ func.func @tfrt_parallel_while_test() -> !tfrt.chain {
   tfrt.return %ch3 : !tfrt.chain
 }
 
+func.func @tfrt_windowed_while_body(%ch: !tfrt.chain, %iteration: i32, %in_flight: !test.atomic.i32, %max_in_flight: !test.atomic.i32) -> (!tfrt.chain, i32, !test.atomic.i32, !test.atomic.i32, i1) {
+  %one = tfrt.constant.i32 1
+  %minus_one = tfrt.constant.i32 -1
+  %hundred = tfrt.constant.i32 100
+  %sleep_us = tfrt.constant.i32 10
+  %next_iteration = tfrt.add.i32 %iteration, %one
+
+  // The iteration is counted as in flight from the start of the body until
+  // the work is done, which happens before the body results are available.
+  %entered = "tfrt_test.atomic.inc_max.i32"(%in_flight, %max_in_flight) : (!test.atomic.i32, !test.atomic.i32) -> !tfrt.chain
+  %work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+  %done = tfrt.merge.chains %entered, %work : !tfrt.chain, !tfrt.chain
+  %left = "tfrt_test.atomic.add.i32"(%in_flight, %minus_one, %done) : (!test.atomic.i32, i32, !tfrt.chain) -> !tfrt.chain
+
+  %next_cond = "tfrt.lessequal.i32"(%next_iteration, %hundred) : (i32, i32) -> (i1)
+
+  tfrt.return %left, %next_iteration, %in_flight, %max_in_flight, %next_cond : !tfrt.chain, i32, !test.atomic.i32, !test.atomic.i32, i1
+}
+
+// Iterations only depend on each other through the iteration count, so more
+// than `parallel_iterations` of them could be in flight without the window.
+// CHECK-LABEL: --- Running 'tfrt_windowed_while_test'
+func.func @tfrt_windowed_while_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  %cond = tfrt.constant.i1 true
+  %iteration = tfrt.constant.i32 0
+  %in_flight = "tfrt_test.atomic.create.i32"() : () -> !test.atomic.i32
+  %max_in_flight = "tfrt_test.atomic.create.i32"() : () -> !test.atomic.i32
+
+  %ch1, %final_iteration, %in_flight_out, %max_in_flight_out = tfrt.while %cond @tfrt_windowed_while_body(%ch0, %iteration, %in_flight, %max_in_flight) parallel_iterations(2) : (!tfrt.chain, i32, !test.atomic.i32, !test.atomic.i32) -> (!tfrt.chain, i32, !test.atomic.i32, !test.atomic.i32)
+
+  // CHECK: int32 = 101
+  %ch2 = tfrt.print.i32 %final_iteration, %ch1
+
+  // The peak number of concurrent iterations is bounded by the window.
+  %window = tfrt.constant.i32 2
+  %peak, %ch3 = "tfrt_test.atomic.get.i32"(%max_in_flight_out, %ch2) : (!test.atomic.i32, !tfrt.chain) -> (i32, !tfrt.chain)
+  %bounded = "tfrt.lessequal.i32"(%peak, %window) : (i32, i32) -> (i1)
+  // CHECK: int1 = 1
+  %ch4 = "tfrt.print.i1"(%bounded, %ch3) : (i1, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch4 : !tfrt.chain
+}
+
 func.func @tfrt_while_error_body(%ch: !tfrt.chain, %iteration: i32, %arg: i32) -> (!tfrt.chain, i32, i32, i1) {
   %one = tfrt.constant.i32 1
   %five = tfrt.constant.i32 5
@@ -39,3 +39,25 @@ func.func @if_mismatch(%cond: i1, %v1: i32, %v2: i32) -> i32 {
   }
   tfrt.return %v1 : i32
 }
+
+// -----
+
+func.func @repeat_zero_block_size(%count: i32, %v: i32) -> i32 {
+
+  // expected-error @+1 {{'tfrt.repeat.i32' op block_size must be positive}}
+  %res = tfrt.repeat.i32 %count, %v attributes {block_size = 0 : i32} : i32 {
+    tfrt.return %v : i32
+  }
+  tfrt.return %res : i32
+}
+
+// -----
+
+func.func @repeat_negative_block_size(%count: i32, %v: i32) -> i32 {
+
+  // expected-error @+1 {{'tfrt.repeat.i32' op block_size must be positive}}
+  %res = tfrt.repeat.i32 %count, %v attributes {block_size = -4 : i32, independent_iterations = true} : i32 {
+    tfrt.return %v : i32
+  }
+  tfrt.return %res : i32
+}
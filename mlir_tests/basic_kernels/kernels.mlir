@@ -56,6 +56,23 @@ func.func @repeat(%arg0: i32, %arg1: f32) -> i32 {
   tfrt.return %res1 : i32
 }
 
+// CHECK-LABEL: func @repeat_attributes(%arg0: i32, %arg1: f32) -> f32 {
+func.func @repeat_attributes(%arg0: i32, %arg1: f32) -> f32 {
+  // CHECK: tfrt.repeat.i32 %arg0, %arg1 attributes {block_size = 4 : i32} : f32 {
+  %res1 = tfrt.repeat.i32 %arg0, %arg1 attributes {block_size = 4 : i32} : f32 {
+    tfrt.return %arg1 : f32
+  }
+
+  // The parser adds the default block_size for independent iterations.
+
+  // CHECK: tfrt.repeat.i32 %arg0, %{{.*}} attributes {block_size = 32 : i32, independent_iterations = true} : f32 {
+  %res2 = tfrt.repeat.i32 %arg0, %res1 attributes {independent_iterations = true} : f32 {
+    tfrt.return %res1 : f32
+  }
+
+  tfrt.return %res2 : f32
+}
+
 // CHECK-LABEL: func @return(
 func.func @return(%arg: i32) -> i32 {
   // CHECK: tfrt.return %{{.*}} : i32
@@ -0,0 +1,99 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- repeat.benchmark.mlir ----------------------------------------------===//
+//
+// These benchmarks compare sequential and independent tfrt.repeat.i32 loops
+// for different body latencies. The body latency is simulated with blocking
+// sleeps so that it does not occupy the non-blocking work queue threads.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: bef_executor --work_queue_type=mstd:8 %s.bef | FileCheck %s
+
+// CHECK-LABEL: --- Running 'repeat.1us_body.sequential.benchmark'
+func.func @repeat.1us_body.sequential.benchmark() {
+  %count = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "repeat.1us_body.sequential"(
+    %count : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work = tfrt.repeat.i32 %count, %work0 attributes {block_size = 32 : i32} : !tfrt.chain {
+      %sleep_us = tfrt.constant.i32 1
+      %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+      tfrt.return %next_work : !tfrt.chain
+    }
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'repeat.1us_body.independent.benchmark'
+func.func @repeat.1us_body.independent.benchmark() {
+  %count = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "repeat.1us_body.independent"(
+    %count : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work = tfrt.repeat.i32 %count, %work0 attributes {block_size = 32 : i32, independent_iterations = true} : !tfrt.chain {
+      %sleep_us = tfrt.constant.i32 1
+      %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+      tfrt.return %next_work : !tfrt.chain
+    }
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'repeat.100us_body.sequential.benchmark'
+func.func @repeat.100us_body.sequential.benchmark() {
+  %count = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "repeat.100us_body.sequential"(
+    %count : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work = tfrt.repeat.i32 %count, %work0 attributes {block_size = 32 : i32} : !tfrt.chain {
+      %sleep_us = tfrt.constant.i32 100
+      %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+      tfrt.return %next_work : !tfrt.chain
+    }
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'repeat.100us_body.independent.benchmark'
+func.func @repeat.100us_body.independent.benchmark() {
+  %count = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "repeat.100us_body.independent"(
+    %count : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work = tfrt.repeat.i32 %count, %work0 attributes {block_size = 32 : i32, independent_iterations = true} : !tfrt.chain {
+      %sleep_us = tfrt.constant.i32 100
+      %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+      tfrt.return %next_work : !tfrt.chain
+    }
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
@@ -0,0 +1,144 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- while.benchmark.mlir -----------------------------------------------===//
+//
+// These benchmarks measure the throughput of tfrt.while loops with independent
+// iterations, for different body latencies and window sizes. The body latency
+// is simulated with blocking sleeps so that it does not occupy the non-blocking
+// work queue threads.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: bef_executor --work_queue_type=mstd:8 %s.bef | FileCheck %s
+
+func.func @while_body.1us(%work: !tfrt.chain, %iteration: i32, %end: i32) -> (!tfrt.chain, i32, i32, i1) {
+  %one = tfrt.constant.i32 1
+  %sleep_us = tfrt.constant.i32 1
+  %next_iteration = tfrt.add.i32 %iteration, %one
+  %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+  %next_cond = "tfrt.lessequal.i32"(%next_iteration, %end) : (i32, i32) -> (i1)
+  tfrt.return %next_work, %next_iteration, %end, %next_cond : !tfrt.chain, i32, i32, i1
+}
+
+// CHECK-LABEL: --- Running 'while.1us_body.parallel_iterations_2.benchmark'
+func.func @while.1us_body.parallel_iterations_2.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.1us_body.parallel_iterations_2"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.1us(%work0, %start, %end) parallel_iterations(2) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'while.1us_body.parallel_iterations_8.benchmark'
+func.func @while.1us_body.parallel_iterations_8.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.1us_body.parallel_iterations_8"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.1us(%work0, %start, %end) parallel_iterations(8) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'while.1us_body.parallel_iterations_32.benchmark'
+func.func @while.1us_body.parallel_iterations_32.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.1us_body.parallel_iterations_32"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.1us(%work0, %start, %end) parallel_iterations(32) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+func.func @while_body.100us(%work: !tfrt.chain, %iteration: i32, %end: i32) -> (!tfrt.chain, i32, i32, i1) {
+  %one = tfrt.constant.i32 1
+  %sleep_us = tfrt.constant.i32 100
+  %next_iteration = tfrt.add.i32 %iteration, %one
+  %next_work = "tfrt_test.blocking.usleep"(%sleep_us) : (i32) -> !tfrt.chain
+  %next_cond = "tfrt.lessequal.i32"(%next_iteration, %end) : (i32, i32) -> (i1)
+  tfrt.return %next_work, %next_iteration, %end, %next_cond : !tfrt.chain, i32, i32, i1
+}
+
+// CHECK-LABEL: --- Running 'while.100us_body.parallel_iterations_2.benchmark'
+func.func @while.100us_body.parallel_iterations_2.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.100us_body.parallel_iterations_2"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.100us(%work0, %start, %end) parallel_iterations(2) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'while.100us_body.parallel_iterations_8.benchmark'
+func.func @while.100us_body.parallel_iterations_8.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.100us_body.parallel_iterations_8"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.100us(%work0, %start, %end) parallel_iterations(8) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'while.100us_body.parallel_iterations_32.benchmark'
+func.func @while.100us_body.parallel_iterations_32.benchmark() {
+  %cond = tfrt.constant.i1 true
+  %start = tfrt.constant.i32 0
+  %end = tfrt.constant.i32 1000
+
+  tfrt_test.benchmark "while.100us_body.parallel_iterations_32"(
+    %cond : i1, %start : i32, %end : i32
+  ) duration_secs = 3, max_count = 1000, num_warmup_runs = 2 {
+    %work0 = tfrt.new.chain
+    %work, %iteration, %bound = tfrt.while %cond @while_body.100us(%work0, %start, %end) parallel_iterations(32) : (!tfrt.chain, i32, i32) -> (!tfrt.chain, i32, i32)
+    tfrt.return %work : !tfrt.chain
+  }
+
+  tfrt.return
+}
@@ -0,0 +1,79 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- memory_budget.benchmark.mlir ---------------------------------------===//
+//
+// This benchmark measures the latency of a wide graph of large allocations with
+// and without memory bounded scheduling. Compare the reported peak memory
+// budget usage with the benchmark latency to see the trade-off between memory
+// footprint and parallelism.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd:8 | FileCheck %s
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd:8 --memory_budget_bytes=1073741824 | FileCheck %s --check-prefixes=CHECK,BUDGET
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd:8 --memory_budget_bytes=1048576 | FileCheck %s --check-prefixes=CHECK,BUDGET
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd:8 --memory_budget_bytes=262144 | FileCheck %s --check-prefixes=CHECK,BUDGET
+
+module attributes {tfrt.cost_threshold = 10 : i64} {
+
+// CHECK-LABEL: --- Running 'wide_allocations.benchmark'
+func.func @wide_allocations.benchmark() {
+  // CHECK: BM:wide_allocations:Duration(ns):
+  // CHECK: BM:wide_allocations:Time 50%(ns):
+  tfrt_test.benchmark "wide_allocations"() duration_secs = 3, max_count = 10000, num_warmup_runs = 10 {
+    %ch0 = tfrt.new.chain
+
+    %t0 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f0 = tfrt_dht.fill_tensor_with_constant.f32 %t0, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t1 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f1 = tfrt_dht.fill_tensor_with_constant.f32 %t1, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t2 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f2 = tfrt_dht.fill_tensor_with_constant.f32 %t2, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t3 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f3 = tfrt_dht.fill_tensor_with_constant.f32 %t3, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t4 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f4 = tfrt_dht.fill_tensor_with_constant.f32 %t4, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t5 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f5 = tfrt_dht.fill_tensor_with_constant.f32 %t5, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t6 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f6 = tfrt_dht.fill_tensor_with_constant.f32 %t6, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t7 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f7 = tfrt_dht.fill_tensor_with_constant.f32 %t7, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t8 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f8 = tfrt_dht.fill_tensor_with_constant.f32 %t8, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t9 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f9 = tfrt_dht.fill_tensor_with_constant.f32 %t9, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t10 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f10 = tfrt_dht.fill_tensor_with_constant.f32 %t10, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t11 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f11 = tfrt_dht.fill_tensor_with_constant.f32 %t11, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t12 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f12 = tfrt_dht.fill_tensor_with_constant.f32 %t12, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t13 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f13 = tfrt_dht.fill_tensor_with_constant.f32 %t13, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t14 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f14 = tfrt_dht.fill_tensor_with_constant.f32 %t14, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+    %t15 = tfrt_dht.create_uninitialized_tensor.f32.1 [65536 : i64] {_tfrt_cost = 100 : i64}
+    %f15 = tfrt_dht.fill_tensor_with_constant.f32 %t15, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+
+    %ch1 = tfrt.merge.chains %f0, %f1, %f2, %f3, %f4, %f5, %f6, %f7, %f8, %f9, %f10, %f11, %f12, %f13, %f14, %f15 : !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain
+    tfrt.return %ch1 : !tfrt.chain
+  }
+
+  tfrt.return
+}
+// BUDGET: Peak memory budget usage:
+
+}
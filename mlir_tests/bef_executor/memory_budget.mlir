@@ -0,0 +1,71 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd --memory_budget_bytes=8192 2>&1 | FileCheck %s
+// RUN: bef_executor_lite %s.bef --work_queue_type=mstd --memory_budget_bytes=1 2>&1 | FileCheck %s
+
+// These tests check that the memory bounded scheduling mode runs all kernels
+// to completion when the memory budget is exceeded, including the degenerate
+// case where any allocation exceeds the budget.
+
+module attributes {tfrt.cost_threshold = 10 : i64} {
+
+// CHECK: Choosing memory budget of
+
+// CHECK-LABEL: --- Running 'wide_allocations'
+func.func @wide_allocations() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  %t0 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f0 = tfrt_dht.fill_tensor_with_constant.f32 %t0, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t1 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f1 = tfrt_dht.fill_tensor_with_constant.f32 %t1, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t2 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f2 = tfrt_dht.fill_tensor_with_constant.f32 %t2, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t3 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f3 = tfrt_dht.fill_tensor_with_constant.f32 %t3, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t4 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f4 = tfrt_dht.fill_tensor_with_constant.f32 %t4, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t5 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f5 = tfrt_dht.fill_tensor_with_constant.f32 %t5, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t6 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f6 = tfrt_dht.fill_tensor_with_constant.f32 %t6, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+  %t7 = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64] {_tfrt_cost = 100 : i64}
+  %f7 = tfrt_dht.fill_tensor_with_constant.f32 %t7, %ch0 1.0 : f32 {_tfrt_cost = 100 : i64}
+
+  %ch1 = tfrt.merge.chains %f0, %f1, %f2, %f3, %f4, %f5, %f6, %f7 : !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain, !tfrt.chain
+
+  // CHECK: DenseHostTensor dtype = f32, shape = [1024]
+  %ch2 = tfrt_dht.print_tensor %t7, %ch1
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: Peak memory budget usage:
+
+// CHECK-LABEL: --- Running 'deferred_results'
+func.func @deferred_results() -> i1 {
+  %ch0 = tfrt.new.chain
+
+  // Deferred kernels must still produce the same results.
+  %a = tfrt_dht.create_uninitialized_tensor.i32.1 [256 : i64] {_tfrt_cost = 100 : i64}
+  %ch1 = tfrt_dht.fill_tensor_with_constant.i32 %a, %ch0 7 : i32 {_tfrt_cost = 100 : i64}
+  %b = tfrt_dht.create_uninitialized_tensor.i32.1 [256 : i64] {_tfrt_cost = 100 : i64}
+  %ch2 = tfrt_dht.fill_tensor_with_constant.i32 %b, %ch0 7 : i32 {_tfrt_cost = 100 : i64}
+  %ch3 = tfrt.merge.chains %ch1, %ch2 : !tfrt.chain, !tfrt.chain
+
+  // CHECK: 'deferred_results' returned 1
+  %eq, %ch4 = tfrt_dht.tensor_equal.i32 %a, %b, %ch3
+  tfrt.return %eq : i1
+}
+
+}
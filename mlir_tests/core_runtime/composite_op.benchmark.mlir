@@ -0,0 +1,85 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- composite_op.benchmark.mlir ----------------------------------------===//
+//
+// These benchmarks compare the same composite op built from an async
+// BEFFunction, which is run by the BEF executor, and from a SyncBEFFunction,
+// which is run inline by a BEFInterpreter. The functions chain a few small
+// adds, so that the per kernel overheads dominate.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu --work_queue_type=mstd:8 %s.bef | FileCheck %s
+
+func.func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+
+func.func @async_add4(%ch: !tfrt.chain, %x: !corert.tensorhandle) -> (!tfrt.chain, !corert.tensorhandle) {
+  %cpu = corert.get_op_handler %ch "cpu"
+  %a = corert.executeop(%cpu) "tfrt_test.add"(%x, %x) : 1
+  %b = corert.executeop(%cpu) "tfrt_test.add"(%a, %x) : 1
+  %c = corert.executeop(%cpu) "tfrt_test.add"(%b, %x) : 1
+  %d = corert.executeop(%cpu) "tfrt_test.add"(%c, %x) : 1
+  tfrt.return %ch, %d : !tfrt.chain, !corert.tensorhandle
+}
+
+func.func @sync_add4(%x: !corert.tensorhandle) -> !corert.tensorhandle attributes {tfrt.sync} {
+  %cpu = corert_sync.get_op_handler "cpu"
+  %a = corert_sync.executeop(%cpu) "tfrt_test.add"(%x, %x) : 1
+  %b = corert_sync.executeop(%cpu) "tfrt_test.add"(%a, %x) : 1
+  %c = corert_sync.executeop(%cpu) "tfrt_test.add"(%b, %x) : 1
+  %d = corert_sync.executeop(%cpu) "tfrt_test.add"(%c, %x) : 1
+  tfrt.return %d : !corert.tensorhandle
+}
+
+// CHECK-LABEL: --- Running 'composite_op.async_fn.benchmark'
+func.func @composite_op.async_fn.benchmark() {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %x = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1 : i32] } : 1
+  %fn_op = "corert.make_composite_op" () {fn=@async_add4} : () -> !corert.op
+
+  tfrt_test.benchmark "composite_op.async_fn"(
+    %fn_op : !corert.op, %x : !corert.tensorhandle
+  ) duration_secs = 3, max_count = 1000000, num_warmup_runs = 10 {
+    %y = "corert.execute_crt_op" (%fn_op, %x) {op_attrs = [], op_func_attrs = []} : (!corert.op, !corert.tensorhandle) -> (!corert.tensorhandle)
+    tfrt.return %y : !corert.tensorhandle
+  }
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'composite_op.sync_fn.benchmark'
+func.func @composite_op.sync_fn.benchmark() {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %x = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1 : i32] } : 1
+  %fn_op = "corert.make_composite_op" () {fn=@sync_add4} : () -> !corert.op
+
+  tfrt_test.benchmark "composite_op.sync_fn"(
+    %fn_op : !corert.op, %x : !corert.tensorhandle
+  ) duration_secs = 3, max_count = 1000000, num_warmup_runs = 10 {
+    %y = "corert.execute_crt_op" (%fn_op, %x) {op_attrs = [], op_func_attrs = []} : (!corert.op, !corert.tensorhandle) -> (!corert.tensorhandle)
+    tfrt.return %y : !corert.tensorhandle
+  }
+
+  tfrt.return
+}
@@ -12,7 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// RUN: bef_executor --test_init_function=register_op_handlers_cpu %s.bef
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu %s.bef | FileCheck %s
 
 func.func @register_op_handlers_cpu() {
   %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
@@ -62,3 +62,34 @@ func.func @corert.composite_op_async_output() -> !tfrt.chain {
 
   tfrt.return %ch1 : !tfrt.chain
 }
+
+func.func @sync_add(%x: !corert.tensorhandle, %y: !corert.tensorhandle) -> !corert.tensorhandle attributes {tfrt.sync} {
+  %cpu = corert_sync.get_op_handler "cpu"
+  %z = corert_sync.executeop(%cpu) "tfrt_test.add"(%x, %y) : 1
+  tfrt.return %z : !corert.tensorhandle
+}
+
+// CHECK-LABEL: --- Running 'corert.composite_op_sync'
+func.func @corert.composite_op_sync() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %a_handle = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2, 2], values = [1 : i32] } : 1
+
+  %fn_op = "corert.make_composite_op" () {fn=@sync_add} : () -> !corert.op
+
+  // The arguments are available, the function runs inline.
+  %b_handle = "corert.execute_crt_op" (%fn_op, %a_handle, %a_handle) {op_attrs =[], op_func_attrs = []} : (!corert.op, !corert.tensorhandle, !corert.tensorhandle) -> (!corert.tensorhandle)
+
+  // CHECK: DenseHostTensor dtype = i32, shape = [2, 2], values = [2, 2, 2, 2]
+  %ch1 = "corert.print_tensorhandle"(%b_handle, %ch0) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+
+  // The argument is not available, the function runs when it is.
+  %async_handle = corert.executeop(%cpu) "tfrt_test.async.noop"(%b_handle) : 1
+  %c_handle = "corert.execute_crt_op" (%fn_op, %async_handle, %a_handle) {op_attrs =[], op_func_attrs = []} : (!corert.op, !corert.tensorhandle, !corert.tensorhandle) -> (!corert.tensorhandle)
+
+  // CHECK: DenseHostTensor dtype = i32, shape = [2, 2], values = [3, 3, 3, 3]
+  %ch2 = "corert.print_tensorhandle"(%c_handle, %ch1) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch2 : !tfrt.chain
+}
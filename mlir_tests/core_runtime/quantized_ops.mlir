@@ -0,0 +1,123 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu %s.bef | FileCheck %s
+
+func.func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+
+// The operands are quantized with one level per unit and a zero zero point,
+// so the int32 products dequantize to the exact float products.
+// CHECK-LABEL: --- Running 'quantized_matmul'
+func.func @quantized_matmul() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2, 2], values = [1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32] } : 1
+  %b = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2, 2], values = [1.0 : f32, -1.0 : f32, 2.0 : f32, 0.0 : f32] } : 1
+  %a_min = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [0.0 : f32] } : 1
+  %a_max = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [255.0 : f32] } : 1
+  %b_min = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [-128.0 : f32] } : 1
+  %b_max = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [127.0 : f32] } : 1
+
+  %qa, %qa_min, %qa_max = corert.executeop(%cpu)
+    "tf.QuantizeV2"(%a, %a_min, %a_max) { T = !corert.quint8, mode = "MIN_FIRST" } : 3
+  %qb, %qb_min, %qb_max = corert.executeop(%cpu)
+    "tf.QuantizeV2"(%b, %b_min, %b_max) { T = !corert.qint8, mode = "MIN_FIRST" } : 3
+
+  %qc, %qc_min, %qc_max = corert.executeop(%cpu)
+    "tf.QuantizedMatMul"(%qa, %qb, %qa_min, %qa_max, %qb_min, %qb_max)
+    { transpose_a = false, transpose_b = false, Toutput = !corert.qint32 } : 3
+
+  %c = corert.executeop(%cpu)
+    "tf.Dequantize"(%qc, %qc_min, %qc_max) { mode = "MIN_FIRST" } : 1
+
+  // CHECK: DenseHostTensor dtype = f32, shape = [2, 2], values = [5.000000e+00, -1.000000e+00, 1.100000e+01, -3.000000e+00]
+  %ch1 = "corert.print_tensorhandle"(%c, %ch0) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// The packed constant weight is reused by the second MatMul.
+// CHECK-LABEL: --- Running 'quantized_matmul_const_weight'
+func.func @quantized_matmul_const_weight() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2, 2], values = [1.0 : f32, 2.0 : f32, 3.0 : f32, 4.0 : f32] } : 1
+  %b = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2, 2], values = [1.0 : f32, -1.0 : f32, 2.0 : f32, 0.0 : f32] } : 1
+  %a_min = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [0.0 : f32] } : 1
+  %a_max = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [255.0 : f32] } : 1
+  %b_min = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [-128.0 : f32] } : 1
+  %b_max = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [127.0 : f32] } : 1
+
+  %qa, %qa_min, %qa_max = corert.executeop(%cpu)
+    "tf.QuantizeV2"(%a, %a_min, %a_max) { T = !corert.quint8, mode = "MIN_FIRST" } : 3
+  %qb, %qb_min, %qb_max = corert.executeop(%cpu)
+    "tf.QuantizeV2"(%b, %b_min, %b_max) { T = !corert.qint8, mode = "MIN_FIRST" } : 3
+
+  %qc0, %qc0_min, %qc0_max = corert.executeop(%cpu)
+    "tf.QuantizedMatMul"(%qa, %qb, %qa_min, %qa_max, %qb_min, %qb_max)
+    { transpose_a = false, transpose_b = true, Toutput = !corert.qint32, is_weight_const = true } : 3
+  %qc1, %qc1_min, %qc1_max = corert.executeop(%cpu)
+    "tf.QuantizedMatMul"(%qa, %qb, %qa_min, %qa_max, %qb_min, %qb_max)
+    { transpose_a = false, transpose_b = true, Toutput = !corert.qint32, is_weight_const = true } : 3
+
+  %c0 = corert.executeop(%cpu)
+    "tf.Dequantize"(%qc0, %qc0_min, %qc0_max) { mode = "MIN_FIRST" } : 1
+  %c1 = corert.executeop(%cpu)
+    "tf.Dequantize"(%qc1, %qc1_min, %qc1_max) { mode = "MIN_FIRST" } : 1
+
+  // CHECK: DenseHostTensor dtype = f32, shape = [2, 2], values = [-1.000000e+00, 2.000000e+00, -1.000000e+00, 6.000000e+00]
+  %ch1 = "corert.print_tensorhandle"(%c0, %ch0) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+  // CHECK: DenseHostTensor dtype = f32, shape = [2, 2], values = [-1.000000e+00, 2.000000e+00, -1.000000e+00, 6.000000e+00]
+  %ch2 = "corert.print_tensorhandle"(%c1, %ch1) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'quantize_requires_mode'
+func.func @quantize_requires_mode() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1.0 : f32] } : 1
+  %min = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [0.0 : f32] } : 1
+  %max = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [], values = [255.0 : f32] } : 1
+
+  // expected-error @+1 {{runtime error: missing quantization mode}}
+  %qa, %qa_min, %qa_max = corert.executeop(%cpu)
+    "tf.QuantizeV2"(%a, %min, %max) { T = !corert.quint8 } : 3
+
+  tfrt.return %ch0 : !tfrt.chain
+}
@@ -23,6 +23,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "tfrt/bef_executor_driver/bef_executor_driver.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/memory_budget.h"
 #include "tfrt/tracing/tracing.h"
 
 static llvm::cl::opt<std::string> cl_input_filename(  // NOLINT
@@ -77,6 +78,13 @@ static llvm::cl::opt<tfrt::tracing::TracingLevel> cl_tracing_level(  // NOLINT
         clEnumValN(tfrt::tracing::TracingLevel::Debug, "debug", "debug")),
     llvm::cl::init(tfrt::tracing::TracingLevel::Default));
 
+// Enable memory bounded scheduling with the given budget.
+static llvm::cl::opt<uint64_t> cl_memory_budget_bytes(  // NOLINT
+    "memory_budget_bytes",
+    llvm::cl::desc("Defer allocating kernels when the outstanding host memory "
+                   "exceeds this many bytes (0 disables the budget)."),
+    llvm::cl::init(0));
+
 // Print error code if there's any error.
 static llvm::cl::opt<bool> cl_print_error_code(  // NOLINT
     "print_error_code",
@@ -100,6 +108,12 @@ int main(int argc, char** argv) {
   run_config.host_allocator_type = cl_host_allocator_type;
   run_config.print_error_code = cl_print_error_code;
 
+  std::optional<tfrt::MemoryBudget> memory_budget;
+  if (cl_memory_budget_bytes > 0) {
+    memory_budget.emplace(cl_memory_budget_bytes);
+    run_config.memory_budget = &*memory_budget;
+  }
+
   std::optional<tfrt::tracing::TracingRequester> tracing;
   if (cl_enable_tracing) tracing.emplace();
   tfrt::tracing::SetTracingLevel(cl_tracing_level);